@@ -26,10 +26,12 @@ static inline void *dma_alloc_coherent(size_t len, unsigned long *handle)
 	return (void *)(*handle | IO_REGION_BASE);
 }
 
+#define DMA_ALIGNMENT	DCACHE_LINE_SIZE
+
 #define dma_alloc dma_alloc
 static inline void *dma_alloc(size_t size)
 {
-	return xmemalign(DCACHE_LINE_SIZE, ALIGN(size, DCACHE_LINE_SIZE));
+	return xmemalign(DMA_ALIGNMENT, ALIGN(size, DMA_ALIGNMENT));
 }
 
 #endif /* __ASM_NIOS2_DMA_MAPPING_H */
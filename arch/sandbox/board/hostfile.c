@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <mach/hostfile.h>
 #include <xfuncs.h>
+#include <fs.h>
 
 struct hf_priv {
 	struct cdev cdev;
@@ -39,6 +40,14 @@ static ssize_t hf_read(struct cdev *cdev, void *buf, size_t count, loff_t offset
 	struct hf_platform_data *hf = cdev->priv;
 	int fd = hf->fd;
 
+	if (hf->base) {
+		if (offset >= hf->size)
+			return 0;
+		count = min_t(size_t, count, hf->size - offset);
+		memcpy(buf, (void *)hf->base + offset, count);
+		return count;
+	}
+
 	if (linux_lseek(fd, offset) != offset)
 		return -EINVAL;
 
@@ -50,12 +59,35 @@ static ssize_t hf_write(struct cdev *cdev, const void *buf, size_t count, loff_t
 	struct hf_platform_data *hf = cdev->priv;
 	int fd = hf->fd;
 
+	if (hf->base && !hf->readonly) {
+		if (offset >= hf->size)
+			return -ENOSPC;
+		count = min_t(size_t, count, hf->size - offset);
+		memcpy((void *)hf->base + offset, buf, count);
+		return count;
+	}
+
 	if (linux_lseek(fd, offset) != offset)
 		return -EINVAL;
 
 	return linux_write(fd, buf, count);
 }
 
+static int hf_memmap(struct cdev *cdev, void **map, int flags)
+{
+	struct hf_platform_data *hf = cdev->priv;
+
+	if (!hf->base)
+		return -EINVAL;
+
+	if ((flags & PROT_WRITE) && hf->readonly)
+		return -EACCES;
+
+	*map = (void *)hf->base;
+
+	return 0;
+}
+
 static void hf_info(struct device_d *dev)
 {
 	struct hf_platform_data *hf = dev->platform_data;
@@ -67,6 +99,7 @@ static struct file_operations hf_fops = {
 	.read  = hf_read,
 	.write = hf_write,
 	.lseek = dev_lseek_default,
+	.memmap = hf_memmap,
 };
 
 static int hf_probe(struct device_d *dev)
@@ -80,6 +113,7 @@ static int hf_probe(struct device_d *dev)
 	priv->cdev.size = hf->size;
 	priv->cdev.ops = &hf_fops;
 	priv->cdev.priv = hf;
+	priv->cdev.dev = dev;
 #ifdef CONFIG_FS_DEVFS
 	devfs_create(&priv->cdev);
 #endif
@@ -106,3 +140,8 @@ int barebox_register_filedev(struct hf_platform_data *hf)
 			   IORESOURCE_MEM, hf);
 }
 
+int barebox_register_nand(struct hf_platform_data *hf)
+{
+	return !add_generic_device("sandbox_nand", DEVICE_ID_DYNAMIC, NULL,
+			hf->base, hf->size, IORESOURCE_MEM, hf);
+}
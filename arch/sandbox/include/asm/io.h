@@ -1 +1,6 @@
-/* nothing */
+#ifndef __ASM_SANDBOX_IO_H
+#define __ASM_SANDBOX_IO_H
+
+#include <asm-generic/io.h>
+
+#endif /* __ASM_SANDBOX_IO_H */
@@ -4,12 +4,15 @@
 struct hf_platform_data {
 	int fd;
 	size_t size;
-	unsigned long base;
+	unsigned long base;	/* host mapping of the file, 0 if not mapped */
+	int readonly;
 	char *filename;
 	char *name;
+	char *options;		/* driver specific options */
 };
 
 int barebox_register_filedev(struct hf_platform_data *hf);
+int barebox_register_nand(struct hf_platform_data *hf);
 
 #endif /* __ASM_ARCH_HOSTFILE_H */
 
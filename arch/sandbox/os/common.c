@@ -235,6 +235,9 @@ static int add_image(char *str, char *name)
 	fd = open(file, readonly ? O_RDONLY : O_RDWR);
 	hf->fd = fd;
 	hf->filename = file;
+	hf->readonly = readonly;
+	hf->base = 0;
+	hf->options = NULL;
 
 	if (fd < 0) {
 		perror("open");
@@ -253,8 +256,10 @@ static int add_image(char *str, char *name)
 		hf->base = (unsigned long)mmap(NULL, hf->size,
 				PROT_READ | (readonly ? 0 : PROT_WRITE),
 				MAP_SHARED, fd, 0);
-		if ((void *)hf->base == MAP_FAILED)
+		if ((void *)hf->base == MAP_FAILED) {
 			printf("warning: mmapping %s failed\n", file);
+			hf->base = 0;
+		}
 	}
 
 	ret = barebox_register_filedev(hf);
@@ -269,6 +274,58 @@ err_out:
 	return -1;
 }
 
+static int add_nand(char *str)
+{
+	char *file;
+	struct stat s;
+	int fd;
+	struct hf_platform_data *hf = calloc(1, sizeof(struct hf_platform_data));
+
+	if (!hf)
+		return -1;
+
+	file = strtok(str, ",");
+	hf->options = strtok(NULL, "");
+
+	printf("add nand %s\n", file);
+
+	fd = open(file, O_RDWR);
+	hf->fd = fd;
+	hf->filename = file;
+
+	if (fd < 0) {
+		perror("open");
+		goto err_out;
+	}
+
+	if (fstat(fd, &s)) {
+		perror("fstat");
+		goto err_out;
+	}
+
+	hf->size = s.st_size;
+	hf->name = strdup("nand");
+
+	/* the simulator works on the mapping only */
+	hf->base = (unsigned long)mmap(NULL, hf->size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+	if ((void *)hf->base == MAP_FAILED) {
+		printf("mmapping %s failed\n", file);
+		goto err_out;
+	}
+
+	if (barebox_register_nand(hf))
+		goto err_out;
+
+	return 0;
+
+err_out:
+	if (fd > 0)
+		close(fd);
+	free(hf);
+	return -1;
+}
+
 static void print_usage(const char*);
 
 int main(int argc, char *argv[])
@@ -294,10 +351,11 @@ int main(int argc, char *argv[])
 			{"env",    1, 0, 'e'},
 			{"stdout", 1, 0, 'O'},
 			{"stdin",  1, 0, 'I'},
+			{"nand",   1, 0, 'n'},
 			{0, 0, 0, 0},
 		};
 
-		opt = getopt_long(argc, argv, "hi:e:O:I:",
+		opt = getopt_long(argc, argv, "hi:e:O:I:n:",
 			long_options, &option_index);
 
 		if (opt == -1)
@@ -346,6 +404,11 @@ int main(int argc, char *argv[])
 
 			barebox_register_console("cin", fd, -1);
 			break;
+		case 'n':
+			ret = add_nand(optarg);
+			if (ret)
+				exit(1);
+			break;
 		default:
 			exit(1);
 		}
@@ -382,7 +445,14 @@ static void print_usage(const char *prgname)
 "  -O, --stdout=<file>  Register a file as a console capable of doing stdout.\n"
 "                       <file> can be a regular file or a FIFO.\n"
 "  -I, --stdin=<file>   Register a file as a console capable of doing stdin.\n"
-"                       <file> can be a regular file or a FIFO.\n",
+"                       <file> can be a regular file or a FIFO.\n"
+"  -n, --nand=<file>[,<opt>=<val>...]\n"
+"                       Simulate a NAND chip with <file> as flash array. The\n"
+"                       file holds (pagesize + oobsize) bytes per page.\n"
+"                       Options are pagesize (2048), oobsize (64),\n"
+"                       erasesize (128k) and bad=<block>[:<block>...] to\n"
+"                       mark blocks as factory bad. The chip shows up as\n"
+"                       /dev/nand0.\n",
 	prgname
 	);
 }
@@ -422,6 +492,20 @@ static void print_usage(const char *prgname)
  * Register \<file\> as a console capable of doing stdin. \<file\> can be a regular
  * file or a fifo.
  *
+ * -n \<file\>[,\<opt\>=\<val\>...]
+ *
+ * Simulate a NAND chip with \<file\> as flash array, the chip shows up as
+ * /dev/nand0. The file holds page data and oob of each page interleaved, so
+ * for a 64MiB chip with 2048 byte pages and 64 byte oob it must have a size
+ * of 64MiB / 2048 * (2048 + 64) bytes. An erased chip is generated with
+ *
+ * $ dd if=/dev/zero bs=2112 count=32768 | tr '\\000' '\\377' > nand.img
+ *
+ * The options pagesize, oobsize and erasesize set the geometry,
+ * bad=\<block\>[:\<block\>...] marks blocks as factory bad. The timing model,
+ * bitflip injection and the operation counters are parameters of the
+ * sandbox_nand device, see 'devinfo sandbox_nand0'.
+ *
  * @section simu_dbg How to debug barebox simulator
  *
  */
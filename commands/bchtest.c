@@ -0,0 +1,222 @@
+/*
+ * bchtest.c - test and benchmark the BCH library
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <malloc.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <clock.h>
+#include <linux/bch.h>
+
+struct bchtest_params {
+	int m, t;
+	unsigned int size;
+};
+
+/* (m,t) and data size of the usual NAND configurations */
+static const struct bchtest_params bchtest_default[] = {
+	{ .m = 13, .t = 4, .size = 512 },
+	{ .m = 13, .t = 8, .size = 512 },
+	{ .m = 13, .t = 16, .size = 512 },
+	{ .m = 14, .t = 24, .size = 1024 },
+};
+
+/*
+ * Flip a bit of the code word, numbered like the error locations of
+ * decode_bch(): the data bits first, then the ECC bits.
+ */
+static void bchtest_flip_bit(uint8_t *data, unsigned int size, uint8_t *ecc,
+		unsigned int pos)
+{
+	if (pos < 8 * size)
+		data[pos >> 3] ^= 1 << (pos & 7);
+	else
+		ecc[(pos >> 3) - size] ^= 1 << (pos & 7);
+}
+
+/* flip nerr distinct random bits, necc of them in the ECC */
+static void bchtest_flip(struct bch_control *bch, uint8_t *data,
+		unsigned int size, uint8_t *ecc, unsigned int *pos, int nerr,
+		int necc)
+{
+	unsigned int bit;
+	int i, j;
+
+	for (i = 0; i < nerr; i++) {
+again:
+		bit = (rand() << 15) | rand();
+		if (i < necc) {
+			/* the ECC is stored MSB first, skip the padding bits */
+			bit %= bch->ecc_bits;
+			pos[i] = 8 * size + ((bit & ~7) | (7 - (bit & 7)));
+		} else {
+			pos[i] = bit % (size * 8);
+		}
+		for (j = 0; j < i; j++)
+			if (pos[j] == pos[i])
+				goto again;
+		bchtest_flip_bit(data, size, ecc, pos[i]);
+	}
+}
+
+static int bchtest_one(const struct bchtest_params *p, int loops, int nerr)
+{
+	struct bch_control *bch;
+	uint8_t *data, *ref, *ecc, *ecc_ref;
+	unsigned int *errloc, *pos;
+	uint64_t start, t_enc = 0, t_clean = 0, t_err = 0;
+	uint64_t bytes = (uint64_t)p->size * loops;
+	int i, j, n, failed = 0, ret = 0;
+
+	bch = init_bch(p->m, p->t, 0);
+	if (!bch) {
+		printf("m=%d t=%d not supported\n", p->m, p->t);
+		return -EINVAL;
+	}
+
+	if (8 * p->size > bch->n - bch->ecc_bits) {
+		printf("%u bytes too large for m=%d t=%d\n", p->size,
+				p->m, p->t);
+		ret = -EINVAL;
+		goto out_bch;
+	}
+
+	if (nerr < 0 || nerr > p->t)
+		nerr = p->t;
+
+	data = xmalloc(p->size);
+	ref = xmalloc(p->size);
+	ecc = xmalloc(bch->ecc_bytes);
+	ecc_ref = xmalloc(bch->ecc_bytes);
+	errloc = xmalloc(p->t * sizeof(*errloc));
+	pos = xmalloc(p->t * sizeof(*pos));
+
+	get_random_bytes((char *)ref, p->size);
+
+	for (i = 0; i < loops; i++) {
+		start = get_time_ns();
+		memset(ecc_ref, 0, bch->ecc_bytes);
+		encode_bch(bch, ref, p->size, ecc_ref);
+		t_enc += get_time_ns() - start;
+
+		start = get_time_ns();
+		n = decode_bch(bch, ref, p->size, ecc_ref, NULL, NULL, errloc);
+		t_clean += get_time_ns() - start;
+		if (n)
+			failed++;
+
+		/* go through all mixes of data and ECC errors */
+		memcpy(data, ref, p->size);
+		memcpy(ecc, ecc_ref, bch->ecc_bytes);
+		bchtest_flip(bch, data, p->size, ecc, pos, nerr,
+				i % (nerr + 1));
+
+		start = get_time_ns();
+		n = decode_bch(bch, data, p->size, ecc, NULL, NULL, errloc);
+		for (j = 0; j < n; j++)
+			bchtest_flip_bit(data, p->size, ecc, errloc[j]);
+		t_err += get_time_ns() - start;
+
+		if (n != nerr || memcmp(data, ref, p->size) ||
+				memcmp(ecc, ecc_ref, bch->ecc_bytes))
+			failed++;
+
+		if (ctrlc()) {
+			ret = -EINTR;
+			goto out;
+		}
+	}
+
+	printf("m=%d t=%d, %u bytes, %d errors:%s\n", p->m, p->t, p->size,
+			nerr, failed ? "" : " ok");
+	if (failed)
+		printf("  %d of %d decodes failed\n", failed, 2 * loops);
+	print_rate("encode", bytes, t_enc);
+	print_rate("decode", bytes, t_clean);
+	print_rate("decode+correct", bytes, t_err);
+
+	if (failed)
+		ret = -EIO;
+out:
+	free(pos);
+	free(errloc);
+	free(ecc_ref);
+	free(ecc);
+	free(ref);
+	free(data);
+out_bch:
+	free_bch(bch);
+
+	return ret;
+}
+
+static int do_bchtest(int argc, char *argv[])
+{
+	struct bchtest_params p = { .m = 0, .t = 0, .size = 512 };
+	int opt, i, loops = 1000, nerr = -1, ret = 0;
+
+	while ((opt = getopt(argc, argv, "m:t:s:n:e:")) > 0) {
+		switch (opt) {
+		case 'm':
+			p.m = simple_strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			p.t = simple_strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			p.size = simple_strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			loops = simple_strtoul(optarg, NULL, 0);
+			break;
+		case 'e':
+			nerr = simple_strtoul(optarg, NULL, 0);
+			break;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
+
+	if (!p.m != !p.t || !p.size || loops < 1)
+		return COMMAND_ERROR_USAGE;
+
+	if (p.m)
+		return bchtest_one(&p, loops, nerr) ? 1 : 0;
+
+	for (i = 0; i < ARRAY_SIZE(bchtest_default); i++) {
+		ret = bchtest_one(&bchtest_default[i], loops, nerr);
+		if (ret == -EINTR)
+			break;
+	}
+
+	return ret ? 1 : 0;
+}
+
+BAREBOX_CMD_HELP_START(bchtest)
+BAREBOX_CMD_HELP_USAGE("bchtest [OPTIONS]\n")
+BAREBOX_CMD_HELP_SHORT("Encode random data, flip bits of the data and the ECC,\n")
+BAREBOX_CMD_HELP_SHORT("decode it again and print the encoder/decoder throughput.\n")
+BAREBOX_CMD_HELP_SHORT("Without -m/-t the common NAND configurations are tested.\n")
+BAREBOX_CMD_HELP_OPT  ("-m <m>",  "Galois field order\n")
+BAREBOX_CMD_HELP_OPT  ("-t <t>",  "number of correctable bits\n")
+BAREBOX_CMD_HELP_OPT  ("-s <size>",  "data size in bytes (512)\n")
+BAREBOX_CMD_HELP_OPT  ("-n <loops>",  "number of iterations (1000)\n")
+BAREBOX_CMD_HELP_OPT  ("-e <errors>",  "bits to flip per iteration (t)\n")
+BAREBOX_CMD_HELP_END
+
+BAREBOX_CMD_START(bchtest)
+	.cmd		= do_bchtest,
+	.usage		= "test and benchmark the BCH library",
+	BAREBOX_CMD_HELP(cmd_bchtest_help)
+BAREBOX_CMD_END
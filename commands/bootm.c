@@ -63,20 +63,12 @@ int register_image_handler(struct image_handler *handler)
 
 static int bootm_open_os_uimage(struct image_data *data)
 {
-	int ret;
-
 	data->os = uimage_open(data->os_file);
 	if (!data->os)
 		return -EINVAL;
 
-	if (data->verify) {
-		ret = uimage_verify(data->os);
-		if (ret) {
-			printf("Checking data crc failed with %s\n",
-					strerror(-ret));
-			return ret;
-		}
-	}
+	/* the data crc is checked when the image is loaded */
+	data->os->verify = data->verify;
 
 	uimage_print_contents(data->os);
 
@@ -101,8 +93,6 @@ static int bootm_open_os_uimage(struct image_data *data)
 
 static int bootm_open_initrd_uimage(struct image_data *data)
 {
-	int ret;
-
 	if (!data->initrd_file)
 		return 0;
 
@@ -111,13 +101,9 @@ static int bootm_open_initrd_uimage(struct image_data *data)
 		if (!data->initrd)
 			return -EINVAL;
 
-		if (data->verify) {
-			ret = uimage_verify(data->initrd);
-			if (ret) {
-				printf("Checking data crc failed with %s\n",
-					strerror(-ret));
-			}
-		}
+		/* like for the OS a bad crc makes the boot fail */
+		data->initrd->verify = data->verify;
+
 		uimage_print_contents(data->initrd);
 	} else {
 		data->initrd = data->os;
@@ -381,9 +367,9 @@ static int do_bootm(int argc, char *argv[])
 			printf(", multifile image %d", data.os_num);
 		printf("\n");
 		if (data.os_res)
-			printf("OS image is at 0x%08x-0x%08x\n",
-					data.os_res->start,
-					data.os_res->end);
+			printf("OS image is at 0x%08llx-0x%08llx\n",
+					(unsigned long long)data.os_res->start,
+					(unsigned long long)data.os_res->end);
 		else
 			printf("OS image not yet relocated\n");
 
@@ -396,9 +382,9 @@ static int do_bootm(int argc, char *argv[])
 				printf(", multifile image %d", data.initrd_num);
 			printf("\n");
 			if (data.initrd_res)
-				printf("initrd is at 0x%08x-0x%08x\n",
-					data.initrd_res->start,
-					data.initrd_res->end);
+				printf("initrd is at 0x%08llx-0x%08llx\n",
+					(unsigned long long)data.initrd_res->start,
+					(unsigned long long)data.initrd_res->end);
 			else
 				printf("initrd image not yet relocated\n");
 		}
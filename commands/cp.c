@@ -30,9 +30,164 @@
 #include <linux/stat.h>
 #include <libbb.h>
 #include <fs.h>
+#include <fcntl.h>
 #include <malloc.h>
 #include <libgen.h>
 #include <getopt.h>
+#include <digest.h>
+#include <errno.h>
+#include <linux/ctype.h>
+
+#define CP_MAX_DIGESTS	4
+
+struct cp_digest {
+	struct digest *d;
+	unsigned char *expected;
+};
+
+#ifdef CONFIG_CMD_CP_DIGEST
+static int cp_hex_to_bin(unsigned char *dst, const char *src, int len)
+{
+	int i;
+
+	if (strlen(src) != len * 2)
+		return -EINVAL;
+
+	for (i = 0; i < len * 2; i++) {
+		int c = tolower(src[i]);
+
+		if (!isxdigit(c))
+			return -EINVAL;
+
+		c = isdigit(c) ? c - '0' : c - 'a' + 10;
+		if (i & 1)
+			dst[i / 2] |= c;
+		else
+			dst[i / 2] = c << 4;
+	}
+
+	return 0;
+}
+
+/*
+ * parse a <algo>:<hash> argument
+ */
+static int cp_add_digest(struct cp_digest *cd, char *arg)
+{
+	char *hash;
+
+	hash = strchr(arg, ':');
+	if (!hash) {
+		printf("cp: expected <algo>:<hash>, got %s\n", arg);
+		return -EINVAL;
+	}
+
+	*hash++ = 0;
+
+	cd->d = digest_alloc(arg);
+	if (!cd->d) {
+		printf("cp: unknown digest %s\n", arg);
+		return -ENOENT;
+	}
+
+	cd->expected = xmalloc(digest_length(cd->d));
+
+	if (cp_hex_to_bin(cd->expected, hash, digest_length(cd->d))) {
+		printf("cp: invalid %s hash %s\n", arg, hash);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int cp_check_digests(struct cp_digest *cd, int num)
+{
+	unsigned char *hash;
+	int i, j, ret = 0;
+
+	for (i = 0; i < num; i++) {
+		hash = xmalloc(digest_length(cd[i].d));
+
+		digest_final(cd[i].d, hash);
+
+		if (memcmp(hash, cd[i].expected, digest_length(cd[i].d))) {
+			printf("cp: %s mismatch: ", cd[i].d->algo->name);
+			for (j = 0; j < digest_length(cd[i].d); j++)
+				printf("%02x", hash[j]);
+			printf("\n");
+			ret = -EBADMSG;
+		}
+
+		free(hash);
+	}
+
+	return ret;
+}
+
+/*
+ * The data has already been written when the digests are checked, so
+ * make sure it is not used: files are removed, devices are erased.
+ */
+static void cp_invalidate(const char *dst)
+{
+	struct stat s;
+	int fd, ret;
+
+	if (stat(dst, &s))
+		return;
+
+	if (!S_ISCHR(s.st_mode)) {
+		if (unlink(dst))
+			printf("cp: could not remove %s: %s\n", dst,
+					errno_str());
+		return;
+	}
+
+	fd = open(dst, O_WRONLY);
+	if (fd < 0) {
+		printf("cp: could not open %s: %s\n", dst, errno_str());
+		return;
+	}
+
+	ret = erase(fd, ~0, 0);
+	if (ret)
+		printf("cp: could not erase %s: %s, it contains bad data\n",
+				dst, strerror(-ret));
+
+	close(fd);
+}
+
+static void cp_free_digests(struct cp_digest *cd, int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		free(cd[i].expected);
+		digest_free(cd[i].d);
+	}
+}
+#else
+static inline int cp_add_digest(struct cp_digest *cd, char *arg)
+{
+	cd->d = NULL;
+	printf("cp: digest support not available\n");
+
+	return -ENOSYS;
+}
+
+static inline int cp_check_digests(struct cp_digest *cd, int num)
+{
+	return 0;
+}
+
+static inline void cp_invalidate(const char *dst)
+{
+}
+
+static inline void cp_free_digests(struct cp_digest *cd, int num)
+{
+}
+#endif
 
 /**
  * @param[in] argc Argument count from command line
@@ -45,21 +200,54 @@ static int do_cp(int argc, char *argv[])
 	int last_is_dir = 0;
 	int i;
 	int opt;
-	int verbose = 0;
+	char *dst;
+	unsigned flags = 0;
 	int argc_min;
+	struct cp_digest cd[CP_MAX_DIGESTS];
+	struct digest *digests[CP_MAX_DIGESTS];
+	int num_digests = 0;
 
-	while ((opt = getopt(argc, argv, "v")) > 0) {
+	while ((opt = getopt(argc, argv, "vuec:")) > 0) {
 		switch (opt) {
 		case 'v':
-			verbose = 1;
+			flags |= COPY_FILE_VERBOSE;
+			break;
+		case 'u':
+			flags |= COPY_FILE_UNCOMPRESS;
+			break;
+		case 'e':
+			flags |= COPY_FILE_ERASE;
+			break;
+		case 'c':
+			if (num_digests == CP_MAX_DIGESTS) {
+				printf("cp: too many digests\n");
+				goto out;
+			}
+			ret = cp_add_digest(&cd[num_digests], optarg);
+			if (cd[num_digests].d) {
+				digests[num_digests] = cd[num_digests].d;
+				num_digests++;
+			}
+			if (ret) {
+				ret = 1;
+				goto out;
+			}
 			break;
 		}
 	}
 
 	argc_min = optind + 2;
 
-	if (argc < argc_min)
-		return COMMAND_ERROR_USAGE;
+	if (argc < argc_min) {
+		ret = COMMAND_ERROR_USAGE;
+		goto out;
+	}
+
+	if (num_digests && argc > argc_min) {
+		printf("cp: digests can only be checked for a single file\n");
+		ret = 1;
+		goto out;
+	}
 
 	if (!stat(argv[argc - 1], &statbuf)) {
 		if (S_ISDIR(statbuf.st_mode))
@@ -68,32 +256,54 @@ static int do_cp(int argc, char *argv[])
 
 	if (argc > argc_min && !last_is_dir) {
 		printf("cp: target `%s' is not a directory\n", argv[argc - 1]);
-		return 1;
+		ret = 1;
+		goto out;
 	}
 
+	for (i = 0; i < num_digests; i++)
+		digest_init(digests[i]);
+
 	for (i = optind; i < argc - 1; i++) {
-		if (last_is_dir) {
-			char *dst;
+		if (last_is_dir)
 			dst = concat_path_file(argv[argc - 1], basename(argv[i]));
-			ret = copy_file(argv[i], dst, verbose);
+		else
+			dst = xstrdup(argv[argc - 1]);
+
+		ret = copy_file_flags(argv[i], dst, flags,
+				digests, num_digests);
+		if (ret) {
 			free(dst);
-			if (ret)
-				goto out;
-		} else {
-			ret = copy_file(argv[i], argv[argc - 1], verbose);
-			if (ret)
-				goto out;
+			goto out;
 		}
-	}
 
-	ret = 0;
+		/* digests are only allowed with a single source */
+		ret = cp_check_digests(cd, num_digests);
+		if (ret)
+			cp_invalidate(dst);
+
+		free(dst);
+		if (ret)
+			goto out;
+	}
 out:
+	cp_free_digests(cd, num_digests);
+
 	return ret;
 }
 
 BAREBOX_CMD_HELP_START(cp)
-BAREBOX_CMD_HELP_USAGE("cp [-v] <source> <destination>\n")
+BAREBOX_CMD_HELP_USAGE("cp [-vue] [-c <algo>:<hash>] <source> <destination>\n")
 BAREBOX_CMD_HELP_SHORT("copy file from <source> to <destination>.\n")
+BAREBOX_CMD_HELP_OPT  ("-v", "show a progress bar\n")
+#ifdef CONFIG_UNCOMPRESS
+BAREBOX_CMD_HELP_OPT  ("-u", "uncompress <source> while copying\n")
+#endif
+BAREBOX_CMD_HELP_OPT  ("-e", "erase flash in <destination> block by block while writing\n")
+#ifdef CONFIG_CMD_CP_DIGEST
+BAREBOX_CMD_HELP_OPT  ("-c <algo>:<hash>", "fail if the <algo> digest of the copied data is not <hash>.\n")
+BAREBOX_CMD_HELP_OPT  ("", "May be given up to four times. On a mismatch the\n")
+BAREBOX_CMD_HELP_OPT  ("", "<destination> is removed, or erased for devices.\n")
+#endif
 BAREBOX_CMD_HELP_END
 
 /**
@@ -102,6 +312,16 @@ This command operates on files.
 
 If you want to copy between memory blocks, use 'memcpy'.
 
+The data is streamed through a small buffer, so large images can be
+copied from network filesystems to flash without loading them to RAM
+first. For example
+
+cp -u -e -c md5:<hash> /mnt/tftp/root.ubi.xz /dev/nand0.root.bb
+
+decompresses the image while it is downloaded, checks the md5 of the
+decompressed data and writes it to the partition, erasing each block
+right before it is written.
+
 \todo What does this mean? Add examples.
  */
 
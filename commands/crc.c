@@ -29,16 +29,22 @@
 #include <xfuncs.h>
 #include <malloc.h>
 #include <linux/ctype.h>
+#include <clock.h>
+#include <asm-generic/div64.h>
+#include <dma.h>
 
 static int file_crc(char* filename, ulong start, ulong size, ulong *crc,
-		    ulong *total)
+		    ulong *total, uint64_t *crc_ns)
 {
 	int fd, now;
 	int ret = 0;
 	char *buf;
+	uint64_t t, ctrlc_start;
+	const ulong bufsize = CONFIG_CHECKSUM_BUF_SIZE * 1024;
 
 	*total = 0;
 	*crc = 0;
+	*crc_ns = 0;
 
 	fd = open(filename, O_RDONLY);
 	if (fd < 0) {
@@ -54,10 +60,16 @@ static int file_crc(char* filename, ulong start, ulong size, ulong *crc,
 		}
 	}
 
-	buf = xmalloc(4096);
+	buf = dma_alloc(bufsize);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ctrlc_start = get_time_ns();
 
 	while (size) {
-		now = min((ulong)4096, size);
+		now = min(bufsize, size);
 		now = read(fd, buf, now);
 		if (now < 0) {
 			ret = now;
@@ -66,7 +78,17 @@ static int file_crc(char* filename, ulong start, ulong size, ulong *crc,
 		}
 		if (!now)
 			break;
+
+		if (is_timeout(ctrlc_start, 100 * MSECOND)) {
+			if (ctrlc()) {
+				ret = -EINTR;
+				goto out_free;
+			}
+			ctrlc_start = get_time_ns();
+		}
+		t = get_time_ns();
 		*crc = crc32(*crc, buf, now);
+		*crc_ns += get_time_ns() - t;
 		size -= now;
 		*total += now;
 	}
@@ -75,13 +97,31 @@ static int file_crc(char* filename, ulong start, ulong size, ulong *crc,
 			filename, start, start + *total - 1, *crc);
 
 out_free:
-	free(buf);
+	dma_free(buf);
 out:
 	close(fd);
 
 	return ret;
 }
 
+/*
+ * print the throughput of the crc calculation itself, the time spent
+ * reading the data is not accounted.
+ */
+static void crc_print_bench(ulong total, uint64_t ns)
+{
+	uint64_t rate = (uint64_t)total * 1000000;
+	uint64_t us = ns;
+
+	do_div(us, 1000);
+	if (!us)
+		us = 1;
+	do_div(rate, us);
+
+	printf("%lu bytes in %llu us, %llu.%02llu MiB/s\n", total, us,
+			rate >> 20, ((rate & 0xfffff) * 100) >> 20);
+}
+
 static int do_crc(int argc, char *argv[])
 {
 	loff_t start = 0, size = ~0;
@@ -90,10 +130,14 @@ static int do_crc(int argc, char *argv[])
 #ifdef CONFIG_CMD_CRC_CMP
 	char *vfilename = NULL;
 #endif
-	int opt, err = 0, filegiven = 0, verify = 0;
+	int opt, err = 0, filegiven = 0, verify = 0, bench = 0;
+	uint64_t crc_ns;
 
-	while((opt = getopt(argc, argv, "f:F:v:")) > 0) {
+	while((opt = getopt(argc, argv, "f:F:v:b")) > 0) {
 		switch(opt) {
+		case 'b':
+			bench = 1;
+			break;
 		case 'f':
 			filename = optarg;
 			filegiven = 1;
@@ -123,14 +167,15 @@ static int do_crc(int argc, char *argv[])
 		}
 	}
 
-	if (file_crc(filename, start, size, &crc, &total) < 0)
+	if (file_crc(filename, start, size, &crc, &total, &crc_ns) < 0)
 		return 1;
 
 #ifdef CONFIG_CMD_CRC_CMP
 	if (vfilename) {
 		size = total;
 		puts("\n");
-		if (file_crc(vfilename, start, size, &vcrc, &total) < 0)
+		if (file_crc(vfilename, start, size, &vcrc, &total,
+					&crc_ns) < 0)
 			return 1;
 	}
 #endif
@@ -142,6 +187,9 @@ static int do_crc(int argc, char *argv[])
 
 	printf("\n");
 
+	if (bench)
+		crc_print_bench(total, crc_ns);
+
 	return err;
 }
 
@@ -153,6 +201,7 @@ BAREBOX_CMD_HELP_OPT  ("-f <file>", "Use file instead of memory.\n")
 BAREBOX_CMD_HELP_OPT  ("-F <file>", "Use file to compare.\n")
 #endif
 BAREBOX_CMD_HELP_OPT  ("-v <crc>",  "Verify\n")
+BAREBOX_CMD_HELP_OPT  ("-b",        "Show the crc32 throughput\n")
 BAREBOX_CMD_HELP_END
 
 BAREBOX_CMD_START(crc32)
@@ -36,15 +36,16 @@ static int do_digest(char *algorithm, int argc, char *argv[])
 	int i;
 	unsigned char *hash;
 
-	d = digest_get_by_name(algorithm);
-	BUG_ON(!d);
-
 	if (argc < 2)
 		return COMMAND_ERROR_USAGE;
 
-	hash = calloc(d->length, sizeof(unsigned char));
+	d = digest_alloc(algorithm);
+	BUG_ON(!d);
+
+	hash = calloc(digest_length(d), sizeof(unsigned char));
 	if (!hash) {
 		perror("calloc");
+		digest_free(d);
 		return COMMAND_ERROR_USAGE;
 	}
 
@@ -63,7 +64,7 @@ static int do_digest(char *algorithm, int argc, char *argv[])
 		if (digest_file_window(d, filename, hash, start, size) < 0)
 			ret = 1;
 
-		for (i = 0; i < d->length; i++)
+		for (i = 0; i < digest_length(d); i++)
 			printf("%02x", hash[i]);
 
 		printf("  %s\t0x%08llx ... 0x%08llx\n", filename, start, start + size);
@@ -72,6 +73,7 @@ static int do_digest(char *algorithm, int argc, char *argv[])
 	}
 
 	free(hash);
+	digest_free(d);
 
 	return ret;
 }
@@ -35,13 +35,14 @@
 #define NAND_ADD (1 << 0)
 #define NAND_DEL (1 << 1)
 #define NAND_MARKBAD (1 << 2)
+#define NAND_WRITEBBT (1 << 3)
 
 static int do_nand(int argc, char *argv[])
 {
 	int opt;
 	int command = 0, badblock = 0;
 
-	while((opt = getopt(argc, argv, "adb:")) > 0) {
+	while((opt = getopt(argc, argv, "adb:w")) > 0) {
 		if (command) {
 			printf("only one command may be given\n");
 			return 1;
@@ -57,6 +58,10 @@ static int do_nand(int argc, char *argv[])
 		case 'b':
 			command = NAND_MARKBAD;
 			badblock = simple_strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			command = NAND_WRITEBBT;
+			break;
 		}
 	}
 
@@ -79,6 +84,7 @@ static int do_nand(int argc, char *argv[])
 	if (command & NAND_MARKBAD) {
 		if (optind < argc) {
 			int ret = 0, fd;
+			loff_t ofs = badblock;
 
 			printf("marking block at 0x%08x on %s as bad\n", badblock, argv[optind]);
 
@@ -88,7 +94,7 @@ static int do_nand(int argc, char *argv[])
 				return 1;
 			}
 
-			ret = ioctl(fd, MEMSETBADBLOCK, (void *)badblock);
+			ret = ioctl(fd, MEMSETBADBLOCK, &ofs);
 			if (ret)
 				perror("ioctl");
 
@@ -97,6 +103,29 @@ static int do_nand(int argc, char *argv[])
 		}
 	}
 
+	if (command & NAND_WRITEBBT) {
+		while (optind < argc) {
+			int ret, fd;
+
+			fd = open(argv[optind], O_RDWR);
+			if (fd < 0) {
+				perror("open");
+				return 1;
+			}
+
+			/* writes a bad block table created on demand */
+			ret = flush(fd);
+			if (ret)
+				perror("flush");
+
+			close(fd);
+			if (ret)
+				return 1;
+
+			optind++;
+		}
+	}
+
 	return 0;
 }
 
@@ -105,7 +134,8 @@ static const __maybe_unused char cmd_nand_help[] =
 "nand related commands\n"
 "  -a  <dev>  register a bad block aware device ontop of a normal nand device\n"
 "  -d  <dev>  deregister a bad block aware device\n"
-"  -b  <ofs> <dev> mark block at offset ofs as bad\n";
+"  -b  <ofs> <dev> mark block at offset ofs as bad\n"
+"  -w  <dev>  write the bad block table to the flash\n";
 
 BAREBOX_CMD_START(nand)
 	.cmd		= do_nand,
@@ -0,0 +1,276 @@
+/*
+ * nandecctest.c - test and benchmark the NAND Hamming ECC
+ *
+ * The reference calculation is the table driven one nand_ecc.c used
+ * before, Copyright (C) 2000-2004 Steven J. Hill (sjhill@realitydiluted.com)
+ * and Toshiba America Electronics Components, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <malloc.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <clock.h>
+#include <linux/mtd/nand_ecc.h>
+
+/* the ECC is calculated over 256 byte steps */
+#define NANDECCTEST_STEP	256
+
+/*
+ * Pre-calculated 256-way 1 byte column parity
+ */
+static const u_char nand_ecc_precalc_table[] = {
+	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00,
+	0x65, 0x30, 0x33, 0x66, 0x3c, 0x69, 0x6a, 0x3f, 0x3f, 0x6a, 0x69, 0x3c, 0x66, 0x33, 0x30, 0x65,
+	0x66, 0x33, 0x30, 0x65, 0x3f, 0x6a, 0x69, 0x3c, 0x3c, 0x69, 0x6a, 0x3f, 0x65, 0x30, 0x33, 0x66,
+	0x03, 0x56, 0x55, 0x00, 0x5a, 0x0f, 0x0c, 0x59, 0x59, 0x0c, 0x0f, 0x5a, 0x00, 0x55, 0x56, 0x03,
+	0x69, 0x3c, 0x3f, 0x6a, 0x30, 0x65, 0x66, 0x33, 0x33, 0x66, 0x65, 0x30, 0x6a, 0x3f, 0x3c, 0x69,
+	0x0c, 0x59, 0x5a, 0x0f, 0x55, 0x00, 0x03, 0x56, 0x56, 0x03, 0x00, 0x55, 0x0f, 0x5a, 0x59, 0x0c,
+	0x0f, 0x5a, 0x59, 0x0c, 0x56, 0x03, 0x00, 0x55, 0x55, 0x00, 0x03, 0x56, 0x0c, 0x59, 0x5a, 0x0f,
+	0x6a, 0x3f, 0x3c, 0x69, 0x33, 0x66, 0x65, 0x30, 0x30, 0x65, 0x66, 0x33, 0x69, 0x3c, 0x3f, 0x6a,
+	0x6a, 0x3f, 0x3c, 0x69, 0x33, 0x66, 0x65, 0x30, 0x30, 0x65, 0x66, 0x33, 0x69, 0x3c, 0x3f, 0x6a,
+	0x0f, 0x5a, 0x59, 0x0c, 0x56, 0x03, 0x00, 0x55, 0x55, 0x00, 0x03, 0x56, 0x0c, 0x59, 0x5a, 0x0f,
+	0x0c, 0x59, 0x5a, 0x0f, 0x55, 0x00, 0x03, 0x56, 0x56, 0x03, 0x00, 0x55, 0x0f, 0x5a, 0x59, 0x0c,
+	0x69, 0x3c, 0x3f, 0x6a, 0x30, 0x65, 0x66, 0x33, 0x33, 0x66, 0x65, 0x30, 0x6a, 0x3f, 0x3c, 0x69,
+	0x03, 0x56, 0x55, 0x00, 0x5a, 0x0f, 0x0c, 0x59, 0x59, 0x0c, 0x0f, 0x5a, 0x00, 0x55, 0x56, 0x03,
+	0x66, 0x33, 0x30, 0x65, 0x3f, 0x6a, 0x69, 0x3c, 0x3c, 0x69, 0x6a, 0x3f, 0x65, 0x30, 0x33, 0x66,
+	0x65, 0x30, 0x33, 0x66, 0x3c, 0x69, 0x6a, 0x3f, 0x3f, 0x6a, 0x69, 0x3c, 0x66, 0x33, 0x30, 0x65,
+	0x00, 0x55, 0x56, 0x03, 0x59, 0x0c, 0x0f, 0x5a, 0x5a, 0x0f, 0x0c, 0x59, 0x03, 0x56, 0x55, 0x00
+};
+
+/* the reference: calculate the ECC of 256 bytes a byte at a time */
+static void nandecctest_calculate_ref(const u_char *dat, u_char *ecc_code)
+{
+	uint8_t idx, reg1, reg2, reg3, tmp1, tmp2;
+	int i;
+
+	/* Initialize variables */
+	reg1 = reg2 = reg3 = 0;
+
+	/* Build up column parity */
+	for(i = 0; i < 256; i++) {
+		/* Get CP0 - CP5 from table */
+		idx = nand_ecc_precalc_table[*dat++];
+		reg1 ^= (idx & 0x3f);
+
+		/* All bit XOR = 1 ? */
+		if (idx & 0x40) {
+			reg3 ^= (uint8_t) i;
+			reg2 ^= ~((uint8_t) i);
+		}
+	}
+
+	/* Create non-inverted ECC code from line parity */
+	tmp1  = (reg3 & 0x80) >> 0; /* B7 -> B7 */
+	tmp1 |= (reg2 & 0x80) >> 1; /* B7 -> B6 */
+	tmp1 |= (reg3 & 0x40) >> 1; /* B6 -> B5 */
+	tmp1 |= (reg2 & 0x40) >> 2; /* B6 -> B4 */
+	tmp1 |= (reg3 & 0x20) >> 2; /* B5 -> B3 */
+	tmp1 |= (reg2 & 0x20) >> 3; /* B5 -> B2 */
+	tmp1 |= (reg3 & 0x10) >> 3; /* B4 -> B1 */
+	tmp1 |= (reg2 & 0x10) >> 4; /* B4 -> B0 */
+
+	tmp2  = (reg3 & 0x08) << 4; /* B3 -> B7 */
+	tmp2 |= (reg2 & 0x08) << 3; /* B3 -> B6 */
+	tmp2 |= (reg3 & 0x04) << 3; /* B2 -> B5 */
+	tmp2 |= (reg2 & 0x04) << 2; /* B2 -> B4 */
+	tmp2 |= (reg3 & 0x02) << 2; /* B1 -> B3 */
+	tmp2 |= (reg2 & 0x02) << 1; /* B1 -> B2 */
+	tmp2 |= (reg3 & 0x01) << 1; /* B0 -> B1 */
+	tmp2 |= (reg2 & 0x01) << 0; /* B7 -> B0 */
+
+	/* Calculate final ECC code */
+#ifdef CONFIG_MTD_NAND_ECC_SMC
+	ecc_code[0] = ~tmp2;
+	ecc_code[1] = ~tmp1;
+#else
+	ecc_code[0] = ~tmp1;
+	ecc_code[1] = ~tmp2;
+#endif
+	ecc_code[2] = ((~reg1) << 2) | 0x03;
+}
+
+/* random data, the first loops use erased and all zero blocks */
+static void nandecctest_fill(uint8_t *data, unsigned int size, int loop)
+{
+	switch (loop) {
+	case 0:
+		memset(data, 0xff, size);
+		break;
+	case 1:
+		memset(data, 0, size);
+		break;
+	default:
+		get_random_bytes((char *)data, size);
+		break;
+	}
+}
+
+/*
+ * Flip a random bit of a step, of its data or of its ECC, and check that
+ * nand_correct_data() restores the data with either ECC.
+ */
+static int nandecctest_correct(uint8_t *data, const uint8_t *ref,
+		const uint8_t *ecc, const uint8_t *ecc_ref)
+{
+	uint8_t read_ecc[3], calc_ecc[3];
+	unsigned int bit;
+	int ret;
+
+	bit = ((rand() << 15) | rand()) % (8 * (NANDECCTEST_STEP + 3));
+
+	memcpy(data, ref, NANDECCTEST_STEP);
+	memcpy(read_ecc, ecc, sizeof(read_ecc));
+
+	if (bit < 8 * NANDECCTEST_STEP)
+		data[bit >> 3] ^= 1 << (bit & 7);
+	else
+		read_ecc[(bit >> 3) - NANDECCTEST_STEP] ^= 1 << (bit & 7);
+
+	nand_calculate_ecc(NULL, data, calc_ecc);
+	ret = nand_correct_data(NULL, data, read_ecc, calc_ecc);
+	if (ret != 1 || memcmp(data, ref, NANDECCTEST_STEP))
+		return -EIO;
+
+	/* the same with the ECC of the reference calculation */
+	memcpy(data, ref, NANDECCTEST_STEP);
+	memcpy(read_ecc, ecc_ref, sizeof(read_ecc));
+
+	if (bit < 8 * NANDECCTEST_STEP)
+		data[bit >> 3] ^= 1 << (bit & 7);
+	else
+		read_ecc[(bit >> 3) - NANDECCTEST_STEP] ^= 1 << (bit & 7);
+
+	nandecctest_calculate_ref(data, calc_ecc);
+	ret = nand_correct_data(NULL, data, read_ecc, calc_ecc);
+	if (ret != 1 || memcmp(data, ref, NANDECCTEST_STEP))
+		return -EIO;
+
+	return 0;
+}
+
+static int nandecctest_one(unsigned int size, int loops)
+{
+	uint8_t *buf, *data, *ref, *ecc, *ecc_ref;
+	unsigned int steps = size / NANDECCTEST_STEP, offset;
+	uint64_t start, t_calc = 0, t_ref = 0;
+	uint64_t bytes = (uint64_t)size * loops;
+	int i, j, ecc_failed = 0, correct_failed = 0, ret = 0;
+
+	/* the data is placed at all alignments */
+	buf = xmalloc(size + 3);
+	ref = xmalloc(size);
+	ecc = xmalloc(3 * steps);
+	ecc_ref = xmalloc(3 * steps);
+
+	for (i = 0; i < loops; i++) {
+		offset = i & 3;
+		data = buf + offset;
+		nandecctest_fill(data, size, i);
+		memcpy(ref, data, size);
+
+		start = get_time_ns();
+		for (j = 0; j < steps; j++)
+			nand_calculate_ecc(NULL, data + j * NANDECCTEST_STEP,
+					ecc + j * 3);
+		t_calc += get_time_ns() - start;
+
+		start = get_time_ns();
+		for (j = 0; j < steps; j++)
+			nandecctest_calculate_ref(data + j * NANDECCTEST_STEP,
+					ecc_ref + j * 3);
+		t_ref += get_time_ns() - start;
+
+		if (memcmp(ecc, ecc_ref, 3 * steps))
+			ecc_failed++;
+
+		for (j = 0; j < steps; j++)
+			if (nandecctest_correct(data + j * NANDECCTEST_STEP,
+					ref + j * NANDECCTEST_STEP,
+					ecc + j * 3, ecc_ref + j * 3))
+				correct_failed++;
+
+		if (ctrlc()) {
+			ret = -EINTR;
+			goto out;
+		}
+	}
+
+	printf("%u bytes:%s\n", size,
+			ecc_failed || correct_failed ? "" : " ok");
+	if (ecc_failed)
+		printf("  %d of %d ECCs differ from the reference\n",
+				ecc_failed, loops);
+	if (correct_failed)
+		printf("  %d of %d single bit errors not corrected\n",
+				correct_failed, loops * steps);
+	print_rate("calculate", bytes, t_calc);
+	print_rate("reference", bytes, t_ref);
+
+	if (ecc_failed || correct_failed)
+		ret = -EIO;
+out:
+	free(ecc_ref);
+	free(ecc);
+	free(ref);
+	free(buf);
+
+	return ret;
+}
+
+static int do_nandecctest(int argc, char *argv[])
+{
+	unsigned int size = 0;
+	int opt, loops = 10000, ret;
+
+	while ((opt = getopt(argc, argv, "s:n:")) > 0) {
+		switch (opt) {
+		case 's':
+			size = simple_strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			loops = simple_strtoul(optarg, NULL, 0);
+			break;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
+
+	if (size % NANDECCTEST_STEP || loops < 1)
+		return COMMAND_ERROR_USAGE;
+
+	if (size)
+		return nandecctest_one(size, loops) ? 1 : 0;
+
+	ret = nandecctest_one(256, loops);
+	if (ret != -EINTR)
+		ret = nandecctest_one(512, loops);
+
+	return ret ? 1 : 0;
+}
+
+BAREBOX_CMD_HELP_START(nandecctest)
+BAREBOX_CMD_HELP_USAGE("nandecctest [OPTIONS]\n")
+BAREBOX_CMD_HELP_SHORT("Calculate the Hamming ECC of random data, compare it with the\n")
+BAREBOX_CMD_HELP_SHORT("table driven reference and correct single bit errors. Print\n")
+BAREBOX_CMD_HELP_SHORT("the throughput of both calculations.\n")
+BAREBOX_CMD_HELP_SHORT("Without -s 256 and 512 byte blocks are tested.\n")
+BAREBOX_CMD_HELP_OPT  ("-s <size>",  "block size in bytes, a multiple of 256\n")
+BAREBOX_CMD_HELP_OPT  ("-n <loops>",  "number of iterations (10000)\n")
+BAREBOX_CMD_HELP_END
+
+BAREBOX_CMD_START(nandecctest)
+	.cmd		= do_nandecctest,
+	.usage		= "test and benchmark the NAND Hamming ECC",
+	BAREBOX_CMD_HELP(cmd_nandecctest_help)
+BAREBOX_CMD_END
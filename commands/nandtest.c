@@ -44,52 +44,6 @@ static unsigned int ecc_stats[MAX_ECC_BITS];
 static unsigned int ecc_stats_over;
 static unsigned int ecc_failed_cnt;
 
-/*
- * Implementation of pread with lseek and read.
- */
-static ssize_t pread(int fd, void *buf, size_t count, off_t offset)
-{
-	int ret;
-
-	/* Seek to offset */
-	ret = lseek(fd, offset, SEEK_SET);
-	if (ret < 0)
-		perror("lseek");
-
-	/* Read from flash and put it into buf  */
-	ret = read(fd, buf, count);
-	if (ret < 0)
-		perror("read");
-
-	return 0;
-}
-
-/*
- * Implementation of pwrite with lseek and write.
- */
-static ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset)
-{
-	int ret;
-
-	ret = lseek(fd, offset, SEEK_SET);
-	if (ret < 0)
-		perror("lseek");
-
-	/* Write buf to flash */
-	ret = write(fd, buf, count);
-	if (ret < 0) {
-		perror("write");
-		if (markbad) {
-			printf("Mark block bad at 0x%08x\n",
-					(unsigned)(offset + memregion.offset));
-			ioctl(fd, MEMSETBADBLOCK, &offset);
-		}
-	}
-
-	flush(fd);
-	return 0;
-}
-
 /*
  * Erase and write function.
  * Param ofs: offset on flash_device.
@@ -117,12 +71,26 @@ static int erase_and_write(off_t ofs, unsigned char *data, unsigned char *rbuf)
 	printf("\r0x%08x: writing...", (unsigned)(ofs + memregion.offset));
 
 	/* Write data to given offset */
-	pwrite(fd, data, meminfo.erasesize, ofs);
+	ret = pwrite(fd, data, meminfo.erasesize, ofs);
+	if (ret < 0) {
+		perror("pwrite");
+		if (markbad) {
+			loff_t bad = ofs;
+
+			printf("Mark block bad at 0x%08x\n",
+					(unsigned)(ofs + memregion.offset));
+			ioctl(fd, MEMSETBADBLOCK, &bad);
+		}
+	}
+
+	flush(fd);
 
 	printf("\r0x%08x: reading...", (unsigned)(ofs + memregion.offset));
 
 	/* Read data from offset */
-	pread(fd, rbuf, meminfo.erasesize, ofs);
+	ret = pread(fd, rbuf, meminfo.erasesize, ofs);
+	if (ret < 0)
+		perror("pread");
 
 	ret = ioctl(fd, ECCGETSTATS, &newstats);
 	if (ret < 0) {
@@ -308,10 +276,12 @@ static int do_nandtest(int argc, char *argv[])
 				test_ofs < flash_offset+length;
 				test_ofs += meminfo.erasesize) {
 
+			loff_t ofs = test_ofs;
+
 			srand(seed);
 			seed = rand();
 
-			if (ioctl(fd, MEMGETBADBLOCK, (void *)test_ofs)) {
+			if (ioctl(fd, MEMGETBADBLOCK, &ofs)) {
 				printf("\rBad block at 0x%08x\n",
 						(unsigned)(test_ofs +
 							memregion.offset));
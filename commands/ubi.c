@@ -10,6 +10,7 @@
 #include <linux/mtd/mtd-abi.h>
 #include <mtd/ubi-user.h>
 #include <ubi-media.h>
+#include <driver.h>
 
 static int do_ubimkvol(int argc, char *argv[])
 {
@@ -127,3 +128,43 @@ BAREBOX_CMD_START(ubirmvol)
 	BAREBOX_CMD_HELP(cmd_ubirmvol_help)
 BAREBOX_CMD_END
 
+
+static int do_ubiinfo(int argc, char *argv[])
+{
+	struct device_d *dev;
+	const char *name;
+	int i, ret = 0;
+
+	if (argc == 1) {
+		for_each_device(dev)
+			if (!strcmp(dev->name, "ubi"))
+				ubi_print_info(dev->id);
+		return 0;
+	}
+
+	for (i = 1; i < argc; i++) {
+		name = argv[i];
+		if (!strncmp(name, "/dev/", 5))
+			name += 5;
+		if (strncmp(name, "ubi", 3) ||
+				ubi_print_info(simple_strtoul(name + 3, NULL, 0))) {
+			printf("no such UBI device: %s\n", argv[i]);
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+static const __maybe_unused char cmd_ubiinfo_help[] =
+"Usage: ubiinfo [ubidev...]\n"
+"Show information and the attach and I/O statistics of ubi devices.\n"
+"Without arguments all attached devices are shown. The statistics are\n"
+"also available as parameters of the ubiN devices and can be reset by\n"
+"setting them to 0.\n";
+
+BAREBOX_CMD_START(ubiinfo)
+	.cmd		= do_ubiinfo,
+	.usage		= "show ubi device statistics",
+	BAREBOX_CMD_HELP(cmd_ubiinfo_help)
+BAREBOX_CMD_END
@@ -59,7 +59,11 @@ static int do_uimage(int argc, char *argv[])
 		uimage_print_contents(handle);
 	}
 
-	if (verify) {
+	/* when extracting, check the crc while loading the data */
+	if (verify && extract)
+		handle->verify = 1;
+
+	if (verify && !extract) {
 		printf("verifying data crc... ");
 		ret = uimage_verify(handle);
 		if (ret) {
@@ -85,6 +89,9 @@ static int do_uimage(int argc, char *argv[])
 			goto err;
 		}
 
+		if (verify)
+			printf("data crc ok\n");
+
 		close(fd);
 	}
 err:
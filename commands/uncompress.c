@@ -26,10 +26,118 @@
 #include <fcntl.h>
 #include <fs.h>
 #include <uncompress.h>
+#include <getopt.h>
+#include <malloc.h>
+#include <xfuncs.h>
+#include <clock.h>
+#include <asm-generic/div64.h>
+
+#define UNCOMPRESS_BENCH_BUF_SIZE	(64 * 1024)
+
+/*
+ * Decompress a file to nowhere and print the throughput. The input is
+ * read into memory first so that only the decompression is timed. With
+ * contiguous set the output is collected in one growing buffer, the way
+ * images are decompressed to their final location.
+ */
+static int uncompress_bench(const char *filename, int contiguous)
+{
+	struct uncompress_ctx *ctx;
+	void *in, *out, *tmp;
+	size_t insize, outsize = UNCOMPRESS_BENCH_BUF_SIZE;
+	uint64_t start, us, rate;
+	unsigned long total = 0;
+	int ret;
+
+	in = read_file(filename, &insize);
+	if (!in) {
+		printf("could not read %s\n", filename);
+		return 1;
+	}
+
+	if (contiguous)
+		outsize = max(outsize, insize * 4);
+
+	out = malloc(outsize);
+	if (!out) {
+		printf("out of memory\n");
+		free(in);
+		return 1;
+	}
+
+	ctx = uncompress_open(NULL, NULL, uncompress_err_stdout);
+	ctx->contiguous = contiguous;
+	uncompress_feed(ctx, in, insize);
+
+	start = get_time_ns();
+
+	while (1) {
+		if (contiguous && outsize - total < UNCOMPRESS_BENCH_BUF_SIZE) {
+			tmp = realloc(out, outsize * 2);
+			if (!tmp) {
+				printf("out of memory\n");
+				ret = -ENOMEM;
+				break;
+			}
+			out = tmp;
+			outsize *= 2;
+		}
+
+		ret = uncompress_read(ctx, contiguous ? out + total : out,
+				UNCOMPRESS_BENCH_BUF_SIZE);
+		if (ret <= 0)
+			break;
+		total += ret;
+	}
+
+	us = get_time_ns() - start;
+
+	uncompress_close(ctx);
+	free(out);
+	free(in);
+
+	if (ret) {
+		printf("failed to decompress\n");
+		return 1;
+	}
+
+	do_div(us, 1000);
+	if (!us)
+		us = 1;
+	rate = (uint64_t)total * 1000000;
+	do_div(rate, us);
+
+	printf("%zu -> %lu bytes in %llu us, %llu.%02llu MiB/s\n", insize, total,
+			us, rate >> 20, ((rate & 0xfffff) * 100) >> 20);
+
+	return 0;
+}
 
 static int do_uncompress(int argc, char *argv[])
 {
-	int from, to, ret;
+	int from, to, ret, opt, bench = 0, contiguous = 0;
+
+	while ((opt = getopt(argc, argv, "bc")) > 0) {
+		switch (opt) {
+		case 'b':
+			bench = 1;
+			break;
+		case 'c':
+			contiguous = 1;
+			break;
+		default:
+			return COMMAND_ERROR_USAGE;
+		}
+	}
+
+	argc -= optind - 1;
+	argv += optind - 1;
+
+	if (bench) {
+		if (argc != 2)
+			return COMMAND_ERROR_USAGE;
+		return uncompress_bench(argv[1], contiguous);
+	}
 
 	if (argc != 3)
 		return COMMAND_ERROR_USAGE;
@@ -60,7 +168,11 @@ exit_close:
 
 static const __maybe_unused char cmd_uncompress_help[] =
 "Usage: uncompress <infile> <outfile>\n"
-"Uncompress a compressed file\n";
+"       uncompress -b [-c] <infile>\n"
+"Uncompress a compressed file\n"
+"options:\n"
+" -b  decompress to nowhere and print the throughput\n"
+" -c  with -b, decompress into one contiguous buffer\n";
 
 BAREBOX_CMD_START(uncompress)
         .cmd            = do_uncompress,
@@ -57,28 +57,44 @@ static int writebuffer_flush(struct block_device *blk)
 }
 
 /*
- * get the chunk containing a given block. Will return NULL if the
- * block is not cached, the chunk otherwise.
+ * find the chunk containing a given block without changing the
+ * LRU order. Will return NULL if the block is not cached.
  */
-static struct chunk *chunk_get_cached(struct block_device *blk, int block)
+static struct chunk *chunk_find(struct block_device *blk, int block)
 {
 	struct chunk *chunk;
 
 	list_for_each_entry(chunk, &blk->buffered_blocks, list) {
 		if (block >= chunk->block_start &&
-				block < chunk->block_start + blk->rdbufsize) {
-			debug("%s: found %d in %d\n", __func__, block, chunk->num);
-			/*
-			 * move most recently used entry to the head of the list
-			 */
-			list_move(&chunk->list, &blk->buffered_blocks);
+				block < chunk->block_start + blk->rdbufsize)
 			return chunk;
-		}
 	}
 
 	return NULL;
 }
 
+/*
+ * get the chunk containing a given block. Will return NULL if the
+ * block is not cached, the chunk otherwise.
+ */
+static struct chunk *chunk_get_cached(struct block_device *blk, int block)
+{
+	struct chunk *chunk;
+
+	chunk = chunk_find(blk, block);
+	if (!chunk)
+		return NULL;
+
+	debug("%s: found %d in %d\n", __func__, block, chunk->num);
+
+	/*
+	 * move most recently used entry to the head of the list
+	 */
+	list_move(&chunk->list, &blk->buffered_blocks);
+
+	return chunk;
+}
+
 /*
  * Get the data pointer for a given block. Will return NULL if
  * the block is not cached, the data pointer otherwise.
@@ -179,6 +195,40 @@ static void *block_get(struct block_device *blk, int block)
 	return outdata;
 }
 
+/*
+ * Large reads bypass the cache: a run of at least one chunk of blocks which
+ * are not cached is read directly into the destination buffer. This avoids
+ * copying every block and lets the driver transfer the whole run at once.
+ * The driver may use DMA, so this is only done for buffers aligned like
+ * the ones from dma_alloc(), others go through the cache.
+ * Returns the number of blocks read or 0 if the cache should be used.
+ */
+static int block_read_direct(struct block_device *blk, void *buf, int block,
+		int num_blocks)
+{
+	int num = 0;
+	int ret;
+
+	if (num_blocks < blk->rdbufsize ||
+			!IS_ALIGNED((unsigned long)buf, DMA_ALIGNMENT))
+		return 0;
+
+	if (block + num_blocks > blk->num_blocks)
+		return -ENXIO;
+
+	while (num < num_blocks && !chunk_find(blk, block + num))
+		num++;
+
+	if (num < blk->rdbufsize)
+		return 0;
+
+	ret = blk->ops->read(blk, buf, block, num);
+	if (ret)
+		return ret;
+
+	return num;
+}
+
 static ssize_t block_read(struct cdev *cdev, void *buf, size_t count,
 		loff_t offset, unsigned long flags)
 {
@@ -206,8 +256,21 @@ static ssize_t block_read(struct cdev *cdev, void *buf, size_t count,
 	blocks = count >> blk->blockbits;
 
 	while (blocks) {
-		void *iobuf = block_get(blk, block);
+		void *iobuf;
+		int num;
+
+		num = block_read_direct(blk, buf, block, blocks);
+		if (num < 0)
+			return num;
+		if (num) {
+			buf += num << blk->blockbits;
+			blocks -= num;
+			block += num;
+			count -= num << blk->blockbits;
+			continue;
+		}
 
+		iobuf = block_get(blk, block);
 		if (IS_ERR(iobuf))
 			return PTR_ERR(iobuf);
 
@@ -29,6 +29,8 @@
 #include <errno.h>
 #include <module.h>
 #include <linux/err.h>
+#include <clock.h>
+#include <dma.h>
 
 static LIST_HEAD(digests);
 
@@ -37,7 +39,7 @@ static int dummy_init(struct digest *d)
 	return 0;
 }
 
-int digest_register(struct digest *d)
+int digest_algo_register(struct digest_algo *d)
 {
 	if (!d || !d->name || !d->update || !d->final || d->length < 1)
 		return -EINVAL;
@@ -45,27 +47,27 @@ int digest_register(struct digest *d)
 	if (!d->init)
 		d->init = dummy_init;
 
-	if (digest_get_by_name(d->name))
+	if (digest_algo_get_by_name(d->name))
 		return -EEXIST;
 
 	list_add_tail(&d->list, &digests);
 
 	return 0;
 }
-EXPORT_SYMBOL(digest_register);
+EXPORT_SYMBOL(digest_algo_register);
 
-void digest_unregister(struct digest *d)
+void digest_algo_unregister(struct digest_algo *d)
 {
 	if (!d)
 		return;
 
 	list_del(&d->list);
 }
-EXPORT_SYMBOL(digest_unregister);
+EXPORT_SYMBOL(digest_algo_unregister);
 
-struct digest* digest_get_by_name(char* name)
+struct digest_algo *digest_algo_get_by_name(const char *name)
 {
-	struct digest* d;
+	struct digest_algo *d;
 
 	if (!name)
 		return NULL;
@@ -77,7 +79,38 @@ struct digest* digest_get_by_name(char* name)
 
 	return NULL;
 }
-EXPORT_SYMBOL_GPL(digest_get_by_name);
+EXPORT_SYMBOL_GPL(digest_algo_get_by_name);
+
+/*
+ * allocate a new digest operation for the algorithm 'name'. The context
+ * is freed with digest_free().
+ */
+struct digest *digest_alloc(const char *name)
+{
+	struct digest_algo *algo;
+	struct digest *d;
+
+	algo = digest_algo_get_by_name(name);
+	if (!algo)
+		return NULL;
+
+	d = xzalloc(sizeof(*d));
+	d->algo = algo;
+	d->ctx = xzalloc(algo->ctx_length);
+
+	return d;
+}
+EXPORT_SYMBOL_GPL(digest_alloc);
+
+void digest_free(struct digest *d)
+{
+	if (!d)
+		return;
+
+	free(d->ctx);
+	free(d);
+}
+EXPORT_SYMBOL_GPL(digest_free);
 
 int digest_file_window(struct digest *d, char *filename,
 		       unsigned char *hash,
@@ -87,8 +120,10 @@ int digest_file_window(struct digest *d, char *filename,
 	int fd, now, ret = 0;
 	unsigned char *buf;
 	int flags = 0;
+	const ulong bufsize = CONFIG_CHECKSUM_BUF_SIZE * 1024;
+	uint64_t ctrlc_start = get_time_ns();
 
-	d->init(d);
+	digest_init(d);
 
 	fd = open(filename, O_RDONLY);
 	if (fd < 0) {
@@ -98,7 +133,11 @@ int digest_file_window(struct digest *d, char *filename,
 
 	buf = memmap(fd, PROT_READ);
 	if (buf == (void *)-1) {
-		buf = xmalloc(4096);
+		buf = dma_alloc(bufsize);
+		if (!buf) {
+			ret = -ENOMEM;
+			goto out;
+		}
 		flags = 1;
 	}
 
@@ -107,15 +146,31 @@ int digest_file_window(struct digest *d, char *filename,
 			ret = lseek(fd, start, SEEK_SET);
 			if (ret == -1) {
 				perror("lseek");
-				goto out;
+				goto out_free;
 			}
 		} else {
 			buf += start;
 		}
 	}
 
+	if (!flags) {
+		struct stat s;
+
+		/* the mapping ends with the file, do not read past it */
+		ret = stat(filename, &s);
+		if (ret) {
+			perror("stat");
+			goto out;
+		}
+
+		if (start >= s.st_size)
+			size = 0;
+		else
+			size = min((ulong)(s.st_size - start), size);
+	}
+
 	while (size) {
-		now = min((ulong)4096, size);
+		now = min(bufsize, size);
 		if (flags) {
 			now = read(fd, buf, now);
 			if (now < 0) {
@@ -127,21 +182,27 @@ int digest_file_window(struct digest *d, char *filename,
 				break;
 		}
 
-		if (ctrlc()) {
-			ret = -EINTR;
-			goto out_free;
+		/* polling the console is expensive, do not do it per chunk */
+		if (is_timeout(ctrlc_start, 100 * MSECOND)) {
+			if (ctrlc()) {
+				ret = -EINTR;
+				goto out_free;
+			}
+			ctrlc_start = get_time_ns();
 		}
 
-		d->update(d, buf, now);
+		digest_update(d, buf, now);
 		size -= now;
 		len += now;
+		if (!flags)
+			buf += now;
 	}
 
-	d->final(d, hash);
+	digest_final(d, hash);
 
 out_free:
 	if (flags)
-		free(buf);
+		dma_free(buf);
 out:
 	close(fd);
 
@@ -168,11 +229,16 @@ int digest_file_by_name(char *algo, char *filename,
 		       unsigned char *hash)
 {
 	struct digest *d;
+	int ret;
 
-	d = digest_get_by_name(algo);
+	d = digest_alloc(algo);
 	if (!d)
 		return -EIO;
 
-	return digest_file(d, filename, hash);
+	ret = digest_file(d, filename, hash);
+
+	digest_free(d);
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(digest_file_by_name);
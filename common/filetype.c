@@ -39,6 +39,9 @@ static const char *filetype_str[] = {
 	[filetype_oftree] = "open firmware flat device tree",
 	[filetype_aimage] = "Android boot image",
 	[filetype_sh] = "Bourne Shell",
+	[filetype_mips_barebox] = "MIPS barebox image",
+	[filetype_lz4_compressed] = "lz4 compressed",
+	[filetype_xz_compressed] = "xz compressed",
 };
 
 const char *file_type_to_string(enum filetype f)
@@ -63,6 +66,12 @@ enum filetype file_detect_type(void *_buf)
 	if (buf8[0] == 0x89 && buf8[1] == 0x4c && buf8[2] == 0x5a &&
 			buf8[3] == 0x4f)
 		return filetype_lzo_compressed;
+	if (buf[0] == le32_to_cpu(0x184d2204) ||
+			buf[0] == le32_to_cpu(0x184c2102))
+		return filetype_lz4_compressed;
+	if (buf8[0] == 0xfd && buf8[1] == '7' && buf8[2] == 'z' &&
+			buf8[3] == 'X' && buf8[4] == 'Z' && buf8[5] == 0x00)
+		return filetype_xz_compressed;
 	if (buf[0] == be32_to_cpu(0x27051956))
 		return filetype_uimage;
 	if (buf[0] == 0x23494255)
@@ -236,38 +236,44 @@ int check_passwd(unsigned char* passwd, size_t length)
 	unsigned char *passwd2_sum;
 	int ret = 0;
 
-	d = digest_get_by_name(PASSWD_SUM);
+	d = digest_alloc(PASSWD_SUM);
+	if (!d)
+		return -ENOENT;
 
-	passwd1_sum = calloc(d->length, sizeof(unsigned char));
+	passwd1_sum = calloc(digest_length(d), sizeof(unsigned char));
 
-	if (!passwd1_sum)
-		return -ENOMEM;
+	if (!passwd1_sum) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
 
-	passwd2_sum = calloc(d->length, sizeof(unsigned char));
+	passwd2_sum = calloc(digest_length(d), sizeof(unsigned char));
 
 	if (!passwd2_sum) {
 		ret = -ENOMEM;
 		goto err1;
 	}
 
-	d->init(d);
+	digest_init(d);
 
-	d->update(d, passwd, length);
+	digest_update(d, passwd, length);
 
-	d->final(d, passwd1_sum);
+	digest_final(d, passwd1_sum);
 
-	ret = read_passwd(passwd2_sum, d->length);
+	ret = read_passwd(passwd2_sum, digest_length(d));
 
 	if (ret < 0)
 		goto err2;
 
-	if (strncmp(passwd1_sum, passwd2_sum, d->length) == 0)
+	if (strncmp(passwd1_sum, passwd2_sum, digest_length(d)) == 0)
 		ret = 1;
 
 err2:
 	free(passwd2_sum);
 err1:
 	free(passwd1_sum);
+err_free:
+	digest_free(d);
 
 	return ret;
 }
@@ -279,22 +285,28 @@ int set_passwd(unsigned char* passwd, size_t length)
 	unsigned char *passwd_sum;
 	int ret;
 
-	d = digest_get_by_name(PASSWD_SUM);
+	d = digest_alloc(PASSWD_SUM);
+	if (!d)
+		return -ENOENT;
 
-	passwd_sum = calloc(d->length, sizeof(unsigned char));
+	passwd_sum = calloc(digest_length(d), sizeof(unsigned char));
 
-	if (!passwd_sum)
-		return -ENOMEM;
+	if (!passwd_sum) {
+		ret = -ENOMEM;
+		goto err;
+	}
 
-	d->init(d);
+	digest_init(d);
 
-	d->update(d, passwd, length);
+	digest_update(d, passwd, length);
 
-	d->final(d, passwd_sum);
+	digest_final(d, passwd_sum);
 
-	ret = write_passwd(passwd_sum, d->length);
+	ret = write_passwd(passwd_sum, digest_length(d));
 
 	free(passwd_sum);
+err:
+	digest_free(d);
 
 	return ret;
 }
@@ -134,7 +134,7 @@ again:
 	handle = xzalloc(sizeof(struct uimage_handle));
 	header = &handle->header;
 
-	if (read(fd, header, sizeof(*header)) < 0) {
+	if (pread(fd, header, sizeof(*header), 0) < 0) {
 		printf("could not read: %s\n", errno_str());
 		goto err_out;
 	}
@@ -169,19 +169,19 @@ again:
 	}
 
 	if (uimage_is_multi_image(handle)) {
+		u32 size[MAX_MULTI_IMAGE_COUNT];
 		size_t offset;
 
-		for (i = 0; i < MAX_MULTI_IMAGE_COUNT; i++) {
-			u32 size;
-
-			ret = read(fd, &size, sizeof(size));
-			if (ret < 0)
-				goto err_out;
+		/* read the whole size table at once, it is terminated by 0 */
+		ret = pread(fd, size, sizeof(size), sizeof(*header));
+		if (ret < 0)
+			goto err_out;
 
-			if (!size)
+		for (i = 0; i < ret / sizeof(u32); i++) {
+			if (!size[i])
 				break;
 
-			handle->ihd[i].len = uimage_to_cpu(size);
+			handle->ihd[i].len = uimage_to_cpu(size[i]);
 		}
 
 		handle->nb_data_entries = i;
@@ -203,9 +203,6 @@ again:
 		handle->data_offset = sizeof(struct image_header);
 	}
 
-	/*
-	 * fd is now at the first data word
-	 */
 	handle->fd = fd;
 
 	return handle;
@@ -234,11 +231,107 @@ void uimage_close(struct uimage_handle *handle)
 }
 EXPORT_SYMBOL(uimage_close);
 
-static int uimage_fd;
+/*
+ * Add data read at file position 'pos' to the running data crc. Only data
+ * directly following the already checked part is taken into account.
+ */
+static void uimage_crc_update(struct uimage_handle *handle, loff_t pos,
+		const void *buf, size_t len)
+{
+	size_t start, skip;
+
+	if (pos < sizeof(struct image_header))
+		return;
+
+	start = pos - sizeof(struct image_header);
+
+	if (start > handle->dcrc_len || start + len <= handle->dcrc_len)
+		return;
+
+	skip = handle->dcrc_len - start;
+	len = min(len - skip, handle->header.ih_size - handle->dcrc_len);
+
+	handle->dcrc = crc32(handle->dcrc, buf + skip, len);
+	handle->dcrc_len += len;
+}
+
+/*
+ * Read the data which is not yet checked up to offset 'end' in the data
+ * area and add it to the running data crc.
+ */
+static int uimage_crc_read(struct uimage_handle *handle, size_t end)
+{
+	void *buf;
+	int ret = 0;
+
+	end = min_t(size_t, end, handle->header.ih_size);
+	if (handle->dcrc_len >= end)
+		return 0;
+
+	buf = xmalloc(PAGE_SIZE);
+
+	while (handle->dcrc_len < end) {
+		loff_t pos = handle->dcrc_len + sizeof(struct image_header);
+		int now = min_t(size_t, end - handle->dcrc_len, PAGE_SIZE);
+
+		ret = pread(handle->fd, buf, now, pos);
+		if (ret < 0)
+			goto err;
+		if (!ret) {
+			ret = -EIO;
+			goto err;
+		}
+		uimage_crc_update(handle, pos, buf, ret);
+	}
+
+	ret = 0;
+err:
+	free(buf);
+
+	return ret;
+}
+
+static int uimage_crc_check(struct uimage_handle *handle)
+{
+	int ret;
+
+	ret = uimage_crc_read(handle, handle->header.ih_size);
+	if (ret)
+		return ret;
+
+	if (handle->dcrc != handle->header.ih_dcrc) {
+		printf("Bad Data CRC: 0x%08x != 0x%08x\n",
+				handle->dcrc, handle->header.ih_dcrc);
+		return -EINVAL;
+	}
+
+	return 0;
+}
 
+static struct uimage_handle *uimage_cur;
+static loff_t uimage_pos;
+
+/* read len bytes, less only at the end of the file */
 static int uimage_fill(void *buf, unsigned int len)
 {
-	return read_full(uimage_fd, buf, len);
+	int ret, total = 0;
+
+	while (len) {
+		ret = pread(uimage_cur->fd, buf, len, uimage_pos);
+		if (ret < 0)
+			return ret;
+		if (!ret)
+			break;
+
+		if (uimage_cur->verify)
+			uimage_crc_update(uimage_cur, uimage_pos, buf, ret);
+		uimage_pos += ret;
+		buf += ret;
+		len -= ret;
+		total += ret;
+	}
+
+	return total;
 }
 
 static int uncompress_copy(unsigned char *inbuf_unused, int len,
@@ -256,6 +349,11 @@ static int uncompress_copy(unsigned char *inbuf_unused, int len,
 		ret = fill(buf, now);
 		if (ret < 0)
 			goto err;
+		if (!ret) {
+			ret = -EIO;
+			goto err;
+		}
+		now = ret;
 		ret = flush(buf, now);
 		if (ret < 0)
 			goto err;
@@ -273,43 +371,14 @@ err:
  */
 int uimage_verify(struct uimage_handle *handle)
 {
-	u32 crc = 0;
-	int len, ret;
-	void *buf;
-
-	ret = lseek(handle->fd, sizeof(struct image_header), SEEK_SET);
-	if (ret < 0)
-		return ret;
-
-	buf = xmalloc(PAGE_SIZE);
-
-	len = handle->header.ih_size;
-	while (len) {
-		int now = min(len, PAGE_SIZE);
-		ret = read(handle->fd, buf, now);
-		if (ret < 0)
-			goto err;
-		crc = crc32(crc, buf, now);
-		len -= ret;
-	}
-
-	if (crc != handle->header.ih_dcrc) {
-		printf("Bad Data CRC: 0x%08x != 0x%08x\n",
-				crc, handle->header.ih_dcrc);
-		ret = -EINVAL;
-		goto err;
-	}
-
-	ret = 0;
-err:
-	free(buf);
-
-	return ret;
+	return uimage_crc_check(handle);
 }
 EXPORT_SYMBOL(uimage_verify);
 
 /*
- * Load a uimage, flushing output to flush function
+ * Load a uimage, flushing output to flush function. If handle->verify is
+ * set the data crc is calculated from the data read for loading and
+ * checked afterwards, so that the image has to be read only once.
  */
 int uimage_load(struct uimage_handle *handle, unsigned int image_no,
 		int(*flush)(void*, unsigned int))
@@ -329,21 +398,31 @@ int uimage_load(struct uimage_handle *handle, unsigned int image_no,
 
 	iha = &handle->ihd[image_no];
 
-	ret = lseek(handle->fd, iha->offset + handle->data_offset,
-			SEEK_SET);
-	if (ret < 0)
-		return ret;
-
 	if (hdr->ih_comp == IH_COMP_NONE)
 		uncompress_fn = uncompress_copy;
 	else
 		uncompress_fn = uncompress;
 
-	uimage_fd = handle->fd;
+	uimage_cur = handle;
+	uimage_pos = iha->offset + handle->data_offset;
+
+	/* multifile images: checksum the data in front of this image */
+	if (handle->verify) {
+		ret = uimage_crc_read(handle,
+				uimage_pos - sizeof(struct image_header));
+		if (ret)
+			return ret;
+	}
 
 	ret = uncompress_fn(NULL, iha->len, uimage_fill, flush,
 				NULL, NULL,
 				uncompress_err_stdout);
+	if (ret)
+		return ret;
+
+	if (handle->verify)
+		ret = uimage_crc_check(handle);
+
 	return ret;
 }
 EXPORT_SYMBOL(uimage_load);
@@ -362,8 +441,9 @@ static int uimage_sdram_flush(void *buf, unsigned int len)
 		uimage_resource = request_sdram_region("uimage",
 				start, size);
 		if (!uimage_resource) {
-			printf("unable to request SDRAM 0x%08x-0x%08x\n",
-				start, start + size - 1);
+			printf("unable to request SDRAM 0x%08llx-0x%08llx\n",
+				(unsigned long long)start,
+				(unsigned long long)start + size - 1);
 			return -ENOMEM;
 		}
 	}
@@ -443,8 +523,9 @@ struct resource *uimage_load_to_sdram(struct uimage_handle *handle,
 	uimage_resource = request_sdram_region("uimage",
 				start, size);
 	if (!uimage_resource) {
-		printf("unable to request SDRAM 0x%08x-0x%08x\n",
-			start, start + size - 1);
+		printf("unable to request SDRAM 0x%08llx-0x%08llx\n",
+			(unsigned long long)start,
+			(unsigned long long)start + size - 1);
 		return NULL;
 	}
 
@@ -458,6 +539,61 @@ struct resource *uimage_load_to_sdram(struct uimage_handle *handle,
 }
 EXPORT_SYMBOL(uimage_load_to_sdram);
 
+static void *uimage_grow_buf;
+static size_t uimage_grow_len, uimage_grow_size;
+
+static int uimage_grow_flush(void *buf, unsigned int len)
+{
+	void *new;
+	size_t size;
+
+	if (uimage_grow_len + len > uimage_grow_size) {
+		size = max(uimage_grow_size * 2, uimage_grow_len + len);
+		new = realloc(uimage_grow_buf, size);
+		if (!new)
+			return -ENOMEM;
+		uimage_grow_buf = new;
+		uimage_grow_size = size;
+	}
+
+	memcpy(uimage_grow_buf + uimage_grow_len, buf, len);
+	uimage_grow_len += len;
+
+	return len;
+}
+
+/*
+ * Load an image into a buffer growing with the data. @size is the
+ * expected size of the image or 0 if it is not known in advance.
+ */
+static void *uimage_load_to_grow_buf(struct uimage_handle *handle,
+		int image_no, size_t size, size_t *outsize)
+{
+	int ret;
+
+	uimage_grow_buf = NULL;
+	uimage_grow_len = 0;
+	uimage_grow_size = 0;
+
+	if (size) {
+		uimage_grow_buf = malloc(size);
+		if (!uimage_grow_buf)
+			return NULL;
+		uimage_grow_size = size;
+	}
+
+	ret = uimage_load(handle, image_no, uimage_grow_flush);
+	if (ret) {
+		free(uimage_grow_buf);
+		return NULL;
+	}
+
+	if (outsize)
+		*outsize = uimage_grow_len;
+
+	return uimage_grow_buf;
+}
+
 void *uimage_load_to_buf(struct uimage_handle *handle, int image_no,
 		size_t *outsize)
 {
@@ -466,32 +602,17 @@ void *uimage_load_to_buf(struct uimage_handle *handle, int image_no,
 	struct uimage_handle_data *ihd;
 	char ftbuf[128];
 	enum filetype ft;
-	void *buf;
 
 	if (image_no >= handle->nb_data_entries)
 		return NULL;
 
 	ihd = &handle->ihd[image_no];
 
-	ret = lseek(handle->fd, ihd->offset + handle->data_offset,
-			SEEK_SET);
-	if (ret < 0)
-		return NULL;
-
-	if (handle->header.ih_comp == IH_COMP_NONE) {
-		buf = malloc(ihd->len);
-		if (!buf)
-			return NULL;
-
-		ret = read_full(handle->fd, buf, ihd->len);
-		if (ret < ihd->len) {
-			free(buf);
-			return NULL;
-		}
-		goto out;
-	}
+	if (handle->header.ih_comp == IH_COMP_NONE)
+		return uimage_load_to_grow_buf(handle, image_no, ihd->len,
+				outsize);
 
-	ret = read(handle->fd, ftbuf, 128);
+	ret = pread(handle->fd, ftbuf, 128, ihd->offset + handle->data_offset);
 	if (ret < 0)
 		return NULL;
 
@@ -499,36 +620,15 @@ void *uimage_load_to_buf(struct uimage_handle *handle, int image_no,
 	if ((int)ft < 0)
 		return NULL;
 
+	/* only gzip stores the uncompressed size at a known place */
 	if (ft != filetype_gzip)
-		return NULL;
+		return uimage_load_to_grow_buf(handle, image_no, 0, outsize);
 
-	ret = lseek(handle->fd, ihd->offset + handle->data_offset +
-			ihd->len - 4,
-			SEEK_SET);
+	ret = pread(handle->fd, &size, 4, ihd->offset + handle->data_offset +
+			ihd->len - 4);
 	if (ret < 0)
 		return NULL;
 
-	ret = read(handle->fd, &size, 4);
-	if (ret < 0)
-		return NULL;
-
-	size = le32_to_cpu(size);
-
-	ret = lseek(handle->fd, ihd->offset + handle->data_offset,
-			SEEK_SET);
-	if (ret < 0)
-		return NULL;
-
-	buf = malloc(size);
-	ret = uncompress_fd_to_buf(handle->fd, buf, uncompress_err_stdout);
-	if (ret) {
-		free(buf);
-		return NULL;
-	}
-
-out:
-	if (outsize)
-		*outsize = size;
-
-	return buf;
+	return uimage_load_to_grow_buf(handle, image_no, le32_to_cpu(size),
+			outsize);
 }
@@ -12,7 +12,9 @@
 #include <common.h>
 #endif
 
-#ifdef CONFIG_DYNAMIC_CRC_TABLE
+#if defined(CONFIG_CRC32_SLICEBY8) || defined(CONFIG_CRC32_SLICEBY4)
+/* tables are generated at build time, see below */
+#elif defined(CONFIG_DYNAMIC_CRC_TABLE)
 
 static int crc_table_empty = 1;
 static ulong crc_table[256];
@@ -125,22 +127,77 @@ static const ulong crc_table[256] = {
 #endif
 
 
+#if defined(CONFIG_CRC32_SLICEBY8) || defined(CONFIG_CRC32_SLICEBY4)
+
+#ifdef CONFIG_CRC32_SLICEBY8
+#define CRC32_SLICES	8
+#else
+#define CRC32_SLICES	4
+#endif
+
+#include "crc32table.h"
+
+#define DO1(buf) crc = crc32table_le[0][(crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
+
+/*
+ * Process the aligned part of the buffer CRC32_SLICES bytes at a time,
+ * the tables are generated at build time by gen_crc32table.
+ */
+static uint32_t crc32_body(uint32_t crc, const unsigned char *buf,
+		unsigned int len)
+{
+	const uint32_t (*t)[256] = crc32table_le;
+	const uint32_t *b;
+	uint32_t q;
+#if CRC32_SLICES == 8
+	uint32_t hi;
+#endif
+
+	while (len && ((unsigned long)buf & 3)) {
+		DO1(buf);
+		len--;
+	}
+
+	b = (const uint32_t *)buf;
+
+	while (len >= CRC32_SLICES) {
+		q = crc ^ le32_to_cpu(*b++);
+#if CRC32_SLICES == 8
+		hi = le32_to_cpu(*b++);
+		crc = t[7][q & 0xff] ^ t[6][(q >> 8) & 0xff] ^
+			t[5][(q >> 16) & 0xff] ^ t[4][q >> 24] ^
+			t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+			t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+#else
+		crc = t[3][q & 0xff] ^ t[2][(q >> 8) & 0xff] ^
+			t[1][(q >> 16) & 0xff] ^ t[0][q >> 24];
+#endif
+		len -= CRC32_SLICES;
+	}
+
+	buf = (const unsigned char *)b;
+
+	while (len--)
+		DO1(buf);
+
+	return crc;
+}
+
+#else
+
 /* ========================================================================= */
 #define DO1(buf) crc = crc_table[((int)crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
 #define DO2(buf)  DO1(buf); DO1(buf);
 #define DO4(buf)  DO2(buf); DO2(buf);
 #define DO8(buf)  DO4(buf); DO4(buf);
 
-/* ========================================================================= */
-uint32_t crc32(uint32_t crc, const void *_buf, unsigned int len)
+static uint32_t crc32_body(uint32_t crc, const unsigned char *buf,
+		unsigned int len)
 {
-    const unsigned char *buf = _buf;
-
 #ifdef CONFIG_DYNAMIC_CRC_TABLE
     if (crc_table_empty)
       make_crc_table();
 #endif
-    crc = crc ^ 0xffffffffL;
     while (len >= 8)
     {
       DO8(buf);
@@ -149,6 +206,17 @@ uint32_t crc32(uint32_t crc, const void *_buf, unsigned int len)
     if (len) do {
       DO1(buf);
     } while (--len);
+
+    return crc;
+}
+
+#endif
+
+/* ========================================================================= */
+uint32_t crc32(uint32_t crc, const void *_buf, unsigned int len)
+{
+    crc = crc32_body(crc ^ 0xffffffffL, _buf, len);
+
     return crc ^ 0xffffffffL;
 }
 #ifdef __BAREBOX__
@@ -160,21 +228,5 @@ EXPORT_SYMBOL(crc32);
  */
 uint32_t crc32_no_comp(uint32_t crc, const void *_buf, unsigned int len)
 {
-   const unsigned char *buf = _buf;
-
-#ifdef CONFIG_DYNAMIC_CRC_TABLE
-    if (crc_table_empty)
-      make_crc_table();
-#endif
-    while (len >= 8)
-    {
-      DO8(buf);
-      len -= 8;
-    }
-    if (len) do {
-      DO1(buf);
-    } while (--len);
-
-    return crc;
+    return crc32_body(crc, _buf, len);
 }
-
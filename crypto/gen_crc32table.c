@@ -0,0 +1,69 @@
+/*
+ * gen_crc32table.c - generate the tables for the sliced crc32
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define CRC32_POLY_LE	0xedb88320
+#define MAX_SLICES	8
+
+static uint32_t table[MAX_SLICES][256];
+
+/*
+ * table[0] is the classic byte-at-a-time table. table[k][n] is the crc of
+ * byte n followed by k zero bytes, which allows processing k + 1 bytes
+ * with independent table lookups.
+ */
+static void crc32_init(void)
+{
+	uint32_t crc;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (crc & 1 ? CRC32_POLY_LE : 0);
+		table[0][i] = crc;
+	}
+
+	for (i = 0; i < 256; i++) {
+		crc = table[0][i];
+		for (j = 1; j < MAX_SLICES; j++) {
+			crc = table[0][crc & 0xff] ^ (crc >> 8);
+			table[j][i] = crc;
+		}
+	}
+}
+
+int main(void)
+{
+	int i, j;
+
+	crc32_init();
+
+	printf("/* this file is generated - do not edit */\n\n");
+	printf("static const uint32_t crc32table_le[CRC32_SLICES][256] = {\n");
+
+	for (i = 0; i < MAX_SLICES; i++) {
+		if (i == 4)
+			printf("#if CRC32_SLICES > 4\n");
+		printf("\t{");
+		for (j = 0; j < 256; j++)
+			printf("%s0x%08xU,", j % 6 ? " " : "\n\t", table[i][j]);
+		printf("\n\t},\n");
+	}
+
+	printf("#endif\n};\n");
+
+	return 0;
+}
@@ -53,24 +53,74 @@ static 	ssize_t mtd_read(struct cdev *cdev, void* buf, size_t count,
 #define MTDPGALG(x) ((x) & ~(mtd->writesize - 1))
 
 #ifdef CONFIG_MTD_WRITE
+/*
+ * Check if a buffer is erased (all 0xff). Most of the buffer is compared a
+ * long at a time.
+ */
 static int all_ff(const void *buf, int len)
 {
-	int i;
 	const uint8_t *p = buf;
+	const unsigned long *l;
+
+	while (len && ((unsigned long)p & (sizeof(long) - 1))) {
+		if (*p++ != 0xff)
+			return 0;
+		len--;
+	}
+
+	l = (const unsigned long *)p;
+	while (len >= 4 * sizeof(long)) {
+		if ((l[0] & l[1] & l[2] & l[3]) != ~0UL)
+			return 0;
+		l += 4;
+		len -= 4 * sizeof(long);
+	}
 
-	for (i = 0; i < len; i++)
-		if (p[i] != 0xFF)
+	while (len >= sizeof(long)) {
+		if (*l++ != ~0UL)
 			return 0;
+		len -= sizeof(long);
+	}
+
+	p = (const uint8_t *)l;
+	while (len--)
+		if (*p++ != 0xff)
+			return 0;
+
 	return 1;
 }
 
+/*
+ * Bounce buffer for writes not ending on a page boundary. It is kept
+ * around and grown to the largest page size seen.
+ */
+static void *mtd_wrbuf;
+static size_t mtd_wrbuf_size;
+
+static void *mtd_get_wrbuf(struct mtd_info *mtd)
+{
+	if (mtd_wrbuf_size < mtd->writesize) {
+		free(mtd_wrbuf);
+		mtd_wrbuf = xmalloc(mtd->writesize);
+		mtd_wrbuf_size = mtd->writesize;
+	}
+
+	return mtd_wrbuf;
+}
+
+/*
+ * Pages which are all 0xff are not written, so that they can still be
+ * programmed later (e.g. by UBI). The other pages are passed to the
+ * driver in runs of up to one erase block, so that NAND drivers can
+ * program them in one go.
+ */
 static ssize_t mtd_write(struct cdev* cdev, const void *buf, size_t _count,
 			  loff_t _offset, ulong flags)
 {
 	struct mtd_info *mtd = cdev->priv;
-	size_t retlen, now;
+	size_t retlen, now, blockleft;
 	int ret = 0;
-	void *wrbuf = NULL;
+	void *wrbuf;
 	size_t count = _count;
 	unsigned long offset = _offset;
 
@@ -87,18 +137,22 @@ static ssize_t mtd_write(struct cdev* cdev, const void *buf, size_t _count,
 			dev_dbg(cdev->dev, "not aligned: %d %ld\n",
 				mtd->writesize,
 				(offset % mtd->writesize));
-			wrbuf = xmalloc(mtd->writesize);
+			wrbuf = mtd_get_wrbuf(mtd);
 			memset(wrbuf, 0xff, mtd->writesize);
-			memcpy(wrbuf + (offset % mtd->writesize), buf, now);
+			memcpy(wrbuf, buf, now);
 			if (!all_ff(wrbuf, mtd->writesize))
 				ret = mtd->write(mtd, MTDPGALG(offset),
 						  mtd->writesize, &retlen,
 						  wrbuf);
-			free(wrbuf);
-		} else {
-			if (!all_ff(buf, mtd->writesize))
-				ret = mtd->write(mtd, offset, now, &retlen,
-						  buf);
+		} else if (!all_ff(buf, mtd->writesize)) {
+			blockleft = mtd->erasesize - offset % mtd->erasesize;
+
+			while (now + mtd->writesize <= count &&
+					now < blockleft &&
+					!all_ff(buf + now, mtd->writesize))
+				now += mtd->writesize;
+
+			ret = mtd->write(mtd, offset, now, &retlen, buf);
 			dev_dbg(cdev->dev,
 				"offset: 0x%08lx now: 0x%08x retlen: 0x%08x\n",
 				offset, now, retlen);
@@ -203,6 +257,16 @@ static ssize_t mtd_erase(struct cdev *cdev, size_t count, loff_t offset)
 
 	return 0;
 }
+
+static int mtd_flush(struct cdev *cdev)
+{
+	struct mtd_info *mtd = cdev->priv;
+
+	if (mtd->sync)
+		mtd->sync(mtd);
+
+	return 0;
+}
 #endif
 
 static struct file_operations mtd_ops = {
@@ -210,6 +274,7 @@ static struct file_operations mtd_ops = {
 #ifdef CONFIG_MTD_WRITE
 	.write  = mtd_write,
 	.erase  = mtd_erase,
+	.flush  = mtd_flush,
 #endif
 	.ioctl  = mtd_ioctl,
 	.lseek  = dev_lseek_default,
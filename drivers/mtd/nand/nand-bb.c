@@ -32,6 +32,7 @@
 #include <fcntl.h>
 #include <libgen.h>
 #include <linux/list.h>
+#include <asm-generic/div64.h>
 
 struct nand_bb {
 	char cdevname[MAX_DRIVER_NAME];
@@ -48,11 +49,93 @@ struct nand_bb {
 	unsigned long flags;
 	void *writebuf;
 
+	/*
+	 * Maps the logical (good) blocks of the device to the physical
+	 * blocks of the parent, so that offsets can be translated without
+	 * walking over all blocks before them. The map is extended when an
+	 * offset behind its end is accessed, scanned is the number of
+	 * physical blocks looked at so far.
+	 */
+	unsigned int *blocks;
+	unsigned int raw_blocks;
+	unsigned int mapped;
+	unsigned int scanned;
+
 	struct cdev cdev;
 
 	struct list_head list;
 };
 
+/*
+ * The device is as large as the good blocks found so far plus the blocks
+ * not looked at yet. It shrinks when the map runs over bad blocks.
+ */
+static void nand_bb_update_size(struct nand_bb *bb)
+{
+	bb->cdev.size = (loff_t)(bb->mapped + bb->raw_blocks - bb->scanned) *
+		bb->info.erasesize;
+}
+
+/* Forget the map, it is built up again on the next access */
+static void nand_bb_reset_map(struct nand_bb *bb)
+{
+	bb->mapped = 0;
+	bb->scanned = 0;
+	nand_bb_update_size(bb);
+}
+
+/*
+ * Extend the map up to the logical block. Returns -ENOSPC if the device
+ * has less good blocks.
+ */
+static int nand_bb_map(struct nand_bb *bb, unsigned int block)
+{
+	loff_t pos;
+	int ret = 0;
+
+	while (bb->mapped <= block) {
+		if (bb->scanned == bb->raw_blocks) {
+			ret = -ENOSPC;
+			break;
+		}
+
+		pos = (loff_t)bb->scanned * bb->info.erasesize;
+
+		ret = cdev_ioctl(bb->cdev_parent, MEMGETBADBLOCK, &pos);
+		if (ret < 0)
+			break;
+		if (!ret)
+			bb->blocks[bb->mapped++] = bb->scanned;
+		bb->scanned++;
+		ret = 0;
+	}
+
+	nand_bb_update_size(bb);
+
+	return ret;
+}
+
+/*
+ * Translate an offset in the bb device to an offset in the parent
+ * device.
+ */
+static int nand_bb_phys(struct nand_bb *bb, loff_t offset, loff_t *phys)
+{
+	uint64_t block = offset;
+	uint32_t ofs;
+	int ret;
+
+	ofs = do_div(block, bb->info.erasesize);
+
+	ret = nand_bb_map(bb, block);
+	if (ret)
+		return ret;
+
+	*phys = (loff_t)bb->blocks[block] * bb->info.erasesize + ofs;
+
+	return 0;
+}
+
 static ssize_t nand_bb_read(struct cdev *cdev, void *buf, size_t count,
 	loff_t offset, ulong flags)
 {
@@ -60,30 +143,35 @@ static ssize_t nand_bb_read(struct cdev *cdev, void *buf, size_t count,
 	struct cdev *parent = bb->cdev_parent;
 	int ret, bytes = 0, now;
 
-	debug("%s %d %d\n", __func__, offset, count);
+	debug("%s %lld %d\n", __func__, offset, count);
+
+	if (offset >= bb->cdev.size)
+		return 0;
+
+	count = min_t(loff_t, count, bb->cdev.size - offset);
 
 	while(count) {
-		ret = cdev_ioctl(parent, MEMGETBADBLOCK, &bb->offset);
-		if (ret < 0)
-			return ret;
+		loff_t phys;
 
-		if (ret) {
-			printf("skipping bad block at 0x%08llx\n", bb->offset);
-			bb->offset += bb->info.erasesize;
-			continue;
-		}
+		ret = nand_bb_phys(bb, offset, &phys);
+		if (ret == -ENOSPC)
+			break;
+		if (ret)
+			return ret;
 
 		now = min(count, (size_t)(bb->info.erasesize -
-				((size_t)bb->offset % bb->info.erasesize)));
-		ret = cdev_read(parent, buf, now, bb->offset, 0);
+				((size_t)phys % bb->info.erasesize)));
+		ret = cdev_read(parent, buf, now, phys, 0);
 		if (ret < 0)
 			return ret;
 		buf += now;
 		count -= now;
-		bb->offset += now;
+		offset += now;
 		bytes += now;
 	};
 
+	bb->offset = offset;
+
 	return bytes;
 }
 
@@ -91,33 +179,26 @@ static ssize_t nand_bb_read(struct cdev *cdev, void *buf, size_t count,
 #define BB_WRITEBUF_SIZE	4096
 
 #ifdef CONFIG_MTD_WRITE
+/*
+ * Write out the write buffer. As the buffer size divides the erase block
+ * size, the buffer never crosses a block boundary.
+ */
 static int nand_bb_write_buf(struct nand_bb *bb, size_t count)
 {
-	int ret, now;
-	struct cdev *parent = bb->cdev_parent;
-	void *buf = bb->writebuf;
-	off_t cur_ofs = bb->offset & ~(BB_WRITEBUF_SIZE - 1);
+	loff_t cur_ofs = bb->offset & ~(BB_WRITEBUF_SIZE - 1);
+	loff_t phys;
+	int ret;
 
-	while (count) {
-		ret = cdev_ioctl(parent, MEMGETBADBLOCK, &cur_ofs);
-		if (ret < 0)
-			return ret;
+	if (cur_ofs >= bb->cdev.size)
+		return -ENOSPC;
 
-		if (ret) {
-			debug("skipping bad block at 0x%08x\n", cur_ofs);
-			bb->offset += bb->info.erasesize;
-			cur_ofs += bb->info.erasesize;
-			continue;
-		}
+	ret = nand_bb_phys(bb, cur_ofs, &phys);
+	if (ret)
+		return ret;
 
-		now = min(count, (size_t)(bb->info.erasesize));
-		ret = cdev_write(parent, buf, now, cur_ofs, 0);
-		if (ret < 0)
-			return ret;
-		buf += now;
-		count -= now;
-		cur_ofs += now;
-	};
+	ret = cdev_write(bb->cdev_parent, bb->writebuf, count, phys, 0);
+	if (ret < 0)
+		return ret;
 
 	return 0;
 }
@@ -172,6 +253,13 @@ static int nand_bb_open(struct cdev *cdev, unsigned long flags)
 	if (bb->open)
 		return -EBUSY;
 
+	/*
+	 * Blocks may have gone bad since we last looked, writes must not
+	 * go to them. Reading through the cached map is fine.
+	 */
+	if (flags & O_ACCMODE)
+		nand_bb_reset_map(bb);
+
 	bb->flags = flags;
 	bb->open = 1;
 	bb->offset = 0;
@@ -195,54 +283,20 @@ static int nand_bb_close(struct cdev *cdev)
 	return 0;
 }
 
-static int nand_bb_calc_size(struct nand_bb *bb)
-{
-	loff_t pos = 0;
-	int ret;
-
-	while (pos < bb->raw_size) {
-		ret = cdev_ioctl(bb->cdev_parent, MEMGETBADBLOCK, &pos);
-		if (ret < 0)
-			return ret;
-		if (!ret)
-			bb->cdev.size += bb->info.erasesize;
-
-		pos += bb->info.erasesize;
-	}
-
-	return 0;
-}
-
-static loff_t nand_bb_lseek(struct cdev *cdev, loff_t __offset)
+static loff_t nand_bb_lseek(struct cdev *cdev, loff_t offset)
 {
 	struct nand_bb *bb = cdev->priv;
-	unsigned long raw_pos = 0;
-	uint32_t offset = __offset;
-	int ret;
 
 	/* lseek only in readonly mode */
 	if (bb->flags & O_ACCMODE)
 		return -ENOSYS;
-	while (raw_pos < bb->raw_size) {
-		off_t now = min(offset, bb->info.erasesize);
 
-		ret = cdev_ioctl(bb->cdev_parent, MEMGETBADBLOCK, (void *)raw_pos);
-		if (ret < 0)
-			return ret;
-		if (!ret) {
-			offset -= now;
-			raw_pos += now;
-		} else {
-			raw_pos += bb->info.erasesize;
-		}
+	if (offset > bb->cdev.size)
+		return -EINVAL;
 
-		if (!offset) {
-			bb->offset = raw_pos;
-			return __offset;
-		}
-	}
+	bb->offset = offset;
 
-	return -EINVAL;
+	return offset;
 }
 
 static struct file_operations nand_bb_ops = {
@@ -267,6 +321,7 @@ static LIST_HEAD(bb_list);
 int dev_add_bb_dev(char *path, const char *name)
 {
 	struct nand_bb *bb;
+	uint64_t raw_blocks;
 	int ret = -ENOMEM;
 
 	bb = xzalloc(sizeof(*bb));
@@ -290,7 +345,12 @@ int dev_add_bb_dev(char *path, const char *name)
 	if (ret)
 		goto out4;
 
-	nand_bb_calc_size(bb);
+	raw_blocks = bb->raw_size;
+	do_div(raw_blocks, bb->info.erasesize);
+	bb->raw_blocks = raw_blocks;
+	bb->blocks = xmalloc(bb->raw_blocks * sizeof(*bb->blocks));
+	nand_bb_reset_map(bb);
+
 	bb->cdev.ops = &nand_bb_ops;
 	bb->cdev.priv = bb;
 
@@ -303,6 +363,7 @@ int dev_add_bb_dev(char *path, const char *name)
 	return 0;
 
 out4:
+	free(bb->blocks);
 	cdev_close(bb->cdev_parent);
 out1:
 	free(bb);
@@ -312,11 +373,16 @@ out1:
 int dev_remove_bb_dev(const char *name)
 {
 	struct nand_bb *bb;
+	int ret;
 
 	list_for_each_entry(bb, &bb_list, list) {
 		if (!strcmp(bb->cdev.name, name)) {
-			devfs_remove(&bb->cdev);
+			ret = devfs_remove(&bb->cdev);
+			if (ret)
+				return ret;
+			list_del(&bb->list);
 			cdev_close(bb->cdev_parent);
+			free(bb->blocks);
 			free(bb);
 			return 0;
 		}
@@ -24,6 +24,8 @@ int nand_write(struct mtd_info *mtd, loff_t to, size_t len,
 int nand_write_oob(struct mtd_info *mtd, loff_t to,
 			  struct mtd_oob_ops *ops);
 
+void nand_pagecache_invalidate(struct nand_chip *chip, int first, int last);
+
 void nand_init_ecc_hw(struct nand_chip *chip);
 void nand_init_ecc_soft(struct nand_chip *chip);
 void nand_init_ecc_hw_syndrome(struct nand_chip *chip);
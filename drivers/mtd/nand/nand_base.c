@@ -644,6 +644,90 @@ static uint8_t *nand_transfer_oob(struct nand_chip *chip, uint8_t *oob,
 }
 #endif
 
+/*
+ * The page cache holds pages read partially and pages read ahead. Pages
+ * are replaced in the order they were added.
+ */
+static uint8_t *nand_pagecache_find(struct nand_chip *chip, int page)
+{
+	int i;
+
+	for (i = 0; i < NAND_PAGECACHE_PAGES; i++)
+		if (chip->pagecache[i] == page)
+			return chip->pagecache_buf + (i << chip->page_shift);
+
+	return NULL;
+}
+
+static uint8_t *nand_pagecache_add(struct nand_chip *chip, int page)
+{
+	int i = chip->pagecache_next;
+
+	chip->pagecache_next = (i + 1) % NAND_PAGECACHE_PAGES;
+	chip->pagecache[i] = page;
+
+	return chip->pagecache_buf + (i << chip->page_shift);
+}
+
+/**
+ * nand_pagecache_invalidate - drop pages from the page cache
+ * @chip:	NAND chip descriptor
+ * @first:	first page to drop
+ * @last:	last page to drop
+ */
+void nand_pagecache_invalidate(struct nand_chip *chip, int first, int last)
+{
+	int i;
+
+	for (i = 0; i < NAND_PAGECACHE_PAGES; i++)
+		if (chip->pagecache[i] >= first && chip->pagecache[i] <= last)
+			chip->pagecache[i] = -1;
+}
+
+/*
+ * Continue a cache read sequence: move the page read ahead by the chip
+ * to the cache register. With more pages to come the chip starts reading
+ * the next one while the current page is transferred.
+ */
+static void nand_cacheread_next(struct mtd_info *mtd, struct nand_chip *chip,
+		int more)
+{
+	chip->cmdfunc(mtd, more ? NAND_CMD_READCACHESEQ : NAND_CMD_READCACHEEND,
+			-1, -1);
+}
+
+/*
+ * Read pages following a read into the page cache, as far as the cache
+ * read sequence was started. Errors just end the read-ahead, the pages
+ * are read again when they are really needed.
+ */
+static void nand_read_ahead(struct mtd_info *mtd, struct nand_chip *chip,
+		int realpage, int seqlast)
+{
+	unsigned int failed = mtd->ecc_stats.failed;
+	uint8_t *bufpoi;
+	int ret;
+
+	while (++realpage <= seqlast) {
+		nand_cacheread_next(mtd, chip, realpage < seqlast);
+
+		bufpoi = nand_pagecache_add(chip, realpage);
+
+		ret = chip->ecc.read_page(mtd, chip, bufpoi);
+		if (ret < 0 || mtd->ecc_stats.failed != failed) {
+			nand_pagecache_invalidate(chip, realpage, realpage);
+			/* The chip still has to be taken out of cache mode */
+			if (realpage < seqlast)
+				chip->cmdfunc(mtd, NAND_CMD_READCACHEEND,
+						-1, -1);
+			break;
+		}
+	}
+
+	/* Only count errors in pages which are really read */
+	mtd->ecc_stats.failed = failed;
+}
+
 /**
  * nand_do_read_ops - [Internal] Read data with ECC
  *
@@ -652,6 +736,12 @@ static uint8_t *nand_transfer_oob(struct nand_chip *chip, uint8_t *oob,
  * @ops:	oob ops structure
  *
  * Internal function. Called with chip held.
+ *
+ * Consecutive pages in an erase block are read with the cache read
+ * commands if the chip supports them, so the chip reads the next page
+ * while the current one is transferred. When the caller reads through
+ * the flash sequentially, the sequence is continued for some pages into
+ * the page cache.
  */
 static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 			    struct mtd_oob_ops *ops)
@@ -664,7 +754,10 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 	int ret = 0;
 	uint32_t readlen = ops->len;
 	uint32_t oobreadlen = ops->ooblen;
-	uint8_t *bufpoi, *oob, *buf;
+	uint8_t *bufpoi, *oob, *buf, *cached;
+	unsigned int failed;
+	int raw = ops->mode == MTD_OOB_RAW;
+	int lastpage, seqlast = -1, readahead = 0;
 
 	stats = mtd->ecc_stats;
 
@@ -673,38 +766,82 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 
 	realpage = (int)(from >> chip->page_shift);
 	page = realpage & chip->pagemask;
+	lastpage = (int)((from + readlen - 1) >> chip->page_shift);
 
 	col = (int)(from & (mtd->writesize - 1));
 
 	buf = ops->datbuf;
 	oob = ops->oobbuf;
 
+	/*
+	 * Read ahead when the last reads went through the flash page by
+	 * page. Reading further in the same page counts as sequential.
+	 */
+	if (!oob && !raw && (chip->options & NAND_CACHEREAD)) {
+		if (realpage == chip->ra_next || realpage == chip->ra_next - 1)
+			chip->ra_seq++;
+		else
+			chip->ra_seq = 0;
+		chip->ra_next = lastpage + 1;
+
+		if (chip->ra_seq >= 2)
+			readahead = NAND_READAHEAD_PAGES;
+	}
+
 	while(1) {
 		bytes = min(mtd->writesize - col, readlen);
 		aligned = (bytes == mtd->writesize);
 
-		/* Is the current page in the buffer ? */
-		if (realpage != chip->pagebuf || oob) {
-			bufpoi = aligned ? buf : chip->buffers->databuf;
+		/*
+		 * Is the current page in the cache ? Not while the chip is
+		 * in a cache read sequence, it has to read all its pages.
+		 */
+		cached = NULL;
+		if (realpage > seqlast && !oob && !raw)
+			cached = nand_pagecache_find(chip, realpage);
+
+		if (!cached) {
+			if (aligned)
+				bufpoi = buf;
+			else if (!oob && !raw)
+				bufpoi = nand_pagecache_add(chip, realpage);
+			else
+				bufpoi = chip->buffers->databuf;
 
 			if (likely(sndcmd)) {
 				chip->cmdfunc(mtd, NAND_CMD_READ0, 0x00, page);
 				sndcmd = 0;
+
+				if (chip->options & NAND_CACHEREAD) {
+					seqlast = min(lastpage + readahead,
+						realpage | blkcheck);
+					if (seqlast > realpage)
+						nand_cacheread_next(mtd, chip, 1);
+				}
+			} else if (realpage <= seqlast) {
+				nand_cacheread_next(mtd, chip,
+						realpage < seqlast);
 			}
 
 			/* Now read the page into the buffer */
-			if (unlikely(ops->mode == MTD_OOB_RAW))
+			failed = mtd->ecc_stats.failed;
+			if (unlikely(raw))
 				ret = chip->ecc.read_page_raw(mtd, chip, bufpoi);
 			else
 				ret = chip->ecc.read_page(mtd, chip, bufpoi);
-			if (ret < 0)
+			if (ret < 0 || mtd->ecc_stats.failed != failed)
+				nand_pagecache_invalidate(chip, realpage,
+						realpage);
+			if (ret < 0) {
+				if (realpage < seqlast)
+					chip->cmdfunc(mtd,
+						NAND_CMD_READCACHEEND, -1, -1);
 				break;
+			}
 
 			/* Transfer not aligned data */
-			if (!aligned) {
-				chip->pagebuf = realpage;
-				memcpy(buf, chip->buffers->databuf + col, bytes);
-			}
+			if (!aligned)
+				memcpy(buf, bufpoi + col, bytes);
 
 			buf += bytes;
 
@@ -738,8 +875,10 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 					nand_wait_ready(mtd);
 			}
 		} else {
-			memcpy(buf, chip->buffers->databuf + col, bytes);
+			memcpy(buf, cached + col, bytes);
 			buf += bytes;
+			/* The chip has not auto incremented over this page */
+			sndcmd = 1;
 		}
 
 		readlen -= bytes;
@@ -765,8 +904,14 @@ static int nand_do_read_ops(struct mtd_info *mtd, loff_t from,
 		 */
 		if (!NAND_CANAUTOINCR(chip) || !(page & blkcheck))
 			sndcmd = 1;
+		/* A cache read sequence continues up to its last page */
+		if (realpage <= seqlast)
+			sndcmd = 0;
 	}
 
+	if (!ret && realpage < seqlast)
+		nand_read_ahead(mtd, chip, realpage, seqlast);
+
 	ops->retlen = ops->len - (size_t) readlen;
 	if (oob)
 		ops->oobretlen = ops->ooblen - oobreadlen;
@@ -981,6 +1126,18 @@ int nand_block_isbad(struct mtd_info *mtd, loff_t offs)
 	return nand_block_checkbad(mtd, offs, 1, 0);
 }
 
+/**
+ * nand_sync - [MTD Interface] write out pending data
+ * @mtd:	MTD device structure
+ */
+static void nand_sync(struct mtd_info *mtd)
+{
+#ifdef CONFIG_NAND_BBT_LAZY
+	/* Write a bad block table created on demand */
+	nand_persist_bbt(mtd);
+#endif
+}
+
 /*
  * Set default functions
  */
@@ -1395,8 +1552,9 @@ int nand_scan_tail(struct mtd_info *mtd)
 	/* De-select the device */
 	chip->select_chip(mtd, -1);
 
-	/* Invalidate the pagebuffer reference */
-	chip->pagebuf = -1;
+	/* Set up the page cache */
+	chip->pagecache_buf = xmalloc(NAND_PAGECACHE_PAGES << chip->page_shift);
+	nand_pagecache_invalidate(chip, 0, INT_MAX);
 
 	/* Fill in remaining MTD driver data */
 	mtd->type = MTD_NANDFLASH;
@@ -1415,6 +1573,7 @@ int nand_scan_tail(struct mtd_info *mtd)
 	mtd->block_isbad = nand_block_isbad;
 #ifdef CONFIG_MTD_WRITE
 	mtd->block_markbad = nand_block_markbad;
+	mtd->sync = nand_sync;
 #endif
 	/* propagate ecc.layout to mtd_info */
 	mtd->ecclayout = chip->ecc.layout;
@@ -1465,6 +1624,10 @@ void nand_release(struct mtd_info *mtd)
 
 	/* Free bad block table memory */
 	kfree(chip->bbt);
+#ifdef CONFIG_NAND_BBT_LAZY
+	kfree(chip->bbt_scanned);
+	kfree(chip->bbt_scan_buf);
+#endif
 	if (!(chip->options & NAND_OWN_BUFFERS))
 		kfree(chip->buffers);
 }
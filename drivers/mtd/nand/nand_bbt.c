@@ -46,6 +46,11 @@
  *
  * Multichip devices like DOC store the bad block info per floor.
  *
+ * With CONFIG_NAND_BBT_LAZY a table which has to be created by scanning
+ * the device is filled in block by block, when the state of a block is
+ * queried for the first time. A table on the flash is only written on an
+ * explicit update, see nand_persist_bbt().
+ *
  * Following assumptions are made:
  * - bbts start at a page boundary, if autolocated on a block boundary
  * - the space necessary for a bbt in FLASH does not exceed a block boundary
@@ -947,6 +952,204 @@ static void mark_bbt_region(struct mtd_info *mtd, struct nand_bbt_descr *td)
 	}
 }
 
+#ifdef CONFIG_NAND_BBT_LAZY
+/*
+ * Prepare scanning the blocks on demand instead of creating the table
+ * now. Only possible when checking the first pages of a block is enough.
+ */
+static int nand_bbt_lazy_init(struct mtd_info *mtd, struct nand_bbt_descr *bd)
+{
+	struct nand_chip *this = mtd->priv;
+	int numblocks = mtd->size >> this->bbt_erase_shift;
+
+	if (bd->options & (NAND_BBT_SCANALLPAGES | NAND_BBT_SCANEMPTY))
+		return -EINVAL;
+
+	this->bbt_scanned = kzalloc(DIV_ROUND_UP(numblocks, 8), GFP_KERNEL);
+	if (!this->bbt_scanned)
+		return -ENOMEM;
+
+	/*
+	 * Blocks are scanned from within other operations, the chip's
+	 * buffers may be in use then.
+	 */
+	this->bbt_scan_buf = kmalloc(mtd->oobsize, GFP_KERNEL);
+	if (!this->bbt_scan_buf) {
+		kfree(this->bbt_scanned);
+		this->bbt_scanned = NULL;
+		return -ENOMEM;
+	}
+
+	this->bbt_unscanned = numblocks;
+	this->bbt_scan_bd = bd;
+
+	return 0;
+}
+
+/*
+ * Scan a block for the bad block marker, if it has not been scanned yet
+ */
+static int nand_bbt_scan_block(struct mtd_info *mtd, int block)
+{
+	struct nand_chip *this = mtd->priv;
+	struct nand_bbt_descr *bd = this->bbt_scan_bd;
+	loff_t from = (loff_t)block << this->bbt_erase_shift;
+	int ret;
+
+	if (!this->bbt_scanned ||
+			this->bbt_scanned[block >> 3] & (1 << (block & 0x07)))
+		return 0;
+
+	ret = scan_block_fast(mtd, bd, from, this->bbt_scan_buf,
+			(bd->options & NAND_BBT_SCAN2NDPAGE) ? 2 : 1);
+	if (ret < 0)
+		return ret;
+
+	if (ret) {
+		this->bbt[block >> 2] |= 0x03 << ((block & 0x03) * 2);
+		printk(KERN_WARNING "Bad eraseblock %d at 0x%08x\n",
+		       block, (unsigned int)from);
+		mtd->ecc_stats.badblocks++;
+	}
+
+	this->bbt_scanned[block >> 3] |= 1 << (block & 0x07);
+
+	if (!--this->bbt_unscanned) {
+		kfree(this->bbt_scanned);
+		this->bbt_scanned = NULL;
+		kfree(this->bbt_scan_buf);
+		this->bbt_scan_buf = NULL;
+	}
+
+	return 0;
+}
+
+/*
+ * Scan all blocks not scanned yet, so that the table is complete
+ */
+static int nand_bbt_scan_all(struct mtd_info *mtd)
+{
+	struct nand_chip *this = mtd->priv;
+	int block, ret;
+
+	for (block = 0; this->bbt_scanned; block++) {
+		ret = nand_bbt_scan_block(mtd, block);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * The blocks reserved for an automatically placed table have to be
+ * scanned before they are marked as reserved, so that bad ones are not
+ * used for the table.
+ */
+static int nand_bbt_scan_region(struct mtd_info *mtd, struct nand_bbt_descr *td)
+{
+	struct nand_chip *this = mtd->priv;
+	int i, j, chips, block, nrblocks, ret;
+
+	if (td->options & NAND_BBT_PERCHIP) {
+		chips = this->numchips;
+		nrblocks = (int)(this->chipsize >> this->bbt_erase_shift);
+	} else {
+		chips = 1;
+		nrblocks = (int)(mtd->size >> this->bbt_erase_shift);
+	}
+
+	for (i = 0; i < chips; i++) {
+		if (td->options & NAND_BBT_LASTBLOCK)
+			block = ((i + 1) * nrblocks) - td->maxblocks;
+		else
+			block = i * nrblocks;
+
+		for (j = 0; j < td->maxblocks; j++) {
+			ret = nand_bbt_scan_block(mtd, block + j);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Check if none of the tables was found on the flash, so the whole table
+ * has to be created and can be created on demand.
+ */
+static int nand_bbt_none_found(struct mtd_info *mtd)
+{
+	struct nand_chip *this = mtd->priv;
+	struct nand_bbt_descr *td = this->bbt_td;
+	struct nand_bbt_descr *md = this->bbt_md;
+	int i, chips;
+
+	if (!(td->options & NAND_BBT_CREATE) ||
+			(td->options & NAND_BBT_ABSPAGE))
+		return 0;
+
+	chips = (td->options & NAND_BBT_PERCHIP) ? this->numchips : 1;
+
+	for (i = 0; i < chips; i++)
+		if (td->pages[i] != -1 || (md && md->pages[i] != -1))
+			return 0;
+
+	return 1;
+}
+
+/**
+ * nand_persist_bbt - [NAND Interface] write a table created on demand
+ * @mtd:	MTD device structure
+ *
+ * If the device uses a flash based table and none was found, the blocks
+ * not scanned yet are scanned and the table is written to the flash.
+ * This must not be called from within other NAND operations.
+ */
+int nand_persist_bbt(struct mtd_info *mtd)
+{
+	struct nand_chip *this = mtd->priv;
+	struct nand_bbt_descr *td = this->bbt_td;
+	struct nand_bbt_descr *md = this->bbt_md;
+	int i, len, res = 0;
+	uint8_t *buf;
+
+	if (!this->bbt_persist)
+		return 0;
+
+	res = nand_bbt_scan_all(mtd);
+	if (res)
+		return res;
+
+	this->bbt_persist = 0;
+
+	len = (1 << this->bbt_erase_shift);
+	len += (len >> this->page_shift) * mtd->oobsize;
+	buf = vmalloc(len);
+	if (!buf)
+		return -ENOMEM;
+
+	for (i = 0; i < NAND_MAX_CHIPS; i++) {
+		td->version[i] = 1;
+		if (md)
+			md->version[i] = 1;
+	}
+
+	if (td->options & NAND_BBT_WRITE)
+		res = write_bbt(mtd, buf, td, md, -1);
+	if (!res && md && (md->options & NAND_BBT_WRITE))
+		res = write_bbt(mtd, buf, md, td, -1);
+
+	if (res)
+		printk(KERN_WARNING "nand_bbt: writing the bad block table "
+		       "failed: %d\n", res);
+
+	vfree(buf);
+	return res;
+}
+#endif
+
 /**
  * nand_scan_bbt - [NAND Interface] scan, find, read and maybe create bad block table(s)
  * @mtd:	MTD device structure
@@ -981,6 +1184,10 @@ int nand_scan_bbt(struct mtd_info *mtd, struct nand_bbt_descr *bd)
 	 * to build a memory based bad block table
 	 */
 	if (!td) {
+#ifdef CONFIG_NAND_BBT_LAZY
+		if (!nand_bbt_lazy_init(mtd, bd))
+			return 0;
+#endif
 		if ((res = nand_memory_bbt(mtd, bd))) {
 			printk(KERN_ERR "nand_bbt: Can't scan flash and build the RAM-based BBT\n");
 			kfree(this->bbt);
@@ -1008,6 +1215,15 @@ int nand_scan_bbt(struct mtd_info *mtd, struct nand_bbt_descr *bd)
 		res = search_read_bbts(mtd, buf, td, md);
 	}
 
+#ifdef CONFIG_NAND_BBT_LAZY
+	if (res && nand_bbt_none_found(mtd) && !nand_bbt_lazy_init(mtd, bd)) {
+		/* Written by nand_persist_bbt() on request */
+		this->bbt_persist = 1;
+		res = nand_bbt_scan_region(mtd, td);
+		if (!res && md)
+			res = nand_bbt_scan_region(mtd, md);
+	} else
+#endif
 	if (res)
 		res = check_create(mtd, buf, bd);
 
@@ -1039,6 +1255,14 @@ int nand_update_bbt(struct mtd_info *mtd, loff_t offs)
 	if (!this->bbt || !td)
 		return -EINVAL;
 
+#ifdef CONFIG_NAND_BBT_LAZY
+	/* Only a complete table can be written */
+	res = nand_bbt_scan_all(mtd);
+	if (res)
+		return res;
+	this->bbt_persist = 0;
+#endif
+
 	len = mtd->size >> (this->bbt_erase_shift + 2);
 	/* Allocate a temporary buffer for one eraseblock incl. oob */
 	len = (1 << this->bbt_erase_shift);
@@ -1211,6 +1435,14 @@ int nand_isbad_bbt(struct mtd_info *mtd, loff_t offs, int allowbbt)
 
 	/* Get block number * 2 */
 	block = (int)(offs >> (this->bbt_erase_shift - 1));
+
+#ifdef CONFIG_NAND_BBT_LAZY
+	{
+		int ret = nand_bbt_scan_block(mtd, block >> 1);
+		if (ret)
+			return ret;
+	}
+#endif
 	res = (this->bbt[block >> 3] >> (block & 0x06)) & 0x03;
 
 	MTD_DEBUG(MTD_DEBUG_LEVEL2, "nand_isbad_bbt(): bbt info for offs 0x%08x: (block %d) 0x%02x\n",
@@ -1229,5 +1461,8 @@ int nand_isbad_bbt(struct mtd_info *mtd, loff_t offs, int allowbbt)
 
 EXPORT_SYMBOL(nand_scan_bbt);
 EXPORT_SYMBOL(nand_default_bbt);
+#ifdef CONFIG_NAND_BBT_LAZY
+EXPORT_SYMBOL(nand_persist_bbt);
+#endif
 
 #endif /* DOXYGEN_SHOULD_SKIP_THIS */
@@ -0,0 +1,701 @@
+/*
+ * NAND flash simulator for the sandbox
+ *
+ * The chip is emulated on the command/address latch level below the
+ * generic nand_command()/nand_command_lp() functions, so the whole NAND
+ * stack including ECC and bad block handling is exercised. The flash
+ * array is a host file holding page data and oob of each page
+ * interleaved. The chip supports the ONFI read cache commands unless the
+ * cacheread=0 option is given. With flashbbt=1 the bad block table is
+ * kept on the flash.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <driver.h>
+#include <init.h>
+#include <malloc.h>
+#include <errno.h>
+#include <clock.h>
+#include <xfuncs.h>
+#include <stdlib.h>
+#include <sizes.h>
+#include <linux/mtd/mtd.h>
+#include <linux/mtd/nand.h>
+#include <mach/hostfile.h>
+
+/* ID of the emulated chip, the 4th byte describes the geometry */
+#define SANDBOX_NAND_MAF_ID	NAND_MFR_MICRON
+
+struct sandbox_nand {
+	struct mtd_info mtd;
+	struct nand_chip chip;
+	struct nand_ecclayout layout;
+	struct device_d *dev;
+
+	u8 *array;
+	unsigned int pagesize, oobsize, rawsize;
+	unsigned int pages_per_block;
+	unsigned int numpages;
+	int largepage;
+	u8 id[4];
+	int cacheread_enabled;
+	int flashbbt;
+
+	/* command state */
+	unsigned int cmd;
+	u8 addr[5];
+	int naddr;
+	int output;
+	unsigned int id_pos;
+	unsigned int area;		/* small page read pointer */
+	unsigned int column;
+	unsigned int page;
+	u8 *reg;			/* cache register, data and oob */
+
+	/* cache read: the page register is loaded in the background */
+	int cacheread;
+	u8 *areg;
+	unsigned int apage;
+	u64 aready;			/* time_ns when areg is loaded */
+
+	/*
+	 * Timing model in ns, time_ns accumulates the time a real chip
+	 * would have needed. With delay set the time is actually waited.
+	 */
+	u64 t_read;
+	u64 t_prog;
+	u64 t_erase;
+	u64 t_byte;
+	u64 t_rcbsy;
+	u64 delay;
+
+	/* flip this many bits on every bitflip_interval-th page read */
+	u64 bitflips;
+	u64 bitflip_interval;
+
+	u64 reads;
+	u64 programs;
+	u64 erases;
+	u64 time_ns;
+};
+
+enum {
+	OUTPUT_NONE,
+	OUTPUT_ID,
+	OUTPUT_STATUS,
+	OUTPUT_DATA,
+};
+
+static void sandbox_nand_busy(struct sandbox_nand *sn, u64 ns)
+{
+	sn->time_ns += ns;
+
+	if (sn->delay)
+		ndelay(ns);
+}
+
+/* decode the row (page) address following the column address cycles */
+static unsigned int sandbox_nand_row(struct sandbox_nand *sn, int skip)
+{
+	unsigned int row = 0;
+	int i;
+
+	for (i = sn->naddr - 1; i >= skip; i--)
+		row = (row << 8) | sn->addr[i];
+
+	return row;
+}
+
+static void sandbox_nand_set_column(struct sandbox_nand *sn)
+{
+	if (sn->largepage)
+		sn->column = sn->addr[0] | (sn->addr[1] << 8);
+	else
+		sn->column = sn->area + sn->addr[0];
+}
+
+static void sandbox_nand_bitflips(struct sandbox_nand *sn, u8 *buf)
+{
+	unsigned int bit;
+	int i;
+
+	if (!sn->bitflip_interval || sn->reads % sn->bitflip_interval)
+		return;
+
+	for (i = 0; i < sn->bitflips; i++) {
+		bit = ((rand() << 15) | rand()) % (sn->pagesize * 8);
+		buf[bit / 8] ^= 1 << (bit % 8);
+	}
+}
+
+/* read a page from the array */
+static void sandbox_nand_fetch(struct sandbox_nand *sn, unsigned int page,
+		u8 *buf)
+{
+	if (page >= sn->numpages) {
+		dev_err(sn->dev, "read beyond end of flash: page %u\n", page);
+		memset(buf, 0xff, sn->rawsize);
+		return;
+	}
+
+	memcpy(buf, sn->array + page * sn->rawsize, sn->rawsize);
+	sn->reads++;
+	sandbox_nand_bitflips(sn, buf);
+}
+
+static void sandbox_nand_load(struct sandbox_nand *sn)
+{
+	sn->page = sandbox_nand_row(sn, sn->largepage ? 2 : 1);
+	sandbox_nand_set_column(sn);
+	sn->naddr = 0;
+
+	sandbox_nand_fetch(sn, sn->page, sn->reg);
+
+	sandbox_nand_busy(sn, sn->t_read);
+	sn->output = OUTPUT_DATA;
+}
+
+/*
+ * READ CACHE SEQUENTIAL and READ CACHE END: wait until the page register
+ * is loaded and move it to the cache register. For READ CACHE SEQUENTIAL
+ * start loading the next page into the page register, this overlaps with
+ * the transfer of the current page.
+ */
+static void sandbox_nand_cacheread(struct sandbox_nand *sn, int more)
+{
+	if (sn->cacheread) {
+		if (sn->aready > sn->time_ns)
+			sandbox_nand_busy(sn, sn->aready - sn->time_ns);
+		memcpy(sn->reg, sn->areg, sn->rawsize);
+		sn->page = sn->apage;
+	} else if (!more) {
+		return;
+	}
+
+	sn->cacheread = more;
+	sandbox_nand_busy(sn, sn->t_rcbsy);
+
+	if (more) {
+		sn->apage = sn->page + 1;
+		sandbox_nand_fetch(sn, sn->apage, sn->areg);
+		sn->aready = sn->time_ns + sn->t_read;
+	}
+
+	sn->column = 0;
+	sn->output = OUTPUT_DATA;
+}
+
+static void sandbox_nand_program(struct sandbox_nand *sn)
+{
+	u8 *dst;
+	int i;
+
+	if (sn->page >= sn->numpages) {
+		dev_err(sn->dev, "program beyond end of flash: page %u\n",
+				sn->page);
+		return;
+	}
+
+	/* programming can only clear bits */
+	dst = sn->array + sn->page * sn->rawsize;
+	for (i = 0; i < sn->rawsize; i++)
+		dst[i] &= sn->reg[i];
+
+	sn->programs++;
+	sandbox_nand_busy(sn, sn->t_prog);
+}
+
+static void sandbox_nand_erase(struct sandbox_nand *sn)
+{
+	unsigned int page = sandbox_nand_row(sn, 0);
+
+	page -= page % sn->pages_per_block;
+
+	if (page >= sn->numpages) {
+		dev_err(sn->dev, "erase beyond end of flash: page %u\n", page);
+		return;
+	}
+
+	memset(sn->array + page * sn->rawsize, 0xff,
+			sn->pages_per_block * sn->rawsize);
+
+	sn->erases++;
+	sandbox_nand_busy(sn, sn->t_erase);
+}
+
+static void sandbox_nand_command(struct sandbox_nand *sn, unsigned int cmd)
+{
+	if (cmd == NAND_CMD_READCACHESEQ || cmd == NAND_CMD_READCACHEEND) {
+		if (sn->cacheread_enabled)
+			sandbox_nand_cacheread(sn,
+					cmd == NAND_CMD_READCACHESEQ);
+		return;
+	}
+
+	/* Anything else ends a cache read sequence */
+	if (cmd != NAND_CMD_RNDOUT && cmd != NAND_CMD_RNDOUTSTART &&
+			cmd != NAND_CMD_STATUS)
+		sn->cacheread = 0;
+
+	switch (cmd) {
+	case NAND_CMD_RESET:
+		sn->output = OUTPUT_NONE;
+		sn->area = 0;
+		break;
+	case NAND_CMD_READID:
+		sn->output = OUTPUT_ID;
+		sn->id_pos = 0;
+		break;
+	case NAND_CMD_STATUS:
+		sn->output = OUTPUT_STATUS;
+		return;
+	case NAND_CMD_READ0:
+	case NAND_CMD_READ1:
+	case NAND_CMD_READOOB:
+		/* the pointer commands of small page chips */
+		if (cmd == NAND_CMD_READ1)
+			sn->area = 256;
+		else if (cmd == NAND_CMD_READOOB)
+			sn->area = sn->pagesize;
+		else
+			sn->area = 0;
+		cmd = NAND_CMD_READ0;
+		/* also returns to data output after a status read */
+		sn->output = OUTPUT_DATA;
+		break;
+	case NAND_CMD_READSTART:
+		if (sn->cmd == NAND_CMD_READ0)
+			sandbox_nand_load(sn);
+		break;
+	case NAND_CMD_RNDOUTSTART:
+		if (sn->cmd == NAND_CMD_RNDOUT)
+			sandbox_nand_set_column(sn);
+		sn->output = OUTPUT_DATA;
+		break;
+	case NAND_CMD_SEQIN:
+		memset(sn->reg, 0xff, sn->rawsize);
+		sn->output = OUTPUT_NONE;
+		break;
+	case NAND_CMD_PAGEPROG:
+	case NAND_CMD_CACHEDPROG:
+		if (sn->cmd == NAND_CMD_SEQIN || sn->cmd == NAND_CMD_RNDIN)
+			sandbox_nand_program(sn);
+		break;
+	case NAND_CMD_ERASE2:
+		if (sn->cmd == NAND_CMD_ERASE1)
+			sandbox_nand_erase(sn);
+		break;
+	}
+
+	sn->cmd = cmd;
+	sn->naddr = 0;
+}
+
+/*
+ * The end of the address cycles. Small page chips start reading here,
+ * large page chips start after NAND_CMD_READSTART.
+ */
+static void sandbox_nand_address_done(struct sandbox_nand *sn)
+{
+	if (!sn->naddr)
+		return;
+
+	switch (sn->cmd) {
+	case NAND_CMD_READ0:
+		if (!sn->largepage)
+			sandbox_nand_load(sn);
+		break;
+	case NAND_CMD_SEQIN:
+		sn->page = sandbox_nand_row(sn, sn->largepage ? 2 : 1);
+		sandbox_nand_set_column(sn);
+		break;
+	case NAND_CMD_RNDIN:
+		sandbox_nand_set_column(sn);
+		break;
+	}
+}
+
+static void sandbox_nand_cmd_ctrl(struct mtd_info *mtd, int dat,
+		unsigned int ctrl)
+{
+	struct nand_chip *chip = mtd->priv;
+	struct sandbox_nand *sn = chip->priv;
+
+	if (dat == NAND_CMD_NONE) {
+		sandbox_nand_address_done(sn);
+		return;
+	}
+
+	if (ctrl & NAND_CLE) {
+		sandbox_nand_command(sn, dat & 0xff);
+	} else if (ctrl & NAND_ALE) {
+		if (sn->naddr < ARRAY_SIZE(sn->addr))
+			sn->addr[sn->naddr++] = dat;
+	}
+}
+
+static int sandbox_nand_dev_ready(struct mtd_info *mtd)
+{
+	return 1;
+}
+
+static void sandbox_nand_select_chip(struct mtd_info *mtd, int chipnr)
+{
+}
+
+static uint8_t sandbox_nand_read_byte(struct mtd_info *mtd)
+{
+	struct nand_chip *chip = mtd->priv;
+	struct sandbox_nand *sn = chip->priv;
+
+	switch (sn->output) {
+	case OUTPUT_ID:
+		if (sn->id_pos < ARRAY_SIZE(sn->id))
+			return sn->id[sn->id_pos++];
+		return 0;
+	case OUTPUT_STATUS:
+		return NAND_STATUS_READY | NAND_STATUS_WP;
+	case OUTPUT_DATA:
+		sandbox_nand_busy(sn, sn->t_byte);
+		if (sn->column < sn->rawsize)
+			return sn->reg[sn->column++];
+		return 0xff;
+	}
+
+	return 0xff;
+}
+
+static u16 sandbox_nand_read_word(struct mtd_info *mtd)
+{
+	return sandbox_nand_read_byte(mtd) |
+		(sandbox_nand_read_byte(mtd) << 8);
+}
+
+static void sandbox_nand_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
+{
+	struct nand_chip *chip = mtd->priv;
+	struct sandbox_nand *sn = chip->priv;
+	int now = 0;
+
+	if (sn->output == OUTPUT_DATA && sn->column < sn->rawsize) {
+		now = min_t(int, len, sn->rawsize - sn->column);
+		memcpy(buf, sn->reg + sn->column, now);
+		sn->column += now;
+	}
+
+	memset(buf + now, 0xff, len - now);
+	sandbox_nand_busy(sn, sn->t_byte * len);
+}
+
+static void sandbox_nand_write_buf(struct mtd_info *mtd, const uint8_t *buf,
+		int len)
+{
+	struct nand_chip *chip = mtd->priv;
+	struct sandbox_nand *sn = chip->priv;
+	int now;
+
+	if (sn->column >= sn->rawsize)
+		return;
+
+	now = min_t(int, len, sn->rawsize - sn->column);
+	memcpy(sn->reg + sn->column, buf, now);
+	sn->column += now;
+
+	sandbox_nand_busy(sn, sn->t_byte * len);
+}
+
+static int sandbox_nand_verify_buf(struct mtd_info *mtd, const uint8_t *buf,
+		int len)
+{
+	uint8_t *tmp = xmalloc(len);
+	int ret;
+
+	sandbox_nand_read_buf(mtd, tmp, len);
+	ret = memcmp(buf, tmp, len) ? -EFAULT : 0;
+	free(tmp);
+
+	return ret;
+}
+
+static const struct {
+	const char *name;
+	size_t offset;
+	unsigned long flags;
+} sandbox_nand_params[] = {
+	{ "t_read", offsetof(struct sandbox_nand, t_read), 0 },
+	{ "t_prog", offsetof(struct sandbox_nand, t_prog), 0 },
+	{ "t_erase", offsetof(struct sandbox_nand, t_erase), 0 },
+	{ "t_byte", offsetof(struct sandbox_nand, t_byte), 0 },
+	{ "t_rcbsy", offsetof(struct sandbox_nand, t_rcbsy), 0 },
+	{ "delay", offsetof(struct sandbox_nand, delay), 0 },
+	{ "bitflips", offsetof(struct sandbox_nand, bitflips), 0 },
+	{ "bitflip_interval", offsetof(struct sandbox_nand, bitflip_interval), 0 },
+	/* the statistics can only be set to zero */
+	{ "reads", offsetof(struct sandbox_nand, reads), PARAM_FLAG_CLEAR },
+	{ "programs", offsetof(struct sandbox_nand, programs), PARAM_FLAG_CLEAR },
+	{ "erases", offsetof(struct sandbox_nand, erases), PARAM_FLAG_CLEAR },
+	{ "time_ns", offsetof(struct sandbox_nand, time_ns), PARAM_FLAG_CLEAR },
+};
+
+/* mark the blocks given as <blk>[:<blk>...] bad in the flash array */
+static void sandbox_nand_factory_bad(struct sandbox_nand *sn, char *list)
+{
+	unsigned int block, pos;
+	char *blk;
+	u8 *oob;
+
+	pos = sn->largepage ? NAND_LARGE_BADBLOCK_POS : NAND_SMALL_BADBLOCK_POS;
+
+	while ((blk = strsep(&list, ":"))) {
+		block = simple_strtoul(blk, NULL, 0);
+		if (block >= sn->numpages / sn->pages_per_block) {
+			dev_err(sn->dev, "bad block %u out of range\n", block);
+			continue;
+		}
+
+		/* the marker is checked in the first and the second page */
+		oob = sn->array + block * sn->pages_per_block * sn->rawsize +
+			sn->pagesize;
+		oob[pos] = 0;
+		oob[pos + sn->rawsize] = 0;
+	}
+}
+
+/*
+ * Find the ID to report for the chip size. The generic code takes the
+ * first entry of the ID table, so skip IDs which are used for other
+ * chips earlier in the table.
+ */
+static int sandbox_nand_find_id(struct sandbox_nand *sn, unsigned long size)
+{
+	struct nand_flash_dev *type, *first;
+
+	for (type = nand_flash_ids; type->name; type++) {
+		if (type->chipsize != size >> 20)
+			continue;
+		if (type->pagesize != (sn->largepage ? 0 : sn->pagesize))
+			continue;
+		if (type->options & NAND_BUSWIDTH_16)
+			continue;
+
+		for (first = nand_flash_ids; first->id != type->id; first++)
+			;
+
+		if (first == type)
+			return type->id;
+	}
+
+	return -ENODEV;
+}
+
+static int sandbox_nand_geometry(struct sandbox_nand *sn, size_t filesize,
+		unsigned int erasesize)
+{
+	unsigned long chipsize;
+	int id;
+
+	sn->rawsize = sn->pagesize + sn->oobsize;
+	sn->largepage = sn->pagesize > 512;
+
+	if (sn->largepage) {
+		if ((sn->pagesize & (sn->pagesize - 1)) ||
+				sn->pagesize > 4096 ||
+				(sn->oobsize != sn->pagesize / 64 &&
+				 sn->oobsize != sn->pagesize / 32) ||
+				(erasesize & (erasesize - 1)) ||
+				erasesize < SZ_64K || erasesize > SZ_512K) {
+			dev_err(sn->dev, "unsupported geometry\n");
+			return -EINVAL;
+		}
+	} else {
+		if (sn->pagesize != 512 || sn->oobsize != 16 ||
+				erasesize != SZ_16K) {
+			dev_err(sn->dev, "small page chips have 512 byte pages, "
+					"16 byte oob and 16KiB erase blocks\n");
+			return -EINVAL;
+		}
+	}
+
+	sn->pages_per_block = erasesize / sn->pagesize;
+	sn->numpages = filesize / sn->rawsize;
+	chipsize = (unsigned long)sn->numpages * sn->pagesize;
+
+	id = sandbox_nand_find_id(sn, chipsize);
+	if (id < 0 || filesize % sn->rawsize) {
+		dev_err(sn->dev, "no chip with %u+%u byte pages matches a "
+				"file size of %zu bytes. The file must hold "
+				"(pagesize + oobsize) * pages bytes for a "
+				"chip of 16MiB to 2GiB\n",
+				sn->pagesize, sn->oobsize, filesize);
+		return -EINVAL;
+	}
+
+	sn->id[0] = SANDBOX_NAND_MAF_ID;
+	sn->id[1] = id;
+	sn->id[2] = 0;
+	sn->id[3] = (ffs(sn->pagesize >> 10) - 1) |
+		((sn->oobsize == sn->pagesize / 32) << 2) |
+		((ffs(erasesize >> 16) - 1) << 4);
+
+	return 0;
+}
+
+/*
+ * The generic code only has ecc layouts for 16 and 64 byte oob. For other
+ * sizes put the ecc at the end of the oob.
+ */
+static int sandbox_nand_layout(struct sandbox_nand *sn)
+{
+	struct nand_ecclayout *layout = &sn->layout;
+	unsigned int eccbytes = sn->pagesize / 256 * 3;
+	int i;
+
+	if ((sn->oobsize == 16 && eccbytes == 6) ||
+			(sn->oobsize == 64 && eccbytes == 24))
+		return 0;
+
+	if (eccbytes > ARRAY_SIZE(layout->eccpos) ||
+			eccbytes + 2 > sn->oobsize) {
+		dev_err(sn->dev, "oob too small for software ecc\n");
+		return -EINVAL;
+	}
+
+	layout->eccbytes = eccbytes;
+	for (i = 0; i < eccbytes; i++)
+		layout->eccpos[i] = sn->oobsize - eccbytes + i;
+	layout->oobfree[0].offset = 2;
+	layout->oobfree[0].length = sn->oobsize - eccbytes - 2;
+
+	sn->chip.ecc.layout = layout;
+
+	return 0;
+}
+
+static int sandbox_nand_probe(struct device_d *dev)
+{
+	struct hf_platform_data *hf = dev->platform_data;
+	struct sandbox_nand *sn;
+	struct nand_chip *chip;
+	struct mtd_info *mtd;
+	unsigned int erasesize = SZ_128K;
+	char *options, *buf, *opt, *val, *bad = NULL;
+	int i, ret;
+
+	sn = xzalloc(sizeof(*sn));
+	sn->dev = dev;
+	dev->priv = sn;
+
+	sn->array = (u8 *)hf->base;
+	sn->pagesize = 2048;
+	sn->oobsize = 64;
+	sn->t_read = 25000;
+	sn->t_prog = 200000;
+	sn->t_erase = 2000000;
+	sn->t_byte = 25;
+	sn->t_rcbsy = 3000;
+	sn->cacheread_enabled = 1;
+
+	buf = options = xstrdup(hf->options ? hf->options : "");
+
+	while ((opt = strsep(&options, ","))) {
+		val = strchr(opt, '=');
+		if (!val)
+			continue;
+		*val++ = 0;
+
+		if (!strcmp(opt, "pagesize"))
+			sn->pagesize = simple_strtoul(val, NULL, 0);
+		else if (!strcmp(opt, "oobsize"))
+			sn->oobsize = simple_strtoul(val, NULL, 0);
+		else if (!strcmp(opt, "erasesize"))
+			erasesize = strtoul_suffix(val, NULL, 0);
+		else if (!strcmp(opt, "bad"))
+			bad = val;
+		else if (!strcmp(opt, "cacheread"))
+			sn->cacheread_enabled = simple_strtoul(val, NULL, 0);
+		else if (!strcmp(opt, "flashbbt"))
+			sn->flashbbt = simple_strtoul(val, NULL, 0);
+		else
+			dev_warn(dev, "unknown option %s\n", opt);
+	}
+
+	if (!sn->array) {
+		dev_err(dev, "%s is not mapped\n", hf->filename);
+		ret = -EINVAL;
+		goto err;
+	}
+
+	ret = sandbox_nand_geometry(sn, hf->size, erasesize);
+	if (ret)
+		goto err;
+
+	if (bad)
+		sandbox_nand_factory_bad(sn, bad);
+	free(buf);
+	buf = NULL;
+
+	sn->reg = xmalloc(sn->rawsize);
+	sn->areg = xmalloc(sn->rawsize);
+
+	mtd = &sn->mtd;
+	chip = &sn->chip;
+	mtd->priv = chip;
+	chip->priv = sn;
+
+	chip->cmd_ctrl = sandbox_nand_cmd_ctrl;
+	chip->dev_ready = sandbox_nand_dev_ready;
+	chip->select_chip = sandbox_nand_select_chip;
+	chip->read_byte = sandbox_nand_read_byte;
+	chip->read_word = sandbox_nand_read_word;
+	chip->read_buf = sandbox_nand_read_buf;
+	chip->write_buf = sandbox_nand_write_buf;
+	chip->verify_buf = sandbox_nand_verify_buf;
+	chip->ecc.mode = NAND_ECC_SOFT;
+	if (sn->cacheread_enabled && sn->largepage)
+		chip->options |= NAND_CACHEREAD;
+	if (sn->flashbbt)
+		chip->options |= NAND_USE_FLASH_BBT;
+
+	ret = sandbox_nand_layout(sn);
+	if (ret)
+		goto err;
+
+	ret = nand_scan(mtd, 1);
+	if (ret)
+		goto err;
+
+	for (i = 0; i < ARRAY_SIZE(sandbox_nand_params); i++)
+		dev_add_param_u64(dev, sandbox_nand_params[i].name,
+				(void *)sn + sandbox_nand_params[i].offset,
+				sandbox_nand_params[i].flags);
+
+	return add_mtd_device(mtd, "nand");
+err:
+	free(buf);
+	free(sn->reg);
+	free(sn->areg);
+	dev->priv = NULL;
+	free(sn);
+	return ret;
+}
+
+static struct driver_d sandbox_nand_driver = {
+	.name  = "sandbox_nand",
+	.probe = sandbox_nand_probe,
+};
+
+static int sandbox_nand_init(void)
+{
+	return register_driver(&sandbox_nand_driver);
+}
+
+device_initcall(sandbox_nand_init);
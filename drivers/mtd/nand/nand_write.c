@@ -298,10 +298,9 @@ int nand_do_write_ops(struct mtd_info *mtd, loff_t to,
 	page = realpage & chip->pagemask;
 	blockmask = (1 << (chip->phys_erase_shift - chip->page_shift)) - 1;
 
-	/* Invalidate the page cache, when we write to the cached page */
-	if (to <= (chip->pagebuf << chip->page_shift) &&
-	    (chip->pagebuf << chip->page_shift) < (to + ops->len))
-		chip->pagebuf = -1;
+	/* Invalidate the page cache for the pages we write to */
+	nand_pagecache_invalidate(chip, realpage,
+			(int)((to + ops->len - 1) >> chip->page_shift));
 
 	/* Initialize to all 0xFF, to avoid the possibility of
 	   left over OOB data from a previous OOB read. */
@@ -316,7 +315,6 @@ int nand_do_write_ops(struct mtd_info *mtd, loff_t to,
 		if (unlikely(column || writelen < (mtd->writesize - 1))) {
 			cached = 0;
 			bytes = min_t(int, bytes - column, (int) writelen);
-			chip->pagebuf = -1;
 			memset(chip->buffers->databuf, 0xff, mtd->writesize);
 			memcpy(&chip->buffers->databuf[column], buf, bytes);
 			wbuf = chip->buffers->databuf;
@@ -449,9 +447,8 @@ static int nand_do_write_oob(struct mtd_info *mtd, loff_t to,
 	if (nand_check_wp(mtd))
 		return -EROFS;
 
-	/* Invalidate the page cache, if we write to the cached page */
-	if (page == chip->pagebuf)
-		chip->pagebuf = -1;
+	/* Invalidate the page cache, if we write to a cached page */
+	nand_pagecache_invalidate(chip, page, page);
 
 	memset(chip->oob_poi, 0xff, mtd->oobsize);
 	nand_fill_oob(chip, ops->oobbuf, ops);
@@ -639,11 +636,10 @@ int nand_erase_nand(struct mtd_info *mtd, struct erase_info *instr,
 
 		/*
 		 * Invalidate the page cache, if we erase the block which
-		 * contains the current cached page
+		 * contains cached pages
 		 */
-		if (page <= chip->pagebuf && chip->pagebuf <
-		    (page + pages_per_block))
-			chip->pagebuf = -1;
+		nand_pagecache_invalidate(chip, page,
+				page + pages_per_block - 1);
 
 		chip->erase_cmd(mtd, page & chip->pagemask);
 
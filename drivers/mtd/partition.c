@@ -28,6 +28,12 @@ static int mtd_part_read(struct mtd_info *mtd, loff_t from, size_t len,
 		len = mtd->size - from;
 	res = part->master->read(part->master, from + part->offset,
 				len, retlen, buf);
+
+	mtd->ecc_stats.corrected += part->master->ecc_stats.corrected -
+		stats.corrected;
+	mtd->ecc_stats.failed += part->master->ecc_stats.failed -
+		stats.failed;
+
 	return res;
 }
 
@@ -409,6 +409,10 @@ static int uif_init(struct ubi_device *ubi)
 	if (err)
 		goto out_sysfs;
 
+	err = ubi_stats_register(ubi);
+	if (err)
+		goto out_sysfs;
+
 	for (i = 0; i < ubi->vtbl_slots; i++)
 		if (ubi->volumes[i]) {
 			err = ubi_add_volume(ubi, ubi->volumes[i]);
@@ -422,6 +426,7 @@ static int uif_init(struct ubi_device *ubi)
 
 out_volumes:
 	kill_volumes(ubi);
+	ubi_stats_unregister(ubi);
 out_sysfs:
 	ubi_sysfs_close(ubi);
 	ubi_cdev_remove(ubi);
@@ -438,6 +443,7 @@ out_unreg:
 static void uif_close(struct ubi_device *ubi)
 {
 	kill_volumes(ubi);
+	ubi_stats_unregister(ubi);
 	ubi_sysfs_close(ubi);
 	ubi_cdev_remove(ubi);
 	unregister_chrdev_region(ubi->cdev.dev, ubi->vtbl_slots + 1);
@@ -450,36 +456,57 @@ static void uif_close(struct ubi_device *ubi)
  * This function returns zero in case of success and a negative error code in
  * case of failure.
  *
- * Note, currently this is the only method to attach UBI devices. Hopefully in
- * the future we'll have more scalable attaching methods and avoid full media
- * scanning. But even in this case scanning will be needed as a fall-back
- * attaching method if there are some on-flash table corruptions.
+ * Note, with CONFIG_UBI_FASTMAP the device is attached by the fastmap if
+ * there is a valid one. Full media scanning is the fall-back attaching method
+ * if there is no fastmap or it is corrupted.
  */
 static int attach_by_scanning(struct ubi_device *ubi)
 {
 	int err;
-	struct ubi_scan_info *si;
+	struct ubi_scan_info *si = NULL;
+	struct ubi_stats *stats = ubi->stats;
+	uint64_t start = get_time_ns();
 
-	si = ubi_scan(ubi);
+#ifdef CONFIG_UBI_FASTMAP
+	si = ubi_scan_fastmap(ubi);
 	if (IS_ERR(si))
 		return PTR_ERR(si);
+#endif
+	if (!si) {
+		si = ubi_scan(ubi);
+		if (IS_ERR(si))
+			return PTR_ERR(si);
+	}
+
+	stats->fastmap = ubi->fm != NULL;
+	stats->scan_ns = get_time_ns() - start;
+
+	if (si->alien_peb_count)
+		/* A fastmap could not describe them */
+		ubi->fm_disabled = 1;
 
 	ubi->bad_peb_count = si->bad_peb_count;
 	ubi->good_peb_count = ubi->peb_count - ubi->bad_peb_count;
 	ubi->max_ec = si->max_ec;
 	ubi->mean_ec = si->mean_ec;
 
+	start = get_time_ns();
 	err = ubi_read_volume_table(ubi, si);
 	if (err)
 		goto out_si;
+	stats->vtbl_ns = get_time_ns() - start;
 
+	start = get_time_ns();
 	err = ubi_wl_init_scan(ubi, si);
 	if (err)
 		goto out_vtbl;
+	stats->wl_init_ns = get_time_ns() - start;
 
+	start = get_time_ns();
 	err = ubi_eba_init_scan(ubi, si);
 	if (err)
 		goto out_wl;
+	stats->eba_init_ns = get_time_ns() - start;
 
 	ubi_scan_destroy_si(si);
 	return 0;
@@ -489,6 +516,7 @@ out_wl:
 out_vtbl:
 	vfree(ubi->vtbl);
 out_si:
+	ubi_free_fastmap(ubi);
 	ubi_scan_destroy_si(si);
 	return err;
 }
@@ -714,6 +742,7 @@ static int autoresize(struct ubi_device *ubi, int vol_id)
 int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num, int vid_hdr_offset)
 {
 	struct ubi_device *ubi;
+	uint64_t start = get_time_ns();
 	int i, err;
 
 	/*
@@ -769,6 +798,12 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num, int vid_hdr_offset)
 	if (!ubi)
 		return -ENOMEM;
 
+	ubi->stats = kzalloc(sizeof(struct ubi_stats), GFP_KERNEL);
+	if (!ubi->stats) {
+		kfree(ubi);
+		return -ENOMEM;
+	}
+
 	ubi->mtd = mtd;
 	ubi->ubi_num = ubi_num;
 	ubi->vid_hdr_offset = vid_hdr_offset;
@@ -813,6 +848,12 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num, int vid_hdr_offset)
 			goto out_detach;
 	}
 
+	/*
+	 * Speed up the next attach, unless there is a valid fastmap already.
+	 * Only done with CONFIG_UBI_FASTMAP_CREATE.
+	 */
+	ubi_update_fastmap(ubi);
+
 	err = uif_init(ubi);
 	if (err)
 		goto out_detach;
@@ -825,6 +866,8 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num, int vid_hdr_offset)
 		goto out_uif;
 	}
 
+	ubi->stats->attach_ns = get_time_ns() - start;
+
 	ubi_msg("attached mtd%d to ubi%d", mtd->index, ubi_num);
 	ubi_msg("MTD device name:            \"%s\"", mtd->name);
 	ubi_msg("MTD device size:            %llu MiB", ubi->flash_size >> 20);
@@ -855,6 +898,7 @@ out_uif:
 out_detach:
 	ubi_eba_close(ubi);
 	ubi_wl_close(ubi);
+	ubi_free_fastmap(ubi);
 	vfree(ubi->vtbl);
 out_free:
 	vfree(ubi->peb_buf1);
@@ -862,6 +906,7 @@ out_free:
 #ifdef CONFIG_MTD_UBI_DEBUG
 	vfree(ubi->dbg_peb_buf);
 #endif
+	kfree(ubi->stats);
 	kfree(ubi);
 	return err;
 }
@@ -921,9 +966,12 @@ int ubi_detach_mtd_dev(struct mtd_info *mtd, int anyway)
 	if (ubi->bgt_thread)
 		kthread_stop(ubi->bgt_thread);
 
+	ubi_update_fastmap(ubi);
+
 	uif_close(ubi);
 	ubi_eba_close(ubi);
 	ubi_wl_close(ubi);
+	ubi_free_fastmap(ubi);
 	vfree(ubi->vtbl);
 	vfree(ubi->peb_buf1);
 	vfree(ubi->peb_buf2);
@@ -931,6 +979,7 @@ int ubi_detach_mtd_dev(struct mtd_info *mtd, int anyway)
 	vfree(ubi->dbg_peb_buf);
 #endif
 	ubi_msg("mtd%d is detached from ubi%d", ubi->mtd->index, ubi->ubi_num);
+	kfree(ubi->stats);
 	kfree(ubi);
 	return 0;
 }
@@ -2,6 +2,7 @@
 #include <fcntl.h>
 #include <fs.h>
 #include <ioctl.h>
+#include <malloc.h>
 #include "ubi-barebox.h"
 #include "ubi.h"
 
@@ -9,50 +10,111 @@ struct ubi_volume_cdev_priv {
 	struct ubi_device *ubi;
 	struct ubi_volume *vol;
 	int updating;
+
+	/* read-ahead buffer, holds LEB ra_lnum from ra_offs to ra_end */
+	void *ra_buf;
+	int ra_lnum;
+	int ra_offs, ra_end;
+	/* where a sequential reader continues */
+	loff_t next;
 };
 
+/*
+ * Number of bytes of LEB @lnum which are part of the volume data
+ */
+static int ubi_volume_leb_end(struct ubi_volume *vol, int lnum)
+{
+	long long left = vol->used_bytes - (long long)lnum * vol->usable_leb_size;
+
+	return left < vol->usable_leb_size ? left : vol->usable_leb_size;
+}
+
+/*
+ * Read LEB @lnum from @off up to its end into the read-ahead buffer
+ */
+static int ubi_volume_read_ahead(struct ubi_volume_cdev_priv *priv, int lnum,
+		int off)
+{
+	struct ubi_volume *vol = priv->vol;
+	int end = ubi_volume_leb_end(vol, lnum);
+	int err;
+
+	if (!priv->ra_buf) {
+		priv->ra_buf = malloc(vol->usable_leb_size);
+		if (!priv->ra_buf)
+			return -ENOMEM;
+	}
+
+	priv->ra_lnum = -1;
+
+	err = ubi_eba_read_leb(priv->ubi, vol, lnum, priv->ra_buf + off, off,
+			end - off, 0);
+	if (err)
+		return err;
+
+	priv->ra_lnum = lnum;
+	priv->ra_offs = off;
+	priv->ra_end = end;
+
+	return 0;
+}
+
+/*
+ * Reads are done LEB wise. A read up to the end of a LEB goes directly into
+ * the callers buffer. When a sequential reader reads less, the rest of the
+ * LEB is read into a read-ahead buffer at once and the following reads are
+ * served from there.
+ */
 static ssize_t ubi_volume_cdev_read(struct cdev *cdev, void *buf, size_t size,
 		loff_t offset, unsigned long flags)
 {
 	struct ubi_volume_cdev_priv *priv = cdev->priv;
 	struct ubi_volume *vol = priv->vol;
 	struct ubi_device *ubi = priv->ubi;
-	int err, lnum, off, len;
-	size_t count_save = size;
-	unsigned long long tmp;
-	loff_t offp = offset;
-	int usable_leb_size = vol->usable_leb_size;
+	int err = 0, lnum, off, len, end;
+	int sequential = offset == priv->next;
+	size_t count = 0;
+	uint64_t tmp;
 
-	printf("%s: %d @ 0x%08llx\n", __func__, size, offset);
+	debug("%s: %d @ 0x%08llx\n", __func__, size, offset);
 
-	len = size > usable_leb_size ? usable_leb_size : size;
-
-	tmp = offp;
-	off = do_div(tmp, usable_leb_size);
+	tmp = offset;
+	off = do_div(tmp, vol->usable_leb_size);
 	lnum = tmp;
-	do {
-		if (off + len >= usable_leb_size)
-			len = usable_leb_size - off;
 
-		err = ubi_eba_read_leb(ubi, vol, lnum, buf, off, len, 0);
-		if (err) {
-			printf("read err %x\n", err);
+	while (count < size) {
+		end = ubi_volume_leb_end(vol, lnum);
+		if (off >= end)
 			break;
+
+		len = min_t(size_t, size - count, end - off);
+
+		if (lnum == priv->ra_lnum && off >= priv->ra_offs &&
+				off + len <= priv->ra_end) {
+			memcpy(buf, priv->ra_buf + off, len);
+		} else if (sequential && off + len < end &&
+				!ubi_volume_read_ahead(priv, lnum, off)) {
+			memcpy(buf, priv->ra_buf + off, len);
+		} else {
+			err = ubi_eba_read_leb(ubi, vol, lnum, buf, off, len, 0);
+			if (err) {
+				printf("read err %x\n", err);
+				break;
+			}
 		}
+
+		count += len;
+		buf += len;
 		off += len;
-		if (off == usable_leb_size) {
-			lnum += 1;
-			off -= usable_leb_size;
+		if (off == vol->usable_leb_size) {
+			lnum++;
+			off = 0;
 		}
+	}
 
-		size -= len;
-		offp += len;
-
-		buf += len;
-		len = size > usable_leb_size ? usable_leb_size : size;
-	} while (size);
+	priv->next = offset + count;
 
-	return count_save;
+	return count ? count : err;
 }
 
 static ssize_t ubi_volume_cdev_write(struct cdev* cdev, const void *buf,
@@ -63,6 +125,9 @@ static ssize_t ubi_volume_cdev_write(struct cdev* cdev, const void *buf,
 	struct ubi_device *ubi = priv->ubi;
 	int err;
 
+	/* the data is replaced, drop what was read ahead */
+	priv->ra_lnum = -1;
+
 	if (!priv->updating) {
 		err = ubi_start_update(ubi, vol, 16*1024*1024);
 		if (err < 0) {
@@ -86,6 +151,8 @@ static int ubi_volume_cdev_open(struct cdev *cdev, unsigned long flags)
 	struct ubi_volume_cdev_priv *priv = cdev->priv;
 
 	priv->updating = 0;
+	priv->ra_lnum = -1;
+	priv->next = 0;
 
 	return 0;
 }
@@ -97,6 +164,10 @@ static int ubi_volume_cdev_close(struct cdev *cdev)
 	struct ubi_device *ubi = priv->ubi;
 	int err;
 
+	free(priv->ra_buf);
+	priv->ra_buf = NULL;
+	priv->ra_lnum = -1;
+
 	if (priv->updating) {
 		err = ubi_finish_update(ubi, vol);
 		if (err)
@@ -116,6 +187,7 @@ static int ubi_volume_cdev_close(struct cdev *cdev)
 
 		vol->checked = 1;
 		ubi_gluebi_updated(vol);
+		ubi_update_fastmap(ubi);
 	}
 
 	return 0;
@@ -150,6 +222,7 @@ int ubi_volume_cdev_add(struct ubi_device *ubi, struct ubi_volume *vol)
 
 	priv->vol = vol;
 	priv->ubi = ubi;
+	priv->ra_lnum = -1;
 
 	cdev->ops = &ubi_volume_fops;
 	cdev->name = asprintf("ubi%d.%s", ubi->ubi_num, vol->name);
@@ -172,6 +245,7 @@ void ubi_volume_cdev_remove(struct ubi_volume *vol)
 
 	devfs_remove(cdev);
 	free(cdev->name);
+	free(priv->ra_buf);
 	free(priv);
 }
 
@@ -180,6 +254,7 @@ static int ubi_cdev_ioctl(struct cdev *cdev, int cmd, void *buf)
 	struct ubi_volume_desc *desc;
 	struct ubi_device *ubi = cdev->priv;
 	struct ubi_mkvol_req *req = buf;
+	int err = 0;
 
 	switch (cmd) {
 	case UBI_IOCRMVOL:
@@ -192,10 +267,14 @@ static int ubi_cdev_ioctl(struct cdev *cdev, int cmd, void *buf)
 	case UBI_IOCMKVOL:
 		if (!req->bytes)
 			req->bytes = ubi->avail_pebs * ubi->leb_size;
-		return ubi_create_volume(ubi, req);
+		err = ubi_create_volume(ubi, req);
+		break;
 	};
 
-	return 0;
+	if (!err)
+		ubi_update_fastmap(ubi);
+
+	return err;
 }
 
 
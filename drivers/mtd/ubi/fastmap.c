@@ -0,0 +1,939 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See
+ * the GNU General Public License for more details.
+ */
+
+/*
+ * UBI fastmap unit.
+ *
+ * A fastmap is a snapshot of the attach information (the EBA tables and the
+ * erase counters of all physical eraseblocks) stored on the flash. With a
+ * valid fastmap the device is attached by reading a few eraseblocks instead
+ * of the headers of all of them. The on-flash format is the one used by
+ * Linux (%UBI_FM_FMT_VERSION). Fastmaps written by Linux are read here;
+ * whether Linux attaches from a fastmap written by barebox has not been
+ * tested.
+ *
+ * The fastmap super block is searched for in the first %UBI_FM_MAX_START
+ * physical eraseblocks. If there is none, or it is inconsistent, the device
+ * is scanned as usual.
+ *
+ * Barebox does not keep pools of PEBs which have to be scanned on attach,
+ * instead the fastmap is erased before anything on the flash is changed (see
+ * 'ubi_io_write()' and 'ubi_io_sync_erase()'), and a new one is written when
+ * the change is complete. A fastmap found on the flash therefore always
+ * describes the current state.
+ *
+ * A fastmap is only written to a device which had one when it was attached,
+ * or with CONFIG_UBI_FASTMAP_CREATE. Otherwise attaching and changing a
+ * device leaves it without a fastmap, as it was.
+ */
+
+#include "ubi-barebox.h"
+#include "ubi.h"
+
+/* The fastmap is not usable, the device has to be scanned */
+#define BAD_FASTMAP 1
+
+/* State of the physical eraseblocks while a fastmap is read or written */
+enum {
+	FM_PEB_UNKNOWN = 0,
+	FM_PEB_FREE,
+	FM_PEB_USED,
+	FM_PEB_SCRUB,
+	FM_PEB_ERASE,
+	FM_PEB_POOL,
+	FM_PEB_FASTMAP,
+	FM_PEB_MAPPED,
+	FM_PEB_BAD,
+};
+
+/**
+ * calc_fm_size - calculate the size of a fastmap.
+ * @ubi: UBI device description object
+ *
+ * Returns the size of the largest possible fastmap for this device, rounded
+ * up to the LEB size.
+ */
+static int calc_fm_size(struct ubi_device *ubi)
+{
+	size_t size;
+
+	size = sizeof(struct ubi_fm_sb) + sizeof(struct ubi_fm_hdr) +
+		sizeof(struct ubi_fm_scan_pool) * 2 +
+		ubi->peb_count * sizeof(struct ubi_fm_ec) +
+		(sizeof(struct ubi_fm_volhdr) + sizeof(struct ubi_fm_eba)) *
+		(UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT) +
+		ubi->peb_count * sizeof(__be32);
+
+	return DIV_ROUND_UP(size, ubi->leb_size) * ubi->leb_size;
+}
+
+static void free_fm_layout(struct ubi_fastmap_layout *fm)
+{
+	int i;
+
+	for (i = 0; i < fm->used_blocks; i++)
+		kmem_cache_free(ubi_wl_entry_slab, fm->e[i]);
+	kfree(fm);
+}
+
+/**
+ * add_seb - add a physical eraseblock from the fastmap to a list.
+ * @si: scanning information
+ * @list: the list to add to
+ * @pnum: physical eraseblock number
+ * @ec: erase counter
+ *
+ * Returns zero in case of success and %-ENOMEM in case of failure.
+ */
+static int add_seb(struct ubi_scan_info *si, struct list_head *list, int pnum,
+		   int ec)
+{
+	struct ubi_scan_leb *seb;
+
+	seb = kzalloc(sizeof(struct ubi_scan_leb), GFP_KERNEL);
+	if (!seb)
+		return -ENOMEM;
+
+	seb->pnum = pnum;
+	seb->ec = ec;
+	list_add_tail(&seb->u.list, list);
+
+	return 0;
+}
+
+static void account_ec(struct ubi_scan_info *si, int ec)
+{
+	si->ec_sum += ec;
+	si->ec_count += 1;
+	if (ec > si->max_ec)
+		si->max_ec = ec;
+	if (ec < si->min_ec)
+		si->min_ec = ec;
+}
+
+/**
+ * find_fm_anchor - find the fastmap super block.
+ * @ubi: UBI device description object
+ *
+ * Returns the physical eraseblock holding the newest fastmap super block or
+ * %-ENOENT if there is none.
+ */
+static int find_fm_anchor(struct ubi_device *ubi)
+{
+	struct ubi_vid_hdr *vh;
+	unsigned long long sqnum, max_sqnum = 0;
+	int pnum, err, anchor = -ENOENT;
+
+	vh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	if (!vh)
+		return -ENOMEM;
+
+	for (pnum = 0; pnum < UBI_FM_MAX_START && pnum < ubi->peb_count;
+	     pnum++) {
+		if (ubi_io_is_bad(ubi, pnum))
+			continue;
+
+		err = ubi_io_read_vid_hdr(ubi, pnum, vh, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			continue;
+
+		if (be32_to_cpu(vh->vol_id) != UBI_FM_SB_VOLUME_ID)
+			continue;
+
+		sqnum = be64_to_cpu(vh->sqnum);
+		if (anchor < 0 || sqnum > max_sqnum) {
+			max_sqnum = sqnum;
+			anchor = pnum;
+		}
+	}
+
+	ubi_free_vid_hdr(ubi, vh);
+
+	return anchor;
+}
+
+/**
+ * read_fm_blocks - read and check the fastmap eraseblocks.
+ * @ubi: UBI device description object
+ * @anchor: physical eraseblock of the fastmap super block
+ * @fm: layout to fill in
+ * @bufp: returns the fastmap data
+ * @max_sqnum: returns the highest sequence number found
+ *
+ * Returns zero in case of success, %BAD_FASTMAP if the fastmap is not usable
+ * and a negative error code in case of failure.
+ */
+static int read_fm_blocks(struct ubi_device *ubi, int anchor,
+			  struct ubi_fastmap_layout *fm, void **bufp,
+			  unsigned long long *max_sqnum)
+{
+	struct ubi_fm_sb *fmsb;
+	struct ubi_ec_hdr *ech;
+	struct ubi_vid_hdr *vh;
+	struct ubi_wl_entry *e;
+	void *buf = NULL;
+	int i, err, ret = -ENOMEM, used_blocks, pnum, ec, vol_id;
+	uint32_t crc;
+
+	fmsb = kmalloc(sizeof(struct ubi_fm_sb), GFP_KERNEL);
+	ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+	vh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	if (!fmsb || !ech || !vh)
+		goto out;
+
+	ret = BAD_FASTMAP;
+
+	err = ubi_io_read_data(ubi, fmsb, anchor, 0, sizeof(struct ubi_fm_sb));
+	if (err && err != UBI_IO_BITFLIPS)
+		goto out;
+
+	if (be32_to_cpu(fmsb->magic) != UBI_FM_SB_MAGIC) {
+		ubi_warn("bad fastmap super block magic at PEB %d", anchor);
+		goto out;
+	}
+
+	if (fmsb->version != UBI_FM_FMT_VERSION) {
+		ubi_warn("fastmap version %d is not supported",
+			 (int)fmsb->version);
+		goto out;
+	}
+
+	used_blocks = be32_to_cpu(fmsb->used_blocks);
+	if (used_blocks < 1 || used_blocks > UBI_FM_MAX_BLOCKS ||
+	    be32_to_cpu(fmsb->block_loc[0]) != anchor) {
+		ubi_warn("bad fastmap super block at PEB %d", anchor);
+		goto out;
+	}
+
+	buf = vmalloc(used_blocks * ubi->leb_size);
+	if (!buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	*max_sqnum = be64_to_cpu(fmsb->sqnum);
+
+	for (i = 0; i < used_blocks; i++) {
+		pnum = be32_to_cpu(fmsb->block_loc[i]);
+		if (pnum < 0 || pnum >= ubi->peb_count)
+			goto out;
+
+		err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			goto out;
+
+		ec = be64_to_cpu(ech->ec);
+		if (ec != be32_to_cpu(fmsb->block_ec[i])) {
+			ubi_warn("fastmap PEB %d has EC %d, expected %d", pnum,
+				 ec, be32_to_cpu(fmsb->block_ec[i]));
+			goto out;
+		}
+
+		err = ubi_io_read_vid_hdr(ubi, pnum, vh, 0);
+		if (err && err != UBI_IO_BITFLIPS)
+			goto out;
+
+		vol_id = i ? UBI_FM_DATA_VOLUME_ID : UBI_FM_SB_VOLUME_ID;
+		if (be32_to_cpu(vh->vol_id) != vol_id ||
+		    be32_to_cpu(vh->lnum) != i) {
+			ubi_warn("PEB %d does not belong to the fastmap", pnum);
+			goto out;
+		}
+
+		if (be64_to_cpu(vh->sqnum) > *max_sqnum)
+			*max_sqnum = be64_to_cpu(vh->sqnum);
+
+		err = ubi_io_read_data(ubi, buf + i * ubi->leb_size, pnum, 0,
+				       ubi->leb_size);
+		if (err && err != UBI_IO_BITFLIPS)
+			goto out;
+
+		e = kmem_cache_alloc(ubi_wl_entry_slab, GFP_KERNEL);
+		if (!e) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		e->pnum = pnum;
+		e->ec = ec;
+		fm->e[i] = e;
+		fm->used_blocks = i + 1;
+	}
+
+	/* The CRC is calculated with the data_crc field set to zero */
+	crc = be32_to_cpu(((struct ubi_fm_sb *)buf)->data_crc);
+	((struct ubi_fm_sb *)buf)->data_crc = 0;
+	if (ubi_crc32(ubi, buf, used_blocks * ubi->leb_size) != crc) {
+		ubi_warn("fastmap data CRC is invalid");
+		goto out;
+	}
+
+	*bufp = buf;
+	buf = NULL;
+	ret = 0;
+out:
+	vfree(buf);
+	kfree(fmsb);
+	kfree(ech);
+	ubi_free_vid_hdr(ubi, vh);
+	return ret;
+}
+
+/**
+ * fm_get - get the next structure from the fastmap data.
+ * @buf: the fastmap data
+ * @pos: current position, advanced by @len
+ * @size: size of the fastmap data
+ * @len: length of the structure
+ *
+ * Returns a pointer to the structure or %NULL if the data is too short.
+ */
+static void *fm_get(void *buf, int *pos, int size, int len)
+{
+	void *p = buf + *pos;
+
+	if (len < 0 || *pos + len > size)
+		return NULL;
+
+	*pos += len;
+
+	return p;
+}
+
+/**
+ * parse_fm - build the scanning information from the fastmap data.
+ * @ubi: UBI device description object
+ * @si: scanning information to fill in
+ * @fm: the fastmap layout
+ * @buf: the fastmap data
+ * @size: size of @buf
+ *
+ * Returns zero in case of success, %BAD_FASTMAP if the fastmap is
+ * inconsistent and a negative error code in case of failure.
+ */
+static int parse_fm(struct ubi_device *ubi, struct ubi_scan_info *si,
+		    struct ubi_fastmap_layout *fm, void *buf, int size)
+{
+	struct ubi_fm_hdr *fmhdr;
+	struct ubi_fm_scan_pool *fmpl;
+	struct ubi_fm_ec *fmec;
+	struct ubi_fm_volhdr *fmvhdr;
+	struct ubi_fm_eba *fmeba;
+	struct ubi_vid_hdr *vh;
+	unsigned char *state;
+	int *ecs, *pool;
+	int pos = sizeof(struct ubi_fm_sb);
+	int i, j, n, err, pnum, vol_id, reserved_pebs, pool_count = 0;
+	int count[4], total = 0;
+	static const int list_state[4] = {
+		FM_PEB_FREE, FM_PEB_USED, FM_PEB_SCRUB, FM_PEB_ERASE,
+	};
+
+	state = kzalloc(ubi->peb_count, GFP_KERNEL);
+	ecs = kmalloc(ubi->peb_count * sizeof(int), GFP_KERNEL);
+	pool = kmalloc(2 * UBI_FM_MAX_POOL_SIZE * sizeof(int), GFP_KERNEL);
+	vh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	err = -ENOMEM;
+	if (!state || !ecs || !pool || !vh)
+		goto out;
+
+	err = BAD_FASTMAP;
+
+	for (i = 0; i < fm->used_blocks; i++) {
+		state[fm->e[i]->pnum] = FM_PEB_FASTMAP;
+		account_ec(si, fm->e[i]->ec);
+	}
+
+	fmhdr = fm_get(buf, &pos, size, sizeof(struct ubi_fm_hdr));
+	if (!fmhdr || be32_to_cpu(fmhdr->magic) != UBI_FM_HDR_MAGIC) {
+		ubi_warn("bad fastmap header magic");
+		goto out;
+	}
+
+	count[0] = be32_to_cpu(fmhdr->free_peb_count);
+	count[1] = be32_to_cpu(fmhdr->used_peb_count);
+	count[2] = be32_to_cpu(fmhdr->scrub_peb_count);
+	count[3] = be32_to_cpu(fmhdr->erase_peb_count);
+	si->bad_peb_count = be32_to_cpu(fmhdr->bad_peb_count);
+
+	for (i = 0; i < 2; i++) {
+		fmpl = fm_get(buf, &pos, size, sizeof(struct ubi_fm_scan_pool));
+		if (!fmpl || be32_to_cpu(fmpl->magic) != UBI_FM_POOL_MAGIC) {
+			ubi_warn("bad fastmap pool magic");
+			goto out;
+		}
+
+		n = be16_to_cpu(fmpl->size);
+		if (n > UBI_FM_MAX_POOL_SIZE)
+			goto out;
+
+		for (j = 0; j < n; j++) {
+			pnum = be32_to_cpu(fmpl->pebs[j]);
+			if (pnum < 0 || pnum >= ubi->peb_count ||
+			    state[pnum] != FM_PEB_UNKNOWN)
+				goto out;
+
+			state[pnum] = FM_PEB_POOL;
+			pool[pool_count++] = pnum;
+		}
+	}
+
+	/* The erase counters of the free, used, scrub and erase PEBs */
+	for (i = 0; i < 4; i++) {
+		if (count[i] < 0 || count[i] > ubi->peb_count)
+			goto out;
+
+		fmec = fm_get(buf, &pos, size,
+			      count[i] * sizeof(struct ubi_fm_ec));
+		if (!fmec)
+			goto out;
+
+		for (j = 0; j < count[i]; j++) {
+			pnum = be32_to_cpu(fmec[j].pnum);
+			if (pnum < 0 || pnum >= ubi->peb_count ||
+			    state[pnum] != FM_PEB_UNKNOWN) {
+				ubi_warn("bad PEB %d in fastmap", pnum);
+				goto out;
+			}
+
+			state[pnum] = list_state[i];
+			ecs[pnum] = be32_to_cpu(fmec[j].ec);
+			account_ec(si, ecs[pnum]);
+
+			if (list_state[i] == FM_PEB_FREE)
+				n = add_seb(si, &si->free, pnum, ecs[pnum]);
+			else if (list_state[i] == FM_PEB_ERASE)
+				n = add_seb(si, &si->erase, pnum, ecs[pnum]);
+			else
+				n = 0;
+			if (n) {
+				err = n;
+				goto out;
+			}
+		}
+
+		total += count[i];
+	}
+
+	if (total + pool_count + fm->used_blocks + si->bad_peb_count !=
+	    ubi->peb_count) {
+		ubi_warn("fastmap knows %d PEBs, the device has %d",
+			 total + pool_count + fm->used_blocks +
+			 si->bad_peb_count, ubi->peb_count);
+		goto out;
+	}
+
+	/* The volumes and their EBA tables */
+	n = be32_to_cpu(fmhdr->vol_count);
+	if (n < 0 || n > UBI_MAX_VOLUMES + UBI_INT_VOL_COUNT)
+		goto out;
+
+	for (i = 0; i < n; i++) {
+		fmvhdr = fm_get(buf, &pos, size, sizeof(struct ubi_fm_volhdr));
+		if (!fmvhdr || be32_to_cpu(fmvhdr->magic) != UBI_FM_VHDR_MAGIC) {
+			ubi_warn("bad fastmap volume header magic");
+			goto out;
+		}
+
+		vol_id = be32_to_cpu(fmvhdr->vol_id);
+		if ((vol_id < 0 || vol_id >= UBI_MAX_VOLUMES) &&
+		    vol_id != UBI_LAYOUT_VOLUME_ID)
+			goto out;
+
+		if (fmvhdr->vol_type != UBI_DYNAMIC_VOLUME &&
+		    fmvhdr->vol_type != UBI_STATIC_VOLUME)
+			goto out;
+
+		fmeba = fm_get(buf, &pos, size, sizeof(struct ubi_fm_eba));
+		if (!fmeba || be32_to_cpu(fmeba->magic) != UBI_FM_EBA_MAGIC) {
+			ubi_warn("bad fastmap EBA magic");
+			goto out;
+		}
+
+		reserved_pebs = be32_to_cpu(fmeba->reserved_pebs);
+		if (reserved_pebs < 0 || reserved_pebs > ubi->peb_count ||
+		    !fm_get(buf, &pos, size, reserved_pebs * sizeof(__be32)))
+			goto out;
+
+		/*
+		 * The LEBs are added like scanned ones, with a fake VID
+		 * header and sequence number 0, so that a newer copy found
+		 * in the pools takes precedence.
+		 */
+		memset(vh, 0, sizeof(struct ubi_vid_hdr));
+		vh->vol_type = fmvhdr->vol_type == UBI_STATIC_VOLUME ?
+			       UBI_VID_STATIC : UBI_VID_DYNAMIC;
+		vh->compat = vol_id == UBI_LAYOUT_VOLUME_ID ?
+			     UBI_LAYOUT_VOLUME_COMPAT : 0;
+		vh->vol_id = cpu_to_be32(vol_id);
+		vh->data_size = fmvhdr->last_eb_bytes;
+		vh->used_ebs = fmvhdr->used_ebs;
+		vh->data_pad = fmvhdr->data_pad;
+
+		for (j = 0; j < reserved_pebs; j++) {
+			int scrub;
+
+			pnum = be32_to_cpu(fmeba->pnum[j]);
+			if (pnum == UBI_LEB_UNMAPPED)
+				continue;
+
+			if (pnum < 0 || pnum >= ubi->peb_count ||
+			    (state[pnum] != FM_PEB_USED &&
+			     state[pnum] != FM_PEB_SCRUB)) {
+				ubi_warn("LEB %d:%d is mapped to bad PEB %d",
+					 vol_id, j, pnum);
+				goto out;
+			}
+
+			scrub = state[pnum] == FM_PEB_SCRUB;
+			state[pnum] = FM_PEB_MAPPED;
+
+			vh->lnum = cpu_to_be32(j);
+			err = ubi_scan_add_used(ubi, si, pnum, ecs[pnum], vh,
+						scrub);
+			if (err) {
+				if (err != -ENOMEM)
+					err = BAD_FASTMAP;
+				goto out;
+			}
+			err = BAD_FASTMAP;
+		}
+	}
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		if (state[pnum] == FM_PEB_USED || state[pnum] == FM_PEB_SCRUB) {
+			ubi_warn("PEB %d is used, but not mapped", pnum);
+			goto out;
+		}
+	}
+
+	if (!ubi_scan_find_sv(si, UBI_LAYOUT_VOLUME_ID)) {
+		ubi_warn("fastmap has no layout volume");
+		goto out;
+	}
+
+	/* Whatever was written to the pool PEBs is newer than the fastmap */
+	if (pool_count) {
+		dbg_bld("scan %d pool PEBs", pool_count);
+		err = ubi_scan_pebs(ubi, si, pool, pool_count);
+		if (err)
+			goto out;
+	}
+
+	si->is_empty = 0;
+	err = 0;
+out:
+	ubi_free_vid_hdr(ubi, vh);
+	kfree(pool);
+	kfree(ecs);
+	kfree(state);
+	return err;
+}
+
+/**
+ * ubi_scan_fastmap - get the scanning information from the fastmap.
+ * @ubi: UBI device description object
+ *
+ * This function looks for a fastmap and builds the scanning information
+ * from it, the same as 'ubi_scan()' would. Returns %NULL if there is no
+ * usable fastmap, the device has to be scanned then. In case of failure, an
+ * error code is returned.
+ */
+struct ubi_scan_info *ubi_scan_fastmap(struct ubi_device *ubi)
+{
+	struct ubi_fastmap_layout *fm;
+	struct ubi_scan_info *si;
+	unsigned long long max_sqnum = 0;
+	void *buf = NULL;
+	int anchor, err;
+
+	ubi->fm_size = calc_fm_size(ubi);
+	if (ubi->fm_size / ubi->leb_size > UBI_FM_MAX_BLOCKS) {
+		ubi_warn("device too large for a fastmap");
+		ubi->fm_disabled = 1;
+	}
+
+	anchor = find_fm_anchor(ubi);
+	if (anchor == -ENOENT)
+		return NULL;
+	if (anchor < 0)
+		return ERR_PTR(anchor);
+
+	si = ubi_scan_alloc_si();
+	fm = kzalloc(sizeof(struct ubi_fastmap_layout), GFP_KERNEL);
+	err = -ENOMEM;
+	if (!si || !fm)
+		goto out;
+
+	err = read_fm_blocks(ubi, anchor, fm, &buf, &max_sqnum);
+	if (err)
+		goto out;
+
+	err = parse_fm(ubi, si, fm, buf, fm->used_blocks * ubi->leb_size);
+	if (err)
+		goto out;
+
+	if (si->max_sqnum < max_sqnum)
+		si->max_sqnum = max_sqnum;
+
+	err = ubi_scan_finish(ubi, si);
+	if (err)
+		goto out;
+
+	vfree(buf);
+	ubi->fm = fm;
+	ubi->fm_keep = 1;
+	ubi_msg("attaching by fastmap at PEB %d (%d PEBs)", anchor,
+		fm->used_blocks);
+
+	return si;
+
+out:
+	vfree(buf);
+	if (fm)
+		free_fm_layout(fm);
+	if (si)
+		ubi_scan_destroy_si(si);
+
+	if (err < 0)
+		return ERR_PTR(err);
+
+	ubi_msg("no usable fastmap, scanning the device");
+	return NULL;
+}
+
+/**
+ * ubi_invalidate_fastmap - remove the fastmap from the flash.
+ * @ubi: UBI device description object
+ *
+ * This function is called before anything on the flash is changed. It erases
+ * the fastmap eraseblocks, so that a stale fastmap is never used. Returns
+ * zero in case of success and a negative error code in case of failure.
+ */
+int ubi_invalidate_fastmap(struct ubi_device *ubi)
+{
+	struct ubi_fastmap_layout *fm = ubi->fm;
+	struct ubi_wl_entry *e;
+	int i, ret, err = 0;
+
+	if (!fm)
+		return 0;
+
+	/* The erasure below goes through the I/O unit again */
+	ubi->fm = NULL;
+
+	dbg_bld("invalidate the fastmap at PEB %d", fm->e[0]->pnum);
+
+	for (i = 0; i < fm->used_blocks; i++) {
+		e = fm->e[i];
+
+		if (ubi->lookuptbl) {
+			ret = ubi_wl_put_fm_peb(ubi, e);
+		} else {
+			/*
+			 * The WL unit is not initialized yet, this happens
+			 * when the volume table is repaired while attaching.
+			 * The PEB is unused until the next attach.
+			 */
+			ret = ubi_scan_erase_peb(ubi, NULL, e->pnum, e->ec + 1);
+			kmem_cache_free(ubi_wl_entry_slab, e);
+		}
+
+		if (ret && !err)
+			err = ret;
+	}
+
+	kfree(fm);
+
+	return err;
+}
+
+/**
+ * fill_fm_ecs - add the erase counters of PEBs in a given state.
+ * @ubi: UBI device description object
+ * @state: PEB states
+ * @which: the state to add
+ * @ec: erase counters of the PEBs
+ * @fmec: where to store the records
+ *
+ * Returns the number of records added.
+ */
+static int fill_fm_ecs(struct ubi_device *ubi, const unsigned char *state,
+		       int which, const int *ec, struct ubi_fm_ec *fmec)
+{
+	int pnum, n = 0;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		if (state[pnum] != which)
+			continue;
+
+		fmec[n].pnum = cpu_to_be32(pnum);
+		fmec[n].ec = cpu_to_be32(ec[pnum]);
+		n++;
+	}
+
+	return n;
+}
+
+/**
+ * write_fm - write a fastmap to the given PEBs.
+ * @ubi: UBI device description object
+ * @fm: the fastmap PEBs
+ *
+ * Returns zero in case of success and a negative error code in case of
+ * failure.
+ */
+static int write_fm(struct ubi_device *ubi, struct ubi_fastmap_layout *fm)
+{
+	struct ubi_fm_sb *fmsb;
+	struct ubi_fm_hdr *fmhdr;
+	struct ubi_fm_scan_pool *fmpl;
+	struct ubi_fm_ec *fmec;
+	struct ubi_fm_volhdr *fmvhdr;
+	struct ubi_fm_eba *fmeba;
+	struct ubi_vid_hdr *vh;
+	struct ubi_wl_entry *e;
+	struct ubi_volume *vol;
+	struct rb_node *rb;
+	unsigned char *state;
+	int *ecs;
+	void *buf;
+	int i, j, n, err, pnum, pool_size, vol_count = 0, bad = 0;
+	int pos = 0;
+
+	buf = vmalloc(ubi->fm_size);
+	state = kzalloc(ubi->peb_count, GFP_KERNEL);
+	ecs = kmalloc(ubi->peb_count * sizeof(int), GFP_KERNEL);
+	vh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	err = -ENOMEM;
+	if (!buf || !state || !ecs || !vh)
+		goto out;
+
+	memset(buf, 0, ubi->fm_size);
+
+	/* Sort the PEBs known to the WL unit */
+	ubi_rb_for_each_entry(rb, e, &ubi->free, rb)
+		state[e->pnum] = FM_PEB_FREE;
+	ubi_rb_for_each_entry(rb, e, &ubi->scrub, rb)
+		state[e->pnum] = FM_PEB_SCRUB;
+	for (i = 0; i < fm->used_blocks; i++)
+		state[fm->e[i]->pnum] = FM_PEB_FASTMAP;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		e = ubi->lookuptbl[pnum];
+		if (e) {
+			if (state[pnum] == FM_PEB_UNKNOWN)
+				state[pnum] = FM_PEB_USED;
+			ecs[pnum] = e->ec;
+		} else if (ubi_io_is_bad(ubi, pnum)) {
+			state[pnum] = FM_PEB_BAD;
+			bad++;
+		} else {
+			/* Lost track of it, erase it on the next attach */
+			state[pnum] = FM_PEB_ERASE;
+			ecs[pnum] = ubi->mean_ec;
+		}
+	}
+
+	fmsb = buf;
+	pos += sizeof(struct ubi_fm_sb);
+
+	fmhdr = buf + pos;
+	pos += sizeof(struct ubi_fm_hdr);
+	fmhdr->magic = cpu_to_be32(UBI_FM_HDR_MAGIC);
+	fmhdr->bad_peb_count = cpu_to_be32(bad);
+
+	/*
+	 * Barebox uses no pools. Their size is set the way Linux would, so
+	 * that it can use them when it attaches from this fastmap.
+	 */
+	pool_size = ubi->peb_count / 100 * 5;
+	if (pool_size > UBI_FM_MAX_POOL_SIZE)
+		pool_size = UBI_FM_MAX_POOL_SIZE;
+	if (pool_size < UBI_FM_MIN_POOL_SIZE)
+		pool_size = UBI_FM_MIN_POOL_SIZE;
+
+	for (i = 0; i < 2; i++) {
+		fmpl = buf + pos;
+		pos += sizeof(struct ubi_fm_scan_pool);
+		fmpl->magic = cpu_to_be32(UBI_FM_POOL_MAGIC);
+		fmpl->max_size = cpu_to_be16(i ? UBI_FM_WL_POOL_SIZE :
+						 pool_size);
+	}
+
+	fmec = buf + pos;
+	n = fill_fm_ecs(ubi, state, FM_PEB_FREE, ecs, fmec);
+	fmhdr->free_peb_count = cpu_to_be32(n);
+	pos += n * sizeof(struct ubi_fm_ec);
+
+	fmec = buf + pos;
+	n = fill_fm_ecs(ubi, state, FM_PEB_USED, ecs, fmec);
+	fmhdr->used_peb_count = cpu_to_be32(n);
+	pos += n * sizeof(struct ubi_fm_ec);
+
+	fmec = buf + pos;
+	n = fill_fm_ecs(ubi, state, FM_PEB_SCRUB, ecs, fmec);
+	fmhdr->scrub_peb_count = cpu_to_be32(n);
+	pos += n * sizeof(struct ubi_fm_ec);
+
+	fmec = buf + pos;
+	n = fill_fm_ecs(ubi, state, FM_PEB_ERASE, ecs, fmec);
+	fmhdr->erase_peb_count = cpu_to_be32(n);
+	pos += n * sizeof(struct ubi_fm_ec);
+
+	for (i = 0; i < ubi->vtbl_slots + UBI_INT_VOL_COUNT; i++) {
+		vol = ubi->volumes[i];
+		if (!vol)
+			continue;
+
+		if (pos + sizeof(struct ubi_fm_volhdr) +
+		    sizeof(struct ubi_fm_eba) +
+		    vol->reserved_pebs * sizeof(__be32) > ubi->fm_size) {
+			ubi_err("fastmap too large");
+			err = -ENOSPC;
+			goto out;
+		}
+
+		fmvhdr = buf + pos;
+		pos += sizeof(struct ubi_fm_volhdr);
+		fmvhdr->magic = cpu_to_be32(UBI_FM_VHDR_MAGIC);
+		fmvhdr->vol_id = cpu_to_be32(vol->vol_id);
+		fmvhdr->vol_type = vol->vol_type;
+		fmvhdr->used_ebs = cpu_to_be32(vol->used_ebs);
+		fmvhdr->data_pad = cpu_to_be32(vol->data_pad);
+		fmvhdr->last_eb_bytes = cpu_to_be32(vol->last_eb_bytes);
+
+		fmeba = buf + pos;
+		pos += sizeof(struct ubi_fm_eba);
+		fmeba->magic = cpu_to_be32(UBI_FM_EBA_MAGIC);
+		fmeba->reserved_pebs = cpu_to_be32(vol->reserved_pebs);
+		for (j = 0; j < vol->reserved_pebs; j++)
+			fmeba->pnum[j] = cpu_to_be32(vol->eba_tbl[j]);
+		pos += vol->reserved_pebs * sizeof(__be32);
+
+		vol_count++;
+	}
+
+	fmhdr->vol_count = cpu_to_be32(vol_count);
+
+	fmsb->magic = cpu_to_be32(UBI_FM_SB_MAGIC);
+	fmsb->version = UBI_FM_FMT_VERSION;
+	fmsb->used_blocks = cpu_to_be32(fm->used_blocks);
+	fmsb->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
+	for (i = 0; i < fm->used_blocks; i++) {
+		fmsb->block_loc[i] = cpu_to_be32(fm->e[i]->pnum);
+		fmsb->block_ec[i] = cpu_to_be32(fm->e[i]->ec);
+	}
+	fmsb->data_crc = cpu_to_be32(crc32(UBI_CRC32_INIT, buf,
+					   ubi->fm_size));
+
+	/* Write the super block last, it makes the fastmap valid */
+	for (i = fm->used_blocks - 1; i >= 0; i--) {
+		memset(vh, 0, sizeof(struct ubi_vid_hdr));
+		vh->vol_type = UBI_VID_DYNAMIC;
+		vh->compat = UBI_COMPAT_DELETE;
+		vh->vol_id = cpu_to_be32(i ? UBI_FM_DATA_VOLUME_ID :
+					     UBI_FM_SB_VOLUME_ID);
+		vh->lnum = cpu_to_be32(i);
+		vh->sqnum = cpu_to_be64(ubi_next_sqnum(ubi));
+
+		pnum = fm->e[i]->pnum;
+		err = ubi_io_write_vid_hdr(ubi, pnum, vh);
+		if (err)
+			goto out;
+
+		err = ubi_io_write_data(ubi, buf + i * ubi->leb_size, pnum, 0,
+					ubi->leb_size);
+		if (err)
+			goto out;
+	}
+
+	err = 0;
+out:
+	ubi_free_vid_hdr(ubi, vh);
+	kfree(ecs);
+	kfree(state);
+	vfree(buf);
+	return err;
+}
+
+/**
+ * ubi_update_fastmap - write a new fastmap.
+ * @ubi: UBI device description object
+ *
+ * This function writes a fastmap describing the current state of the
+ * device, unless the fastmap on the flash is still valid or the device is
+ * not to get one. It is called when a change to the device is complete.
+ * Returns zero in case of success and a negative error code in case of
+ * failure.
+ */
+int ubi_update_fastmap(struct ubi_device *ubi)
+{
+	struct ubi_fastmap_layout *fm;
+	int i, err;
+
+	if (ubi->fm || ubi->fm_disabled || ubi->ro_mode)
+		return 0;
+
+	if (!ubi->fm_keep && !IS_ENABLED(CONFIG_UBI_FASTMAP_CREATE))
+		return 0;
+
+	/* The state has to be stable, no erasures pending */
+	err = ubi_wl_flush(ubi);
+	if (err)
+		return err;
+
+	fm = kzalloc(sizeof(struct ubi_fastmap_layout), GFP_KERNEL);
+	if (!fm)
+		return -ENOMEM;
+
+	for (i = 0; i < ubi->fm_size / ubi->leb_size; i++) {
+		fm->e[i] = ubi_wl_get_fm_peb(ubi, i == 0);
+		if (!fm->e[i]) {
+			if (!i)
+				ubi_warn("no free PEB below %d for the fastmap",
+					 UBI_FM_MAX_START);
+			else
+				ubi_warn("no free PEB for the fastmap");
+			err = -ENOSPC;
+			break;
+		}
+		fm->used_blocks = i + 1;
+	}
+
+	if (!err)
+		err = write_fm(ubi, fm);
+
+	if (err) {
+		ubi_err("cannot write fastmap, error %d", err);
+		for (i = 0; i < fm->used_blocks; i++)
+			ubi_wl_put_fm_peb(ubi, fm->e[i]);
+		kfree(fm);
+		return err;
+	}
+
+	dbg_bld("fastmap written to PEB %d", fm->e[0]->pnum);
+	ubi->fm = fm;
+
+	return 0;
+}
+
+/**
+ * ubi_free_fastmap - free the in-memory fastmap information.
+ * @ubi: UBI device description object
+ */
+void ubi_free_fastmap(struct ubi_device *ubi)
+{
+	if (ubi->fm)
+		free_fm_layout(ubi->fm);
+	ubi->fm = NULL;
+}
@@ -138,6 +138,9 @@ static int paranoid_check_all_ff(struct ubi_device *ubi, int pnum, int offset,
 int ubi_io_read(const struct ubi_device *ubi, void *buf, int pnum, int offset,
 		int len)
 {
+	struct ubi_stats *stats = ubi->stats;
+	uint64_t start = get_time_ns();
+	unsigned int corrected = ubi->mtd->ecc_stats.corrected;
 	int err, retries = 0;
 	size_t read;
 	loff_t addr;
@@ -163,7 +166,8 @@ retry:
 			 */
 			ubi_msg("fixable bit-flip detected at PEB %d", pnum);
 			ubi_assert(len == read);
-			return UBI_IO_BITFLIPS;
+			err = UBI_IO_BITFLIPS;
+			goto out;
 		}
 
 		if (read != len && retries++ < UBI_IO_RETRIES) {
@@ -197,6 +201,21 @@ retry:
 		}
 	}
 
+out:
+	stats->reads++;
+	stats->read_bytes += read;
+	stats->read_ns += get_time_ns() - start;
+	/*
+	 * NAND drivers count the corrected bits without necessarily returning
+	 * -EUCLEAN, a bit-flip reported without that counts as one.
+	 */
+	corrected = ubi->mtd->ecc_stats.corrected - corrected;
+	if (!corrected && err == UBI_IO_BITFLIPS)
+		corrected = 1;
+	stats->bitflips += corrected;
+	if (err == -EBADMSG)
+		stats->ecc_errors++;
+
 	return err;
 }
 
@@ -220,6 +239,7 @@ retry:
 int ubi_io_write(struct ubi_device *ubi, const void *buf, int pnum, int offset,
 		 int len)
 {
+	uint64_t start;
 	int err;
 	size_t written;
 	loff_t addr;
@@ -236,6 +256,11 @@ int ubi_io_write(struct ubi_device *ubi, const void *buf, int pnum, int offset,
 		return -EROFS;
 	}
 
+	/* Any change on the flash makes the fastmap stale */
+	err = ubi_invalidate_fastmap(ubi);
+	if (err)
+		return err;
+
 	/* The below has to be compiled out if paranoid checks are disabled */
 
 	err = paranoid_check_not_bad(ubi, pnum);
@@ -268,7 +293,11 @@ int ubi_io_write(struct ubi_device *ubi, const void *buf, int pnum, int offset,
 	}
 
 	addr = (loff_t)pnum * ubi->peb_size + offset;
+	start = get_time_ns();
 	err = ubi->mtd->write(ubi->mtd, addr, len, &written, buf);
+	ubi->stats->writes++;
+	ubi->stats->write_bytes += written;
+	ubi->stats->write_ns += get_time_ns() - start;
 	if (err) {
 		ubi_err("error %d while writing %d bytes to PEB %d:%d, written"
 			" %zd bytes", err, len, pnum, offset, written);
@@ -305,10 +334,13 @@ static int do_sync_erase(struct ubi_device *ubi, int pnum)
 	int err, retries = 0;
 	struct erase_info ei;
 	wait_queue_head_t wq;
+	uint64_t start;
 
 	dbg_io("erase PEB %d", pnum);
 
+	ubi->stats->erases++;
 retry:
+	start = get_time_ns();
 	init_waitqueue_head(&wq);
 	memset(&ei, 0, sizeof(struct erase_info));
 
@@ -320,6 +352,7 @@ retry:
 
 	err = ubi->mtd->erase(ubi->mtd, &ei);
 	if (err) {
+		ubi->stats->erase_ns += get_time_ns() - start;
 		if (retries++ < UBI_IO_RETRIES) {
 			dbg_io("error %d while erasing PEB %d, retry",
 			       err, pnum);
@@ -333,6 +366,7 @@ retry:
 
 	err = wait_event_interruptible(wq, ei.state == MTD_ERASE_DONE ||
 					   ei.state == MTD_ERASE_FAILED);
+	ubi->stats->erase_ns += get_time_ns() - start;
 	if (err) {
 		ubi_err("interrupted PEB %d erasure", pnum);
 		return -EINTR;
@@ -399,6 +433,8 @@ static int torture_peb(struct ubi_device *ubi, int pnum)
 	patt_count = ARRAY_SIZE(patterns);
 	ubi_assert(patt_count > 0);
 
+	ubi->stats->tortures++;
+
 	mutex_lock(&ubi->buf_mutex);
 	for (i = 0; i < patt_count; i++) {
 		err = do_sync_erase(ubi, pnum);
@@ -486,6 +522,10 @@ int ubi_io_sync_erase(struct ubi_device *ubi, int pnum, int torture)
 		return -EROFS;
 	}
 
+	err = ubi_invalidate_fastmap(ubi);
+	if (err)
+		return err;
+
 	if (torture) {
 		ret = torture_peb(ubi, pnum);
 		if (ret < 0)
@@ -631,6 +671,7 @@ bad:
 int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 		       struct ubi_ec_hdr *ec_hdr, int verbose)
 {
+	uint64_t start;
 	int err, read_err = 0;
 	uint32_t crc, magic, hdr_crc;
 
@@ -639,7 +680,10 @@ int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 	if (UBI_IO_DEBUG)
 		verbose = 1;
 
+	start = get_time_ns();
 	err = ubi_io_read(ubi, ec_hdr, pnum, 0, UBI_EC_HDR_SIZE);
+	ubi->stats->ec_hdr_reads++;
+	ubi->stats->ec_hdr_ns += get_time_ns() - start;
 	if (err) {
 		if (err != UBI_IO_BITFLIPS && err != -EBADMSG)
 			return err;
@@ -699,7 +743,7 @@ int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 		return UBI_IO_BAD_EC_HDR;
 	}
 
-	crc = crc32(UBI_CRC32_INIT, ec_hdr, UBI_EC_HDR_SIZE_CRC);
+	crc = ubi_crc32(ubi, ec_hdr, UBI_EC_HDR_SIZE_CRC);
 	hdr_crc = be32_to_cpu(ec_hdr->hdr_crc);
 
 	if (hdr_crc != crc) {
@@ -905,6 +949,7 @@ bad:
 int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 			struct ubi_vid_hdr *vid_hdr, int verbose)
 {
+	uint64_t start;
 	int err, read_err = 0;
 	uint32_t crc, magic, hdr_crc;
 	void *p;
@@ -915,8 +960,11 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 		verbose = 1;
 
 	p = (char *)vid_hdr - ubi->vid_hdr_shift;
+	start = get_time_ns();
 	err = ubi_io_read(ubi, p, pnum, ubi->vid_hdr_aloffset,
 			  ubi->vid_hdr_alsize);
+	ubi->stats->vid_hdr_reads++;
+	ubi->stats->vid_hdr_ns += get_time_ns() - start;
 	if (err) {
 		if (err != UBI_IO_BITFLIPS && err != -EBADMSG)
 			return err;
@@ -974,7 +1022,7 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 		return UBI_IO_BAD_VID_HDR;
 	}
 
-	crc = crc32(UBI_CRC32_INIT, vid_hdr, UBI_VID_HDR_SIZE_CRC);
+	crc = ubi_crc32(ubi, vid_hdr, UBI_VID_HDR_SIZE_CRC);
 	hdr_crc = be32_to_cpu(vid_hdr->hdr_crc);
 
 	if (hdr_crc != crc) {
@@ -353,7 +353,7 @@ static int compare_lebs(struct ubi_device *ubi, const struct ubi_scan_leb *seb,
 		goto out_free_buf;
 
 	data_crc = be32_to_cpu(vid_hdr->data_crc);
-	crc = crc32(UBI_CRC32_INIT, buf, len);
+	crc = ubi_crc32(ubi, buf, len);
 	if (crc != data_crc) {
 		dbg_bld("PEB %d CRC error: calculated %#08x, must be %#08x",
 			pnum, crc, data_crc);
@@ -853,7 +853,7 @@ static int process_eb(struct ubi_device *ubi, struct ubi_scan_info *si, int pnum
 			err = add_to_list(si, pnum, ec, &si->corr);
 			if (err)
 				return err;
-			break;
+			goto adjust_mean_ec;
 
 		case UBI_COMPAT_RO:
 			ubi_msg("read-only compatible internal volume %d:%d"
@@ -897,23 +897,18 @@ adjust_mean_ec:
 }
 
 /**
- * ubi_scan - scan an MTD device.
- * @ubi: UBI device description object
+ * ubi_scan_alloc_si - allocate empty scanning information.
  *
- * This function does full scanning of an MTD device and returns complete
- * information about it. In case of failure, an error code is returned.
+ * This function returns the new scanning information object or %NULL if
+ * there is no memory.
  */
-struct ubi_scan_info *ubi_scan(struct ubi_device *ubi)
+struct ubi_scan_info *ubi_scan_alloc_si(void)
 {
-	int err, pnum;
-	struct rb_node *rb1, *rb2;
-	struct ubi_scan_volume *sv;
-	struct ubi_scan_leb *seb;
 	struct ubi_scan_info *si;
 
 	si = kzalloc(sizeof(struct ubi_scan_info), GFP_KERNEL);
 	if (!si)
-		return ERR_PTR(-ENOMEM);
+		return NULL;
 
 	INIT_LIST_HEAD(&si->corr);
 	INIT_LIST_HEAD(&si->free);
@@ -922,27 +917,63 @@ struct ubi_scan_info *ubi_scan(struct ubi_device *ubi)
 	si->volumes = RB_ROOT;
 	si->is_empty = 1;
 
-	err = -ENOMEM;
+	return si;
+}
+
+/**
+ * ubi_scan_pebs - scan a set of physical eraseblocks.
+ * @ubi: UBI device description object
+ * @si: scanning information to add the eraseblocks to
+ * @pebs: physical eraseblock numbers
+ * @count: number of entries in @pebs
+ *
+ * This function reads the UBI headers of the given physical eraseblocks and
+ * adds them to the scanning information, the same way a full scan does.
+ * Returns zero in case of success and a negative error code in case of
+ * failure.
+ */
+int ubi_scan_pebs(struct ubi_device *ubi, struct ubi_scan_info *si,
+		  const int *pebs, int count)
+{
+	int err = -ENOMEM, i;
+
 	ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
 	if (!ech)
-		goto out_si;
+		return err;
 
 	vidh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
 	if (!vidh)
 		goto out_ech;
 
-	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+	for (i = 0; i < count; i++) {
 		cond_resched();
 
-//		dbg_msg("process PEB %d", pnum);
-		err = process_eb(ubi, si, pnum);
-		if(err < 0)
-			printf("err: %d\n", err);
+		err = process_eb(ubi, si, pebs[i]);
 		if (err < 0)
-			goto out_vidh;
+			break;
 	}
 
-	dbg_msg("scanning is finished");
+	ubi_free_vid_hdr(ubi, vidh);
+out_ech:
+	kfree(ech);
+	return err;
+}
+
+/**
+ * ubi_scan_finish - finish the scanning information.
+ * @ubi: UBI device description object
+ * @si: scanning information
+ *
+ * This function calculates the mean erase counter and uses it for all
+ * eraseblocks with unknown erase counters. Returns zero in case of success
+ * and a negative error code in case of failure.
+ */
+int ubi_scan_finish(struct ubi_device *ubi, struct ubi_scan_info *si)
+{
+	struct rb_node *rb1, *rb2;
+	struct ubi_scan_volume *sv;
+	struct ubi_scan_leb *seb;
+	int err;
 
 	/* Calculate mean erase counter */
 	if (si->ec_count) {
@@ -950,9 +981,6 @@ struct ubi_scan_info *ubi_scan(struct ubi_device *ubi)
 		si->mean_ec = si->ec_sum;
 	}
 
-	if (si->is_empty)
-		ubi_msg("empty MTD device detected");
-
 	/*
 	 * In case of unknown erase counter we use the mean erase counter
 	 * value.
@@ -977,12 +1005,57 @@ struct ubi_scan_info *ubi_scan(struct ubi_device *ubi)
 			seb->ec = si->mean_ec;
 
 	err = paranoid_check_si(ubi, si);
-	if (err) {
-		if (err > 0)
-			err = -EINVAL;
-		goto out_vidh;
+	if (err > 0)
+		err = -EINVAL;
+
+	return err;
+}
+
+/**
+ * ubi_scan - scan an MTD device.
+ * @ubi: UBI device description object
+ *
+ * This function does full scanning of an MTD device and returns complete
+ * information about it. In case of failure, an error code is returned.
+ */
+struct ubi_scan_info *ubi_scan(struct ubi_device *ubi)
+{
+	int err, pnum;
+	struct ubi_scan_info *si;
+
+	si = ubi_scan_alloc_si();
+	if (!si)
+		return ERR_PTR(-ENOMEM);
+
+	err = -ENOMEM;
+	ech = kzalloc(ubi->ec_hdr_alsize, GFP_KERNEL);
+	if (!ech)
+		goto out_si;
+
+	vidh = ubi_zalloc_vid_hdr(ubi, GFP_KERNEL);
+	if (!vidh)
+		goto out_ech;
+
+	for (pnum = 0; pnum < ubi->peb_count; pnum++) {
+		cond_resched();
+
+//		dbg_msg("process PEB %d", pnum);
+		err = process_eb(ubi, si, pnum);
+		if(err < 0)
+			printf("err: %d\n", err);
+		if (err < 0)
+			goto out_vidh;
 	}
 
+	dbg_msg("scanning is finished");
+
+	if (si->is_empty)
+		ubi_msg("empty MTD device detected");
+
+	err = ubi_scan_finish(ubi, si);
+	if (err)
+		goto out_vidh;
+
 	ubi_free_vid_hdr(ubi, vidh);
 	kfree(ech);
 
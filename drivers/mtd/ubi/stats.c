@@ -0,0 +1,194 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See
+ * the GNU General Public License for more details.
+ */
+
+/*
+ * The attach and I/O statistics of an UBI device. They are exported as
+ * parameters of a "ubiN" device and printed by ubi_print_info().
+ */
+
+#include <common.h>
+#include <driver.h>
+#include <param.h>
+#include <malloc.h>
+#include <asm-generic/div64.h>
+#include "ubi-barebox.h"
+#include "ubi.h"
+
+static const struct {
+	const char *name;
+	size_t offset;
+} ubi_stats_params[] = {
+	{ "attach_ns", offsetof(struct ubi_stats, attach_ns) },
+	{ "scan_ns", offsetof(struct ubi_stats, scan_ns) },
+	{ "vtbl_ns", offsetof(struct ubi_stats, vtbl_ns) },
+	{ "wl_init_ns", offsetof(struct ubi_stats, wl_init_ns) },
+	{ "eba_init_ns", offsetof(struct ubi_stats, eba_init_ns) },
+	{ "fastmap", offsetof(struct ubi_stats, fastmap) },
+	{ "ec_hdr_reads", offsetof(struct ubi_stats, ec_hdr_reads) },
+	{ "ec_hdr_ns", offsetof(struct ubi_stats, ec_hdr_ns) },
+	{ "vid_hdr_reads", offsetof(struct ubi_stats, vid_hdr_reads) },
+	{ "vid_hdr_ns", offsetof(struct ubi_stats, vid_hdr_ns) },
+	{ "crc_ns", offsetof(struct ubi_stats, crc_ns) },
+	{ "reads", offsetof(struct ubi_stats, reads) },
+	{ "read_bytes", offsetof(struct ubi_stats, read_bytes) },
+	{ "read_ns", offsetof(struct ubi_stats, read_ns) },
+	{ "writes", offsetof(struct ubi_stats, writes) },
+	{ "write_bytes", offsetof(struct ubi_stats, write_bytes) },
+	{ "write_ns", offsetof(struct ubi_stats, write_ns) },
+	{ "erases", offsetof(struct ubi_stats, erases) },
+	{ "erase_ns", offsetof(struct ubi_stats, erase_ns) },
+	{ "bitflips", offsetof(struct ubi_stats, bitflips) },
+	{ "ecc_errors", offsetof(struct ubi_stats, ecc_errors) },
+	{ "scrubs", offsetof(struct ubi_stats, scrubs) },
+	{ "tortures", offsetof(struct ubi_stats, tortures) },
+	{ "wl_moves", offsetof(struct ubi_stats, wl_moves) },
+	{ "leb_reads", offsetof(struct ubi_stats, leb_reads) },
+	{ "leb_writes", offsetof(struct ubi_stats, leb_writes) },
+};
+
+/**
+ * ubi_stats_register - export the statistics of an UBI device.
+ * @ubi: UBI device description object
+ *
+ * This function returns zero in case of success and a negative error code in
+ * case of failure.
+ */
+int ubi_stats_register(struct ubi_device *ubi)
+{
+	struct device_d *dev = &ubi->stats_dev;
+	int i, err;
+
+	strcpy(dev->name, "ubi");
+	dev->id = ubi->ubi_num;
+	dev->priv = ubi;
+
+	err = register_device(dev);
+	if (err)
+		return err;
+
+	/* the statistics can only be reset to zero */
+	for (i = 0; i < ARRAY_SIZE(ubi_stats_params); i++)
+		dev_add_param_u64(dev, ubi_stats_params[i].name,
+				(void *)ubi->stats + ubi_stats_params[i].offset,
+				PARAM_FLAG_CLEAR);
+
+	return 0;
+}
+
+/**
+ * ubi_stats_unregister - remove the statistics device of an UBI device.
+ * @ubi: UBI device description object
+ */
+void ubi_stats_unregister(struct ubi_device *ubi)
+{
+	dev_remove_parameters(&ubi->stats_dev);
+	unregister_device(&ubi->stats_dev);
+}
+
+/* print @ns as milliseconds with three decimals */
+static void ubi_print_ms(uint64_t ns)
+{
+	uint32_t us;
+
+	do_div(ns, 1000);
+	us = do_div(ns, 1000);
+	printf("%llu.%03u ms\n", ns, us);
+}
+
+static void ubi_print_time(const char *what, uint64_t ns)
+{
+	printf("  %-24s ", what);
+	ubi_print_ms(ns);
+}
+
+static void ubi_print_io(const char *what, uint64_t count, uint64_t bytes,
+		uint64_t ns)
+{
+	uint64_t us = ns, rate = bytes * 1000000;
+
+	do_div(us, 1000);
+	if (!us)
+		us = 1;
+	/* do_div() only takes a 32 bit divisor */
+	while (us >> 32) {
+		us >>= 1;
+		rate >>= 1;
+	}
+	do_div(rate, us);
+
+	printf("  %-24s %8llu, %llu KiB, %llu KiB/s, ", what, count,
+			bytes >> 10, rate >> 10);
+	ubi_print_ms(ns);
+}
+
+static void ubi_print_count(const char *what, uint64_t count, uint64_t ns)
+{
+	printf("  %-24s %8llu, ", what, count);
+	ubi_print_ms(ns);
+}
+
+/**
+ * ubi_print_info - print information and statistics of an UBI device.
+ * @ubi_num: UBI device number
+ *
+ * This function returns zero in case of success and %-ENODEV if there is no
+ * UBI device @ubi_num.
+ */
+int ubi_print_info(int ubi_num)
+{
+	struct ubi_device *ubi = ubi_get_device(ubi_num);
+	struct ubi_stats *s;
+
+	if (!ubi)
+		return -ENODEV;
+
+	s = ubi->stats;
+
+	printf("%s: mtd%d \"%s\"\n", ubi->ubi_name, ubi->mtd->index,
+			ubi->mtd->name);
+	printf("  PEBs: %d, good %d, bad %d, available %d, PEB size %d, "
+			"LEB size %d\n", ubi->peb_count, ubi->good_peb_count,
+			ubi->bad_peb_count, ubi->avail_pebs, ubi->peb_size,
+			ubi->leb_size);
+	printf("  volumes: %d, max/mean erase counter %d/%d\n",
+			ubi->vol_count - UBI_INT_VOL_COUNT, ubi->max_ec,
+			ubi->mean_ec);
+
+	printf("attach (%s):\n", s->fastmap ? "fastmap" : "scan");
+	ubi_print_time("total", s->attach_ns);
+	ubi_print_time(s->fastmap ? "fastmap" : "scan", s->scan_ns);
+	ubi_print_time("volume table", s->vtbl_ns);
+	ubi_print_time("wear-leveling init", s->wl_init_ns);
+	ubi_print_time("EBA init", s->eba_init_ns);
+
+	printf("headers and CRCs:\n");
+	ubi_print_count("EC headers", s->ec_hdr_reads, s->ec_hdr_ns);
+	ubi_print_count("VID headers", s->vid_hdr_reads, s->vid_hdr_ns);
+	ubi_print_time("CRC checks", s->crc_ns);
+
+	printf("I/O:\n");
+	ubi_print_io("reads", s->reads, s->read_bytes, s->read_ns);
+	ubi_print_io("writes", s->writes, s->write_bytes, s->write_ns);
+	ubi_print_count("erases", s->erases, s->erase_ns);
+	printf("  %-24s %8llu\n", "LEB reads", s->leb_reads);
+	printf("  %-24s %8llu\n", "LEB writes", s->leb_writes);
+	printf("  %-24s %8llu\n", "bit-flips", s->bitflips);
+	printf("  %-24s %8llu\n", "ECC errors", s->ecc_errors);
+	printf("  %-24s %8llu\n", "scrubs", s->scrubs);
+	printf("  %-24s %8llu\n", "tortures", s->tortures);
+	printf("  %-24s %8llu\n", "wear-leveling moves", s->wl_moves);
+
+	ubi_put_device(ubi);
+
+	return 0;
+}
+EXPORT_SYMBOL(ubi_print_info);
@@ -47,6 +47,8 @@
 #include <linux/string.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/ubi.h>
+#include <clock.h>
+#include <driver.h>
 
 #include "ubi-media.h"
 #include "scan.h"
@@ -118,6 +120,19 @@ struct ubi_wl_entry {
 	int pnum;
 };
 
+/**
+ * struct ubi_fastmap_layout - in-memory fastmap data structure.
+ * @e: PEBs used by the current fastmap, @e[0] is the anchor
+ * @used_blocks: number of used PEBs
+ *
+ * The PEBs of the fastmap are not kept in any of the WL RB-trees, they go
+ * back to the free tree when the fastmap is invalidated.
+ */
+struct ubi_fastmap_layout {
+	struct ubi_wl_entry *e[UBI_FM_MAX_BLOCKS];
+	int used_blocks;
+};
+
 /**
  * struct ubi_ltree_entry - an entry in the lock tree.
  * @rb: links RB-tree nodes
@@ -256,6 +271,71 @@ struct ubi_volume_desc {
 
 struct ubi_wl_entry;
 
+/**
+ * struct ubi_stats - UBI attach and I/O statistics
+ * @attach_ns: time spent attaching the device
+ * @scan_ns: time spent scanning the PEBs or reading the fastmap
+ * @vtbl_ns: time spent reading the volume table
+ * @wl_init_ns: time spent setting up wear-leveling
+ * @eba_init_ns: time spent setting up the EBA tables
+ * @fastmap: %1 if the device was attached from a fastmap
+ * @ec_hdr_reads: number of EC headers read
+ * @ec_hdr_ns: time spent reading EC headers, without checking them
+ * @vid_hdr_reads: number of VID headers read
+ * @vid_hdr_ns: time spent reading VID headers, without checking them
+ * @crc_ns: time spent checking the CRCs of headers and data
+ * @reads: number of read operations
+ * @read_bytes: number of bytes read
+ * @read_ns: time spent reading
+ * @writes: number of write operations
+ * @write_bytes: number of bytes written
+ * @write_ns: time spent writing
+ * @erases: number of PEB erasures, including those of torture tests
+ * @erase_ns: time spent erasing
+ * @bitflips: number of corrected bit-flips
+ * @ecc_errors: number of reads with uncorrectable errors
+ * @scrubs: number of PEBs scheduled for scrubbing
+ * @tortures: number of PEBs tortured
+ * @wl_moves: number of LEBs moved by wear-leveling or scrubbing
+ * @leb_reads: number of LEB read operations
+ * @leb_writes: number of LEB write operations
+ *
+ * All fields are 64 bit wide so that they can be exported as device
+ * parameters the same way.
+ */
+struct ubi_stats {
+	uint64_t attach_ns;
+	uint64_t scan_ns;
+	uint64_t vtbl_ns;
+	uint64_t wl_init_ns;
+	uint64_t eba_init_ns;
+	uint64_t fastmap;
+
+	uint64_t ec_hdr_reads;
+	uint64_t ec_hdr_ns;
+	uint64_t vid_hdr_reads;
+	uint64_t vid_hdr_ns;
+	uint64_t crc_ns;
+
+	uint64_t reads;
+	uint64_t read_bytes;
+	uint64_t read_ns;
+	uint64_t writes;
+	uint64_t write_bytes;
+	uint64_t write_ns;
+	uint64_t erases;
+	uint64_t erase_ns;
+
+	uint64_t bitflips;
+	uint64_t ecc_errors;
+	uint64_t scrubs;
+	uint64_t tortures;
+	uint64_t wl_moves;
+
+	uint64_t leb_reads;
+	uint64_t leb_writes;
+};
+
 /**
  * struct ubi_device - UBI device description structure
  * @dev: UBI device object to use the the Linux device model
@@ -337,11 +417,21 @@ struct ubi_wl_entry;
  *               not
  * @mtd: MTD device descriptor
  *
+ * @fm: the fastmap which is valid on the flash, %NULL if there is none
+ * @fm_size: size of a fastmap in bytes, a multiple of @leb_size
+ * @fm_disabled: if no fastmap is written for this device
+ * @fm_keep: if the device was attached by a fastmap, which is written
+ *           again after changes
+ *
  * @peb_buf1: a buffer of PEB size used for different purposes
  * @peb_buf2: another buffer of PEB size used for different purposes
  * @buf_mutex: proptects @peb_buf1 and @peb_buf2
  * @dbg_peb_buf: buffer of PEB size used for debugging
  * @dbg_buf_mutex: proptects @dbg_peb_buf
+ *
+ * @stats: attach and I/O statistics, a pointer so that they can be updated
+ *         through const device pointers
+ * @stats_dev: device exporting @stats as parameters
  */
 struct ubi_device {
 	struct cdev cdev;
@@ -416,6 +506,12 @@ struct ubi_device {
 	int bad_allowed;
 	struct mtd_info *mtd;
 
+	/* Fastmap stuff */
+	struct ubi_fastmap_layout *fm;
+	int fm_size;
+	int fm_disabled;
+	int fm_keep;
+
 	void *peb_buf1;
 	void *peb_buf2;
 	struct mutex buf_mutex;
@@ -424,6 +520,9 @@ struct ubi_device {
 	void *dbg_peb_buf;
 	struct mutex dbg_buf_mutex;
 #endif
+
+	struct ubi_stats *stats;
+	struct device_d stats_dev;
 };
 
 extern struct kmem_cache *ubi_wl_entry_slab;
@@ -445,6 +544,10 @@ int ubi_resize_volume(struct ubi_volume_desc *desc, int reserved_pebs);
 int ubi_add_volume(struct ubi_device *ubi, struct ubi_volume *vol);
 void ubi_free_volume(struct ubi_device *ubi, struct ubi_volume *vol);
 
+/* stats.c */
+int ubi_stats_register(struct ubi_device *ubi);
+void ubi_stats_unregister(struct ubi_device *ubi);
+
 /* upd.c */
 int ubi_start_update(struct ubi_device *ubi, struct ubi_volume *vol,
 		     long long bytes);
@@ -487,6 +590,7 @@ int ubi_eba_atomic_leb_change(struct ubi_device *ubi, struct ubi_volume *vol,
 int ubi_eba_copy_leb(struct ubi_device *ubi, int from, int to,
 		     struct ubi_vid_hdr *vid_hdr);
 int ubi_eba_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si);
+unsigned long long ubi_next_sqnum(struct ubi_device *ubi);
 void ubi_eba_close(const struct ubi_device *ubi);
 
 /* wl.c */
@@ -496,6 +600,8 @@ int ubi_wl_flush(struct ubi_device *ubi);
 int ubi_wl_scrub_peb(struct ubi_device *ubi, int pnum);
 int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si);
 void ubi_wl_close(struct ubi_device *ubi);
+struct ubi_wl_entry *ubi_wl_get_fm_peb(struct ubi_device *ubi, int anchor);
+int ubi_wl_put_fm_peb(struct ubi_device *ubi, struct ubi_wl_entry *e);
 int ubi_thread(void *u);
 
 /* io.c */
@@ -515,6 +621,18 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 			 struct ubi_vid_hdr *vid_hdr);
 
+/* fastmap.c */
+#ifdef CONFIG_UBI_FASTMAP
+struct ubi_scan_info *ubi_scan_fastmap(struct ubi_device *ubi);
+int ubi_update_fastmap(struct ubi_device *ubi);
+int ubi_invalidate_fastmap(struct ubi_device *ubi);
+void ubi_free_fastmap(struct ubi_device *ubi);
+#else
+static inline int ubi_update_fastmap(struct ubi_device *ubi) { return 0; }
+static inline int ubi_invalidate_fastmap(struct ubi_device *ubi) { return 0; }
+static inline void ubi_free_fastmap(struct ubi_device *ubi) { }
+#endif
+
 /* build.c */
 int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num, int vid_hdr_offset);
 int ubi_detach_mtd_dev(struct mtd_info *mtd, int anyway);
@@ -607,6 +725,20 @@ static inline int ubi_io_write_data(struct ubi_device *ubi, const void *buf,
 	return ubi_io_write(ubi, buf, pnum, offset + ubi->leb_start, len);
 }
 
+/*
+ * CRC check of headers or data read from the flash, the time is accounted in
+ * the statistics of @ubi.
+ */
+static inline uint32_t ubi_crc32(const struct ubi_device *ubi, const void *buf,
+				 int len)
+{
+	uint64_t start = get_time_ns();
+	uint32_t crc = crc32(UBI_CRC32_INIT, buf, len);
+
+	ubi->stats->crc_ns += get_time_ns() - start;
+	return crc;
+}
+
 /**
  * ubi_ro_mode - switch to read-only mode.
  * @ubi: UBI device description object
@@ -877,7 +877,8 @@ static int wear_leveling_worker(struct ubi_device *ubi, struct ubi_work *wrk,
 		}
 
 		protect = 1;
-	}
+	} else
+		ubi->stats->wl_moves++;
 
 	ubi_free_vid_hdr(ubi, vid_hdr);
 	spin_lock(&ubi->wl_lock);
@@ -1098,6 +1099,7 @@ static int erase_worker(struct ubi_device *ubi, struct ubi_work *wl_wrk,
 	}
 
 	/* It is %-EIO, the PEB went bad */
+	ubi->lookuptbl[pnum] = NULL;
 
 	if (!ubi->bad_allowed) {
 		ubi_err("bad physical eraseblock %d detected", pnum);
@@ -1224,6 +1226,77 @@ retry:
 	return err;
 }
 
+/**
+ * ubi_wl_get_fm_peb - get a physical eraseblock for the fastmap.
+ * @ubi: UBI device description object
+ * @anchor: if the physical eraseblock is for the fastmap super block
+ *
+ * This function takes a free physical eraseblock out of the free tree. The
+ * super block has to be within the first %UBI_FM_MAX_START PEBs, other
+ * fastmap blocks preferably are not, to keep those for the super block.
+ * Returns %NULL if there is no suitable free physical eraseblock.
+ */
+struct ubi_wl_entry *ubi_wl_get_fm_peb(struct ubi_device *ubi, int anchor)
+{
+	struct ubi_wl_entry *e, *victim = NULL;
+	struct rb_node *rb;
+
+	spin_lock(&ubi->wl_lock);
+	ubi_rb_for_each_entry(rb, e, &ubi->free, rb) {
+		if (anchor) {
+			if (e->pnum < UBI_FM_MAX_START) {
+				victim = e;
+				break;
+			}
+		} else {
+			if (!victim)
+				victim = e;
+			if (e->pnum >= UBI_FM_MAX_START) {
+				victim = e;
+				break;
+			}
+		}
+	}
+
+	if (victim)
+		rb_erase(&victim->rb, &ubi->free);
+	spin_unlock(&ubi->wl_lock);
+
+	return victim;
+}
+
+/**
+ * ubi_wl_put_fm_peb - return a fastmap physical eraseblock.
+ * @ubi: UBI device description object
+ * @e: the physical eraseblock, as returned by ubi_wl_get_fm_peb()
+ *
+ * The physical eraseblock is erased synchronously, so that the fastmap is
+ * gone from the flash when this function returns, and then goes back to the
+ * free tree. Returns zero in case of success and a negative error code in
+ * case of failure.
+ */
+int ubi_wl_put_fm_peb(struct ubi_device *ubi, struct ubi_wl_entry *e)
+{
+	int err;
+
+	err = sync_erase(ubi, e, 0);
+	if (err) {
+		ubi_err("failed to erase fastmap PEB %d, error %d",
+			e->pnum, err);
+		ubi_ro_mode(ubi);
+		return err;
+	}
+
+	spin_lock(&ubi->wl_lock);
+	ubi->abs_ec += 1;
+	wl_tree_add(e, &ubi->free);
+	spin_unlock(&ubi->wl_lock);
+
+	check_protection_over(ubi);
+
+	return 0;
+}
+
 /**
  * ubi_wl_scrub_peb - schedule a physical eraseblock for scrubbing.
  * @ubi: UBI device description object
@@ -1277,6 +1350,7 @@ retry:
 	}
 
 	wl_tree_add(e, &ubi->scrub);
+	ubi->stats->scrubs++;
 	spin_unlock(&ubi->wl_lock);
 
 	/*
@@ -1444,7 +1518,7 @@ static void cancel_pending(struct ubi_device *ubi)
  */
 int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 {
-	int err;
+	int err, i, __maybe_unused fm_pebs;
 	struct rb_node *rb1, *rb2;
 	struct ubi_scan_volume *sv;
 	struct ubi_scan_leb *seb, *tmp;
@@ -1466,6 +1540,14 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 	if (!ubi->lookuptbl)
 		return err;
 
+	/* The fastmap PEBs are known, but stay out of the RB-trees */
+	if (ubi->fm) {
+		for (i = 0; i < ubi->fm->used_blocks; i++) {
+			e = ubi->fm->e[i];
+			ubi->lookuptbl[e->pnum] = e;
+		}
+	}
+
 	list_for_each_entry_safe(seb, tmp, &si->erase, u.list) {
 		cond_resched();
 
@@ -1543,6 +1625,23 @@ int ubi_wl_init_scan(struct ubi_device *ubi, struct ubi_scan_info *si)
 	ubi->avail_pebs -= WL_RESERVED_PEBS;
 	ubi->rsvd_pebs += WL_RESERVED_PEBS;
 
+#ifdef CONFIG_UBI_FASTMAP
+	/*
+	 * Reserve enough PEBs to store two fastmaps, as Linux does. Images
+	 * which have no room for them are still attached, but without a
+	 * fastmap. At least one PEB has to stay for the EBA unit.
+	 */
+	fm_pebs = ubi->fm_size / ubi->leb_size * 2;
+	if (ubi->avail_pebs > fm_pebs) {
+		ubi->avail_pebs -= fm_pebs;
+		ubi->rsvd_pebs += fm_pebs;
+	} else {
+		ubi_warn("no room for a fastmap (%d PEBs available, need %d)",
+			 ubi->avail_pebs, fm_pebs);
+		ubi->fm_disabled = 1;
+	}
+#endif
+
 	/* Schedule wear-leveling if needed */
 	err = ensure_wear_leveling(ubi);
 	if (err)
@@ -38,21 +38,33 @@
 
 extern struct list_head cdev_list;
 
-static int devfs_read(struct device_d *_dev, FILE *f, void *buf, size_t size)
+static int devfs_pread(struct device_d *_dev, FILE *f, void *buf, size_t size,
+		loff_t pos)
 {
 	struct cdev *cdev = f->inode;
 
-	return cdev_read(cdev, buf, size, f->pos, f->flags);
+	return cdev_read(cdev, buf, size, pos, f->flags);
 }
 
-static int devfs_write(struct device_d *_dev, FILE *f, const void *buf, size_t size)
+static int devfs_read(struct device_d *_dev, FILE *f, void *buf, size_t size)
+{
+	return devfs_pread(_dev, f, buf, size, f->pos);
+}
+
+static int devfs_pwrite(struct device_d *_dev, FILE *f, const void *buf,
+		size_t size, loff_t pos)
 {
 	struct cdev *cdev = f->inode;
 
 	if (cdev->flags & DEVFS_PARTITION_READONLY)
 		return -EPERM;
 
-	return cdev_write(cdev, buf, size, f->pos, f->flags);
+	return cdev_write(cdev, buf, size, pos, f->flags);
+}
+
+static int devfs_write(struct device_d *_dev, FILE *f, const void *buf, size_t size)
+{
+	return devfs_pwrite(_dev, f, buf, size, f->pos);
 }
 
 static loff_t devfs_lseek(struct device_d *_dev, FILE *f, loff_t pos)
@@ -121,7 +133,6 @@ static int devfs_open(struct device_d *_dev, FILE *f, const char *filename)
 	if (!cdev)
 		return -ENOENT;
 
-	f->size = cdev->size;
 	f->inode = cdev;
 
 	if (cdev->ops->open) {
@@ -130,6 +141,9 @@ static int devfs_open(struct device_d *_dev, FILE *f, const char *filename)
 			return ret;
 	}
 
+	/* the open may have changed the size */
+	f->size = cdev->size;
+
 	cdev->open++;
 
 	return 0;
@@ -240,6 +254,8 @@ static void devfs_delete(struct device_d *dev)
 static struct fs_driver_d devfs_driver = {
 	.read      = devfs_read,
 	.write     = devfs_write,
+	.pread     = devfs_pread,
+	.pwrite    = devfs_pwrite,
 	.lseek     = devfs_lseek,
 	.open      = devfs_open,
 	.close     = devfs_close,
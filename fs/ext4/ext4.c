@@ -0,0 +1,223 @@
+/*
+ * ext4.c - read-only ext2/3/4 filesystem support
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <driver.h>
+#include <init.h>
+#include <malloc.h>
+#include <fs.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/stat.h>
+#include "ext4.h"
+
+struct ext4_dir {
+	DIR dir;
+	struct ext4_node node;
+	struct ext4_dir_iter it;
+};
+
+static int ext4_open(struct device_d *dev, FILE *f, const char *filename)
+{
+	struct ext4_info *fs = dev->priv;
+	struct ext4_node *node;
+	int ret;
+
+	node = xzalloc(sizeof(*node));
+
+	ret = ext4_lookup(fs, filename, node);
+	if (ret) {
+		free(node);
+		return ret;
+	}
+
+	if (S_ISDIR(le16_to_cpu(node->inode.i_mode))) {
+		ext4_put_inode(node);
+		free(node);
+		return -EISDIR;
+	}
+
+	f->inode = node;
+	f->size = node->size;
+
+	return 0;
+}
+
+static int ext4_close(struct device_d *dev, FILE *f)
+{
+	struct ext4_node *node = f->inode;
+
+	ext4_put_inode(node);
+	free(node);
+
+	return 0;
+}
+
+static int ext4_pread(struct device_d *dev, FILE *f, void *buf, size_t insize,
+		      loff_t pos)
+{
+	return ext4_read_file(f->inode, buf, insize, pos);
+}
+
+static int ext4_read(struct device_d *dev, FILE *f, void *buf, size_t insize)
+{
+	return ext4_pread(dev, f, buf, insize, f->pos);
+}
+
+static loff_t ext4_lseek(struct device_d *dev, FILE *f, loff_t pos)
+{
+	f->pos = pos;
+
+	return f->pos;
+}
+
+static DIR *ext4_opendir(struct device_d *dev, const char *pathname)
+{
+	struct ext4_info *fs = dev->priv;
+	struct ext4_dir *dir;
+	int ret;
+
+	dir = xzalloc(sizeof(*dir));
+
+	ret = ext4_lookup(fs, pathname, &dir->node);
+	if (ret)
+		goto err;
+
+	if (!S_ISDIR(le16_to_cpu(dir->node.inode.i_mode))) {
+		ext4_put_inode(&dir->node);
+		goto err;
+	}
+
+	ext4_dir_open(&dir->it, &dir->node);
+	dir->dir.priv = dir;
+
+	return &dir->dir;
+err:
+	free(dir);
+
+	return NULL;
+}
+
+static struct dirent *ext4_readdir(struct device_d *dev, DIR *_dir)
+{
+	struct ext4_dir *dir = _dir->priv;
+	unsigned long ino;
+	int ret;
+
+	do {
+		ret = ext4_dir_next(&dir->it, _dir->d.d_name,
+				sizeof(_dir->d.d_name), &ino);
+		if (ret <= 0)
+			return NULL;
+	} while (!strcmp(_dir->d.d_name, ".") || !strcmp(_dir->d.d_name, ".."));
+
+	return &_dir->d;
+}
+
+static int ext4_closedir(struct device_d *dev, DIR *_dir)
+{
+	struct ext4_dir *dir = _dir->priv;
+
+	ext4_dir_close(&dir->it);
+	ext4_put_inode(&dir->node);
+	free(dir);
+
+	return 0;
+}
+
+static int ext4_stat(struct device_d *dev, const char *filename,
+		     struct stat *s)
+{
+	struct ext4_info *fs = dev->priv;
+	struct ext4_node node;
+	int ret;
+
+	ret = ext4_lookup(fs, filename, &node);
+	if (ret)
+		return ret;
+
+	s->st_size = node.size;
+	s->st_mode = le16_to_cpu(node.inode.i_mode);
+
+	ext4_put_inode(&node);
+
+	return 0;
+}
+
+static int ext4_probe(struct device_d *dev)
+{
+	struct fs_device_d *fsdev = dev_to_fs_device(dev);
+	char *backingstore = fsdev->backingstore;
+	struct ext4_info *fs;
+	int ret;
+
+	fs = xzalloc(sizeof(*fs));
+	fs->dev = dev;
+	dev->priv = fs;
+
+	if (!strncmp(backingstore, "/dev/", 5))
+		backingstore += 5;
+
+	fs->cdev = cdev_open(backingstore, O_RDONLY);
+	if (!fs->cdev) {
+		ret = -ENOENT;
+		goto err_open;
+	}
+
+	ret = ext4_mount(fs);
+	if (ret)
+		goto err;
+
+	return 0;
+
+err:
+	dev_info(dev, "no valid ext2/3/4 filesystem found\n");
+	cdev_close(fs->cdev);
+err_open:
+	free(fs);
+
+	return ret;
+}
+
+static void ext4_remove(struct device_d *dev)
+{
+	struct ext4_info *fs = dev->priv;
+
+	ext4_umount(fs);
+	cdev_close(fs->cdev);
+	free(fs);
+}
+
+static struct fs_driver_d ext4_driver = {
+	.open		= ext4_open,
+	.close		= ext4_close,
+	.read		= ext4_read,
+	.pread		= ext4_pread,
+	.lseek		= ext4_lseek,
+	.opendir	= ext4_opendir,
+	.readdir	= ext4_readdir,
+	.closedir	= ext4_closedir,
+	.stat		= ext4_stat,
+	.drv = {
+		.probe = ext4_probe,
+		.remove = ext4_remove,
+		.name = "ext4",
+	}
+};
+
+static int ext4_init(void)
+{
+	return register_fs_driver(&ext4_driver);
+}
+
+device_initcall(ext4_init);
@@ -0,0 +1,285 @@
+/*
+ * ext4.h - on-disk format and internal interfaces of the ext2/3/4 driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __EXT4_H
+#define __EXT4_H
+
+#include <linux/types.h>
+
+#define EXT4_SUPER_MAGIC	0xef53
+#define EXT4_SUPERBLOCK_OFFSET	1024
+#define EXT4_ROOT_INO		2
+
+#define EXT4_GOOD_OLD_REV	0
+#define EXT4_GOOD_OLD_INODE_SIZE 128
+
+#define EXT4_MIN_BLOCK_LOG_SIZE	10
+#define EXT4_MAX_BLOCK_LOG_SIZE	16
+
+#define EXT4_MIN_DESC_SIZE	32
+#define EXT4_MIN_DESC_SIZE_64BIT 64
+
+#define EXT4_NDIR_BLOCKS	12
+#define EXT4_IND_BLOCK		EXT4_NDIR_BLOCKS
+#define EXT4_DIND_BLOCK		(EXT4_IND_BLOCK + 1)
+#define EXT4_TIND_BLOCK		(EXT4_DIND_BLOCK + 1)
+#define EXT4_N_BLOCKS		(EXT4_TIND_BLOCK + 1)
+
+/* s_feature_compat */
+#define EXT4_FEATURE_COMPAT_HAS_JOURNAL		0x0004
+
+/* s_feature_ro_compat */
+#define EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER	0x0001
+
+/* s_feature_incompat */
+#define EXT4_FEATURE_INCOMPAT_COMPRESSION	0x0001
+#define EXT4_FEATURE_INCOMPAT_FILETYPE		0x0002
+#define EXT4_FEATURE_INCOMPAT_RECOVER		0x0004
+#define EXT4_FEATURE_INCOMPAT_JOURNAL_DEV	0x0008
+#define EXT4_FEATURE_INCOMPAT_META_BG		0x0010
+#define EXT4_FEATURE_INCOMPAT_EXTENTS		0x0040
+#define EXT4_FEATURE_INCOMPAT_64BIT		0x0080
+#define EXT4_FEATURE_INCOMPAT_MMP		0x0100
+#define EXT4_FEATURE_INCOMPAT_FLEX_BG		0x0200
+#define EXT4_FEATURE_INCOMPAT_EA_INODE		0x0400
+#define EXT4_FEATURE_INCOMPAT_DIRDATA		0x1000
+#define EXT4_FEATURE_INCOMPAT_CSUM_SEED		0x2000
+#define EXT4_FEATURE_INCOMPAT_LARGEDIR		0x4000
+#define EXT4_FEATURE_INCOMPAT_INLINE_DATA	0x8000
+#define EXT4_FEATURE_INCOMPAT_ENCRYPT		0x10000
+
+#define EXT4_FEATURE_INCOMPAT_SUPP	(EXT4_FEATURE_INCOMPAT_FILETYPE | \
+					 EXT4_FEATURE_INCOMPAT_RECOVER | \
+					 EXT4_FEATURE_INCOMPAT_META_BG | \
+					 EXT4_FEATURE_INCOMPAT_EXTENTS | \
+					 EXT4_FEATURE_INCOMPAT_64BIT | \
+					 EXT4_FEATURE_INCOMPAT_MMP | \
+					 EXT4_FEATURE_INCOMPAT_FLEX_BG | \
+					 EXT4_FEATURE_INCOMPAT_EA_INODE | \
+					 EXT4_FEATURE_INCOMPAT_CSUM_SEED | \
+					 EXT4_FEATURE_INCOMPAT_LARGEDIR)
+
+/* i_flags */
+#define EXT4_EXTENTS_FL		0x00080000
+#define EXT4_INLINE_DATA_FL	0x10000000
+
+struct ext4_super_block {
+	__le32	s_inodes_count;
+	__le32	s_blocks_count_lo;
+	__le32	s_r_blocks_count_lo;
+	__le32	s_free_blocks_count_lo;
+	__le32	s_free_inodes_count;
+	__le32	s_first_data_block;
+	__le32	s_log_block_size;
+	__le32	s_log_cluster_size;
+	__le32	s_blocks_per_group;
+	__le32	s_clusters_per_group;
+	__le32	s_inodes_per_group;
+	__le32	s_mtime;
+	__le32	s_wtime;
+	__le16	s_mnt_count;
+	__le16	s_max_mnt_count;
+	__le16	s_magic;
+	__le16	s_state;
+	__le16	s_errors;
+	__le16	s_minor_rev_level;
+	__le32	s_lastcheck;
+	__le32	s_checkinterval;
+	__le32	s_creator_os;
+	__le32	s_rev_level;
+	__le16	s_def_resuid;
+	__le16	s_def_resgid;
+	/* EXT4_DYNAMIC_REV superblocks only */
+	__le32	s_first_ino;
+	__le16	s_inode_size;
+	__le16	s_block_group_nr;
+	__le32	s_feature_compat;
+	__le32	s_feature_incompat;
+	__le32	s_feature_ro_compat;
+	__u8	s_uuid[16];
+	char	s_volume_name[16];
+	char	s_last_mounted[64];
+	__le32	s_algorithm_usage_bitmap;
+	__u8	s_prealloc_blocks;
+	__u8	s_prealloc_dir_blocks;
+	__le16	s_reserved_gdt_blocks;
+	__u8	s_journal_uuid[16];
+	__le32	s_journal_inum;
+	__le32	s_journal_dev;
+	__le32	s_last_orphan;
+	__le32	s_hash_seed[4];
+	__u8	s_def_hash_version;
+	__u8	s_jnl_backup_type;
+	__le16	s_desc_size;
+	__le32	s_default_mount_opts;
+	__le32	s_first_meta_bg;
+	__le32	s_mkfs_time;
+	__le32	s_jnl_blocks[17];
+	/* 64bit support */
+	__le32	s_blocks_count_hi;
+	__le32	s_r_blocks_count_hi;
+	__le32	s_free_blocks_count_hi;
+	__le16	s_min_extra_isize;
+	__le16	s_want_extra_isize;
+	__le32	s_flags;
+	__u8	s_reserved[664];
+} __attribute__ ((packed));
+
+struct ext4_group_desc {
+	__le32	bg_block_bitmap_lo;
+	__le32	bg_inode_bitmap_lo;
+	__le32	bg_inode_table_lo;
+	__le16	bg_free_blocks_count_lo;
+	__le16	bg_free_inodes_count_lo;
+	__le16	bg_used_dirs_count_lo;
+	__le16	bg_flags;
+	__le32	bg_exclude_bitmap_lo;
+	__le16	bg_block_bitmap_csum_lo;
+	__le16	bg_inode_bitmap_csum_lo;
+	__le16	bg_itable_unused_lo;
+	__le16	bg_checksum;
+	/* only valid with EXT4_FEATURE_INCOMPAT_64BIT */
+	__le32	bg_block_bitmap_hi;
+	__le32	bg_inode_bitmap_hi;
+	__le32	bg_inode_table_hi;
+	__le16	bg_free_blocks_count_hi;
+	__le16	bg_free_inodes_count_hi;
+	__le16	bg_used_dirs_count_hi;
+	__le16	bg_itable_unused_hi;
+	__le32	bg_exclude_bitmap_hi;
+	__le16	bg_block_bitmap_csum_hi;
+	__le16	bg_inode_bitmap_csum_hi;
+	__u32	bg_reserved;
+} __attribute__ ((packed));
+
+struct ext4_inode {
+	__le16	i_mode;
+	__le16	i_uid;
+	__le32	i_size_lo;
+	__le32	i_atime;
+	__le32	i_ctime;
+	__le32	i_mtime;
+	__le32	i_dtime;
+	__le16	i_gid;
+	__le16	i_links_count;
+	__le32	i_blocks_lo;
+	__le32	i_flags;
+	__le32	i_version;
+	__le32	i_block[EXT4_N_BLOCKS];
+	__le32	i_generation;
+	__le32	i_file_acl_lo;
+	__le32	i_size_high;
+	__le32	i_obso_faddr;
+	__u8	i_osd2[12];
+} __attribute__ ((packed));
+
+#define EXT4_EXT_MAGIC		0xf30a
+#define EXT4_EXT_INIT_MAX_LEN	32768
+#define EXT4_EXT_MAX_DEPTH	5
+
+struct ext4_extent_header {
+	__le16	eh_magic;
+	__le16	eh_entries;
+	__le16	eh_max;
+	__le16	eh_depth;
+	__le32	eh_generation;
+} __attribute__ ((packed));
+
+struct ext4_extent_idx {
+	__le32	ei_block;
+	__le32	ei_leaf_lo;
+	__le16	ei_leaf_hi;
+	__u16	ei_unused;
+} __attribute__ ((packed));
+
+struct ext4_extent {
+	__le32	ee_block;
+	__le16	ee_len;
+	__le16	ee_start_hi;
+	__le32	ee_start_lo;
+} __attribute__ ((packed));
+
+struct ext4_dir_entry_2 {
+	__le32	inode;
+	__le16	rec_len;
+	__u8	name_len;
+	__u8	file_type;
+	char	name[];
+} __attribute__ ((packed));
+
+#define EXT4_DIR_ENTRY_HDR_LEN	8
+
+struct ext4_info {
+	struct device_d *dev;
+	struct cdev *cdev;
+
+	unsigned int block_size;
+	unsigned int block_bits;
+	unsigned int inode_size;
+	unsigned int desc_size;
+	unsigned int inodes_per_group;
+	unsigned int blocks_per_group;
+	unsigned int first_data_block;
+	unsigned int first_meta_bg;
+	unsigned int group_count;
+	unsigned int desc_per_block;
+	u32 feature_incompat;
+	u32 feature_ro_compat;
+	u64 blocks_count;
+
+	/* group descriptor block cache */
+	void *desc_buf;
+	u64 desc_block;
+};
+
+/* In-memory copy of an inode */
+struct ext4_node {
+	struct ext4_info *fs;
+	unsigned long ino;
+	struct ext4_inode inode;
+	loff_t size;
+
+	/* last mapping found, see ext4_map_block() */
+	u64 map_lblk;
+	u64 map_pblk;
+	u64 map_len;
+	int map_hole;
+
+	/* one metadata block (extent tree or indirect block) */
+	void *meta_buf;
+	u64 meta_block;
+};
+
+int ext4_mount(struct ext4_info *fs);
+void ext4_umount(struct ext4_info *fs);
+
+int ext4_read_inode(struct ext4_info *fs, unsigned long ino,
+		    struct ext4_node *node);
+void ext4_put_inode(struct ext4_node *node);
+ssize_t ext4_read_file(struct ext4_node *node, void *buf, size_t len,
+		       loff_t pos);
+int ext4_lookup(struct ext4_info *fs, const char *path,
+		struct ext4_node *node);
+
+struct ext4_dir_iter {
+	struct ext4_node *node;
+	loff_t pos;
+	void *buf;
+};
+
+void ext4_dir_open(struct ext4_dir_iter *it, struct ext4_node *node);
+void ext4_dir_close(struct ext4_dir_iter *it);
+int ext4_dir_next(struct ext4_dir_iter *it, char *name, int namelen,
+		  unsigned long *ino);
+
+#endif /* __EXT4_H */
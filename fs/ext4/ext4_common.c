@@ -0,0 +1,732 @@
+/*
+ * ext4_common.c - ext2/3/4 inode, block mapping and directory handling
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * File data is read by mapping a file block to a run of physically
+ * contiguous disk blocks (a whole extent, or consecutive entries of an
+ * indirect block) and reading the part of the run that is needed with a
+ * single cdev_read(). For a defragmented ext4 file this is one read per
+ * extent, i.e. up to 128MiB at once.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <errno.h>
+#include <string.h>
+#include <linux/stat.h>
+#include <linux/err.h>
+#include "ext4.h"
+
+#define EXT4_MAX_SYMLINKS	8
+
+static int ext4_read_disk(struct ext4_info *fs, void *buf, size_t len,
+			  loff_t pos)
+{
+	ssize_t ret;
+
+	ret = cdev_read(fs->cdev, buf, len, pos, 0);
+	if (ret < 0)
+		return ret;
+	if (ret != len)
+		return -EIO;
+
+	return 0;
+}
+
+static int ext4_group_has_super(struct ext4_info *fs, unsigned int group)
+{
+	unsigned int p;
+
+	if (!(fs->feature_ro_compat & EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER))
+		return 1;
+	if (group <= 1)
+		return 1;
+	if (!(group & 1))
+		return 0;
+
+	/* with sparse_super only groups 0, 1 and powers of 3, 5, 7 */
+	for (p = 3; p <= 7; p += 2) {
+		unsigned int n = p;
+
+		while (n < group)
+			n *= p;
+		if (n == group)
+			return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Find the disk block holding the group descriptor block @n. Without meta_bg
+ * all descriptors follow the superblock. With meta_bg the descriptors of each
+ * meta group (as many groups as descriptors fit into a block) are stored in
+ * the first group of that meta group, behind its superblock backup if any.
+ */
+static u64 ext4_desc_block(struct ext4_info *fs, unsigned int n)
+{
+	unsigned int group;
+
+	if (!(fs->feature_incompat & EXT4_FEATURE_INCOMPAT_META_BG) ||
+			n < fs->first_meta_bg)
+		return fs->first_data_block + 1 + n;
+
+	group = n * fs->desc_per_block;
+
+	return fs->first_data_block + (u64)group * fs->blocks_per_group +
+		ext4_group_has_super(fs, group);
+}
+
+static int ext4_get_group_desc(struct ext4_info *fs, unsigned int group,
+			       struct ext4_group_desc *desc)
+{
+	u64 block = ext4_desc_block(fs, group / fs->desc_per_block);
+	unsigned int offs = (group % fs->desc_per_block) * fs->desc_size;
+	int ret;
+
+	if (block != fs->desc_block) {
+		ret = ext4_read_disk(fs, fs->desc_buf, fs->block_size,
+				block << fs->block_bits);
+		if (ret) {
+			fs->desc_block = ~0ULL;
+			return ret;
+		}
+		fs->desc_block = block;
+	}
+
+	memset(desc, 0, sizeof(*desc));
+	memcpy(desc, fs->desc_buf + offs,
+			min_t(unsigned int, fs->desc_size, sizeof(*desc)));
+
+	return 0;
+}
+
+int ext4_read_inode(struct ext4_info *fs, unsigned long ino,
+		    struct ext4_node *node)
+{
+	struct ext4_group_desc desc;
+	unsigned int group, index;
+	u64 table;
+	int ret;
+
+	memset(node, 0, sizeof(*node));
+	node->fs = fs;
+	node->ino = ino;
+
+	if (!ino || ino > (u64)fs->inodes_per_group * fs->group_count)
+		return -EINVAL;
+
+	group = (ino - 1) / fs->inodes_per_group;
+	index = (ino - 1) % fs->inodes_per_group;
+
+	ret = ext4_get_group_desc(fs, group, &desc);
+	if (ret)
+		return ret;
+
+	table = le32_to_cpu(desc.bg_inode_table_lo);
+	if (fs->feature_incompat & EXT4_FEATURE_INCOMPAT_64BIT)
+		table |= (u64)le32_to_cpu(desc.bg_inode_table_hi) << 32;
+
+	ret = ext4_read_disk(fs, &node->inode, sizeof(node->inode),
+			(table << fs->block_bits) +
+			(loff_t)index * fs->inode_size);
+	if (ret)
+		return ret;
+
+	node->size = le32_to_cpu(node->inode.i_size_lo);
+	if (S_ISREG(le16_to_cpu(node->inode.i_mode)))
+		node->size |= (loff_t)le32_to_cpu(node->inode.i_size_high) << 32;
+
+	return 0;
+}
+
+void ext4_put_inode(struct ext4_node *node)
+{
+	free(node->meta_buf);
+	node->meta_buf = NULL;
+}
+
+/*
+ * Read a metadata block belonging to @node (extent tree or indirect block).
+ * The last one is kept, so walking the same tree node again is free.
+ */
+static int ext4_read_meta(struct ext4_node *node, u64 block)
+{
+	struct ext4_info *fs = node->fs;
+	int ret;
+
+	if (!node->meta_buf)
+		node->meta_buf = xmalloc(fs->block_size);
+	else if (node->meta_block == block)
+		return 0;
+
+	if (!block || block >= fs->blocks_count)
+		return -EUCLEAN;
+
+	ret = ext4_read_disk(fs, node->meta_buf, fs->block_size,
+			block << fs->block_bits);
+	if (ret) {
+		node->meta_block = 0;
+		return ret;
+	}
+
+	node->meta_block = block;
+
+	return 0;
+}
+
+static int ext4_ext_check(struct ext4_node *node,
+			  struct ext4_extent_header *eh, int size, int depth)
+{
+	int entries = le16_to_cpu(eh->eh_entries);
+	int max = le16_to_cpu(eh->eh_max);
+
+	if (le16_to_cpu(eh->eh_magic) != EXT4_EXT_MAGIC ||
+			le16_to_cpu(eh->eh_depth) != depth ||
+			entries > max ||
+			sizeof(*eh) + max * sizeof(struct ext4_extent) > size) {
+		dev_err(node->fs->dev, "inode %lu: bad extent header\n",
+				node->ino);
+		return -EUCLEAN;
+	}
+
+	return 0;
+}
+
+static int ext4_ext_map(struct ext4_node *node, u64 lblk)
+{
+	struct ext4_extent_header *eh = (void *)node->inode.i_block;
+	struct ext4_extent *ex;
+	int depth, entries, i, ret;
+	u64 start;
+	unsigned int len;
+
+	depth = le16_to_cpu(eh->eh_depth);
+	if (depth > EXT4_EXT_MAX_DEPTH) {
+		dev_err(node->fs->dev, "inode %lu: extent tree too deep\n",
+				node->ino);
+		return -EUCLEAN;
+	}
+
+	ret = ext4_ext_check(node, eh, sizeof(node->inode.i_block), depth);
+	if (ret)
+		return ret;
+
+	while (depth > 0) {
+		struct ext4_extent_idx *idx = (void *)(eh + 1);
+		u64 leaf;
+
+		entries = le16_to_cpu(eh->eh_entries);
+		if (!entries)
+			goto hole;
+
+		for (i = 1; i < entries; i++)
+			if (le32_to_cpu(idx[i].ei_block) > lblk)
+				break;
+		idx += i - 1;
+
+		leaf = le32_to_cpu(idx->ei_leaf_lo) |
+			((u64)le16_to_cpu(idx->ei_leaf_hi) << 32);
+
+		ret = ext4_read_meta(node, leaf);
+		if (ret)
+			return ret;
+
+		eh = node->meta_buf;
+		depth--;
+
+		ret = ext4_ext_check(node, eh, node->fs->block_size, depth);
+		if (ret)
+			return ret;
+	}
+
+	ex = (void *)(eh + 1);
+	entries = le16_to_cpu(eh->eh_entries);
+
+	for (i = 0; i < entries; i++)
+		if (le32_to_cpu(ex[i].ee_block) > lblk)
+			break;
+
+	if (!i) {
+		node->map_len = entries ? le32_to_cpu(ex[0].ee_block) - lblk : 1;
+		goto hole;
+	}
+
+	ex += i - 1;
+	len = le16_to_cpu(ex->ee_len);
+	start = le32_to_cpu(ex->ee_start_lo) |
+		((u64)le16_to_cpu(ex->ee_start_hi) << 32);
+
+	/* uninitialized extents read back as zeroes */
+	node->map_hole = len > EXT4_EXT_INIT_MAX_LEN;
+	if (node->map_hole)
+		len -= EXT4_EXT_INIT_MAX_LEN;
+
+	if (lblk >= le32_to_cpu(ex->ee_block) + len) {
+		node->map_len = i < entries ?
+			le32_to_cpu(ex[1].ee_block) - lblk : 1;
+		goto hole;
+	}
+
+	node->map_pblk = start + lblk - le32_to_cpu(ex->ee_block);
+	node->map_len = le32_to_cpu(ex->ee_block) + len - lblk;
+
+	if (node->map_pblk + node->map_len > node->fs->blocks_count)
+		return -EUCLEAN;
+
+	return 0;
+
+hole:
+	node->map_hole = 1;
+	if (!node->map_len)
+		node->map_len = 1;
+
+	return 0;
+}
+
+/*
+ * Map @lblk through the ext2/3 style direct and indirect blocks. Consecutive
+ * pointers in the same block are merged into one run.
+ */
+static int ext4_ind_map(struct ext4_node *node, u64 lblk)
+{
+	struct ext4_info *fs = node->fs;
+	u64 per = fs->block_size / sizeof(__le32);
+	u64 offsets[3];
+	__le32 i_block[EXT4_N_BLOCKS], *ptrs = i_block;
+	int nptrs = EXT4_NDIR_BLOCKS;
+	int i, levels, ret;
+	u32 block;
+
+	/* the inode is packed, do not point into it */
+	memcpy(i_block, node->inode.i_block, sizeof(i_block));
+
+	if (lblk < EXT4_NDIR_BLOCKS) {
+		levels = 0;
+		offsets[0] = lblk;
+	} else if ((lblk -= EXT4_NDIR_BLOCKS) < per) {
+		levels = 1;
+		offsets[0] = lblk;
+	} else if ((lblk -= per) < per * per) {
+		levels = 2;
+		offsets[0] = lblk / per;
+		offsets[1] = lblk % per;
+	} else if ((lblk -= per * per) < per * per * per) {
+		levels = 3;
+		offsets[0] = lblk / (per * per);
+		offsets[1] = (lblk / per) % per;
+		offsets[2] = lblk % per;
+	} else {
+		return -EFBIG;
+	}
+
+	if (levels) {
+		block = le32_to_cpu(ptrs[EXT4_IND_BLOCK + levels - 1]);
+
+		for (i = 0; i < levels; i++) {
+			if (!block)
+				goto hole;
+
+			ret = ext4_read_meta(node, block);
+			if (ret)
+				return ret;
+
+			ptrs = node->meta_buf;
+			nptrs = per;
+			if (i < levels - 1)
+				block = le32_to_cpu(ptrs[offsets[i]]);
+		}
+		i = offsets[levels - 1];
+	} else {
+		i = offsets[0];
+	}
+
+	block = le32_to_cpu(ptrs[i]);
+	if (!block)
+		goto hole;
+
+	node->map_pblk = block;
+	node->map_len = 1;
+
+	while (i + node->map_len < nptrs &&
+			le32_to_cpu(ptrs[i + node->map_len]) ==
+			block + node->map_len)
+		node->map_len++;
+
+	if (node->map_pblk + node->map_len > fs->blocks_count)
+		return -EUCLEAN;
+
+	return 0;
+
+hole:
+	node->map_hole = 1;
+	node->map_len = 1;
+
+	return 0;
+}
+
+static int ext4_map_block(struct ext4_node *node, u64 lblk)
+{
+	int ret;
+
+	if (node->map_len && lblk >= node->map_lblk &&
+			lblk < node->map_lblk + node->map_len)
+		return 0;
+
+	node->map_lblk = lblk;
+	node->map_pblk = 0;
+	node->map_len = 0;
+	node->map_hole = 0;
+
+	if (le32_to_cpu(node->inode.i_flags) & EXT4_EXTENTS_FL)
+		ret = ext4_ext_map(node, lblk);
+	else
+		ret = ext4_ind_map(node, lblk);
+
+	if (ret)
+		node->map_len = 0;
+
+	return ret;
+}
+
+ssize_t ext4_read_file(struct ext4_node *node, void *buf, size_t len,
+		       loff_t pos)
+{
+	struct ext4_info *fs = node->fs;
+	size_t done = 0;
+	int ret;
+
+	if (pos >= node->size)
+		return 0;
+
+	len = min_t(loff_t, len, node->size - pos);
+
+	while (done < len) {
+		u64 lblk = pos >> fs->block_bits;
+		unsigned int offs = pos & (fs->block_size - 1);
+		u64 avail;
+		size_t now;
+
+		ret = ext4_map_block(node, lblk);
+		if (ret)
+			return ret;
+
+		avail = ((node->map_lblk + node->map_len - lblk) <<
+				fs->block_bits) - offs;
+		now = min_t(u64, len - done, avail);
+
+		if (node->map_hole) {
+			memset(buf, 0, now);
+		} else {
+			u64 pblk = node->map_pblk + lblk - node->map_lblk;
+
+			ret = ext4_read_disk(fs, buf, now,
+					(pblk << fs->block_bits) + offs);
+			if (ret)
+				return ret;
+		}
+
+		buf += now;
+		pos += now;
+		done += now;
+	}
+
+	return done;
+}
+
+void ext4_dir_open(struct ext4_dir_iter *it, struct ext4_node *node)
+{
+	it->node = node;
+	it->pos = 0;
+	it->buf = xmalloc(node->fs->block_size);
+}
+
+void ext4_dir_close(struct ext4_dir_iter *it)
+{
+	free(it->buf);
+	it->buf = NULL;
+}
+
+/*
+ * Get the next entry of a directory. Returns 1 and fills in @name and @ino
+ * when an entry was found, 0 at the end of the directory or a negative
+ * error code. Directory entries never cross block boundaries, so whole
+ * blocks are read. Indexed (htree) directories are read linearly, the index
+ * is hidden in entries with inode number 0.
+ */
+int ext4_dir_next(struct ext4_dir_iter *it, char *name, int namelen,
+		  unsigned long *ino)
+{
+	struct ext4_node *node = it->node;
+	unsigned int bs = node->fs->block_size;
+	ssize_t ret;
+
+	while (it->pos < node->size) {
+		unsigned int offs = it->pos & (bs - 1);
+		struct ext4_dir_entry_2 *de;
+		unsigned int rec_len;
+
+		if (!offs) {
+			ret = ext4_read_file(node, it->buf, bs, it->pos);
+			if (ret < 0)
+				return ret;
+			if (ret != bs)
+				return -EUCLEAN;
+		}
+
+		de = it->buf + offs;
+		rec_len = le16_to_cpu(de->rec_len);
+		if (bs == 65536 && (rec_len == 0 || rec_len == 65535))
+			rec_len = 65536;
+
+		if (rec_len < EXT4_DIR_ENTRY_HDR_LEN || rec_len & 3 ||
+				offs + rec_len > bs ||
+				EXT4_DIR_ENTRY_HDR_LEN + de->name_len > rec_len) {
+			dev_err(node->fs->dev, "inode %lu: bad directory entry\n",
+					node->ino);
+			return -EUCLEAN;
+		}
+
+		it->pos += rec_len;
+
+		if (!de->inode)
+			continue;
+
+		namelen = min(namelen - 1, (int)de->name_len);
+		memcpy(name, de->name, namelen);
+		name[namelen] = 0;
+		*ino = le32_to_cpu(de->inode);
+
+		return 1;
+	}
+
+	return 0;
+}
+
+static int ext4_find_entry(struct ext4_node *dir, const char *name, int len,
+			   unsigned long *ino)
+{
+	struct ext4_dir_iter it;
+	char dname[256];
+	int ret;
+
+	if (!S_ISDIR(le16_to_cpu(dir->inode.i_mode)))
+		return -ENOTDIR;
+
+	ext4_dir_open(&it, dir);
+
+	while ((ret = ext4_dir_next(&it, dname, sizeof(dname), ino)) > 0)
+		if (strlen(dname) == len && !memcmp(dname, name, len))
+			break;
+
+	ext4_dir_close(&it);
+
+	if (!ret)
+		return -ENOENT;
+
+	return ret < 0 ? ret : 0;
+}
+
+static char *ext4_read_symlink(struct ext4_node *node)
+{
+	struct ext4_info *fs = node->fs;
+	struct ext4_inode *inode = &node->inode;
+	unsigned long blocks = le32_to_cpu(inode->i_blocks_lo);
+	char *target;
+	ssize_t ret;
+
+	if (node->size >= fs->block_size)
+		return ERR_PTR(-ENAMETOOLONG);
+
+	target = xzalloc(node->size + 1);
+
+	/* short symlinks are stored in the inode itself */
+	if (inode->i_file_acl_lo)
+		blocks -= fs->block_size >> 9;
+
+	if (!blocks && node->size < sizeof(inode->i_block) &&
+			!(le32_to_cpu(inode->i_flags) & EXT4_EXTENTS_FL)) {
+		memcpy(target, inode->i_block, node->size);
+		return target;
+	}
+
+	ret = ext4_read_file(node, target, node->size, 0);
+	if (ret != node->size) {
+		free(target);
+		return ERR_PTR(ret < 0 ? ret : -EIO);
+	}
+
+	return target;
+}
+
+static int ext4_lookup_at(struct ext4_info *fs, unsigned long dir_ino,
+			  const char *path, struct ext4_node *node, int depth)
+{
+	unsigned long ino;
+	int ret;
+
+	if (*path == '/')
+		dir_ino = EXT4_ROOT_INO;
+
+	ret = ext4_read_inode(fs, dir_ino, node);
+	if (ret)
+		return ret;
+
+	while (1) {
+		const char *end;
+		char *target, *newpath;
+
+		while (*path == '/')
+			path++;
+		if (!*path)
+			return 0;
+
+		end = strchr(path, '/');
+		if (!end)
+			end = path + strlen(path);
+
+		ret = ext4_find_entry(node, path, end - path, &ino);
+		ext4_put_inode(node);
+		if (ret)
+			return ret;
+
+		ret = ext4_read_inode(fs, ino, node);
+		if (ret)
+			return ret;
+
+		path = end;
+
+		if (!S_ISLNK(le16_to_cpu(node->inode.i_mode))) {
+			dir_ino = ino;
+			continue;
+		}
+
+		if (depth >= EXT4_MAX_SYMLINKS) {
+			ext4_put_inode(node);
+			return -ELOOP;
+		}
+
+		target = ext4_read_symlink(node);
+		ext4_put_inode(node);
+		if (IS_ERR(target))
+			return PTR_ERR(target);
+
+		newpath = asprintf("%s%s", target, path);
+		free(target);
+
+		ret = ext4_lookup_at(fs, dir_ino, newpath, node, depth + 1);
+		free(newpath);
+
+		return ret;
+	}
+}
+
+/*
+ * Look up @path (relative to the filesystem root) and read its inode into
+ * @node. Symbolic links are followed. The node must be released with
+ * ext4_put_inode().
+ */
+int ext4_lookup(struct ext4_info *fs, const char *path,
+		struct ext4_node *node)
+{
+	return ext4_lookup_at(fs, EXT4_ROOT_INO, path, node, 0);
+}
+
+int ext4_mount(struct ext4_info *fs)
+{
+	struct ext4_super_block *sb;
+	unsigned int log_block_size;
+	u32 incompat;
+	int ret;
+
+	sb = xmalloc(sizeof(*sb));
+
+	ret = ext4_read_disk(fs, sb, sizeof(*sb), EXT4_SUPERBLOCK_OFFSET);
+	if (ret)
+		goto out;
+
+	ret = -EINVAL;
+
+	if (le16_to_cpu(sb->s_magic) != EXT4_SUPER_MAGIC)
+		goto out;
+
+	incompat = le32_to_cpu(sb->s_feature_incompat);
+	if (incompat & ~EXT4_FEATURE_INCOMPAT_SUPP) {
+		dev_err(fs->dev, "unsupported features 0x%08x\n",
+				incompat & ~EXT4_FEATURE_INCOMPAT_SUPP);
+		goto out;
+	}
+
+	if (incompat & EXT4_FEATURE_INCOMPAT_RECOVER)
+		dev_warn(fs->dev, "journal needs recovery, "
+				"recent changes may be missing\n");
+
+	log_block_size = le32_to_cpu(sb->s_log_block_size);
+	if (log_block_size > EXT4_MAX_BLOCK_LOG_SIZE - EXT4_MIN_BLOCK_LOG_SIZE)
+		goto err_sb;
+
+	fs->feature_incompat = incompat;
+	fs->feature_ro_compat = le32_to_cpu(sb->s_feature_ro_compat);
+	fs->block_bits = log_block_size + EXT4_MIN_BLOCK_LOG_SIZE;
+	fs->block_size = 1 << fs->block_bits;
+	fs->inodes_per_group = le32_to_cpu(sb->s_inodes_per_group);
+	fs->blocks_per_group = le32_to_cpu(sb->s_blocks_per_group);
+	fs->first_data_block = le32_to_cpu(sb->s_first_data_block);
+	fs->first_meta_bg = le32_to_cpu(sb->s_first_meta_bg);
+	fs->blocks_count = le32_to_cpu(sb->s_blocks_count_lo);
+
+	if (le32_to_cpu(sb->s_rev_level) == EXT4_GOOD_OLD_REV)
+		fs->inode_size = EXT4_GOOD_OLD_INODE_SIZE;
+	else
+		fs->inode_size = le16_to_cpu(sb->s_inode_size);
+
+	if (incompat & EXT4_FEATURE_INCOMPAT_64BIT) {
+		fs->desc_size = le16_to_cpu(sb->s_desc_size);
+		fs->blocks_count |= (u64)le32_to_cpu(sb->s_blocks_count_hi) << 32;
+		if (fs->desc_size < EXT4_MIN_DESC_SIZE_64BIT)
+			goto err_sb;
+	} else {
+		fs->desc_size = EXT4_MIN_DESC_SIZE;
+	}
+
+	if (fs->inode_size < EXT4_GOOD_OLD_INODE_SIZE ||
+			fs->inode_size > fs->block_size ||
+			fs->desc_size > fs->block_size ||
+			!fs->inodes_per_group || !fs->blocks_per_group ||
+			fs->first_data_block >= fs->blocks_count ||
+			fs->blocks_count << fs->block_bits > fs->cdev->size)
+		goto err_sb;
+
+	fs->desc_per_block = fs->block_size / fs->desc_size;
+	fs->group_count = DIV_ROUND_UP(fs->blocks_count - fs->first_data_block,
+			fs->blocks_per_group);
+
+	fs->desc_buf = xmalloc(fs->block_size);
+	fs->desc_block = ~0ULL;
+
+	ret = 0;
+	goto out;
+
+err_sb:
+	dev_err(fs->dev, "bad superblock\n");
+out:
+	free(sb);
+
+	return ret;
+}
+
+void ext4_umount(struct ext4_info *fs)
+{
+	free(fs->desc_buf);
+	fs->desc_buf = NULL;
+}
@@ -694,6 +694,124 @@ out:
 }
 EXPORT_SYMBOL(write);
 
+ssize_t pread(int fd, void *buf, size_t count, loff_t offset)
+{
+	struct device_d *dev;
+	struct fs_driver_d *fsdrv;
+	FILE *f = &files[fd];
+	loff_t pos;
+	int ret;
+
+	if (check_fd(fd))
+		return -errno;
+
+	dev = f->dev;
+
+	fsdrv = dev_to_fs_driver(dev);
+
+	if (offset < 0) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (offset >= f->size)
+		return 0;
+
+	if (count > f->size - offset)
+		count = f->size - offset;
+
+	if (!count)
+		return 0;
+
+	if (fsdrv->pread) {
+		ret = fsdrv->pread(dev, f, buf, count, offset);
+		goto out;
+	}
+
+	/* emulate with lseek + read for drivers without pread support */
+	if (!fsdrv->lseek) {
+		ret = -ENOSYS;
+		goto out;
+	}
+
+	pos = f->pos;
+
+	if (fsdrv->lseek(dev, f, offset) < 0) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = fsdrv->read(dev, f, buf, count);
+
+	fsdrv->lseek(dev, f, pos);
+out:
+	if (ret < 0)
+		errno = -ret;
+	return ret;
+}
+EXPORT_SYMBOL(pread);
+
+ssize_t pwrite(int fd, const void *buf, size_t count, loff_t offset)
+{
+	struct device_d *dev;
+	struct fs_driver_d *fsdrv;
+	FILE *f = &files[fd];
+	loff_t pos;
+	int ret;
+
+	if (check_fd(fd))
+		return -errno;
+
+	dev = f->dev;
+
+	fsdrv = dev_to_fs_driver(dev);
+
+	if (offset < 0 || offset > f->size) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (offset + count > f->size) {
+		ret = fsdrv->truncate(dev, f, offset + count);
+		if (ret) {
+			if (ret != -ENOSPC)
+				goto out;
+			count = f->size - offset;
+			if (!count)
+				goto out;
+		} else {
+			f->size = offset + count;
+		}
+	}
+
+	if (fsdrv->pwrite) {
+		ret = fsdrv->pwrite(dev, f, buf, count, offset);
+		goto out;
+	}
+
+	/* emulate with lseek + write for drivers without pwrite support */
+	if (!fsdrv->lseek) {
+		ret = -ENOSYS;
+		goto out;
+	}
+
+	pos = f->pos;
+
+	if (fsdrv->lseek(dev, f, offset) < 0) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	ret = fsdrv->write(dev, f, buf, count);
+
+	fsdrv->lseek(dev, f, pos);
+out:
+	if (ret < 0)
+		errno = -ret;
+	return ret;
+}
+EXPORT_SYMBOL(pwrite);
+
 int flush(int fd)
 {
 	struct device_d *dev;
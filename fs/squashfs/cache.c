@@ -0,0 +1,194 @@
+/*
+ * cache.c - SquashFS block reading and caching
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Three caches of decompressed blocks are used: metadata blocks (inodes and
+ * directories, 8K each), fragment blocks (the packed tails of several small
+ * files) and data blocks. The data block cache is only used for reads not
+ * covering a whole block, whole blocks are decompressed directly into the
+ * destination buffer.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <errno.h>
+#include <linux/err.h>
+#include "squashfs.h"
+
+struct squashfs_cache *squashfs_cache_init(const char *name, int entries,
+		int block_size)
+{
+	struct squashfs_cache *cache;
+	int i;
+
+	cache = xzalloc(sizeof(*cache));
+	cache->name = name;
+	cache->entries = entries;
+	cache->block_size = block_size;
+	cache->entry = xzalloc(entries * sizeof(*cache->entry));
+
+	for (i = 0; i < entries; i++) {
+		cache->entry[i].block = SQUASHFS_INVALID_BLK;
+		cache->entry[i].data = xmalloc(block_size);
+	}
+
+	return cache;
+}
+
+void squashfs_cache_delete(struct squashfs_cache *cache)
+{
+	int i;
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < cache->entries; i++)
+		free(cache->entry[i].data);
+
+	free(cache->entry);
+	free(cache);
+}
+
+/*
+ * Read and decompress the block at @index. @length is the size word of a
+ * data block or 0 for a metadata block, in which case the size is read from
+ * the block header. Up to @outlen bytes are stored in @buf, the index of the
+ * following block is returned in @next_index.
+ *
+ * Returns the decompressed length or a negative error code.
+ */
+int squashfs_read_data(struct squashfs_priv *priv, void *buf, u64 index,
+		int length, u64 *next_index, int outlen)
+{
+	int compressed, ret;
+	__le16 hdr;
+
+	if (length) {
+		compressed = SQUASHFS_COMPRESSED_BLOCK(length);
+		length = SQUASHFS_COMPRESSED_SIZE_BLOCK(length);
+		if (length > priv->block_size)
+			goto err;
+	} else {
+		ret = cdev_read(priv->cdev, &hdr, sizeof(hdr), index, 0);
+		if (ret != sizeof(hdr))
+			goto err_io;
+
+		index += sizeof(hdr);
+		length = le16_to_cpu(hdr);
+		compressed = SQUASHFS_COMPRESSED(length);
+		length = SQUASHFS_COMPRESSED_SIZE(length);
+		if (length > SQUASHFS_METADATA_SIZE)
+			goto err;
+	}
+
+	if (index + length > priv->bytes_used)
+		goto err;
+
+	if (next_index)
+		*next_index = index + length;
+
+	if (!compressed) {
+		if (length > outlen)
+			goto err;
+		ret = cdev_read(priv->cdev, buf, length, index, 0);
+		if (ret != length)
+			goto err_io;
+		return length;
+	}
+
+	ret = cdev_read(priv->cdev, priv->read_buf, length, index, 0);
+	if (ret != length)
+		goto err_io;
+
+	ret = squashfs_decompress(priv, priv->read_buf, length, buf, outlen);
+	if (ret < 0)
+		dev_err(priv->dev, "failed to decompress block at 0x%llx\n",
+				index);
+
+	return ret;
+
+err:
+	dev_err(priv->dev, "bad block at 0x%llx\n", index);
+	return -EUCLEAN;
+err_io:
+	return ret < 0 ? ret : -EIO;
+}
+
+struct squashfs_cache_entry *squashfs_cache_get(struct squashfs_priv *priv,
+		struct squashfs_cache *cache, u64 block, int length)
+{
+	struct squashfs_cache_entry *entry = NULL;
+	int i, ret;
+
+	for (i = 0; i < cache->entries; i++) {
+		struct squashfs_cache_entry *e = &cache->entry[i];
+
+		if (e->block == block) {
+			e->used = ++cache->used;
+			return e;
+		}
+
+		if (!entry || e->used < entry->used)
+			entry = e;
+	}
+
+	entry->block = SQUASHFS_INVALID_BLK;
+
+	ret = squashfs_read_data(priv, entry->data, block, length,
+			&entry->next_index, cache->block_size);
+	if (ret < 0)
+		return ERR_PTR(ret);
+
+	entry->block = block;
+	entry->length = ret;
+	entry->used = ++cache->used;
+
+	return entry;
+}
+
+/*
+ * Read @length bytes of metadata starting at @offset in the metadata block
+ * at @block. @block and @offset are advanced past the data read.
+ */
+int squashfs_read_metadata(struct squashfs_priv *priv, void *buf,
+		u64 *block, int *offset, int length)
+{
+	struct squashfs_cache_entry *entry;
+
+	while (length) {
+		int now;
+
+		entry = squashfs_cache_get(priv, priv->meta_cache, *block, 0);
+		if (IS_ERR(entry))
+			return PTR_ERR(entry);
+
+		if (*offset >= entry->length)
+			return -EUCLEAN;
+
+		now = min(length, entry->length - *offset);
+		if (buf) {
+			memcpy(buf, entry->data + *offset, now);
+			buf += now;
+		}
+
+		length -= now;
+		*offset += now;
+
+		if (*offset == entry->length) {
+			*block = entry->next_index;
+			*offset = 0;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * decompressor.c - SquashFS block decompression
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <errno.h>
+#include <lzo.h>
+#include "squashfs.h"
+
+#ifdef CONFIG_FS_SQUASHFS_ZLIB
+static int squashfs_zlib_decompress(struct squashfs_priv *priv, void *src,
+		int srclen, void *dst, int dstlen)
+{
+	z_stream *strm = &priv->zstream;
+	int ret;
+
+	ret = zlib_inflateReset(strm);
+	if (ret != Z_OK)
+		return -EIO;
+
+	strm->next_in = src;
+	strm->avail_in = srclen;
+	strm->next_out = dst;
+	strm->avail_out = dstlen;
+
+	ret = zlib_inflate(strm, Z_FINISH);
+	if (ret != Z_STREAM_END)
+		return -EIO;
+
+	return strm->total_out;
+}
+#endif
+
+#ifdef CONFIG_FS_SQUASHFS_LZO
+static int squashfs_lzo_decompress(struct squashfs_priv *priv, void *src,
+		int srclen, void *dst, int dstlen)
+{
+	size_t len = dstlen;
+	int ret;
+
+	ret = lzo1x_decompress_safe(src, srclen, dst, &len);
+	if (ret != LZO_E_OK)
+		return -EIO;
+
+	return len;
+}
+#endif
+
+int squashfs_decompress(struct squashfs_priv *priv, void *src, int srclen,
+		void *dst, int dstlen)
+{
+	switch (priv->compression) {
+#ifdef CONFIG_FS_SQUASHFS_ZLIB
+	case ZLIB_COMPRESSION:
+		return squashfs_zlib_decompress(priv, src, srclen, dst, dstlen);
+#endif
+#ifdef CONFIG_FS_SQUASHFS_LZO
+	case LZO_COMPRESSION:
+		return squashfs_lzo_decompress(priv, src, srclen, dst, dstlen);
+#endif
+	default:
+		return -EINVAL;
+	}
+}
+
+int squashfs_decompressor_init(struct squashfs_priv *priv)
+{
+	switch (priv->compression) {
+#ifdef CONFIG_FS_SQUASHFS_ZLIB
+	case ZLIB_COMPRESSION:
+		priv->zstream.workspace =
+			xmalloc(zlib_inflate_workspacesize());
+		if (zlib_inflateInit(&priv->zstream) != Z_OK) {
+			free(priv->zstream.workspace);
+			priv->zstream.workspace = NULL;
+			return -EIO;
+		}
+		return 0;
+#endif
+#ifdef CONFIG_FS_SQUASHFS_LZO
+	case LZO_COMPRESSION:
+		return 0;
+#endif
+	default:
+		dev_err(priv->dev, "unsupported compression type %d\n",
+				priv->compression);
+		return -EINVAL;
+	}
+}
+
+void squashfs_decompressor_exit(struct squashfs_priv *priv)
+{
+#ifdef CONFIG_FS_SQUASHFS_ZLIB
+	if (priv->zstream.workspace) {
+		zlib_inflateEnd(&priv->zstream);
+		free(priv->zstream.workspace);
+		priv->zstream.workspace = NULL;
+	}
+#endif
+}
@@ -0,0 +1,719 @@
+/*
+ * squashfs.c - read-only SquashFS support
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <driver.h>
+#include <init.h>
+#include <malloc.h>
+#include <fs.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/stat.h>
+#include <linux/err.h>
+#include "squashfs.h"
+
+#define SQUASHFS_MAX_SYMLINKS	8
+
+struct squashfs_file {
+	struct squashfs_inode_info inode;
+	int nblocks;
+	u32 *block_size;
+	u64 *block_pos;
+	u64 frag_start;
+	u32 frag_size;
+};
+
+struct squashfs_dir_iter {
+	u64 block;
+	int offset;
+	int remaining;
+	int count;
+	unsigned int start_block;
+};
+
+struct squashfs_dir {
+	DIR dir;
+	struct squashfs_dir_iter it;
+};
+
+static int squashfs_read_inode(struct squashfs_priv *priv, u64 ref,
+			       struct squashfs_inode_info *inode)
+{
+	union squashfs_inode sqi;
+	u64 block = priv->inode_table + SQUASHFS_INODE_BLK(ref);
+	int offset = SQUASHFS_INODE_OFFSET(ref);
+	int ret, type;
+
+	memset(inode, 0, sizeof(*inode));
+
+	ret = squashfs_read_metadata(priv, &sqi.base, &block, &offset,
+			sizeof(sqi.base));
+	if (ret)
+		return ret;
+
+	type = le16_to_cpu(sqi.base.inode_type);
+	inode->ino = le32_to_cpu(sqi.base.inode_number);
+	inode->mode = le16_to_cpu(sqi.base.mode) & ~S_IFMT;
+
+#define READ_REST(member) \
+	squashfs_read_metadata(priv, (void *)&sqi.member + sizeof(sqi.base), \
+			&block, &offset, sizeof(sqi.member) - sizeof(sqi.base))
+
+	switch (type) {
+	case SQUASHFS_DIR_TYPE:
+		ret = READ_REST(dir);
+		inode->mode |= S_IFDIR;
+		inode->size = le16_to_cpu(sqi.dir.file_size);
+		inode->dir_block = le32_to_cpu(sqi.dir.start_block);
+		inode->dir_offset = le16_to_cpu(sqi.dir.offset);
+		break;
+	case SQUASHFS_LDIR_TYPE:
+		ret = READ_REST(ldir);
+		inode->mode |= S_IFDIR;
+		inode->size = le32_to_cpu(sqi.ldir.file_size);
+		inode->dir_block = le32_to_cpu(sqi.ldir.start_block);
+		inode->dir_offset = le16_to_cpu(sqi.ldir.offset);
+		break;
+	case SQUASHFS_REG_TYPE:
+		ret = READ_REST(reg);
+		inode->mode |= S_IFREG;
+		inode->size = le32_to_cpu(sqi.reg.file_size);
+		inode->start_block = le32_to_cpu(sqi.reg.start_block);
+		inode->fragment = le32_to_cpu(sqi.reg.fragment);
+		inode->frag_offset = le32_to_cpu(sqi.reg.offset);
+		break;
+	case SQUASHFS_LREG_TYPE:
+		ret = READ_REST(lreg);
+		inode->mode |= S_IFREG;
+		inode->size = le64_to_cpu(sqi.lreg.file_size);
+		inode->start_block = le64_to_cpu(sqi.lreg.start_block);
+		inode->fragment = le32_to_cpu(sqi.lreg.fragment);
+		inode->frag_offset = le32_to_cpu(sqi.lreg.offset);
+		break;
+	case SQUASHFS_SYMLINK_TYPE:
+	case SQUASHFS_LSYMLINK_TYPE:
+		ret = READ_REST(symlink);
+		inode->mode |= S_IFLNK;
+		inode->size = le32_to_cpu(sqi.symlink.symlink_size);
+		break;
+	case SQUASHFS_BLKDEV_TYPE:
+	case SQUASHFS_LBLKDEV_TYPE:
+		inode->mode |= S_IFBLK;
+		break;
+	case SQUASHFS_CHRDEV_TYPE:
+	case SQUASHFS_LCHRDEV_TYPE:
+		inode->mode |= S_IFCHR;
+		break;
+	case SQUASHFS_FIFO_TYPE:
+	case SQUASHFS_LFIFO_TYPE:
+		inode->mode |= S_IFIFO;
+		break;
+	case SQUASHFS_SOCKET_TYPE:
+	case SQUASHFS_LSOCKET_TYPE:
+		inode->mode |= S_IFSOCK;
+		break;
+	default:
+		dev_err(priv->dev, "unknown inode type %d\n", type);
+		return -EUCLEAN;
+	}
+#undef READ_REST
+
+	if (ret)
+		return ret;
+
+	inode->next_block = block;
+	inode->next_offset = offset;
+
+	return 0;
+}
+
+static int squashfs_dir_open(struct squashfs_priv *priv,
+			     struct squashfs_inode_info *inode,
+			     struct squashfs_dir_iter *it)
+{
+	if (!S_ISDIR(inode->mode))
+		return -ENOTDIR;
+
+	memset(it, 0, sizeof(*it));
+	it->block = priv->directory_table + inode->dir_block;
+	it->offset = inode->dir_offset;
+	it->remaining = inode->size - SQUASHFS_DIR_SIZE_OFFSET;
+
+	return 0;
+}
+
+/*
+ * Get the next directory entry. Entries are grouped behind headers which
+ * give the metadata block of their inodes. Returns 1 if an entry was found,
+ * 0 at the end of the directory or a negative error code.
+ */
+static int squashfs_dir_next(struct squashfs_priv *priv,
+			     struct squashfs_dir_iter *it, char *name,
+			     u64 *ref)
+{
+	struct squashfs_dir_entry entry;
+	int ret, size;
+
+	if (it->remaining <= 0)
+		return 0;
+
+	if (!it->count) {
+		struct squashfs_dir_header hdr;
+
+		if (it->remaining < sizeof(hdr))
+			goto err;
+
+		ret = squashfs_read_metadata(priv, &hdr, &it->block,
+				&it->offset, sizeof(hdr));
+		if (ret)
+			return ret;
+
+		it->remaining -= sizeof(hdr);
+		it->count = le32_to_cpu(hdr.count) + 1;
+		it->start_block = le32_to_cpu(hdr.start_block);
+
+		if (it->count > SQUASHFS_DIR_COUNT)
+			goto err;
+	}
+
+	if (it->remaining < sizeof(entry))
+		goto err;
+
+	ret = squashfs_read_metadata(priv, &entry, &it->block, &it->offset,
+			sizeof(entry));
+	if (ret)
+		return ret;
+
+	it->remaining -= sizeof(entry);
+	size = le16_to_cpu(entry.size) + 1;
+
+	if (size >= SQUASHFS_NAME_LEN || size > it->remaining)
+		goto err;
+
+	ret = squashfs_read_metadata(priv, name, &it->block, &it->offset,
+			size);
+	if (ret)
+		return ret;
+
+	name[size] = 0;
+	it->remaining -= size;
+	it->count--;
+
+	*ref = ((u64)it->start_block << 16) | le16_to_cpu(entry.offset);
+
+	return 1;
+err:
+	dev_err(priv->dev, "bad directory\n");
+	return -EUCLEAN;
+}
+
+static int squashfs_find_entry(struct squashfs_priv *priv,
+			       struct squashfs_inode_info *dir,
+			       const char *name, int len, u64 *ref)
+{
+	struct squashfs_dir_iter it;
+	char dname[SQUASHFS_NAME_LEN];
+	int ret;
+
+	ret = squashfs_dir_open(priv, dir, &it);
+	if (ret)
+		return ret;
+
+	while ((ret = squashfs_dir_next(priv, &it, dname, ref)) > 0)
+		if (strlen(dname) == len && !memcmp(dname, name, len))
+			return 0;
+
+	return ret ? ret : -ENOENT;
+}
+
+static char *squashfs_read_symlink(struct squashfs_priv *priv,
+				   struct squashfs_inode_info *inode)
+{
+	u64 block = inode->next_block;
+	int offset = inode->next_offset;
+	char *target;
+	int ret;
+
+	if (inode->size >= PATH_MAX)
+		return ERR_PTR(-ENAMETOOLONG);
+
+	target = xzalloc(inode->size + 1);
+
+	ret = squashfs_read_metadata(priv, target, &block, &offset,
+			inode->size);
+	if (ret) {
+		free(target);
+		return ERR_PTR(ret);
+	}
+
+	return target;
+}
+
+/*
+ * SquashFS directories have no "." and ".." entries, so symbolic links are
+ * resolved by replacing the link in the path by its target and looking up
+ * the resulting path from the root again.
+ */
+static int squashfs_lookup_depth(struct squashfs_priv *priv, const char *path,
+				 struct squashfs_inode_info *inode, int depth)
+{
+	const char *start = path;
+	u64 ref = le64_to_cpu(priv->sb.root_inode);
+	int ret;
+
+	ret = squashfs_read_inode(priv, ref, inode);
+	if (ret)
+		return ret;
+
+	while (1) {
+		const char *name, *end;
+		char *target, *newpath, *normpath;
+
+		while (*path == '/')
+			path++;
+		if (!*path)
+			return 0;
+
+		name = path;
+		end = strchr(path, '/');
+		if (!end)
+			end = path + strlen(path);
+
+		ret = squashfs_find_entry(priv, inode, path, end - path, &ref);
+		if (ret)
+			return ret;
+
+		ret = squashfs_read_inode(priv, ref, inode);
+		if (ret)
+			return ret;
+
+		path = end;
+
+		if (!S_ISLNK(inode->mode))
+			continue;
+
+		if (depth >= SQUASHFS_MAX_SYMLINKS)
+			return -ELOOP;
+
+		target = squashfs_read_symlink(priv, inode);
+		if (IS_ERR(target))
+			return PTR_ERR(target);
+
+		if (*target == '/')
+			newpath = asprintf("%s%s", target, path);
+		else
+			newpath = asprintf("/%.*s%s%s", (int)(name - start),
+					start, target, path);
+		free(target);
+
+		normpath = normalise_path(newpath);
+		free(newpath);
+
+		ret = squashfs_lookup_depth(priv, normpath, inode, depth + 1);
+		free(normpath);
+
+		return ret;
+	}
+}
+
+static int squashfs_lookup(struct squashfs_priv *priv, const char *path,
+			   struct squashfs_inode_info *inode)
+{
+	return squashfs_lookup_depth(priv, path, inode, 0);
+}
+
+static int squashfs_read_fragment_entry(struct squashfs_priv *priv,
+					unsigned int fragment,
+					u64 *start, u32 *size)
+{
+	struct squashfs_fragment_entry entry;
+	u64 block;
+	int offset, ret;
+
+	if (fragment >= priv->fragments)
+		return -EUCLEAN;
+
+	block = le64_to_cpu(priv->fragment_index[SQUASHFS_FRAGMENT_INDEX(fragment)]);
+	offset = SQUASHFS_FRAGMENT_INDEX_OFFSET(fragment);
+
+	ret = squashfs_read_metadata(priv, &entry, &block, &offset,
+			sizeof(entry));
+	if (ret)
+		return ret;
+
+	*start = le64_to_cpu(entry.start_block);
+	*size = le32_to_cpu(entry.size);
+
+	return 0;
+}
+
+static int squashfs_open(struct device_d *dev, FILE *f, const char *filename)
+{
+	struct squashfs_priv *priv = dev->priv;
+	struct squashfs_file *file;
+	struct squashfs_inode_info *inode;
+	u64 block, pos;
+	int offset, i, ret;
+
+	file = xzalloc(sizeof(*file));
+	inode = &file->inode;
+
+	ret = squashfs_lookup(priv, filename, inode);
+	if (ret)
+		goto err;
+
+	if (!S_ISREG(inode->mode)) {
+		ret = S_ISDIR(inode->mode) ? -EISDIR : -EINVAL;
+		goto err;
+	}
+
+	if (inode->fragment == SQUASHFS_INVALID_FRAG) {
+		file->nblocks = DIV_ROUND_UP(inode->size, priv->block_size);
+	} else {
+		file->nblocks = inode->size >> priv->block_log;
+		ret = squashfs_read_fragment_entry(priv, inode->fragment,
+				&file->frag_start, &file->frag_size);
+		if (ret)
+			goto err;
+	}
+
+	/* the block list directly follows the inode */
+	file->block_size = xmalloc(file->nblocks * sizeof(u32));
+	file->block_pos = xmalloc(file->nblocks * sizeof(u64));
+
+	block = inode->next_block;
+	offset = inode->next_offset;
+	ret = squashfs_read_metadata(priv, file->block_size, &block, &offset,
+			file->nblocks * sizeof(u32));
+	if (ret)
+		goto err;
+
+	pos = inode->start_block;
+	for (i = 0; i < file->nblocks; i++) {
+		file->block_size[i] = le32_to_cpu(file->block_size[i]);
+		file->block_pos[i] = pos;
+		pos += SQUASHFS_COMPRESSED_SIZE_BLOCK(file->block_size[i]);
+	}
+
+	if (pos > priv->bytes_used) {
+		ret = -EUCLEAN;
+		goto err;
+	}
+
+	f->inode = file;
+	f->size = inode->size;
+
+	return 0;
+err:
+	free(file->block_size);
+	free(file->block_pos);
+	free(file);
+
+	return ret;
+}
+
+static int squashfs_close(struct device_d *dev, FILE *f)
+{
+	struct squashfs_file *file = f->inode;
+
+	free(file->block_size);
+	free(file->block_pos);
+	free(file);
+
+	return 0;
+}
+
+static int squashfs_pread(struct device_d *dev, FILE *f, void *buf,
+			  size_t insize, loff_t pos)
+{
+	struct squashfs_priv *priv = dev->priv;
+	struct squashfs_file *file = f->inode;
+	struct squashfs_cache_entry *entry;
+	size_t size;
+	int ret;
+
+	size = min_t(loff_t, insize, file->inode.size - pos);
+	insize = size;
+
+	while (size) {
+		unsigned int blk = pos >> priv->block_log;
+		unsigned int offs = pos & (priv->block_size - 1);
+		unsigned int blen;
+		size_t now;
+
+		/* the last block may be shorter, also when in a fragment */
+		blen = min_t(loff_t, priv->block_size,
+				file->inode.size - ((loff_t)blk << priv->block_log));
+		now = min_t(size_t, size, blen - offs);
+
+		if (blk >= file->nblocks) {
+			entry = squashfs_cache_get(priv, priv->fragment_cache,
+					file->frag_start, file->frag_size);
+			if (IS_ERR(entry))
+				return PTR_ERR(entry);
+			if (file->inode.frag_offset + blen > entry->length)
+				return -EUCLEAN;
+			memcpy(buf, entry->data + file->inode.frag_offset + offs,
+					now);
+		} else if (!file->block_size[blk]) {
+			/* sparse block */
+			memset(buf, 0, now);
+		} else if (!offs && now == blen) {
+			/* whole block, decompress directly into the buffer */
+			ret = squashfs_read_data(priv, buf, file->block_pos[blk],
+					file->block_size[blk], NULL, blen);
+			if (ret < 0)
+				return ret;
+			if (ret != blen)
+				return -EUCLEAN;
+		} else {
+			entry = squashfs_cache_get(priv, priv->read_cache,
+					file->block_pos[blk],
+					file->block_size[blk]);
+			if (IS_ERR(entry))
+				return PTR_ERR(entry);
+			if (offs + now > entry->length)
+				return -EUCLEAN;
+			memcpy(buf, entry->data + offs, now);
+		}
+
+		buf += now;
+		pos += now;
+		size -= now;
+	}
+
+	return insize;
+}
+
+static int squashfs_read(struct device_d *dev, FILE *f, void *buf,
+			 size_t insize)
+{
+	return squashfs_pread(dev, f, buf, insize, f->pos);
+}
+
+static loff_t squashfs_lseek(struct device_d *dev, FILE *f, loff_t pos)
+{
+	f->pos = pos;
+
+	return f->pos;
+}
+
+static DIR *squashfs_opendir(struct device_d *dev, const char *pathname)
+{
+	struct squashfs_priv *priv = dev->priv;
+	struct squashfs_inode_info inode;
+	struct squashfs_dir *dir;
+	int ret;
+
+	ret = squashfs_lookup(priv, pathname, &inode);
+	if (ret)
+		return NULL;
+
+	dir = xzalloc(sizeof(*dir));
+
+	ret = squashfs_dir_open(priv, &inode, &dir->it);
+	if (ret) {
+		free(dir);
+		return NULL;
+	}
+
+	dir->dir.priv = dir;
+
+	return &dir->dir;
+}
+
+static struct dirent *squashfs_readdir(struct device_d *dev, DIR *_dir)
+{
+	struct squashfs_priv *priv = dev->priv;
+	struct squashfs_dir *dir = _dir->priv;
+	u64 ref;
+	int ret;
+
+	ret = squashfs_dir_next(priv, &dir->it, _dir->d.d_name, &ref);
+	if (ret <= 0)
+		return NULL;
+
+	return &_dir->d;
+}
+
+static int squashfs_closedir(struct device_d *dev, DIR *_dir)
+{
+	free(_dir->priv);
+
+	return 0;
+}
+
+static int squashfs_stat(struct device_d *dev, const char *filename,
+			 struct stat *s)
+{
+	struct squashfs_priv *priv = dev->priv;
+	struct squashfs_inode_info inode;
+	int ret;
+
+	ret = squashfs_lookup(priv, filename, &inode);
+	if (ret)
+		return ret;
+
+	s->st_mode = inode.mode;
+	s->st_size = inode.size;
+
+	return 0;
+}
+
+static int squashfs_read_super(struct squashfs_priv *priv)
+{
+	struct squashfs_super_block *sb = &priv->sb;
+	u64 frag_table;
+	int ret, len;
+
+	ret = cdev_read(priv->cdev, sb, sizeof(*sb), 0, 0);
+	if (ret != sizeof(*sb))
+		return ret < 0 ? ret : -EIO;
+
+	if (le32_to_cpu(sb->s_magic) != SQUASHFS_MAGIC)
+		return -EINVAL;
+
+	if (le16_to_cpu(sb->s_major) != SQUASHFS_MAJOR ||
+			le16_to_cpu(sb->s_minor) > SQUASHFS_MINOR) {
+		dev_err(priv->dev, "unsupported version %d.%d\n",
+				le16_to_cpu(sb->s_major),
+				le16_to_cpu(sb->s_minor));
+		return -EINVAL;
+	}
+
+	priv->block_size = le32_to_cpu(sb->block_size);
+	priv->block_log = le16_to_cpu(sb->block_log);
+	priv->bytes_used = le64_to_cpu(sb->bytes_used);
+	priv->inode_table = le64_to_cpu(sb->inode_table_start);
+	priv->directory_table = le64_to_cpu(sb->directory_table_start);
+	priv->fragments = le32_to_cpu(sb->fragments);
+	priv->compression = le16_to_cpu(sb->compression);
+	frag_table = le64_to_cpu(sb->fragment_table_start);
+
+	if (priv->block_log < SQUASHFS_FILE_MIN_LOG ||
+			priv->block_log > SQUASHFS_FILE_MAX_LOG ||
+			priv->block_size != 1 << priv->block_log ||
+			priv->bytes_used > priv->cdev->size ||
+			priv->inode_table >= priv->directory_table ||
+			priv->directory_table > priv->bytes_used) {
+		dev_err(priv->dev, "bad superblock\n");
+		return -EINVAL;
+	}
+
+	if (!priv->fragments)
+		return 0;
+
+	len = SQUASHFS_FRAGMENT_INDEX_BYTES(priv->fragments);
+	if (frag_table + len > priv->bytes_used) {
+		dev_err(priv->dev, "bad fragment table\n");
+		return -EINVAL;
+	}
+
+	priv->fragment_index = xmalloc(len);
+	ret = cdev_read(priv->cdev, priv->fragment_index, len, frag_table, 0);
+	if (ret != len)
+		return ret < 0 ? ret : -EIO;
+
+	return 0;
+}
+
+static void squashfs_free(struct squashfs_priv *priv)
+{
+	squashfs_decompressor_exit(priv);
+	squashfs_cache_delete(priv->meta_cache);
+	squashfs_cache_delete(priv->fragment_cache);
+	squashfs_cache_delete(priv->read_cache);
+	free(priv->read_buf);
+	free(priv->fragment_index);
+	free(priv);
+}
+
+static int squashfs_probe(struct device_d *dev)
+{
+	struct fs_device_d *fsdev = dev_to_fs_device(dev);
+	char *backingstore = fsdev->backingstore;
+	struct squashfs_priv *priv;
+	int ret;
+
+	priv = xzalloc(sizeof(*priv));
+	priv->dev = dev;
+	dev->priv = priv;
+
+	if (!strncmp(backingstore, "/dev/", 5))
+		backingstore += 5;
+
+	priv->cdev = cdev_open(backingstore, O_RDONLY);
+	if (!priv->cdev) {
+		ret = -ENOENT;
+		goto err_open;
+	}
+
+	ret = squashfs_read_super(priv);
+	if (ret)
+		goto err;
+
+	ret = squashfs_decompressor_init(priv);
+	if (ret)
+		goto err;
+
+	priv->read_buf = xmalloc(max_t(unsigned int, priv->block_size,
+				SQUASHFS_METADATA_SIZE));
+	priv->meta_cache = squashfs_cache_init("metadata",
+			SQUASHFS_CACHED_META, SQUASHFS_METADATA_SIZE);
+	priv->fragment_cache = squashfs_cache_init("fragment",
+			SQUASHFS_CACHED_FRAGS, priv->block_size);
+	priv->read_cache = squashfs_cache_init("data",
+			SQUASHFS_CACHED_BLKS, priv->block_size);
+
+	return 0;
+
+err:
+	dev_info(dev, "no valid squashfs found\n");
+	cdev_close(priv->cdev);
+err_open:
+	squashfs_free(priv);
+
+	return ret;
+}
+
+static void squashfs_remove(struct device_d *dev)
+{
+	struct squashfs_priv *priv = dev->priv;
+
+	cdev_close(priv->cdev);
+	squashfs_free(priv);
+}
+
+static struct fs_driver_d squashfs_driver = {
+	.open		= squashfs_open,
+	.close		= squashfs_close,
+	.read		= squashfs_read,
+	.pread		= squashfs_pread,
+	.lseek		= squashfs_lseek,
+	.opendir	= squashfs_opendir,
+	.readdir	= squashfs_readdir,
+	.closedir	= squashfs_closedir,
+	.stat		= squashfs_stat,
+	.drv = {
+		.probe = squashfs_probe,
+		.remove = squashfs_remove,
+		.name = "squashfs",
+	}
+};
+
+static int squashfs_init(void)
+{
+	return register_fs_driver(&squashfs_driver);
+}
+
+device_initcall(squashfs_init);
@@ -0,0 +1,107 @@
+/*
+ * squashfs.h - internal interfaces of the SquashFS driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __SQUASHFS_H
+#define __SQUASHFS_H
+
+#include <driver.h>
+#include <linux/zlib.h>
+#include "squashfs_fs.h"
+
+/* number of decompressed blocks kept in each cache */
+#define SQUASHFS_CACHED_META	8
+#define SQUASHFS_CACHED_FRAGS	3
+#define SQUASHFS_CACHED_BLKS	2
+
+struct squashfs_cache_entry {
+	u64 block;
+	int length;
+	u64 next_index;
+	unsigned long used;
+	void *data;
+};
+
+/*
+ * Cache of decompressed blocks. Entries are identified by the location of
+ * the compressed block on disk, the least recently used entry is replaced.
+ */
+struct squashfs_cache {
+	const char *name;
+	int entries;
+	int block_size;
+	unsigned long used;
+	struct squashfs_cache_entry *entry;
+};
+
+struct squashfs_priv {
+	struct device_d *dev;
+	struct cdev *cdev;
+
+	struct squashfs_super_block sb;
+	unsigned int block_size;
+	unsigned int block_log;
+	u64 bytes_used;
+	u64 inode_table;
+	u64 directory_table;
+	unsigned int fragments;
+	__le64 *fragment_index;
+
+	struct squashfs_cache *meta_cache;
+	struct squashfs_cache *fragment_cache;
+	struct squashfs_cache *read_cache;
+
+	/* compressed data of the block being read */
+	void *read_buf;
+
+	int compression;
+	z_stream zstream;
+};
+
+/* In-memory inode */
+struct squashfs_inode_info {
+	umode_t mode;
+	unsigned int ino;
+	loff_t size;
+
+	/* regular files */
+	u64 start_block;
+	unsigned int fragment;
+	unsigned int frag_offset;
+
+	/* directories */
+	unsigned int dir_block;
+	unsigned int dir_offset;
+
+	/* block list of files, symlink target */
+	u64 next_block;
+	int next_offset;
+};
+
+/* cache.c */
+struct squashfs_cache *squashfs_cache_init(const char *name, int entries,
+		int block_size);
+void squashfs_cache_delete(struct squashfs_cache *cache);
+struct squashfs_cache_entry *squashfs_cache_get(struct squashfs_priv *priv,
+		struct squashfs_cache *cache, u64 block, int length);
+int squashfs_read_metadata(struct squashfs_priv *priv, void *buf,
+		u64 *block, int *offset, int length);
+int squashfs_read_data(struct squashfs_priv *priv, void *buf, u64 index,
+		int length, u64 *next_index, int outlen);
+
+/* decompressor.c */
+int squashfs_decompressor_init(struct squashfs_priv *priv);
+void squashfs_decompressor_exit(struct squashfs_priv *priv);
+int squashfs_decompress(struct squashfs_priv *priv, void *src, int srclen,
+		void *dst, int dstlen);
+
+#endif /* __SQUASHFS_H */
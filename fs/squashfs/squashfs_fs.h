@@ -0,0 +1,206 @@
+/*
+ * squashfs_fs.h - SquashFS 4.0 on-disk format
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __SQUASHFS_FS_H
+#define __SQUASHFS_FS_H
+
+#include <linux/types.h>
+
+#define SQUASHFS_MAGIC			0x73717368
+#define SQUASHFS_MAJOR			4
+#define SQUASHFS_MINOR			0
+
+#define SQUASHFS_METADATA_SIZE		8192
+#define SQUASHFS_METADATA_LOG		13
+
+#define SQUASHFS_FILE_MAX_LOG		20
+#define SQUASHFS_FILE_MIN_LOG		12
+
+#define SQUASHFS_INVALID_FRAG		0xffffffffU
+#define SQUASHFS_INVALID_BLK		(-1LL)
+
+#define SQUASHFS_NAME_LEN		256
+
+/* compressors */
+#define ZLIB_COMPRESSION		1
+#define LZMA_COMPRESSION		2
+#define LZO_COMPRESSION			3
+#define XZ_COMPRESSION			4
+#define LZ4_COMPRESSION			5
+
+/* metadata block header */
+#define SQUASHFS_COMPRESSED_BIT		(1 << 15)
+#define SQUASHFS_COMPRESSED_SIZE(B)	(((B) & ~SQUASHFS_COMPRESSED_BIT) ? \
+					 (B) & ~SQUASHFS_COMPRESSED_BIT : \
+					 SQUASHFS_COMPRESSED_BIT)
+#define SQUASHFS_COMPRESSED(B)		(!((B) & SQUASHFS_COMPRESSED_BIT))
+
+/* data block size word */
+#define SQUASHFS_COMPRESSED_BIT_BLOCK	(1 << 24)
+#define SQUASHFS_COMPRESSED_SIZE_BLOCK(B) ((B) & ~SQUASHFS_COMPRESSED_BIT_BLOCK)
+#define SQUASHFS_COMPRESSED_BLOCK(B)	(!((B) & SQUASHFS_COMPRESSED_BIT_BLOCK))
+
+/* inode references: metadata block start << 16 | offset in the block */
+#define SQUASHFS_INODE_BLK(A)		((unsigned int) ((A) >> 16))
+#define SQUASHFS_INODE_OFFSET(A)	((unsigned int) ((A) & 0xffff))
+
+/* fragment and lookup tables */
+#define SQUASHFS_FRAGMENT_BYTES(A)	((A) * sizeof(struct squashfs_fragment_entry))
+#define SQUASHFS_FRAGMENT_INDEX(A)	(SQUASHFS_FRAGMENT_BYTES(A) / \
+					 SQUASHFS_METADATA_SIZE)
+#define SQUASHFS_FRAGMENT_INDEX_OFFSET(A) (SQUASHFS_FRAGMENT_BYTES(A) % \
+					 SQUASHFS_METADATA_SIZE)
+#define SQUASHFS_FRAGMENT_INDEXES(A)	((SQUASHFS_FRAGMENT_BYTES(A) + \
+					 SQUASHFS_METADATA_SIZE - 1) / \
+					 SQUASHFS_METADATA_SIZE)
+#define SQUASHFS_FRAGMENT_INDEX_BYTES(A) (SQUASHFS_FRAGMENT_INDEXES(A) * \
+					 sizeof(u64))
+
+/* inode types */
+#define SQUASHFS_DIR_TYPE		1
+#define SQUASHFS_REG_TYPE		2
+#define SQUASHFS_SYMLINK_TYPE		3
+#define SQUASHFS_BLKDEV_TYPE		4
+#define SQUASHFS_CHRDEV_TYPE		5
+#define SQUASHFS_FIFO_TYPE		6
+#define SQUASHFS_SOCKET_TYPE		7
+#define SQUASHFS_LDIR_TYPE		8
+#define SQUASHFS_LREG_TYPE		9
+#define SQUASHFS_LSYMLINK_TYPE		10
+#define SQUASHFS_LBLKDEV_TYPE		11
+#define SQUASHFS_LCHRDEV_TYPE		12
+#define SQUASHFS_LFIFO_TYPE		13
+#define SQUASHFS_LSOCKET_TYPE		14
+
+/* superblock flags */
+#define SQUASHFS_COMP_OPT		0x0400
+
+struct squashfs_super_block {
+	__le32	s_magic;
+	__le32	inodes;
+	__le32	mkfs_time;
+	__le32	block_size;
+	__le32	fragments;
+	__le16	compression;
+	__le16	block_log;
+	__le16	flags;
+	__le16	no_ids;
+	__le16	s_major;
+	__le16	s_minor;
+	__le64	root_inode;
+	__le64	bytes_used;
+	__le64	id_table_start;
+	__le64	xattr_id_table_start;
+	__le64	inode_table_start;
+	__le64	directory_table_start;
+	__le64	fragment_table_start;
+	__le64	lookup_table_start;
+} __attribute__ ((packed));
+
+struct squashfs_base_inode {
+	__le16	inode_type;
+	__le16	mode;
+	__le16	uid;
+	__le16	guid;
+	__le32	mtime;
+	__le32	inode_number;
+} __attribute__ ((packed));
+
+struct squashfs_ipc_inode {
+	struct squashfs_base_inode base;
+	__le32	nlink;
+} __attribute__ ((packed));
+
+struct squashfs_symlink_inode {
+	struct squashfs_base_inode base;
+	__le32	nlink;
+	__le32	symlink_size;
+	char	symlink[0];
+} __attribute__ ((packed));
+
+struct squashfs_reg_inode {
+	struct squashfs_base_inode base;
+	__le32	start_block;
+	__le32	fragment;
+	__le32	offset;
+	__le32	file_size;
+	__le32	block_list[0];
+} __attribute__ ((packed));
+
+struct squashfs_lreg_inode {
+	struct squashfs_base_inode base;
+	__le64	start_block;
+	__le64	file_size;
+	__le64	sparse;
+	__le32	nlink;
+	__le32	fragment;
+	__le32	offset;
+	__le32	xattr;
+	__le32	block_list[0];
+} __attribute__ ((packed));
+
+struct squashfs_dir_inode {
+	struct squashfs_base_inode base;
+	__le32	start_block;
+	__le32	nlink;
+	__le16	file_size;
+	__le16	offset;
+	__le32	parent_inode;
+} __attribute__ ((packed));
+
+struct squashfs_ldir_inode {
+	struct squashfs_base_inode base;
+	__le32	nlink;
+	__le32	file_size;
+	__le32	start_block;
+	__le32	parent_inode;
+	__le16	i_count;
+	__le16	offset;
+	__le32	xattr;
+} __attribute__ ((packed));
+
+union squashfs_inode {
+	struct squashfs_base_inode	base;
+	struct squashfs_ipc_inode	ipc;
+	struct squashfs_symlink_inode	symlink;
+	struct squashfs_reg_inode	reg;
+	struct squashfs_lreg_inode	lreg;
+	struct squashfs_dir_inode	dir;
+	struct squashfs_ldir_inode	ldir;
+};
+
+struct squashfs_dir_entry {
+	__le16	offset;
+	__le16	inode_number;
+	__le16	type;
+	__le16	size;
+	char	name[0];
+} __attribute__ ((packed));
+
+struct squashfs_dir_header {
+	__le32	count;
+	__le32	start_block;
+	__le32	inode_number;
+} __attribute__ ((packed));
+
+/* directory listings are 3 bytes longer than what is stored */
+#define SQUASHFS_DIR_SIZE_OFFSET	3
+#define SQUASHFS_DIR_COUNT		256
+
+struct squashfs_fragment_entry {
+	__le64	start_block;
+	__le32	size;
+	unsigned int unused;
+} __attribute__ ((packed));
+
+#endif /* __SQUASHFS_FS_H */
@@ -0,0 +1,166 @@
+/*
+ * io.c - UBIFS node reading and LEB scanning
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <errno.h>
+#include "ubifs.h"
+
+/*
+ * Read @len bytes at @lnum:@offs from the UBI volume. The volume is accessed
+ * through its character device, LEB n starting at n * leb_size.
+ */
+int ubifs_read(struct ubifs_info *c, int lnum, int offs, int len, void *buf)
+{
+	loff_t pos = (loff_t)lnum * c->leb_size + offs;
+	ssize_t ret;
+
+	ret = cdev_read(c->cdev, buf, len, pos, 0);
+	if (ret < 0)
+		return ret;
+	if (ret != len)
+		return -EIO;
+
+	return 0;
+}
+
+/*
+ * Check the common header and the CRC of the node in @buf. At most @len
+ * bytes of @buf are valid. This function does not print anything as it is
+ * also used to find the end of the written area when scanning.
+ */
+int ubifs_check_node(struct ubifs_info *c, const void *buf, int len,
+		     int lnum, int offs)
+{
+	const struct ubifs_ch *ch = buf;
+	uint32_t crc;
+	int node_len;
+
+	if (le32_to_cpu(ch->magic) != UBIFS_NODE_MAGIC)
+		return -EUCLEAN;
+
+	if (ch->node_type >= UBIFS_NODE_TYPES_CNT)
+		return -EUCLEAN;
+
+	node_len = le32_to_cpu(ch->len);
+	if (node_len < UBIFS_CH_SZ || node_len > len ||
+			offs + node_len > c->leb_size)
+		return -EUCLEAN;
+
+	crc = crc32_no_comp(UBIFS_CRC32_INIT, buf + 8, node_len - 8);
+	if (crc != le32_to_cpu(ch->crc))
+		return -EBADMSG;
+
+	return 0;
+}
+
+/*
+ * Read a node of type @type and length @len from @lnum:@offs and validate it.
+ */
+int ubifs_read_node(struct ubifs_info *c, void *buf, int type, int len,
+		    int lnum, int offs)
+{
+	struct ubifs_ch *ch = buf;
+	int ret;
+
+	if (lnum < 0 || lnum >= c->leb_cnt || offs < 0 ||
+			offs + len > c->leb_size) {
+		ubifs_err(c, "bad node reference %d:%d (%d bytes)\n",
+				lnum, offs, len);
+		return -EINVAL;
+	}
+
+	ret = ubifs_read(c, lnum, offs, len, buf);
+	if (ret) {
+		ubifs_err(c, "cannot read node at %d:%d: %s\n", lnum, offs,
+				strerror(-ret));
+		return ret;
+	}
+
+	ret = ubifs_check_node(c, buf, len, lnum, offs);
+	if (ret || ch->node_type != type || le32_to_cpu(ch->len) != len) {
+		ubifs_err(c, "bad node at %d:%d (type %d, expected %d)\n",
+				lnum, offs, ch->node_type, type);
+		return -EUCLEAN;
+	}
+
+	return 0;
+}
+
+static int ubifs_padding_bytes(const void *buf, int len)
+{
+	const uint8_t *p = buf;
+	int pad = 0;
+
+	while (pad < len && p[pad] == UBIFS_PADDING_BYTE)
+		pad++;
+
+	return pad;
+}
+
+/*
+ * Scan LEB @lnum from offset @offs and call @fn for every valid node found.
+ * Padding nodes and padding bytes are skipped. Scanning stops at the first
+ * empty or corrupted area, which is where the last writer was interrupted.
+ * @fn may return a positive value to stop the scan early.
+ *
+ * Returns the offset where the scan stopped or a negative error code.
+ */
+int ubifs_scan_leb(struct ubifs_info *c, int lnum, int offs,
+		   int (*fn)(struct ubifs_info *c, void *node, int lnum,
+			     int offs, void *ctx),
+		   void *ctx)
+{
+	void *buf = c->sbuf;
+	int len = c->leb_size - offs;
+	int pos = 0, ret;
+
+	ret = ubifs_read(c, lnum, offs, len, buf);
+	if (ret)
+		return ret;
+
+	while (pos + UBIFS_CH_SZ <= len) {
+		struct ubifs_ch *ch = buf + pos;
+		int node_len;
+
+		if (le32_to_cpu(ch->magic) != UBIFS_NODE_MAGIC) {
+			int pad = ubifs_padding_bytes(ch, len - pos);
+
+			if (!pad)
+				break;
+			pos += pad;
+			continue;
+		}
+
+		if (ubifs_check_node(c, ch, len - pos, lnum, offs + pos))
+			break;
+
+		node_len = le32_to_cpu(ch->len);
+
+		if (ch->node_type == UBIFS_PAD_NODE) {
+			struct ubifs_pad_node *pad = buf + pos;
+
+			pos += node_len + le32_to_cpu(pad->pad_len);
+			continue;
+		}
+
+		ret = fn(c, ch, lnum, offs + pos, ctx);
+		if (ret < 0)
+			return ret;
+		if (ret > 0)
+			break;
+
+		pos += ALIGN(node_len, 8);
+	}
+
+	return offs + pos;
+}
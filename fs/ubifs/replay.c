@@ -0,0 +1,568 @@
+/*
+ * replay.c - UBIFS journal replay for read-only mounts
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Everything written since the last commit is only referenced from the log
+ * and not from the index. The log points to the journal LEBs ("buds"), which
+ * are scanned here. The nodes found are applied in sequence number order to
+ * an in-memory overlay of the committed index, which is never written back:
+ *
+ * - inode, data and directory entry nodes become overlay entries, deleted
+ *   inodes and directory entries become negative overlay entries,
+ * - inode deletions and truncations become key ranges which hide whatever
+ *   the committed index holds for them.
+ *
+ * Lookups consult the overlay first and fall back to the committed index.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <errno.h>
+#include <string.h>
+#include <qsort.h>
+#include "ubifs.h"
+
+struct replay_entry {
+	struct rb_node rb;
+	union ubifs_key key;
+	int lnum;
+	int offs;
+	int len;
+	int deletion;
+	int nlen;
+	char *name;
+};
+
+struct replay_range {
+	struct list_head list;
+	union ubifs_key from;
+	union ubifs_key to;
+};
+
+struct replay_bud {
+	struct list_head list;
+	int lnum;
+	int offs;
+};
+
+/* a node found in the journal, applied after all buds were scanned */
+struct replay_node {
+	unsigned long long sqnum;
+	int type;
+	union ubifs_key key;
+	int lnum;
+	int offs;
+	int len;
+	int deletion;
+	int nlen;
+	char *name;
+	unsigned long long old_size;
+	unsigned long long new_size;
+};
+
+struct replay_ctx {
+	struct replay_node *nodes;
+	int cnt;
+	int alloc;
+	int group_start;
+	struct list_head buds;
+	int first;
+	int end;
+};
+
+static int entry_cmp(const struct replay_entry *r, const union ubifs_key *key,
+		     const char *name, int nlen)
+{
+	int ret = keys_cmp(&r->key, key);
+
+	if (ret)
+		return ret;
+
+	if (!name || !r->name)
+		return !!r->name - !!name;
+
+	if (r->nlen != nlen)
+		return r->nlen < nlen ? -1 : 1;
+
+	return memcmp(r->name, name, nlen);
+}
+
+static struct replay_entry *replay_find(struct ubifs_info *c,
+					const union ubifs_key *key,
+					const char *name, int nlen)
+{
+	struct rb_node *n = c->replay_tree.rb_node;
+
+	while (n) {
+		struct replay_entry *r = rb_entry(n, struct replay_entry, rb);
+		int cmp = entry_cmp(r, key, name, nlen);
+
+		if (cmp > 0)
+			n = n->rb_left;
+		else if (cmp < 0)
+			n = n->rb_right;
+		else
+			return r;
+	}
+
+	return NULL;
+}
+
+/* find the first entry with a key greater than or equal to @key */
+static struct rb_node *replay_lower_bound(struct ubifs_info *c,
+					  const union ubifs_key *key)
+{
+	struct rb_node *n = c->replay_tree.rb_node, *found = NULL;
+
+	while (n) {
+		struct replay_entry *r = rb_entry(n, struct replay_entry, rb);
+
+		if (keys_cmp(&r->key, key) >= 0) {
+			found = n;
+			n = n->rb_left;
+		} else {
+			n = n->rb_right;
+		}
+	}
+
+	return found;
+}
+
+static void replay_free_entry(struct ubifs_info *c, struct replay_entry *r)
+{
+	rb_erase(&r->rb, &c->replay_tree);
+	free(r->name);
+	free(r);
+}
+
+static void replay_insert(struct ubifs_info *c, struct replay_node *rn)
+{
+	struct rb_node **p = &c->replay_tree.rb_node, *parent = NULL;
+	struct replay_entry *r;
+
+	while (*p) {
+		int cmp;
+
+		parent = *p;
+		r = rb_entry(parent, struct replay_entry, rb);
+		cmp = entry_cmp(r, &rn->key, rn->name, rn->nlen);
+
+		if (cmp > 0) {
+			p = &(*p)->rb_left;
+		} else if (cmp < 0) {
+			p = &(*p)->rb_right;
+		} else {
+			/* newer version of the same node */
+			r->lnum = rn->lnum;
+			r->offs = rn->offs;
+			r->len = rn->len;
+			r->deletion = rn->deletion;
+			return;
+		}
+	}
+
+	r = xzalloc(sizeof(*r));
+	r->key = rn->key;
+	r->lnum = rn->lnum;
+	r->offs = rn->offs;
+	r->len = rn->len;
+	r->deletion = rn->deletion;
+	if (rn->name) {
+		r->name = xmalloc(rn->nlen);
+		memcpy(r->name, rn->name, rn->nlen);
+		r->nlen = rn->nlen;
+	}
+
+	rb_link_node(&r->rb, parent, p);
+	rb_insert_color(&r->rb, &c->replay_tree);
+}
+
+static void replay_remove_range(struct ubifs_info *c,
+				const union ubifs_key *from,
+				const union ubifs_key *to)
+{
+	struct replay_range *range;
+	struct rb_node *n;
+
+	n = replay_lower_bound(c, from);
+	while (n) {
+		struct replay_entry *r = rb_entry(n, struct replay_entry, rb);
+
+		if (keys_cmp(&r->key, to) > 0)
+			break;
+
+		n = rb_next(n);
+		replay_free_entry(c, r);
+	}
+
+	range = xzalloc(sizeof(*range));
+	range->from = *from;
+	range->to = *to;
+	list_add_tail(&range->list, &c->replay_ranges);
+}
+
+static void replay_apply(struct ubifs_info *c, struct replay_node *rn)
+{
+	union ubifs_key from, to;
+	unsigned long inum = key_inum(&rn->key);
+
+	switch (rn->type) {
+	case UBIFS_INO_NODE:
+		if (rn->deletion) {
+			from.u32[0] = to.u32[0] = inum;
+			from.u32[1] = 0;
+			to.u32[1] = 0xffffffff;
+			replay_remove_range(c, &from, &to);
+			break;
+		}
+		/* fall through */
+	case UBIFS_DATA_NODE:
+	case UBIFS_DENT_NODE:
+		replay_insert(c, rn);
+		break;
+	case UBIFS_TRUN_NODE: {
+		unsigned long long min_blk, max_blk;
+
+		min_blk = DIV_ROUND_UP(rn->new_size, UBIFS_BLOCK_SIZE);
+		max_blk = rn->old_size >> UBIFS_BLOCK_SHIFT;
+		if (!(rn->old_size & (UBIFS_BLOCK_SIZE - 1)))
+			max_blk--;
+		if (rn->old_size <= rn->new_size || max_blk < min_blk)
+			break;
+
+		data_key_init(&from, inum, min_blk);
+		data_key_init(&to, inum, max_blk);
+		replay_remove_range(c, &from, &to);
+		break;
+	}
+	}
+}
+
+/*
+ * Look up @key (and @name for directory entries) in the replayed journal.
+ * Returns 1 and fills in @zbr if the journal holds a newer version of the
+ * node, -ENOENT if the journal deleted it and 0 if the committed index is
+ * authoritative for this key.
+ */
+int ubifs_replay_lookup(struct ubifs_info *c, const union ubifs_key *key,
+			const char *name, int nlen,
+			struct ubifs_zbranch *zbr)
+{
+	struct replay_range *range;
+	struct replay_entry *r;
+
+	r = replay_find(c, key, name, nlen);
+	if (r) {
+		if (r->deletion)
+			return -ENOENT;
+
+		zbr->key = r->key;
+		zbr->lnum = r->lnum;
+		zbr->offs = r->offs;
+		zbr->len = r->len;
+		zbr->znode = NULL;
+		return 1;
+	}
+
+	list_for_each_entry(range, &c->replay_ranges, list) {
+		if (keys_cmp(key, &range->from) >= 0 &&
+				keys_cmp(key, &range->to) <= 0)
+			return -ENOENT;
+	}
+
+	return 0;
+}
+
+/*
+ * Call @fn for every directory entry of directory @inum which was created
+ * after the last commit.
+ */
+int ubifs_replay_for_each_dent(struct ubifs_info *c, unsigned long inum,
+			       int (*fn)(struct ubifs_info *c,
+					 const char *name, int nlen,
+					 void *ctx),
+			       void *ctx)
+{
+	union ubifs_key key;
+	struct rb_node *n;
+	int ret;
+
+	key_init(&key, inum, UBIFS_DENT_KEY, 0);
+
+	for (n = replay_lower_bound(c, &key); n; n = rb_next(n)) {
+		struct replay_entry *r = rb_entry(n, struct replay_entry, rb);
+
+		if (key_inum(&r->key) != inum ||
+				key_type(&r->key) != UBIFS_DENT_KEY)
+			break;
+
+		if (r->deletion)
+			continue;
+
+		ret = fn(c, r->name, r->nlen, ctx);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static struct replay_node *replay_add_node(struct replay_ctx *ctx,
+					   struct ubifs_ch *ch, int lnum,
+					   int offs)
+{
+	struct replay_node *rn;
+
+	if (ctx->cnt == ctx->alloc) {
+		ctx->alloc = ctx->alloc ? ctx->alloc * 2 : 256;
+		ctx->nodes = xrealloc(ctx->nodes,
+				ctx->alloc * sizeof(struct replay_node));
+	}
+
+	rn = &ctx->nodes[ctx->cnt++];
+	memset(rn, 0, sizeof(*rn));
+	rn->sqnum = le64_to_cpu(ch->sqnum);
+	rn->type = ch->node_type;
+	rn->lnum = lnum;
+	rn->offs = offs;
+	rn->len = le32_to_cpu(ch->len);
+
+	return rn;
+}
+
+static void replay_drop_nodes(struct replay_ctx *ctx, int from)
+{
+	while (ctx->cnt > from)
+		free(ctx->nodes[--ctx->cnt].name);
+}
+
+static int replay_bud_node(struct ubifs_info *c, void *node, int lnum,
+			   int offs, void *_ctx)
+{
+	struct replay_ctx *ctx = _ctx;
+	struct ubifs_ch *ch = node;
+	struct replay_node *rn;
+	int len = le32_to_cpu(ch->len);
+
+	if (le64_to_cpu(ch->sqnum) < c->cs_sqnum)
+		return 1;
+
+	switch (ch->node_type) {
+	case UBIFS_INO_NODE: {
+		struct ubifs_ino_node *ino = node;
+
+		if (len < UBIFS_INO_NODE_SZ)
+			return 1;
+		rn = replay_add_node(ctx, ch, lnum, offs);
+		key_read(ino->key, &rn->key);
+		rn->deletion = !ino->nlink;
+		break;
+	}
+	case UBIFS_DATA_NODE: {
+		struct ubifs_data_node *dn = node;
+
+		if (len < UBIFS_DATA_NODE_SZ)
+			return 1;
+		rn = replay_add_node(ctx, ch, lnum, offs);
+		key_read(dn->key, &rn->key);
+		break;
+	}
+	case UBIFS_DENT_NODE: {
+		struct ubifs_dent_node *dent = node;
+		int nlen = le16_to_cpu(dent->nlen);
+
+		if (len < UBIFS_DENT_NODE_SZ + nlen + 1 ||
+				nlen > UBIFS_MAX_NLEN)
+			return 1;
+		rn = replay_add_node(ctx, ch, lnum, offs);
+		key_read(dent->key, &rn->key);
+		rn->deletion = !dent->inum;
+		rn->name = xmalloc(nlen);
+		memcpy(rn->name, dent->name, nlen);
+		rn->nlen = nlen;
+		break;
+	}
+	case UBIFS_TRUN_NODE: {
+		struct ubifs_trun_node *trun = node;
+
+		if (len < UBIFS_TRUN_NODE_SZ)
+			return 1;
+		rn = replay_add_node(ctx, ch, lnum, offs);
+		ino_key_init(&rn->key, le32_to_cpu(trun->inum));
+		rn->old_size = le64_to_cpu(trun->old_size);
+		rn->new_size = le64_to_cpu(trun->new_size);
+		break;
+	}
+	default:
+		/* extended attributes are not supported */
+		return 0;
+	}
+
+	/*
+	 * Nodes of a group (e.g. a directory entry and its inode) are only
+	 * valid when the whole group made it to the flash.
+	 */
+	switch (ch->group_type) {
+	case UBIFS_IN_NODE_GROUP:
+		if (ctx->group_start < 0)
+			ctx->group_start = ctx->cnt - 1;
+		break;
+	case UBIFS_LAST_OF_NODE_GROUP:
+	default:
+		ctx->group_start = -1;
+		break;
+	}
+
+	return 0;
+}
+
+static int replay_log_node(struct ubifs_info *c, void *node, int lnum,
+			   int offs, void *_ctx)
+{
+	struct replay_ctx *ctx = _ctx;
+	struct ubifs_ch *ch = node;
+	unsigned long long sqnum = le64_to_cpu(ch->sqnum);
+
+	if (ctx->first) {
+		struct ubifs_cs_node *cs = node;
+
+		ctx->first = 0;
+
+		if (ch->node_type != UBIFS_CS_NODE || offs != 0 ||
+				le64_to_cpu(cs->cmt_no) != c->cmt_no) {
+			ubifs_err(c, "no commit start node in log LEB %d\n",
+					lnum);
+			return -EINVAL;
+		}
+
+		c->cs_sqnum = sqnum;
+		return 0;
+	}
+
+	/* anything older than the commit start node belongs to an old log */
+	if (sqnum < c->cs_sqnum || ch->node_type == UBIFS_CS_NODE) {
+		ctx->end = 1;
+		return 1;
+	}
+
+	if (ch->node_type == UBIFS_REF_NODE) {
+		struct ubifs_ref_node *ref = node;
+		struct replay_bud *bud;
+		int bud_lnum = le32_to_cpu(ref->lnum);
+		int bud_offs = le32_to_cpu(ref->offs);
+
+		if (bud_lnum < c->main_first || bud_lnum >= c->leb_cnt ||
+				bud_offs < 0 || bud_offs >= c->leb_size ||
+				bud_offs & 7) {
+			ubifs_err(c, "bad reference node at %d:%d\n",
+					lnum, offs);
+			return -EINVAL;
+		}
+
+		bud = xzalloc(sizeof(*bud));
+		bud->lnum = bud_lnum;
+		bud->offs = bud_offs;
+		list_add_tail(&bud->list, &ctx->buds);
+	}
+
+	return 0;
+}
+
+static int replay_node_cmp(const void *a, const void *b)
+{
+	const struct replay_node *ra = a, *rb = b;
+
+	if (ra->sqnum < rb->sqnum)
+		return -1;
+	if (ra->sqnum > rb->sqnum)
+		return 1;
+	return 0;
+}
+
+/*
+ * Replay the journal which starts with the commit start node in LEB
+ * @log_lnum.
+ */
+int ubifs_replay_journal(struct ubifs_info *c, int log_lnum)
+{
+	struct replay_ctx ctx;
+	struct replay_bud *bud, *tmp;
+	int lnum = log_lnum, ret, i;
+
+	memset(&ctx, 0, sizeof(ctx));
+	INIT_LIST_HEAD(&ctx.buds);
+	ctx.first = 1;
+
+	c->replay_tree = RB_ROOT;
+	INIT_LIST_HEAD(&c->replay_ranges);
+
+	do {
+		ret = ubifs_scan_leb(c, lnum, 0, replay_log_node, &ctx);
+		if (ret < 0)
+			goto out;
+		if (ctx.first) {
+			ubifs_err(c, "empty log LEB %d\n", lnum);
+			ret = -EINVAL;
+			goto out;
+		}
+		if (ctx.end || ret == 0)
+			break;
+
+		lnum++;
+		if (lnum > c->log_last)
+			lnum = UBIFS_LOG_LNUM;
+	} while (lnum != log_lnum);
+
+	list_for_each_entry(bud, &ctx.buds, list) {
+		ctx.group_start = -1;
+
+		ret = ubifs_scan_leb(c, bud->lnum, bud->offs, replay_bud_node,
+				&ctx);
+		if (ret < 0)
+			goto out;
+
+		if (ctx.group_start >= 0)
+			replay_drop_nodes(&ctx, ctx.group_start);
+	}
+
+	qsort(ctx.nodes, ctx.cnt, sizeof(struct replay_node),
+			replay_node_cmp);
+
+	for (i = 0; i < ctx.cnt; i++)
+		replay_apply(c, &ctx.nodes[i]);
+
+	if (ctx.cnt)
+		dev_dbg(c->dev, "replayed %d journal nodes\n", ctx.cnt);
+
+	ret = 0;
+out:
+	replay_drop_nodes(&ctx, 0);
+	free(ctx.nodes);
+
+	list_for_each_entry_safe(bud, tmp, &ctx.buds, list)
+		free(bud);
+
+	return ret;
+}
+
+void ubifs_replay_free(struct ubifs_info *c)
+{
+	struct replay_range *range, *tmp;
+	struct rb_node *n;
+
+	while ((n = rb_first(&c->replay_tree)))
+		replay_free_entry(c, rb_entry(n, struct replay_entry, rb));
+
+	list_for_each_entry_safe(range, tmp, &c->replay_ranges, list)
+		free(range);
+}
@@ -0,0 +1,343 @@
+/*
+ * tnc.c - UBIFS index lookup and index node cache
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * The committed index is a B+ tree of index nodes. Index nodes are read from
+ * flash the first time they are needed and are then kept in memory, linked
+ * from their parent branch, so that repeated lookups in the same area of the
+ * tree (e.g. reading the data blocks of a file) do not touch the flash again.
+ * When more than UBIFS_TNC_CACHE_MAX index nodes are cached everything but
+ * the root is dropped before the next lookup starts.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <errno.h>
+#include <string.h>
+#include "ubifs.h"
+
+static struct ubifs_znode *tnc_read_znode(struct ubifs_info *c, int lnum,
+					  int offs, int len, int level)
+{
+	struct ubifs_idx_node *idx = c->idx_buf;
+	struct ubifs_znode *znode;
+	int i, child_cnt, ret;
+
+	if (len > c->max_idx_node_sz) {
+		ubifs_err(c, "bad index node length %d at %d:%d\n",
+				len, lnum, offs);
+		return ERR_PTR(-EUCLEAN);
+	}
+
+	ret = ubifs_read_node(c, idx, UBIFS_IDX_NODE, len, lnum, offs);
+	if (ret)
+		return ERR_PTR(ret);
+
+	child_cnt = le16_to_cpu(idx->child_cnt);
+	if (child_cnt < 1 || child_cnt > c->fanout ||
+			UBIFS_IDX_NODE_SZ + child_cnt * c->branch_sz > len ||
+			(level >= 0 && le16_to_cpu(idx->level) != level)) {
+		ubifs_err(c, "bad index node at %d:%d\n", lnum, offs);
+		return ERR_PTR(-EUCLEAN);
+	}
+
+	znode = xzalloc(sizeof(*znode) +
+			child_cnt * sizeof(struct ubifs_zbranch));
+	znode->level = le16_to_cpu(idx->level);
+	znode->child_cnt = child_cnt;
+
+	for (i = 0; i < child_cnt; i++) {
+		struct ubifs_branch *br = (void *)idx->branches +
+			i * c->branch_sz;
+		struct ubifs_zbranch *zbr = &znode->zbranch[i];
+
+		key_read(br->key, &zbr->key);
+		zbr->lnum = le32_to_cpu(br->lnum);
+		zbr->offs = le32_to_cpu(br->offs);
+		zbr->len = le32_to_cpu(br->len);
+	}
+
+	return znode;
+}
+
+static void tnc_free_children(struct ubifs_info *c, struct ubifs_znode *znode)
+{
+	int i;
+
+	if (!znode->level)
+		return;
+
+	for (i = 0; i < znode->child_cnt; i++) {
+		struct ubifs_zbranch *zbr = &znode->zbranch[i];
+
+		if (!zbr->znode)
+			continue;
+
+		tnc_free_children(c, zbr->znode);
+		free(zbr->znode);
+		zbr->znode = NULL;
+		c->znode_cnt--;
+	}
+}
+
+static struct ubifs_znode *tnc_get_child(struct ubifs_info *c,
+					 struct ubifs_znode *znode, int n)
+{
+	struct ubifs_zbranch *zbr = &znode->zbranch[n];
+	struct ubifs_znode *child;
+
+	if (zbr->znode)
+		return zbr->znode;
+
+	child = tnc_read_znode(c, zbr->lnum, zbr->offs, zbr->len,
+			znode->level - 1);
+	if (IS_ERR(child))
+		return child;
+
+	zbr->znode = child;
+	c->znode_cnt++;
+
+	return child;
+}
+
+int ubifs_tnc_init(struct ubifs_info *c, int lnum, int offs, int len)
+{
+	struct ubifs_znode *root;
+
+	root = tnc_read_znode(c, lnum, offs, len, -1);
+	if (IS_ERR(root))
+		return PTR_ERR(root);
+
+	if (root->level >= UBIFS_TNC_MAX_DEPTH) {
+		ubifs_err(c, "index too deep (%d levels)\n", root->level);
+		free(root);
+		return -EINVAL;
+	}
+
+	c->zroot = root;
+	c->znode_cnt = 0;
+
+	return 0;
+}
+
+void ubifs_tnc_close(struct ubifs_info *c)
+{
+	if (!c->zroot)
+		return;
+
+	tnc_free_children(c, c->zroot);
+	free(c->zroot);
+	c->zroot = NULL;
+}
+
+/*
+ * Find the last branch in @znode whose key is strictly smaller than @key, or
+ * 0 if there is none.
+ */
+static int tnc_search(struct ubifs_znode *znode, const union ubifs_key *key)
+{
+	int beg = 0, end = znode->child_cnt;
+
+	while (end - beg > 1) {
+		int mid = (beg + end) >> 1;
+
+		if (keys_cmp(&znode->zbranch[mid].key, key) < 0)
+			beg = mid;
+		else
+			end = mid;
+	}
+
+	return beg;
+}
+
+/*
+ * Position @cur at the first leaf whose key is greater than or equal to @key.
+ * Several directory entries may share a key (hash collisions) and these may
+ * be spread over neighbouring index nodes; this positions at the first of
+ * them. Returns -ENOENT when there is no such leaf.
+ */
+int ubifs_tnc_seek(struct ubifs_info *c, struct ubifs_cursor *cur,
+		   const union ubifs_key *key)
+{
+	struct ubifs_znode *znode;
+	int n;
+
+	if (c->znode_cnt > UBIFS_TNC_CACHE_MAX)
+		tnc_free_children(c, c->zroot);
+
+	znode = c->zroot;
+	cur->depth = 0;
+
+	while (1) {
+		n = tnc_search(znode, key);
+
+		cur->znode[cur->depth] = znode;
+		cur->n[cur->depth] = n;
+		cur->depth++;
+
+		if (!znode->level)
+			break;
+
+		znode = tnc_get_child(c, znode, n);
+		if (IS_ERR(znode))
+			return PTR_ERR(znode);
+	}
+
+	if (keys_cmp(&znode->zbranch[n].key, key) < 0)
+		return ubifs_tnc_next(c, cur);
+
+	return 0;
+}
+
+/*
+ * Advance @cur to the next leaf in key order. Returns -ENOENT at the end of
+ * the index.
+ */
+int ubifs_tnc_next(struct ubifs_info *c, struct ubifs_cursor *cur)
+{
+	int d = cur->depth - 1;
+
+	while (d >= 0) {
+		if (cur->n[d] + 1 < cur->znode[d]->child_cnt) {
+			cur->n[d]++;
+			break;
+		}
+		d--;
+	}
+
+	if (d < 0)
+		return -ENOENT;
+
+	for (; d < cur->depth - 1; d++) {
+		struct ubifs_znode *child;
+
+		child = tnc_get_child(c, cur->znode[d], cur->n[d]);
+		if (IS_ERR(child))
+			return PTR_ERR(child);
+
+		cur->znode[d + 1] = child;
+		cur->n[d + 1] = 0;
+	}
+
+	return 0;
+}
+
+static int tnc_locate(struct ubifs_info *c, const union ubifs_key *key,
+		      struct ubifs_zbranch *zbr)
+{
+	struct ubifs_cursor cur;
+	int ret;
+
+	ret = ubifs_replay_lookup(c, key, NULL, 0, zbr);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
+	ret = ubifs_tnc_seek(c, &cur, key);
+	if (ret)
+		return ret;
+
+	if (keys_cmp(&ubifs_cursor_zbr(&cur)->key, key))
+		return -ENOENT;
+
+	*zbr = *ubifs_cursor_zbr(&cur);
+
+	return 0;
+}
+
+/*
+ * Look up the leaf node with key @key (not a directory entry) and read it
+ * into @node, which is @max_len bytes long. The node must be of type @type.
+ */
+int ubifs_tnc_lookup(struct ubifs_info *c, const union ubifs_key *key,
+		     void *node, int type, int max_len)
+{
+	struct ubifs_zbranch zbr;
+	int ret;
+
+	ret = tnc_locate(c, key, &zbr);
+	if (ret)
+		return ret;
+
+	if (zbr.len > max_len) {
+		ubifs_err(c, "node at %d:%d too long (%d bytes)\n",
+				zbr.lnum, zbr.offs, zbr.len);
+		return -EUCLEAN;
+	}
+
+	return ubifs_read_node(c, node, type, zbr.len, zbr.lnum, zbr.offs);
+}
+
+static int dent_matches(const struct ubifs_dent_node *dent, const char *name,
+			int nlen)
+{
+	return le16_to_cpu(dent->nlen) == nlen &&
+		!memcmp(dent->name, name, nlen);
+}
+
+static int read_dent(struct ubifs_info *c, struct ubifs_zbranch *zbr,
+		     struct ubifs_dent_node *dent)
+{
+	int ret;
+
+	if (zbr->len > UBIFS_MAX_DENT_NODE_SZ || zbr->len < UBIFS_DENT_NODE_SZ)
+		return -EUCLEAN;
+
+	ret = ubifs_read_node(c, dent, UBIFS_DENT_NODE, zbr->len,
+			zbr->lnum, zbr->offs);
+	if (ret)
+		return ret;
+
+	if (UBIFS_DENT_NODE_SZ + le16_to_cpu(dent->nlen) + 1 > zbr->len)
+		return -EUCLEAN;
+
+	return 0;
+}
+
+/*
+ * Look up the directory entry @name with key @key and read it into @dent,
+ * which must be UBIFS_MAX_DENT_NODE_SZ bytes long.
+ */
+int ubifs_tnc_lookup_nm(struct ubifs_info *c, const union ubifs_key *key,
+			const char *name, int nlen,
+			struct ubifs_dent_node *dent)
+{
+	struct ubifs_cursor cur;
+	struct ubifs_zbranch zbr;
+	int ret;
+
+	ret = ubifs_replay_lookup(c, key, name, nlen, &zbr);
+	if (ret < 0)
+		return ret;
+	if (ret > 0)
+		return read_dent(c, &zbr, dent);
+
+	ret = ubifs_tnc_seek(c, &cur, key);
+
+	while (!ret) {
+		zbr = *ubifs_cursor_zbr(&cur);
+
+		if (keys_cmp(&zbr.key, key))
+			return -ENOENT;
+
+		ret = read_dent(c, &zbr, dent);
+		if (ret)
+			return ret;
+
+		if (dent_matches(dent, name, nlen))
+			return 0;
+
+		ret = ubifs_tnc_next(c, &cur);
+	}
+
+	return ret;
+}
@@ -0,0 +1,799 @@
+/*
+ * ubifs.c - read-only UBIFS filesystem driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * UBIFS is mounted on top of a UBI volume character device, e.g.:
+ *
+ *	mount /dev/ubi0.rootfs ubifs /mnt
+ *
+ * The committed index is read from flash on demand (see tnc.c), the journal
+ * is replayed into memory on mount (see replay.c). Nothing is ever written
+ * to the volume.
+ */
+
+#include <common.h>
+#include <driver.h>
+#include <init.h>
+#include <malloc.h>
+#include <fs.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <xfuncs.h>
+#include <libbb.h>
+#include <stringlist.h>
+#include <lzo.h>
+#include <linux/stat.h>
+#include "ubifs.h"
+
+struct ubifs_file {
+	unsigned long inum;
+};
+
+struct ubifs_dir {
+	DIR dir;
+	struct string_list names;
+	struct list_head *pos;
+};
+
+static uint32_t key_mask_hash(uint32_t hash)
+{
+	hash &= UBIFS_S_KEY_HASH_MASK;
+	if (hash <= 2)
+		hash += 3;
+	return hash;
+}
+
+static uint32_t key_r5_hash(const char *s, int len)
+{
+	const signed char *str = (const signed char *)s;
+	uint32_t a = 0;
+
+	while (len--) {
+		a += *str << 4;
+		a += *str >> 4;
+		a *= 11;
+		str++;
+	}
+
+	return key_mask_hash(a);
+}
+
+static uint32_t key_test_hash(const char *str, int len)
+{
+	uint32_t a = 0;
+
+	memcpy(&a, str, min(len, 4));
+
+	return key_mask_hash(le32_to_cpu(a));
+}
+
+void dent_key_init(const struct ubifs_info *c, union ubifs_key *key,
+		   unsigned long inum, const char *name, int len)
+{
+	uint32_t hash;
+
+	if (c->key_hash_type == UBIFS_KEY_HASH_TEST)
+		hash = key_test_hash(name, len);
+	else
+		hash = key_r5_hash(name, len);
+
+	key_init(key, inum, UBIFS_DENT_KEY, hash);
+}
+
+static int ubifs_decompress(struct ubifs_info *c, const void *in, int in_len,
+			    void *out, int *out_len, int compr_type)
+{
+	switch (compr_type) {
+	case UBIFS_COMPR_NONE:
+		if (in_len > *out_len)
+			return -EINVAL;
+		memcpy(out, in, in_len);
+		*out_len = in_len;
+		return 0;
+#ifdef CONFIG_FS_UBIFS_COMPRESSION_LZO
+	case UBIFS_COMPR_LZO: {
+		size_t len = *out_len;
+		int ret;
+
+		ret = lzo1x_decompress_safe(in, in_len, out, &len);
+		if (ret != LZO_E_OK)
+			return -EIO;
+		*out_len = len;
+		return 0;
+	}
+#endif
+#ifdef CONFIG_FS_UBIFS_COMPRESSION_ZLIB
+	case UBIFS_COMPR_ZLIB: {
+		z_stream *strm = &c->zstream;
+		int ret;
+
+		zlib_inflateReset(strm);
+		strm->next_in = in;
+		strm->avail_in = in_len;
+		strm->next_out = out;
+		strm->avail_out = *out_len;
+
+		ret = zlib_inflate(strm, Z_SYNC_FLUSH);
+
+		/*
+		 * In raw deflate mode zlib sometimes wants to see one more
+		 * byte before it reports the end of the stream.
+		 */
+		if (ret == Z_OK && !strm->avail_in && strm->avail_out) {
+			u8 zerostuff = 0;
+
+			strm->next_in = &zerostuff;
+			strm->avail_in = 1;
+			ret = zlib_inflate(strm, Z_FINISH);
+		}
+
+		if (ret != Z_OK && ret != Z_STREAM_END)
+			return -EIO;
+
+		*out_len = strm->total_out;
+		return 0;
+	}
+#endif
+	default:
+		ubifs_err(c, "compression type %d not supported\n",
+				compr_type);
+		return -ENOSYS;
+	}
+}
+
+static int ubifs_read_inode(struct ubifs_info *c, unsigned long inum,
+			    struct ubifs_ino_node *ino)
+{
+	union ubifs_key key;
+
+	ino_key_init(&key, inum);
+
+	return ubifs_tnc_lookup(c, &key, ino, UBIFS_INO_NODE,
+			UBIFS_MAX_INO_NODE_SZ);
+}
+
+/*
+ * Resolve @filename to an inode number. @filename is relative to the
+ * mount point.
+ */
+static int ubifs_lookup(struct ubifs_info *c, const char *filename,
+			unsigned long *inum)
+{
+	struct ubifs_dent_node *dent;
+	char *path, *name, *next;
+	int ret = 0;
+
+	dent = xmalloc(UBIFS_MAX_DENT_NODE_SZ);
+	path = xstrdup(filename);
+	*inum = UBIFS_ROOT_INO;
+
+	for (name = path; name; name = next) {
+		union ubifs_key key;
+		int nlen;
+
+		next = strchr(name, '/');
+		if (next)
+			*next++ = 0;
+
+		nlen = strlen(name);
+		if (!nlen)
+			continue;
+
+		if (nlen > UBIFS_MAX_NLEN) {
+			ret = -ENAMETOOLONG;
+			break;
+		}
+
+		dent_key_init(c, &key, *inum, name, nlen);
+
+		ret = ubifs_tnc_lookup_nm(c, &key, name, nlen, dent);
+		if (ret)
+			break;
+
+		if (next && dent->type != UBIFS_ITYPE_DIR) {
+			ret = -ENOTDIR;
+			break;
+		}
+
+		*inum = le64_to_cpu(dent->inum);
+	}
+
+	free(path);
+	free(dent);
+
+	return ret;
+}
+
+static int ubifs_stat(struct device_d *dev, const char *filename,
+		      struct stat *s)
+{
+	struct ubifs_info *c = dev->priv;
+	struct ubifs_ino_node *ino = c->data_buf;
+	unsigned long inum;
+	int ret;
+
+	ret = ubifs_lookup(c, filename, &inum);
+	if (ret)
+		return ret;
+
+	ret = ubifs_read_inode(c, inum, ino);
+	if (ret)
+		return ret;
+
+	s->st_ino = inum;
+	s->st_mode = le32_to_cpu(ino->mode);
+	s->st_nlink = le32_to_cpu(ino->nlink);
+	s->st_size = le64_to_cpu(ino->size);
+	s->st_mtime = le64_to_cpu(ino->mtime_sec);
+
+	return 0;
+}
+
+static int ubifs_open(struct device_d *dev, FILE *f, const char *filename)
+{
+	struct ubifs_info *c = dev->priv;
+	struct ubifs_ino_node *ino = c->data_buf;
+	struct ubifs_file *uf;
+	unsigned long inum;
+	int ret;
+
+	ret = ubifs_lookup(c, filename, &inum);
+	if (ret)
+		return ret;
+
+	ret = ubifs_read_inode(c, inum, ino);
+	if (ret)
+		return ret;
+
+	if (S_ISDIR(le32_to_cpu(ino->mode)))
+		return -EISDIR;
+
+	uf = xzalloc(sizeof(*uf));
+	uf->inum = inum;
+
+	f->inode = uf;
+	f->size = le64_to_cpu(ino->size);
+
+	return 0;
+}
+
+static int ubifs_close(struct device_d *dev, FILE *f)
+{
+	free(f->inode);
+
+	return 0;
+}
+
+/*
+ * Read data block @block of inode @inum into @buf, which must hold
+ * UBIFS_BLOCK_SIZE bytes. @zbr is the location of the data node or NULL
+ * for a hole.
+ */
+static int ubifs_read_block(struct ubifs_info *c, struct ubifs_zbranch *zbr,
+			    void *buf)
+{
+	struct ubifs_data_node *dn = c->data_buf;
+	int ret, len, dlen;
+
+	if (!zbr) {
+		memset(buf, 0, UBIFS_BLOCK_SIZE);
+		return 0;
+	}
+
+	if (zbr->len < UBIFS_DATA_NODE_SZ ||
+			zbr->len > UBIFS_MAX_DATA_NODE_SZ)
+		return -EUCLEAN;
+
+	ret = ubifs_read_node(c, dn, UBIFS_DATA_NODE, zbr->len, zbr->lnum,
+			zbr->offs);
+	if (ret)
+		return ret;
+
+	len = le32_to_cpu(dn->size);
+	if (len > UBIFS_BLOCK_SIZE)
+		return -EUCLEAN;
+
+	dlen = UBIFS_BLOCK_SIZE;
+	ret = ubifs_decompress(c, dn->data, zbr->len - UBIFS_DATA_NODE_SZ,
+			buf, &dlen, le16_to_cpu(dn->compr_type));
+	if (ret) {
+		ubifs_err(c, "cannot decompress data node at %d:%d\n",
+				zbr->lnum, zbr->offs);
+		return ret;
+	}
+
+	if (dlen != len) {
+		ubifs_err(c, "bad data node at %d:%d\n", zbr->lnum, zbr->offs);
+		return -EUCLEAN;
+	}
+
+	if (len < UBIFS_BLOCK_SIZE)
+		memset(buf + len, 0, UBIFS_BLOCK_SIZE - len);
+
+	return 0;
+}
+
+/*
+ * Find the data node of block @block. The data keys of an inode are
+ * adjacent in the index, so for sequential reads the cursor usually only
+ * has to be advanced by one. Returns NULL for holes.
+ */
+static struct ubifs_zbranch *ubifs_find_block(struct ubifs_info *c,
+					      struct ubifs_cursor *cur,
+					      int *cur_valid,
+					      unsigned long inum,
+					      unsigned int block,
+					      struct ubifs_zbranch *zbr)
+{
+	union ubifs_key key;
+	int ret;
+
+	data_key_init(&key, inum, block);
+
+	ret = ubifs_replay_lookup(c, &key, NULL, 0, zbr);
+	if (ret > 0)
+		return zbr;
+	if (ret < 0)
+		return NULL;
+
+	while (*cur_valid && keys_cmp(&ubifs_cursor_zbr(cur)->key, &key) < 0) {
+		ret = ubifs_tnc_next(c, cur);
+		if (ret == -ENOENT)
+			*cur_valid = 0;
+		else if (ret)
+			return ERR_PTR(ret);
+	}
+
+	if (*cur_valid && !keys_cmp(&ubifs_cursor_zbr(cur)->key, &key)) {
+		*zbr = *ubifs_cursor_zbr(cur);
+		return zbr;
+	}
+
+	return NULL;
+}
+
+static int ubifs_fs_pread(struct device_d *dev, FILE *f, void *buf,
+			  size_t insize, loff_t pos)
+{
+	struct ubifs_info *c = dev->priv;
+	struct ubifs_file *uf = f->inode;
+	struct ubifs_cursor cur;
+	struct ubifs_zbranch zbr;
+	union ubifs_key key;
+	unsigned int block = pos >> UBIFS_BLOCK_SHIFT;
+	int ofs = pos & (UBIFS_BLOCK_SIZE - 1);
+	int cur_valid, ret;
+	size_t size = insize;
+
+	data_key_init(&key, uf->inum, block);
+	ret = ubifs_tnc_seek(c, &cur, &key);
+	if (ret && ret != -ENOENT)
+		return ret;
+	cur_valid = !ret;
+
+	while (size) {
+		int now = min_t(size_t, size, UBIFS_BLOCK_SIZE - ofs);
+
+		if (c->block_inum != uf->inum || c->block_nr != block) {
+			struct ubifs_zbranch *z;
+
+			z = ubifs_find_block(c, &cur, &cur_valid, uf->inum,
+					block, &zbr);
+			if (IS_ERR(z))
+				return PTR_ERR(z);
+
+			if (now == UBIFS_BLOCK_SIZE) {
+				/* full block, decompress in place */
+				ret = ubifs_read_block(c, z, buf);
+				if (ret)
+					return ret;
+				goto next;
+			}
+
+			c->block_inum = 0;
+			ret = ubifs_read_block(c, z, c->block_buf);
+			if (ret)
+				return ret;
+			c->block_inum = uf->inum;
+			c->block_nr = block;
+		}
+
+		memcpy(buf, c->block_buf + ofs, now);
+next:
+		buf += now;
+		size -= now;
+		ofs = 0;
+		block++;
+	}
+
+	return insize;
+}
+
+static int ubifs_fs_read(struct device_d *dev, FILE *f, void *buf,
+			 size_t insize)
+{
+	return ubifs_fs_pread(dev, f, buf, insize, f->pos);
+}
+
+static loff_t ubifs_lseek(struct device_d *dev, FILE *f, loff_t pos)
+{
+	f->pos = pos;
+
+	return f->pos;
+}
+
+static int ubifs_add_dent(struct ubifs_info *c, const char *name, int nlen,
+			  void *ctx)
+{
+	struct ubifs_dir *dir = ctx;
+	char buf[UBIFS_MAX_NLEN + 1];
+
+	memcpy(buf, name, nlen);
+	buf[nlen] = 0;
+
+	return string_list_add(&dir->names, buf);
+}
+
+static int ubifs_collect_dents(struct ubifs_info *c, unsigned long inum,
+			       struct ubifs_dir *dir)
+{
+	struct ubifs_dent_node *dent;
+	struct ubifs_cursor cur;
+	union ubifs_key key;
+	int ret;
+
+	dent = xmalloc(UBIFS_MAX_DENT_NODE_SZ);
+
+	key_init(&key, inum, UBIFS_DENT_KEY, 0);
+	ret = ubifs_tnc_seek(c, &cur, &key);
+
+	while (!ret) {
+		struct ubifs_zbranch *zbr = ubifs_cursor_zbr(&cur);
+		struct ubifs_zbranch tmp;
+		int nlen;
+
+		if (key_inum(&zbr->key) != inum ||
+				key_type(&zbr->key) != UBIFS_DENT_KEY)
+			break;
+
+		if (zbr->len < UBIFS_DENT_NODE_SZ ||
+				zbr->len > UBIFS_MAX_DENT_NODE_SZ) {
+			ret = -EUCLEAN;
+			break;
+		}
+
+		ret = ubifs_read_node(c, dent, UBIFS_DENT_NODE, zbr->len,
+				zbr->lnum, zbr->offs);
+		if (ret)
+			break;
+
+		nlen = le16_to_cpu(dent->nlen);
+		if (nlen > UBIFS_MAX_NLEN ||
+				UBIFS_DENT_NODE_SZ + nlen + 1 > zbr->len) {
+			ret = -EUCLEAN;
+			break;
+		}
+
+		/* entries changed in the journal are added below */
+		if (!ubifs_replay_lookup(c, &zbr->key, (char *)dent->name,
+					nlen, &tmp))
+			ubifs_add_dent(c, (char *)dent->name, nlen, dir);
+
+		ret = ubifs_tnc_next(c, &cur);
+	}
+
+	free(dent);
+
+	if (ret && ret != -ENOENT)
+		return ret;
+
+	return ubifs_replay_for_each_dent(c, inum, ubifs_add_dent, dir);
+}
+
+static DIR *ubifs_opendir(struct device_d *dev, const char *pathname)
+{
+	struct ubifs_info *c = dev->priv;
+	struct ubifs_ino_node *ino = c->data_buf;
+	struct ubifs_dir *dir;
+	unsigned long inum;
+	int ret;
+
+	ret = ubifs_lookup(c, pathname, &inum);
+	if (ret)
+		return NULL;
+
+	ret = ubifs_read_inode(c, inum, ino);
+	if (ret)
+		return NULL;
+
+	if (!S_ISDIR(le32_to_cpu(ino->mode)))
+		return NULL;
+
+	dir = xzalloc(sizeof(*dir));
+	dir->dir.priv = dir;
+	string_list_init(&dir->names);
+
+	ret = ubifs_collect_dents(c, inum, dir);
+	if (ret) {
+		string_list_free(&dir->names);
+		free(dir);
+		return NULL;
+	}
+
+	dir->pos = &dir->names.list;
+
+	return &dir->dir;
+}
+
+static struct dirent *ubifs_readdir(struct device_d *dev, DIR *_dir)
+{
+	struct ubifs_dir *dir = _dir->priv;
+	struct string_list *entry;
+
+	dir->pos = dir->pos->next;
+	if (dir->pos == &dir->names.list)
+		return NULL;
+
+	entry = list_entry(dir->pos, struct string_list, list);
+	safe_strncpy(_dir->d.d_name, entry->str, sizeof(_dir->d.d_name));
+
+	return &_dir->d;
+}
+
+static int ubifs_closedir(struct device_d *dev, DIR *_dir)
+{
+	struct ubifs_dir *dir = _dir->priv;
+
+	string_list_free(&dir->names);
+	free(dir);
+
+	return 0;
+}
+
+static int ubifs_read_sb(struct ubifs_info *c)
+{
+	struct ubifs_sb_node *sb;
+	int ret, flags, fmt_version, lpt_lebs, orph_lebs;
+
+	sb = xmalloc(UBIFS_SB_NODE_SZ);
+
+	/* the real geometry is not known until the superblock is read */
+	c->leb_size = UBIFS_MIN_LEB_SZ;
+	c->leb_cnt = 1;
+
+	ret = ubifs_read_node(c, sb, UBIFS_SB_NODE, UBIFS_SB_NODE_SZ,
+			UBIFS_SB_LNUM, 0);
+	if (ret)
+		goto out;
+
+	ret = -EINVAL;
+
+	fmt_version = le32_to_cpu(sb->fmt_version);
+	if (fmt_version > UBIFS_FORMAT_VERSION &&
+			le32_to_cpu(sb->ro_compat_version) >
+			UBIFS_RO_COMPAT_VERSION) {
+		ubifs_err(c, "on-flash format version %d not supported\n",
+				fmt_version);
+		goto out;
+	}
+
+	flags = le32_to_cpu(sb->flags);
+	if (flags & (UBIFS_FLG_ENCRYPTION | UBIFS_FLG_AUTHENTICATION)) {
+		ubifs_err(c, "encrypted or authenticated UBIFS not supported\n");
+		goto out;
+	}
+
+	if (sb->key_fmt != UBIFS_SIMPLE_KEY_FMT ||
+			sb->key_hash > UBIFS_KEY_HASH_TEST) {
+		ubifs_err(c, "unsupported key format\n");
+		goto out;
+	}
+
+	c->key_hash_type = sb->key_hash;
+	c->min_io_size = le32_to_cpu(sb->min_io_size);
+	c->leb_size = le32_to_cpu(sb->leb_size);
+	c->leb_cnt = le32_to_cpu(sb->leb_cnt);
+	c->fanout = le32_to_cpu(sb->fanout);
+	c->log_lebs = le32_to_cpu(sb->log_lebs);
+	lpt_lebs = le32_to_cpu(sb->lpt_lebs);
+	orph_lebs = le32_to_cpu(sb->orph_lebs);
+
+	c->log_last = UBIFS_LOG_LNUM + c->log_lebs - 1;
+	c->main_first = c->log_last + 1 + lpt_lebs + orph_lebs;
+	c->branch_sz = UBIFS_BRANCH_SZ + UBIFS_SK_LEN;
+	c->max_idx_node_sz = UBIFS_IDX_NODE_SZ + c->fanout * c->branch_sz;
+
+	if (c->leb_size < UBIFS_MIN_LEB_SZ || c->min_io_size < 1 ||
+			c->leb_size % c->min_io_size ||
+			c->fanout < UBIFS_MIN_FANOUT || c->log_lebs < 2 ||
+			c->main_first >= c->leb_cnt ||
+			(loff_t)c->leb_cnt * c->leb_size > c->cdev->size) {
+		ubifs_err(c, "bad superblock\n");
+		goto out;
+	}
+
+	ret = 0;
+out:
+	free(sb);
+
+	return ret;
+}
+
+static int ubifs_mst_node(struct ubifs_info *c, void *node, int lnum,
+			  int offs, void *ctx)
+{
+	struct ubifs_mst_node *mst = ctx;
+	struct ubifs_ch *ch = node;
+
+	if (ch->node_type != UBIFS_MST_NODE ||
+			le32_to_cpu(ch->len) != UBIFS_MST_NODE_SZ)
+		return 0;
+
+	if (le64_to_cpu(ch->sqnum) > le64_to_cpu(mst->ch.sqnum))
+		memcpy(mst, node, UBIFS_MST_NODE_SZ);
+
+	return 0;
+}
+
+/*
+ * There are two copies of the master node area, each containing a sequence
+ * of master nodes. Use the newest valid master node found in either of them.
+ */
+static int ubifs_read_master(struct ubifs_info *c)
+{
+	struct ubifs_mst_node *mst;
+	int ret, lnum, root_lnum, root_offs, root_len, log_lnum;
+
+	mst = xzalloc(UBIFS_MST_NODE_SZ);
+
+	for (lnum = UBIFS_MST_LNUM; lnum < UBIFS_LOG_LNUM; lnum++) {
+		ret = ubifs_scan_leb(c, lnum, 0, ubifs_mst_node, mst);
+		if (ret < 0)
+			goto out;
+	}
+
+	ret = -EINVAL;
+
+	if (!mst->ch.sqnum) {
+		ubifs_err(c, "no valid master node found\n");
+		goto out;
+	}
+
+	root_lnum = le32_to_cpu(mst->root_lnum);
+	root_offs = le32_to_cpu(mst->root_offs);
+	root_len = le32_to_cpu(mst->root_len);
+	log_lnum = le32_to_cpu(mst->log_lnum);
+
+	if (log_lnum < UBIFS_LOG_LNUM || log_lnum > c->log_last ||
+			root_lnum < c->main_first || root_lnum >= c->leb_cnt ||
+			root_offs < 0 || root_offs + root_len > c->leb_size) {
+		ubifs_err(c, "bad master node\n");
+		goto out;
+	}
+
+	c->cmt_no = le64_to_cpu(mst->cmt_no);
+
+	ret = ubifs_tnc_init(c, root_lnum, root_offs, root_len);
+	if (ret)
+		goto out;
+
+	ret = ubifs_replay_journal(c, log_lnum);
+	if (ret)
+		ubifs_tnc_close(c);
+out:
+	free(mst);
+
+	return ret;
+}
+
+static void ubifs_free(struct ubifs_info *c)
+{
+#ifdef CONFIG_FS_UBIFS_COMPRESSION_ZLIB
+	if (c->zstream.workspace) {
+		zlib_inflateEnd(&c->zstream);
+		free(c->zstream.workspace);
+	}
+#endif
+	free(c->sbuf);
+	free(c->idx_buf);
+	free(c->data_buf);
+	free(c->block_buf);
+	free(c);
+}
+
+static int ubifs_probe(struct device_d *dev)
+{
+	struct fs_device_d *fsdev = dev_to_fs_device(dev);
+	char *backingstore = fsdev->backingstore;
+	struct ubifs_info *c;
+	int ret;
+
+	c = xzalloc(sizeof(*c));
+	c->dev = dev;
+	dev->priv = c;
+
+	if (!strncmp(backingstore, "/dev/", 5))
+		backingstore += 5;
+
+	c->cdev = cdev_open(backingstore, O_RDONLY);
+	if (!c->cdev) {
+		ret = -ENOENT;
+		goto err_open;
+	}
+
+	ret = ubifs_read_sb(c);
+	if (ret)
+		goto err;
+
+	c->sbuf = xmalloc(c->leb_size);
+	c->idx_buf = xmalloc(c->max_idx_node_sz);
+	c->data_buf = xmalloc(UBIFS_MAX_INO_NODE_SZ);
+	c->block_buf = xmalloc(UBIFS_BLOCK_SIZE);
+
+#ifdef CONFIG_FS_UBIFS_COMPRESSION_ZLIB
+	c->zstream.workspace = xmalloc(zlib_inflate_workspacesize());
+	zlib_inflateInit2(&c->zstream, -MAX_WBITS);
+#endif
+
+	ret = ubifs_read_master(c);
+	if (ret)
+		goto err;
+
+	/* LEBs are only scanned while mounting */
+	free(c->sbuf);
+	c->sbuf = NULL;
+
+	return 0;
+
+err:
+	dev_info(dev, "no valid ubifs found\n");
+	cdev_close(c->cdev);
+err_open:
+	ubifs_free(c);
+
+	return ret;
+}
+
+static void ubifs_remove(struct device_d *dev)
+{
+	struct ubifs_info *c = dev->priv;
+
+	ubifs_replay_free(c);
+	ubifs_tnc_close(c);
+	cdev_close(c->cdev);
+	ubifs_free(c);
+}
+
+static struct fs_driver_d ubifs_driver = {
+	.open		= ubifs_open,
+	.close		= ubifs_close,
+	.read		= ubifs_fs_read,
+	.pread		= ubifs_fs_pread,
+	.lseek		= ubifs_lseek,
+	.opendir	= ubifs_opendir,
+	.readdir	= ubifs_readdir,
+	.closedir	= ubifs_closedir,
+	.stat		= ubifs_stat,
+	.drv = {
+		.probe = ubifs_probe,
+		.remove = ubifs_remove,
+		.name = "ubifs",
+	}
+};
+
+static int ubifs_init(void)
+{
+	return register_fs_driver(&ubifs_driver);
+}
+
+device_initcall(ubifs_init);
@@ -0,0 +1,220 @@
+/*
+ * ubifs.h - read-only UBIFS implementation, private definitions
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef __UBIFS_H__
+#define __UBIFS_H__
+
+#include <common.h>
+#include <driver.h>
+#include <linux/err.h>
+#include <linux/list.h>
+#include <linux/rbtree.h>
+#include <linux/zlib.h>
+#include "ubifs-media.h"
+
+#define ubifs_err(c, fmt, arg...) \
+	dev_err((c)->dev, fmt, ##arg)
+
+/*
+ * Maximum depth of the index we are prepared to walk and the number of
+ * index nodes we keep cached before the cache is dropped again.
+ */
+#define UBIFS_TNC_MAX_DEPTH	32
+#define UBIFS_TNC_CACHE_MAX	1024
+
+union ubifs_key {
+	uint32_t u32[2];
+};
+
+/**
+ * struct ubifs_zbranch - a branch of an in-memory index node
+ * @key: key of the branch
+ * @znode: the cached child index node (level > 0 only)
+ * @lnum: LEB number of the target node
+ * @offs: offset within @lnum
+ * @len: target node length
+ */
+struct ubifs_zbranch {
+	union ubifs_key key;
+	struct ubifs_znode *znode;
+	int lnum;
+	int offs;
+	int len;
+};
+
+/**
+ * struct ubifs_znode - in-memory copy of an on-flash index node
+ * @level: level in the tree, 0 for the nodes pointing to leaf nodes
+ * @child_cnt: number of valid entries in @zbranch
+ * @zbranch: the branches
+ */
+struct ubifs_znode {
+	int level;
+	int child_cnt;
+	struct ubifs_zbranch zbranch[];
+};
+
+/**
+ * struct ubifs_cursor - position in the index
+ * @depth: number of valid entries in @znode and @n
+ * @znode: the path of index nodes from the root downwards
+ * @n: the branch taken in each of the index nodes
+ */
+struct ubifs_cursor {
+	int depth;
+	struct ubifs_znode *znode[UBIFS_TNC_MAX_DEPTH];
+	int n[UBIFS_TNC_MAX_DEPTH];
+};
+
+struct ubifs_info {
+	struct device_d *dev;
+	struct cdev *cdev;
+
+	int leb_size;
+	int leb_cnt;
+	int min_io_size;
+	int fanout;
+	int log_lebs;
+	int log_last;
+	int main_first;
+	int key_hash_type;
+	int branch_sz;
+	int max_idx_node_sz;
+	unsigned long long cmt_no;
+	unsigned long long cs_sqnum;
+
+	struct ubifs_znode *zroot;
+	int znode_cnt;
+
+	/* journal nodes not yet reflected in the committed index */
+	struct rb_root replay_tree;
+	struct list_head replay_ranges;
+
+	void *sbuf;		/* LEB sized scan buffer */
+	void *idx_buf;		/* index node buffer */
+	void *data_buf;		/* data node buffer */
+	void *block_buf;	/* one uncompressed block */
+	unsigned long block_inum;
+	unsigned int block_nr;
+	int block_len;
+
+#ifdef CONFIG_FS_UBIFS_COMPRESSION_ZLIB
+	z_stream zstream;
+#endif
+};
+
+/* key handling */
+static inline int keys_cmp(const union ubifs_key *key1,
+			   const union ubifs_key *key2)
+{
+	if (key1->u32[0] < key2->u32[0])
+		return -1;
+	if (key1->u32[0] > key2->u32[0])
+		return 1;
+	if (key1->u32[1] < key2->u32[1])
+		return -1;
+	if (key1->u32[1] > key2->u32[1])
+		return 1;
+
+	return 0;
+}
+
+static inline void key_read(const void *from, union ubifs_key *to)
+{
+	const __le32 *f = from;
+
+	to->u32[0] = le32_to_cpu(f[0]);
+	to->u32[1] = le32_to_cpu(f[1]);
+}
+
+static inline void key_init(union ubifs_key *key, unsigned long inum,
+			    int type, uint32_t block_or_hash)
+{
+	key->u32[0] = inum;
+	key->u32[1] = (block_or_hash & UBIFS_S_KEY_BLOCK_MASK) |
+		(type << UBIFS_S_KEY_BLOCK_BITS);
+}
+
+static inline void ino_key_init(union ubifs_key *key, unsigned long inum)
+{
+	key_init(key, inum, UBIFS_INO_KEY, 0);
+}
+
+static inline void data_key_init(union ubifs_key *key, unsigned long inum,
+				 unsigned int block)
+{
+	key_init(key, inum, UBIFS_DATA_KEY, block);
+}
+
+static inline unsigned long key_inum(const union ubifs_key *key)
+{
+	return key->u32[0];
+}
+
+static inline int key_type(const union ubifs_key *key)
+{
+	return key->u32[1] >> UBIFS_S_KEY_BLOCK_BITS;
+}
+
+static inline unsigned int key_block(const union ubifs_key *key)
+{
+	return key->u32[1] & UBIFS_S_KEY_BLOCK_MASK;
+}
+
+void dent_key_init(const struct ubifs_info *c, union ubifs_key *key,
+		   unsigned long inum, const char *name, int len);
+
+/* io.c */
+int ubifs_read(struct ubifs_info *c, int lnum, int offs, int len, void *buf);
+int ubifs_check_node(struct ubifs_info *c, const void *buf, int len,
+		     int lnum, int offs);
+int ubifs_read_node(struct ubifs_info *c, void *buf, int type, int len,
+		    int lnum, int offs);
+int ubifs_scan_leb(struct ubifs_info *c, int lnum, int offs,
+		   int (*fn)(struct ubifs_info *c, void *node, int lnum,
+			     int offs, void *ctx),
+		   void *ctx);
+
+/* tnc.c */
+int ubifs_tnc_init(struct ubifs_info *c, int lnum, int offs, int len);
+void ubifs_tnc_close(struct ubifs_info *c);
+int ubifs_tnc_seek(struct ubifs_info *c, struct ubifs_cursor *cur,
+		   const union ubifs_key *key);
+int ubifs_tnc_next(struct ubifs_info *c, struct ubifs_cursor *cur);
+
+static inline struct ubifs_zbranch *ubifs_cursor_zbr(struct ubifs_cursor *cur)
+{
+	struct ubifs_znode *znode = cur->znode[cur->depth - 1];
+
+	return &znode->zbranch[cur->n[cur->depth - 1]];
+}
+
+int ubifs_tnc_lookup(struct ubifs_info *c, const union ubifs_key *key,
+		     void *node, int type, int max_len);
+int ubifs_tnc_lookup_nm(struct ubifs_info *c, const union ubifs_key *key,
+			const char *name, int nlen,
+			struct ubifs_dent_node *dent);
+
+/* replay.c */
+int ubifs_replay_journal(struct ubifs_info *c, int log_lnum);
+void ubifs_replay_free(struct ubifs_info *c);
+int ubifs_replay_lookup(struct ubifs_info *c, const union ubifs_key *key,
+			const char *name, int nlen,
+			struct ubifs_zbranch *zbr);
+int ubifs_replay_for_each_dent(struct ubifs_info *c, unsigned long inum,
+			       int (*fn)(struct ubifs_info *c,
+					 const char *name, int nlen,
+					 void *ctx),
+			       void *ctx);
+
+#endif /* __UBIFS_H__ */
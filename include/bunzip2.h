@@ -1,10 +1,11 @@
 #ifndef DECOMPRESS_BUNZIP2_H
 #define DECOMPRESS_BUNZIP2_H
 
-int bunzip2(unsigned char *inbuf, int len,
-	    int(*fill)(void*, unsigned int),
-	    int(*flush)(void*, unsigned int),
-	    unsigned char *output,
-	    int *pos,
-	    void(*error)(char *x));
+struct uncompress_ctx;
+
+int bunzip2_stream_init(struct uncompress_ctx *ctx);
+int bunzip2_stream_read(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len);
+void bunzip2_stream_exit(struct uncompress_ctx *ctx);
+int bunzip2_stream_unused(struct uncompress_ctx *ctx);
 #endif
@@ -110,6 +110,7 @@ void __noreturn hang (void);
 void __noreturn panic(const char *fmt, ...);
 
 char *size_human_readable(ulong size);
+void print_rate(const char *what, uint64_t bytes, uint64_t ns);
 
 /* common/main.c */
 int	run_command	(const char *cmd, int flag);
@@ -25,7 +25,9 @@
 
 #include <linux/list.h>
 
-struct digest
+struct digest;
+
+struct digest_algo
 {
 	char *name;
 
@@ -34,17 +36,53 @@ struct digest
 	int (*final)(struct digest *d, unsigned char *md);
 
 	unsigned int length;
+	/* size of the per operation context, allocated by digest_alloc() */
+	unsigned int ctx_length;
 
 	struct list_head list;
 };
 
+/*
+ * A single digest operation. Each one has its own context, so several
+ * of them may be in progress at the same time.
+ */
+struct digest
+{
+	struct digest_algo *algo;
+	void *ctx;
+};
+
 /*
  * digest functions
  */
-int digest_register(struct digest *d);
-void digest_unregister(struct digest *d);
+int digest_algo_register(struct digest_algo *d);
+void digest_algo_unregister(struct digest_algo *d);
+
+struct digest_algo *digest_algo_get_by_name(const char *name);
 
-struct digest* digest_get_by_name(char* name);
+struct digest *digest_alloc(const char *name);
+void digest_free(struct digest *d);
+
+static inline int digest_init(struct digest *d)
+{
+	return d->algo->init(d);
+}
+
+static inline int digest_update(struct digest *d, const void *data,
+				unsigned long len)
+{
+	return d->algo->update(d, data, len);
+}
+
+static inline int digest_final(struct digest *d, unsigned char *md)
+{
+	return d->algo->final(d, md);
+}
+
+static inline unsigned int digest_length(struct digest *d)
+{
+	return d->algo->length;
+}
 
 int digest_file_window(struct digest *d, char *filename,
 		       unsigned char *hash,
@@ -13,6 +13,14 @@
 
 #include <asm/dma.h>
 
+/*
+ * The alignment buffers need for DMA, usually the cache line size. Buffers
+ * from dma_alloc() are aligned like this.
+ */
+#ifndef DMA_ALIGNMENT
+#define DMA_ALIGNMENT	32
+#endif
+
 #ifndef dma_alloc
 static inline void *dma_alloc(size_t size)
 {
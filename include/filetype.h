@@ -18,6 +18,8 @@ enum filetype {
 	filetype_aimage,
 	filetype_sh,
 	filetype_mips_barebox,
+	filetype_lz4_compressed,
+	filetype_xz_compressed,
 };
 
 const char *file_type_to_string(enum filetype f);
@@ -53,6 +53,11 @@ struct fs_driver_d {
 	int (*close)(struct device_d *dev, FILE *f);
 	int (*read)(struct device_d *dev, FILE *f, void *buf, size_t size);
 	int (*write)(struct device_d *dev, FILE *f, const void *buf, size_t size);
+	/* optional, read/write at a given position without changing f->pos */
+	int (*pread)(struct device_d *dev, FILE *f, void *buf, size_t size,
+			loff_t pos);
+	int (*pwrite)(struct device_d *dev, FILE *f, const void *buf,
+			size_t size, loff_t pos);
 	int (*flush)(struct device_d *dev, FILE *f);
 	loff_t (*lseek)(struct device_d *dev, FILE *f, loff_t pos);
 
@@ -104,6 +109,8 @@ int stat(const char *filename, struct stat *s);
 int read(int fd, void *buf, size_t count);
 int ioctl(int fd, int request, void *buf);
 ssize_t write(int fd, const void *buf, size_t count);
+ssize_t pread(int fd, void *buf, size_t count, loff_t offset);
+ssize_t pwrite(int fd, const void *buf, size_t count, loff_t offset);
 
 #define SEEK_SET	1
 #define SEEK_CUR	2
@@ -1,10 +1,11 @@
 #ifndef GUNZIP_H
 #define GUNZIP_H
 
-int gunzip(unsigned char *inbuf, int len,
-	   int(*fill)(void*, unsigned int),
-	   int(*flush)(void*, unsigned int),
-	   unsigned char *output,
-	   int *pos,
-	   void(*error_fn)(char *x));
+struct uncompress_ctx;
+
+int gunzip_stream_init(struct uncompress_ctx *ctx);
+int gunzip_stream_read(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len);
+void gunzip_stream_exit(struct uncompress_ctx *ctx);
+int gunzip_stream_unused(struct uncompress_ctx *ctx);
 #endif
@@ -165,6 +165,9 @@
 #define IH_COMP_NONE		0	/*  No	 Compression Used	*/
 #define IH_COMP_GZIP		1	/* gzip	 Compression Used	*/
 #define IH_COMP_BZIP2		2	/* bzip2 Compression Used	*/
+#define IH_COMP_LZMA		3	/* lzma  Compression Used	*/
+#define IH_COMP_LZO		4	/* lzo   Compression Used	*/
+#define IH_COMP_LZ4		5	/* lz4   Compression Used	*/
 
 #define IH_MAGIC	0x27051956	/* Image Magic Number		*/
 #define IH_NMLEN		32	/* Image Name Length		*/
@@ -244,6 +247,9 @@ struct uimage_handle {
 	int nb_data_entries;
 	size_t data_offset;
 	int fd;
+	int verify;	/* check the data crc while loading */
+	uint32_t dcrc;	/* crc of the first dcrc_len bytes of data */
+	size_t dcrc_len;
 };
 
 #define UIMAGE_INVALID_ADDRESS	(~0)
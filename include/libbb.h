@@ -26,7 +26,17 @@ int recursive_action(const char *fileName, unsigned flags,
 
 char * safe_strncpy(char *dst, const char *src, size_t size);
 
+struct digest;
+
+#define COPY_FILE_VERBOSE	(1 << 0)	/* show a progress bar */
+#define COPY_FILE_UNCOMPRESS	(1 << 1)	/* uncompress the source */
+#define COPY_FILE_ERASE		(1 << 2)	/* erase the destination flash */
+
 int copy_file(const char *src, const char *dst, int verbose);
+int copy_file_digest(const char *src, const char *dst, int verbose,
+		struct digest **digests, int num_digests);
+int copy_file_flags(const char *src, const char *dst, unsigned flags,
+		struct digest **digests, int num_digests);
 
 int process_escape_sequence(const char *source, char *dest, int destlen);
 
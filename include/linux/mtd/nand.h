@@ -86,6 +86,8 @@ extern void nand_wait_ready(struct mtd_info *mtd);
 #define NAND_CMD_READSTART	0x30
 #define NAND_CMD_RNDOUTSTART	0xE0
 #define NAND_CMD_CACHEDPROG	0x15
+#define NAND_CMD_READCACHESEQ	0x31
+#define NAND_CMD_READCACHEEND	0x3f
 
 /* Extended commands for AG-AND device */
 /*
@@ -115,6 +117,13 @@ extern void nand_wait_ready(struct mtd_info *mtd);
 #define NAND_STATUS_READY	0x40
 #define NAND_STATUS_WP		0x80
 
+/*
+ * Number of pages kept in the page cache and the maximum number of pages
+ * read ahead when a sequential read is detected
+ */
+#define NAND_PAGECACHE_PAGES	8
+#define NAND_READAHEAD_PAGES	6
+
 /*
  * Constants for ECC_MODES
  */
@@ -192,6 +201,9 @@ typedef enum {
 /* This option is defined if the board driver allocates its own buffers
    (e.g. because it needs them DMA-coherent */
 #define NAND_OWN_BUFFERS	0x00040000
+/* Chip and driver support the ONFI read cache sequential commands. The
+ * ecc.read_page function must only transfer data (and may use RNDOUT). */
+#define NAND_CACHEREAD		0x00080000
 /* Options set by nand scan */
 /* Nand scan has allocated controller struct */
 #define NAND_CONTROLLER_ALLOC	0x80000000
@@ -345,10 +357,20 @@ struct nand_buffers {
  * @numchips:		[INTERN] number of physical chips
  * @chipsize:		[INTERN] the size of one chip for multichip arrays
  * @pagemask:		[INTERN] page number mask = number of (pages / chip) - 1
- * @pagebuf:		[INTERN] holds the pagenumber which is currently in data_buf
+ * @pagecache:		[INTERN] page numbers of the pages in pagecache_buf, -1 if unused
+ * @pagecache_buf:	[INTERN] buffer for the cached pages
+ * @pagecache_next:	[INTERN] the next page cache entry to replace
+ * @ra_next:		[INTERN] the page following the last read, for read-ahead
+ * @ra_seq:		[INTERN] number of sequential reads in a row
  * @subpagesize:	[INTERN] holds the subpagesize
  * @ecclayout:		[REPLACEABLE] the default ecc placement scheme
  * @bbt:		[INTERN] bad block table pointer
+ * @bbt_scanned:	[INTERN] bitmap of the blocks scanned for the bad block table,
+ *			NULL when the table is complete
+ * @bbt_unscanned:	[INTERN] number of blocks not scanned yet
+ * @bbt_scan_bd:	[INTERN] good/bad block pattern for scanning blocks on demand
+ * @bbt_scan_buf:	[INTERN] oob buffer for scanning blocks on demand
+ * @bbt_persist:	[INTERN] the bad block table is to be written to the flash
  * @bbt_td:		[REPLACEABLE] bad block table descriptor for flash lookup
  * @bbt_md:		[REPLACEABLE] bad block table mirror descriptor
  * @badblock_pattern:	[REPLACEABLE] bad block scan pattern used for initial bad block scan
@@ -393,7 +415,11 @@ struct nand_chip {
 	int		numchips;
 	unsigned long	chipsize;
 	int		pagemask;
-	int		pagebuf;
+	int		pagecache[NAND_PAGECACHE_PAGES];
+	uint8_t		*pagecache_buf;
+	int		pagecache_next;
+	int		ra_next;
+	int		ra_seq;
 	int		subpagesize;
 	uint8_t		cellinfo;
 	int		badblockpos;
@@ -411,6 +437,11 @@ struct nand_chip {
 	struct mtd_oob_ops ops;
 
 	uint8_t		*bbt;
+	uint8_t		*bbt_scanned;
+	int		bbt_unscanned;
+	struct nand_bbt_descr	*bbt_scan_bd;
+	uint8_t		*bbt_scan_buf;
+	int		bbt_persist;
 	struct nand_bbt_descr	*bbt_td;
 	struct nand_bbt_descr	*bbt_md;
 
@@ -539,6 +570,7 @@ extern int nand_scan_bbt(struct mtd_info *mtd, struct nand_bbt_descr *bd);
 extern int nand_update_bbt(struct mtd_info *mtd, loff_t offs);
 extern int nand_default_bbt(struct mtd_info *mtd);
 extern int nand_isbad_bbt(struct mtd_info *mtd, loff_t offs, int allowbbt);
+extern int nand_persist_bbt(struct mtd_info *mtd);
 extern int nand_erase_nand(struct mtd_info *mtd, struct erase_info *instr,
 			   int allowbbt);
 extern int nand_do_read(struct mtd_info *mtd, loff_t from, size_t len,
@@ -0,0 +1,41 @@
+/*
+ * xxHash - extremely fast non-cryptographic hash algorithm
+ *
+ * Copyright (C) 2012-2016, Yann Collet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * Only the 32 bit variant used by the lz4 frame format is provided.
+ */
+#ifndef _LINUX_XXHASH_H
+#define _LINUX_XXHASH_H
+
+#include <linux/types.h>
+
+struct xxh32_state {
+	u32 total_len_32;
+	u32 large_len;
+	u32 v1;
+	u32 v2;
+	u32 v3;
+	u32 v4;
+	u32 mem32[4];
+	u32 memsize;
+};
+
+/* hash length bytes of input in one go */
+u32 xxh32(const void *input, size_t length, u32 seed);
+
+/* hash data given in pieces */
+void xxh32_reset(struct xxh32_state *state, u32 seed);
+void xxh32_update(struct xxh32_state *state, const void *input, size_t length);
+u32 xxh32_digest(const struct xxh32_state *state);
+
+#endif /* _LINUX_XXHASH_H */
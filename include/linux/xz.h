@@ -0,0 +1,107 @@
+/*
+ * XZ decompressor
+ *
+ * Based on XZ Embedded by Lasse Collin <lasse.collin@tukaani.org>
+ *
+ * This file has been put into the public domain.
+ * You can do whatever you want with this file.
+ */
+
+#ifndef XZ_H
+#define XZ_H
+
+#include <linux/types.h>
+
+/**
+ * enum xz_ret - Return codes
+ * @XZ_OK:                  Everything is OK so far. More input or more
+ *                          output space is required to continue.
+ * @XZ_STREAM_END:          Operation finished successfully.
+ * @XZ_UNSUPPORTED_CHECK:   Integrity check type is not supported. Decoding
+ *                          is still possible by simply calling xz_dec_run()
+ *                          again, the check is not verified then.
+ * @XZ_MEM_ERROR:           Allocating memory failed.
+ * @XZ_MEMLIMIT_ERROR:      The data needs a larger dictionary than the
+ *                          dict_max given to xz_dec_init().
+ * @XZ_FORMAT_ERROR:        File format was not recognized (wrong magic
+ *                          bytes).
+ * @XZ_OPTIONS_ERROR:       This implementation doesn't support the requested
+ *                          compression options.
+ * @XZ_DATA_ERROR:          Compressed data is corrupt.
+ * @XZ_BUF_ERROR:           Cannot make any progress, the input ends too
+ *                          early. Returned only if xz_dec_run() is called
+ *                          twice in a row without any progress.
+ */
+enum xz_ret {
+	XZ_OK,
+	XZ_STREAM_END,
+	XZ_UNSUPPORTED_CHECK,
+	XZ_MEM_ERROR,
+	XZ_MEMLIMIT_ERROR,
+	XZ_FORMAT_ERROR,
+	XZ_OPTIONS_ERROR,
+	XZ_DATA_ERROR,
+	XZ_BUF_ERROR
+};
+
+/**
+ * struct xz_buf - Passing input and output buffers to XZ code
+ * @in:         Beginning of the input buffer
+ * @in_pos:     Current position in the input buffer
+ * @in_size:    Size of the input buffer
+ * @out:        Beginning of the output buffer
+ * @out_pos:    Current position in the output buffer
+ * @out_size:   Size of the output buffer
+ */
+struct xz_buf {
+	const uint8_t *in;
+	size_t in_pos;
+	size_t in_size;
+
+	uint8_t *out;
+	size_t out_pos;
+	size_t out_size;
+};
+
+struct xz_dec;
+
+/**
+ * xz_dec_init() - Allocate and initialize a XZ decoder state
+ * @dict_max:   Maximum size of the LZMA2 dictionary (history buffer)
+ *
+ * The dictionary is allocated on demand and grows with the decompressed
+ * data up to the dictionary size of the stream, but not beyond dict_max.
+ * Streams with a larger dictionary can still be decompressed as long as
+ * they do not reference data more than dict_max bytes back.
+ *
+ * Returns NULL if allocating memory failed.
+ */
+struct xz_dec *xz_dec_init(uint32_t dict_max);
+
+/**
+ * xz_dec_run() - Run the XZ decoder
+ * @s:          Decoder state allocated using xz_dec_init()
+ * @b:          Input and output buffers
+ *
+ * The possible return values depend on build options and operation mode.
+ * See enum xz_ret for details.
+ */
+enum xz_ret xz_dec_run(struct xz_dec *s, struct xz_buf *b);
+
+/**
+ * xz_dec_reset() - Reset an already allocated decoder state
+ * @s:          Decoder state allocated using xz_dec_init()
+ *
+ * This function can be used to reset the decoder state without freeing
+ * and reallocating memory with xz_dec_end() and xz_dec_init().
+ */
+void xz_dec_reset(struct xz_dec *s);
+
+/**
+ * xz_dec_end() - Free the memory allocated for the decoder state
+ * @s:          Decoder state allocated using xz_dec_init(). If s is NULL,
+ *              this function does nothing.
+ */
+void xz_dec_end(struct xz_dec *s);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef __LZ4_H__
+#define __LZ4_H__
+/*
+ *  LZ4 decompression interface
+ *
+ *  The LZ4 format is described at http://code.google.com/p/lz4/
+ */
+
+#include <linux/types.h>
+
+#define lz4_compressbound(x)	((x) + ((x) / 255) + 16)
+
+/* safe decompression of a single block with overrun testing */
+int lz4_decompress_safe(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len);
+
+/* state of a block decompressed in pieces */
+struct lz4_dec {
+	const unsigned char *ip, *iend;
+	unsigned int token;
+	size_t lit_len;
+	unsigned int offset;
+	size_t match_len;
+};
+
+void lz4_decompress_start(struct lz4_dec *d, const unsigned char *src,
+			size_t src_len);
+
+/*
+ * Decompress up to *dst_len bytes of the block set up with
+ * lz4_decompress_start to dst. Returns LZ4_E_OUTPUT_FULL if the block
+ * continues, the next call then picks up where this one stopped. Matches
+ * may reference up to prefix_len bytes of earlier output in front of dst.
+ */
+int lz4_decompress_partial(struct lz4_dec *d, unsigned char *dst,
+			size_t *dst_len, size_t prefix_len);
+
+/*
+ * Return values (< 0 = Error)
+ */
+#define LZ4_E_OK			0
+#define LZ4_E_OUTPUT_FULL		1
+#define LZ4_E_INPUT_OVERRUN		(-1)
+#define LZ4_E_OUTPUT_OVERRUN		(-2)
+#define LZ4_E_LOOKBEHIND_OVERRUN	(-3)
+
+struct uncompress_ctx;
+
+int unlz4_stream_init(struct uncompress_ctx *ctx);
+int unlz4_stream_read(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len);
+void unlz4_stream_exit(struct uncompress_ctx *ctx);
+
+#endif
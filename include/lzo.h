@@ -41,10 +41,12 @@ int lzo1x_decompress_safe(const unsigned char *src, size_t src_len,
 #define LZO_E_INPUT_NOT_CONSUMED	(-8)
 #define LZO_E_NOT_YET_IMPLEMENTED	(-9)
 
-int decompress_unlzo(u8 *input, int in_len,
-		int (*fill) (void *, unsigned int),
-		int (*flush) (void *, unsigned int),
-		u8 *output, int *posp,
-		void (*error) (char *x));
+struct uncompress_ctx;
+
+int unlzo_stream_init(struct uncompress_ctx *ctx);
+int unlzo_stream_read(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len);
+void unlzo_stream_exit(struct uncompress_ctx *ctx);
+int unlzo_stream_unused(struct uncompress_ctx *ctx);
 
 #endif
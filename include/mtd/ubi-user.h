@@ -297,4 +297,14 @@ int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num, int vid_hdr_offset);
  */
 int ubi_detach_mtd_dev(struct mtd_info *mtd, int anyway);
 
+/**
+ * ubi_print_info - print information and statistics of an UBI device.
+ * @ubi_num: UBI device number
+ *
+ * This function prints the device geometry, the time spent in the phases of
+ * attaching and the I/O statistics of UBI device @ubi_num. Returns zero in
+ * case of success and %-ENODEV if the UBI device does not exist.
+ */
+int ubi_print_info(int ubi_num);
+
 #endif /* __UBI_USER_H__ */
@@ -5,6 +5,8 @@
 #include <linux/list.h>
 
 #define PARAM_FLAG_RO	(1 << 0)
+/* the value can only be set to zero, e.g. to reset a counter */
+#define PARAM_FLAG_CLEAR	(1 << 1)
 
 struct device_d;
 typedef unsigned long          IPaddr_t;
@@ -30,6 +32,9 @@ int dev_add_param(struct device_d *dev, const char *name,
 
 int dev_add_param_fixed(struct device_d *dev, char *name, char *value);
 
+int dev_add_param_u64(struct device_d *dev, const char *name, uint64_t *value,
+		unsigned long flags);
+
 void dev_remove_parameters(struct device_d *dev);
 
 int dev_param_set_generic(struct device_d *dev, struct param_d *p,
@@ -69,6 +74,12 @@ static inline int dev_add_param_fixed(struct device_d *dev, char *name, char *va
 	return 0;
 }
 
+static inline int dev_add_param_u64(struct device_d *dev, const char *name,
+		uint64_t *value, unsigned long flags)
+{
+	return 0;
+}
+
 static inline void dev_remove_parameters(struct device_d *dev) {}
 
 static inline int dev_param_set_generic(struct device_d *dev, struct param_d *p,
@@ -1,6 +1,8 @@
 #ifndef __UNCOMPRESS_H
 #define __UNCOMPRESS_H
 
+#include <filetype.h>
+
 int uncompress(unsigned char *inbuf, int len,
 	   int(*fill)(void*, unsigned int),
 	   int(*flush)(void*, unsigned int),
@@ -16,4 +18,70 @@ int uncompress_fd_to_buf(int infd, void *output,
 
 void uncompress_err_stdout(char *);
 
+/*
+ * Streaming decompression. The compressed data is taken from buffers passed
+ * with uncompress_feed() first, then from the fill callback if there is
+ * one. Running out of input before the end of the compressed stream is an
+ * error. The decompressed data is pulled with uncompress_read() in pieces
+ * of any size. Each context carries its own state, so several of them
+ * may be in use at the same time.
+ */
+struct uncompress_ctx;
+
+struct uncompress_algo {
+	enum filetype filetype;
+	int (*init)(struct uncompress_ctx *ctx);
+	/* returns the number of bytes read, 0 at the end of the data */
+	int (*read)(struct uncompress_ctx *ctx, void *buf, unsigned int len);
+	void (*exit)(struct uncompress_ctx *ctx);
+	/*
+	 * optional: the number of input bytes fetched with uncompress_fill()
+	 * that are not part of the compressed stream. Negative if the end
+	 * of the stream has not been fetched yet.
+	 */
+	int (*unused)(struct uncompress_ctx *ctx);
+};
+
+#define UNCOMPRESS_HEAD_SIZE	64
+
+struct uncompress_ctx {
+	int (*fill)(void *priv, void *buf, unsigned int len);
+	void *priv;
+	void (*error_fn)(char *x);
+
+	/* buffer passed with uncompress_feed() */
+	const unsigned char *feed_buf;
+	unsigned int feed_len;
+
+	/* start of the input, used to detect the type */
+	unsigned char head[UNCOMPRESS_HEAD_SIZE];
+	unsigned int head_len, head_pos;
+
+	/* number of input bytes handed to the decompressor */
+	unsigned long consumed;
+
+	const struct uncompress_algo *algo;
+	void *algo_priv;
+	int done;
+
+	/*
+	 * Set before the first read if the output of consecutive reads is
+	 * placed back to back in one buffer and left untouched. Decompressors
+	 * may then reference earlier output instead of keeping a copy.
+	 */
+	int contiguous;
+};
+
+struct uncompress_ctx *uncompress_open(
+		int (*fill)(void *priv, void *buf, unsigned int len),
+		void *priv, void (*error_fn)(char *x));
+int uncompress_feed(struct uncompress_ctx *ctx, const void *buf,
+		unsigned int len);
+int uncompress_read(struct uncompress_ctx *ctx, void *buf, unsigned int len);
+void uncompress_close(struct uncompress_ctx *ctx);
+unsigned long uncompress_consumed(struct uncompress_ctx *ctx);
+
+/* for the decompressors: get up to len bytes of compressed data */
+int uncompress_fill(struct uncompress_ctx *ctx, void *buf, unsigned int len);
+
 #endif /* __UNCOMPRESS_H */
@@ -0,0 +1,12 @@
+#ifndef __XZ_H__
+#define __XZ_H__
+
+struct uncompress_ctx;
+
+int unxz_stream_init(struct uncompress_ctx *ctx);
+int unxz_stream_read(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len);
+void unxz_stream_exit(struct uncompress_ctx *ctx);
+int unxz_stream_unused(struct uncompress_ctx *ctx);
+
+#endif
@@ -42,7 +42,8 @@
  * remainder lookup tables.
  *
  * The final stage of decoding involves the following internal steps:
- * a. Syndrome computation
+ * a. Syndrome computation, one byte of the ecc at a time using a lookup table
+ *    per syndrome. Decoding stops here if the ecc shows no errors.
  * b. Error locator polynomial computation using Berlekamp-Massey algorithm
  * c. Error locator root finding (by far the most expensive step)
  *
@@ -338,6 +339,7 @@ static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 	int i, j, s;
 	unsigned int m;
 	uint32_t poly;
+	const uint16_t *tab;
 	const int t = GF_T(bch);
 
 	s = bch->ecc_bits;
@@ -348,16 +350,26 @@ static void compute_syndromes(struct bch_control *bch, uint32_t *ecc,
 		ecc[s/32] &= ~((1u << (32-m))-1);
 	memset(syn, 0, 2*t*sizeof(*syn));
 
-	/* compute v(a^j) for j=1 .. 2t-1 */
+	/*
+	 * compute v(a^j) for j=1 .. 2t-1; the terms of the 8 bits of an ecc
+	 * byte are summed up in syn_tab, so each non-zero byte costs one
+	 * lookup and multiplication per syndrome
+	 */
 	do {
 		poly = *ecc++;
 		s -= 32;
-		while (poly) {
-			i = deg(poly);
-			for (j = 0; j < 2*t; j += 2)
-				syn[j] ^= a_pow(bch, (j+1)*(i+s));
-
-			poly ^= (1 << i);
+		/* drop the cleared bits of the last word */
+		if (s < 0) {
+			poly >>= -s;
+			s = 0;
+		}
+		for (i = s; poly; i += 8, poly >>= 8) {
+			if (!(poly & 0xff))
+				continue;
+			tab = bch->syn_tab + (poly & 0xff)*t;
+			for (j = 0; j < t; j++)
+				if (tab[j] != GF_N(bch))
+					syn[2*j] ^= a_pow(bch, (2*j+1)*i+tab[j]);
 		}
 	} while (s > 0);
 
@@ -1009,16 +1021,22 @@ int decode_bch(struct bch_control *bch, const uint8_t *data, unsigned int len,
 		if (recv_ecc) {
 			load_ecc8(bch, bch->ecc_buf2, recv_ecc);
 			/* XOR received and calculated ecc */
-			for (i = 0, sum = 0; i < (int)ecc_words; i++) {
+			for (i = 0; i < (int)ecc_words; i++)
 				bch->ecc_buf[i] ^= bch->ecc_buf2[i];
-				sum |= bch->ecc_buf[i];
-			}
-			if (!sum)
-				/* no error found */
-				return 0;
 		}
+		for (i = 0, sum = 0; i < (int)ecc_words; i++)
+			sum |= bch->ecc_buf[i];
+		if (!sum)
+			/* no error found */
+			return 0;
 		compute_syndromes(bch, bch->ecc_buf, bch->syn);
 		syn = bch->syn;
+	} else {
+		for (i = 0, sum = 0; i < 2*GF_T(bch); i++)
+			sum |= syn[i];
+		if (!sum)
+			/* all syndromes zero, no error found */
+			return 0;
 	}
 
 	err = compute_error_locator_polynomial(bch, syn);
@@ -1105,6 +1123,27 @@ static void build_mod8_tables(struct bch_control *bch, const uint32_t *g)
 	}
 }
 
+/*
+ * build syndrome tables: for each odd syndrome j=2k+1 and byte value v, the
+ * sum of a^(j*b) over the set bits b of v, stored as its log (n if zero)
+ */
+static void build_syn_tables(struct bch_control *bch)
+{
+	const unsigned int t = GF_T(bch);
+	unsigned int j, b, v, x;
+	uint16_t *tab = bch->syn_tab;
+
+	for (v = 0; v < 256; v++) {
+		for (j = 0; j < t; j++) {
+			x = 0;
+			for (b = 0; b < 8; b++)
+				if (v & (1 << b))
+					x ^= a_pow(bch, (2*j+1)*b);
+			tab[v*t+j] = x ? a_log(bch, x) : GF_N(bch);
+		}
+	}
+}
+
 /*
  * build a base for factoring degree 2 polynomials
  */
@@ -1301,6 +1340,7 @@ struct bch_control *init_bch(int m, int t, unsigned int prim_poly)
 	bch->ecc_buf2  = bch_alloc(words*sizeof(*bch->ecc_buf2), &err);
 	bch->xi_tab    = bch_alloc(m*sizeof(*bch->xi_tab), &err);
 	bch->syn       = bch_alloc(2*t*sizeof(*bch->syn), &err);
+	bch->syn_tab   = bch_alloc(256*t*sizeof(*bch->syn_tab), &err);
 	bch->cache     = bch_alloc(2*t*sizeof(*bch->cache), &err);
 	bch->elp       = bch_alloc((t+1)*sizeof(struct gf_poly_deg1), &err);
 
@@ -1326,6 +1366,8 @@ struct bch_control *init_bch(int m, int t, unsigned int prim_poly)
 	if (err)
 		goto fail;
 
+	build_syn_tables(bch);
+
 	return bch;
 
 fail:
@@ -1350,6 +1392,7 @@ void free_bch(struct bch_control *bch)
 		kfree(bch->ecc_buf2);
 		kfree(bch->xi_tab);
 		kfree(bch->syn);
+		kfree(bch->syn_tab);
 		kfree(bch->cache);
 		kfree(bch->elp);
 
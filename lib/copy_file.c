@@ -5,22 +5,167 @@
 #include <malloc.h>
 #include <libbb.h>
 #include <progress.h>
+#include <digest.h>
+#include <ioctl.h>
+#include <uncompress.h>
+#include <linux/mtd/mtd-abi.h>
 
 #define RW_BUF_SIZE	(ulong)4096
 
+/*
+ * The destination side of a copy. Data is collected in a buffer of one
+ * erase block, so that with COPY_FILE_ERASE each block of a MTD device is
+ * erased right before it is written.
+ */
+struct copy_dst {
+	int fd;
+	int erase;
+	char *buf;
+	size_t bufsize;
+	size_t len;
+	loff_t pos;
+};
+
+static int copy_dst_open(struct copy_dst *d, const char *dst, unsigned flags)
+{
+	struct mtd_info_user user;
+
+	d->fd = open(dst, O_WRONLY | O_CREAT);
+	if (d->fd < 0) {
+		printf("could not open %s: %s\n", dst, errno_str());
+		return -errno;
+	}
+
+	d->bufsize = RW_BUF_SIZE;
+
+	/* other destinations are written like regular files */
+	if ((flags & COPY_FILE_ERASE) &&
+			!ioctl(d->fd, MEMGETINFO, &user) && user.erasesize) {
+		d->erase = 1;
+		d->bufsize = user.erasesize;
+	}
+
+	d->buf = malloc(d->bufsize);
+	if (!d->buf)
+		return -ENOMEM;
+
+	return 0;
+}
+
+/*
+ * Erase the block at the current position. Blocks which are bad or fail
+ * to erase are skipped, the data goes to the next good block then.
+ */
+static int copy_dst_erase(struct copy_dst *d)
+{
+	loff_t ofs;
+	int ret;
+
+	while (1) {
+		ofs = d->pos;
+		if (ioctl(d->fd, MEMGETBADBLOCK, &ofs) > 0) {
+			printf("skipping bad block at 0x%08llx\n", d->pos);
+		} else {
+			ret = erase(d->fd, d->bufsize, d->pos);
+			if (!ret)
+				return 0;
+
+			printf("erase at 0x%08llx: %s, skipping block\n",
+					d->pos, strerror(-ret));
+		}
+
+		d->pos += d->bufsize;
+
+		if (lseek(d->fd, d->pos, SEEK_SET) == -1) {
+			printf("no space left for the data\n");
+			return -ENOSPC;
+		}
+	}
+}
+
+static int copy_dst_flush(struct copy_dst *d)
+{
+	int ret;
+
+	if (!d->len)
+		return 0;
+
+	if (d->erase) {
+		ret = copy_dst_erase(d);
+		if (ret)
+			return ret;
+	}
+
+	ret = write_full(d->fd, d->buf, d->len);
+	if (ret < 0) {
+		perror("write");
+		return ret;
+	}
+
+	d->pos += d->len;
+	d->len = 0;
+
+	return 0;
+}
+
+static int copy_dst_write(struct copy_dst *d, const char *buf, size_t len)
+{
+	size_t now;
+	int ret;
+
+	while (len) {
+		now = min(len, d->bufsize - d->len);
+		memcpy(d->buf + d->len, buf, now);
+		d->len += now;
+		buf += now;
+		len -= now;
+
+		if (d->len == d->bufsize) {
+			ret = copy_dst_flush(d);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int copy_src_fill(void *priv, void *buf, unsigned int len)
+{
+	int fd = (int)(long)priv;
+
+	return read(fd, buf, len);
+}
+
 /**
- * @param[in] src FIXME
- * @param[out] dst FIXME
- * @param[in] verbose FIXME
+ * @param[in] src the file to read from
+ * @param[out] dst the file to write to
+ * @param[in] flags COPY_FILE_* flags
+ * @param[in] digests digests to feed the copied data to, may be NULL
+ * @param[in] num_digests number of entries in digests
+ *
+ * The data is streamed from src to dst through a small buffer. With
+ * COPY_FILE_UNCOMPRESS the source is decompressed on the way, the digests
+ * then see the uncompressed data. With COPY_FILE_ERASE a MTD destination
+ * is erased one erase block at a time right before the block is written,
+ * so no separate erase of the whole destination is needed. Bad blocks are
+ * skipped then. Destinations which do not report an erase block size are
+ * written without erasing.
+ *
+ * The digests are only updated, initializing them and getting the
+ * result is up to the caller.
  */
-int copy_file(const char *src, const char *dst, int verbose)
+int copy_file_flags(const char *src, const char *dst, unsigned flags,
+		struct digest **digests, int num_digests)
 {
+	struct uncompress_ctx *uc = NULL;
+	struct copy_dst d = { .fd = -1 };
 	char *rw_buf = NULL;
-	int srcfd = 0, dstfd = 0;
-	int r, w;
+	int srcfd = 0;
+	int r;
 	int ret = 1;
-	void *buf;
-	int total = 0;
+	loff_t total = 0;
+	int i;
 	struct stat statbuf;
 
 	rw_buf = xmalloc(RW_BUF_SIZE);
@@ -31,13 +176,20 @@ int copy_file(const char *src, const char *dst, int verbose)
 		goto out;
 	}
 
-	dstfd = open(dst, O_WRONLY | O_CREAT);
-	if (dstfd < 0) {
-		printf("could not open %s: %s\n", dst, errno_str());
+	if (copy_dst_open(&d, dst, flags))
 		goto out;
+
+	if (flags & COPY_FILE_UNCOMPRESS) {
+#ifdef CONFIG_UNCOMPRESS
+		uc = uncompress_open(copy_src_fill, (void *)(long)srcfd,
+				uncompress_err_stdout);
+#else
+		printf("uncompression support not available\n");
+		goto out;
+#endif
 	}
 
-	if (verbose) {
+	if (flags & COPY_FILE_VERBOSE) {
 		if (stat(src, &statbuf) < 0)
 			statbuf.st_size = 0;
 
@@ -45,41 +197,62 @@ int copy_file(const char *src, const char *dst, int verbose)
 	}
 
 	while(1) {
-		r = read(srcfd, rw_buf, RW_BUF_SIZE);
+		if (uc)
+			r = uncompress_read(uc, rw_buf, RW_BUF_SIZE);
+		else
+			r = read(srcfd, rw_buf, RW_BUF_SIZE);
 		if (r < 0) {
-			perror("read");
+			if (!uc)
+				perror("read");
 			goto out;
 		}
 		if (!r)
 			break;
 
-		buf = rw_buf;
-		while (r) {
-			w = write(dstfd, buf, r);
-			if (w < 0) {
-				perror("write");
-				goto out;
-			}
-			buf += w;
-			r -= w;
-			total += w;
-		}
+		for (i = 0; i < num_digests; i++)
+			digest_update(digests[i], rw_buf, r);
+
+		if (copy_dst_write(&d, rw_buf, r))
+			goto out;
+
+		total += r;
 
-		if (verbose)
-			show_progress(statbuf.st_size ? total : total / 16384);
+		if (flags & COPY_FILE_VERBOSE) {
+			/* the progress is measured on the input side */
+			loff_t done = uc ? uncompress_consumed(uc) : total;
+
+			show_progress(statbuf.st_size ? done : done / 16384);
+		}
 	}
 
+	if (copy_dst_flush(&d))
+		goto out;
+
 	ret = 0;
 out:
-	if (verbose)
+	if (flags & COPY_FILE_VERBOSE)
 		putchar('\n');
 
+	if (uc)
+		uncompress_close(uc);
+	free(d.buf);
 	free(rw_buf);
 	if (srcfd > 0)
 		close(srcfd);
-	if (dstfd > 0)
-		close(dstfd);
+	if (d.fd > 0)
+		close(d.fd);
 
 	return ret;
 }
 
+int copy_file_digest(const char *src, const char *dst, int verbose,
+		struct digest **digests, int num_digests)
+{
+	return copy_file_flags(src, dst, verbose ? COPY_FILE_VERBOSE : 0,
+			digests, num_digests);
+}
+
+int copy_file(const char *src, const char *dst, int verbose)
+{
+	return copy_file_digest(src, dst, verbose, NULL, 0);
+}
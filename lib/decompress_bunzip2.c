@@ -47,11 +47,9 @@
 #include <common.h>
 #include <malloc.h>
 
-#ifdef STATIC
-#define PREBOOT
-#else
+#include <uncompress.h>
 #include <bunzip2.h>
-#endif /* STATIC */
+#include <errno.h>
 
 #ifndef INT_MAX
 #define INT_MAX 0x7fffffff
@@ -93,7 +91,8 @@ struct bunzip_data {
 	/* State for interrupting output loop */
 	int writeCopies, writePos, writeRunCountdown, writeCount, writeCurrent;
 	/* I/O tracking data (file handles, buffers, positions, etc.) */
-	int (*fill)(void*, unsigned int);
+	int (*fill)(void *priv, void *buf, unsigned int len);
+	void *fill_priv;
 	int inbufCount, inbufPos /*, outbufPos*/;
 	unsigned char *inbuf /*,*outbuf*/;
 	unsigned int inbufBitCount, inbufBits;
@@ -126,7 +125,8 @@ static unsigned int get_bits(struct bunzip_data *bd, char bits_wanted)
 		if (bd->inbufPos == bd->inbufCount) {
 			if (bd->io_error)
 				return 0;
-			bd->inbufCount = bd->fill(bd->inbuf, BZIP2_IOBUF_SIZE);
+			bd->inbufCount = bd->fill(bd->fill_priv, bd->inbuf,
+					BZIP2_IOBUF_SIZE);
 			if (bd->inbufCount <= 0) {
 				bd->io_error = RETVAL_UNEXPECTED_INPUT_EOF;
 				return 0;
@@ -618,16 +618,11 @@ decode_next_byte:
 	goto decode_next_byte;
 }
 
-static int nofill(void *buf, unsigned int len)
-{
-	return -1;
-}
-
-/* Allocate the structure, read file header.  If in_fd ==-1, inbuf must contain
-   a complete bunzip file (len bytes long).  If in_fd!=-1, inbuf and len are
-   ignored, and data is read from file handle into temporary buffer. */
-static int start_bunzip(struct bunzip_data **bdp, void *inbuf, int len,
-			     int (*fill)(void*, unsigned int))
+/* Allocate the structure, read file header.  The data is read with fill
+   into inbuf, which must be BZIP2_IOBUF_SIZE bytes long. */
+static int start_bunzip(struct bunzip_data **bdp, void *inbuf,
+			     int (*fill)(void *, void *, unsigned int),
+			     void *fill_priv)
 {
 	struct bunzip_data *bd;
 	unsigned int i, j, c;
@@ -645,11 +640,8 @@ static int start_bunzip(struct bunzip_data **bdp, void *inbuf, int len,
 	memset(bd, 0, sizeof(struct bunzip_data));
 	/* Setup input buffer */
 	bd->inbuf = inbuf;
-	bd->inbufCount = len;
-	if (fill != NULL)
-		bd->fill = fill;
-	else
-		bd->fill = nofill;
+	bd->fill = fill;
+	bd->fill_priv = fill_priv;
 
 	/* Init the CRC32 table (big endian) */
 	for (i = 0; i < 256; i++) {
@@ -674,83 +666,88 @@ static int start_bunzip(struct bunzip_data **bdp, void *inbuf, int len,
 	return RETVAL_OK;
 }
 
-/* Example usage: decompress src_fd to dst_fd.  (Stops at end of bzip2 data,
-   not end of file.) */
-int bunzip2(unsigned char *buf, int len,
-			int(*fill)(void*, unsigned int),
-			int(*flush)(void*, unsigned int),
-			unsigned char *outbuf,
-			int *pos,
-			void(*error)(char *x))
+static int bunzip2_stream_fill(void *priv, void *buf, unsigned int len)
 {
-	struct bunzip_data *bd;
-	int i = -1;
-	unsigned char *inbuf;
+	return uncompress_fill(priv, buf, len);
+}
 
-	if (flush)
-		outbuf = malloc(BZIP2_IOBUF_SIZE);
+int bunzip2_stream_init(struct uncompress_ctx *ctx)
+{
+	struct bunzip_data *bd = NULL;
+	void *inbuf;
+	int ret;
 
-	if (!outbuf) {
-		error("Could not allocate output bufer");
-		return RETVAL_OUT_OF_MEMORY;
-	}
-	if (buf)
-		inbuf = buf;
-	else
-		inbuf = malloc(BZIP2_IOBUF_SIZE);
-	if (!inbuf) {
-		error("Could not allocate input bufer");
-		i = RETVAL_OUT_OF_MEMORY;
-		goto exit_0;
-	}
-	i = start_bunzip(&bd, inbuf, len, fill);
-	if (!i) {
-		for (;;) {
-			i = read_bunzip(bd, outbuf, BZIP2_IOBUF_SIZE);
-			if (i <= 0)
-				break;
-			if (!flush)
-				outbuf += i;
-			else
-				if (i != flush(outbuf, i)) {
-					i = RETVAL_UNEXPECTED_OUTPUT_EOF;
-					break;
-				}
-		}
+	inbuf = xmalloc(BZIP2_IOBUF_SIZE);
+
+	ret = start_bunzip(&bd, inbuf, bunzip2_stream_fill, ctx);
+	ctx->algo_priv = bd;
+	if (!bd)
+		free(inbuf);
+
+	switch (ret) {
+	case RETVAL_OK:
+		return 0;
+	case RETVAL_OUT_OF_MEMORY:
+		ctx->error_fn("bunzip2: out of memory");
+		return -ENOMEM;
+	default:
+		ctx->error_fn("Not a bzip2 file");
+		return -EINVAL;
 	}
-	/* Check CRC and release memory */
-	if (i == RETVAL_LAST_BLOCK) {
-		if (bd->headerCRC != bd->totalCRC)
-			error("Data integrity error when decompressing.");
-		else
-			i = RETVAL_OK;
-	} else if (i == RETVAL_UNEXPECTED_OUTPUT_EOF) {
-		error("Compressed file ends unexpectedly");
+}
+
+int bunzip2_stream_read(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len)
+{
+	struct bunzip_data *bd = ctx->algo_priv;
+	int ret;
+
+	ret = read_bunzip(bd, buf, len);
+	/* the end of the data may only be reported by the following call */
+	if (!ret)
+		ret = read_bunzip(bd, buf, len);
+	if (ret >= 0)
+		return ret;
+
+	switch (ret) {
+	case RETVAL_LAST_BLOCK:
+		if (bd->headerCRC == bd->totalCRC)
+			return 0;
+		ctx->error_fn("Data integrity error when decompressing.");
+		break;
+	case RETVAL_UNEXPECTED_INPUT_EOF:
+		ctx->error_fn("Compressed file ends unexpectedly");
+		break;
+	default:
+		ctx->error_fn("bunzip2 data error");
+		break;
 	}
+
+	return -EIO;
+}
+
+void bunzip2_stream_exit(struct uncompress_ctx *ctx)
+{
+	struct bunzip_data *bd = ctx->algo_priv;
+
 	if (!bd)
-		goto exit_1;
-	if (bd->dbuf)
-		free(bd->dbuf);
-	if (pos)
-		*pos = bd->inbufPos;
+		return;
+
+	free(bd->dbuf);
+	free(bd->inbuf);
 	free(bd);
-exit_1:
-	if (!buf)
-		free(inbuf);
-exit_0:
-	if (flush)
-		free(outbuf);
-	return i;
+	ctx->algo_priv = NULL;
 }
 
-#ifdef PREBOOT
-STATIC int INIT decompress(unsigned char *buf, int len,
-			int(*fill)(void*, unsigned int),
-			int(*flush)(void*, unsigned int),
-			unsigned char *outbuf,
-			int *pos,
-			void(*error)(char *x))
+/* the input buffer and whole bytes of the bit buffer are not used yet */
+int bunzip2_stream_unused(struct uncompress_ctx *ctx)
 {
-	return bunzip2(buf, len - 4, fill, flush, outbuf, pos, error);
+	struct bunzip_data *bd = ctx->algo_priv;
+
+	int unused = bd->inbufBitCount / 8;
+
+	if (!bd->io_error)
+		unused += bd->inbufCount - bd->inbufPos;
+
+	return unused;
 }
-#endif
@@ -1,17 +1,3 @@
-#ifdef STATIC
-/* Pre-boot environment: included */
-
-/* prevent inclusion of _LINUX_KERNEL_H in pre-boot environment: lots
- * errors about console_printk etc... on ARM */
-#define _LINUX_KERNEL_H
-
-#include "zlib_inflate/inftrees.c"
-#include "zlib_inflate/inffast.c"
-#include "zlib_inflate/inflate.c"
-
-#else /* STATIC */
-/* initramfs et al: linked */
-
 #include <linux/zutil.h>
 #include <common.h>
 #include <malloc.h>
@@ -22,164 +8,214 @@
 
 #include "zlib_inflate/infutil.h"
 
-#endif /* STATIC */
-
+#include <uncompress.h>
 #include <gunzip.h>
+#include <errno.h>
 
+#ifdef CONFIG_ZLIB_IOBUF_SIZE
+#define GZIP_IOBUF_SIZE (CONFIG_ZLIB_IOBUF_SIZE * 1024)
+#else
 #define GZIP_IOBUF_SIZE (16*1024)
+#endif
 
-static int  nofill(void *buffer, unsigned int len)
-{
-	return -1;
-}
+/* gzip header flags */
+#define GZ_FHCRC	0x02
+#define GZ_FEXTRA	0x04
+#define GZ_FNAME	0x08
+#define GZ_FCOMMENT	0x10
 
-/* Included from initramfs et al code */
-int  gunzip(unsigned char *buf, int len,
-		       int(*fill)(void*, unsigned int),
-		       int(*flush)(void*, unsigned int),
-		       unsigned char *out_buf,
-		       int *pos,
-		       void(*error)(char *x)) {
+struct gunzip_stream {
+	struct z_stream_s strm;
 	u8 *zbuf;
-	struct z_stream_s *strm;
-	int rc;
-	size_t out_len;
-
-	rc = -1;
-	if (flush) {
-		out_len = 0x8000; /* 32 K */
-		out_buf = malloc(out_len);
-	} else {
-		out_len = 0x7fffffff; /* no limit */
+	int end;
+};
+
+static int gunzip_stream_refill(struct uncompress_ctx *ctx)
+{
+	struct gunzip_stream *gz = ctx->algo_priv;
+	int len;
+
+	len = uncompress_fill(ctx, gz->zbuf, GZIP_IOBUF_SIZE);
+	if (len < 0) {
+		ctx->error_fn("read error");
+		return len;
 	}
-	if (!out_buf) {
-		error("Out of memory while allocating output buffer");
-		goto gunzip_nomem1;
+	if (!len) {
+		ctx->error_fn("Compressed file ends unexpectedly");
+		return -EIO;
 	}
 
-	if (buf)
-		zbuf = buf;
-	else {
-		zbuf = malloc(GZIP_IOBUF_SIZE);
-		len = 0;
-	}
-	if (!zbuf) {
-		error("Out of memory while allocating input buffer");
-		goto gunzip_nomem2;
+	gz->strm.next_in = gz->zbuf;
+	gz->strm.avail_in = len;
+
+	return 0;
+}
+
+static int gunzip_stream_getc(struct uncompress_ctx *ctx)
+{
+	struct gunzip_stream *gz = ctx->algo_priv;
+	int ret;
+
+	if (!gz->strm.avail_in) {
+		ret = gunzip_stream_refill(ctx);
+		if (ret)
+			return ret;
 	}
 
-	strm = malloc(sizeof(*strm));
-	if (strm == NULL) {
-		error("Out of memory while allocating z_stream");
-		goto gunzip_nomem3;
+	gz->strm.avail_in--;
+
+	return *gz->strm.next_in++;
+}
+
+static int gunzip_stream_skip(struct uncompress_ctx *ctx, int len)
+{
+	int c;
+
+	while (len--) {
+		c = gunzip_stream_getc(ctx);
+		if (c < 0)
+			return c;
 	}
 
-	strm->workspace = malloc(flush ? zlib_inflate_workspacesize() :
-				 sizeof(struct inflate_state));
-	if (strm->workspace == NULL) {
-		error("Out of memory while allocating workspace");
-		goto gunzip_nomem4;
+	return 0;
+}
+
+/* skip a zero terminated string in the header */
+static int gunzip_stream_skip_string(struct uncompress_ctx *ctx)
+{
+	int c;
+
+	do {
+		c = gunzip_stream_getc(ctx);
+		if (c < 0)
+			return c;
+	} while (c);
+
+	return 0;
+}
+
+int gunzip_stream_init(struct uncompress_ctx *ctx)
+{
+	struct gunzip_stream *gz;
+	u8 hdr[10];
+	int i, c, ret;
+
+	gz = xzalloc(sizeof(*gz));
+	ctx->algo_priv = gz;
+
+	gz->zbuf = xmalloc(GZIP_IOBUF_SIZE);
+	/*
+	 * Unless the output is contiguous, inflate needs its own window.
+	 * With contiguous output the data is decoded directly into the
+	 * final buffer and matches are copied from the output itself.
+	 */
+	gz->strm.workspace = xmalloc(ctx->contiguous ?
+			sizeof(struct inflate_state) :
+			zlib_inflate_workspacesize());
+
+	for (i = 0; i < sizeof(hdr); i++) {
+		c = gunzip_stream_getc(ctx);
+		if (c < 0)
+			return c;
+		hdr[i] = c;
 	}
 
-	if (!fill)
-		fill = nofill;
+	if (hdr[0] != 0x1f || hdr[1] != 0x8b || hdr[2] != 0x08) {
+		ctx->error_fn("Not a gzip file");
+		return -EINVAL;
+	}
 
-	if (len == 0)
-		len = fill(zbuf, GZIP_IOBUF_SIZE);
+	if (hdr[3] & GZ_FEXTRA) {
+		int lo, hi;
 
-	/* verify the gzip header */
-	if (len < 10 ||
-	   zbuf[0] != 0x1f || zbuf[1] != 0x8b || zbuf[2] != 0x08) {
-		if (pos)
-			*pos = 0;
-		error("Not a gzip file");
-		goto gunzip_5;
+		lo = gunzip_stream_getc(ctx);
+		hi = gunzip_stream_getc(ctx);
+		if (lo < 0 || hi < 0)
+			return -EIO;
+		ret = gunzip_stream_skip(ctx, lo | (hi << 8));
+		if (ret)
+			return ret;
 	}
 
-	/* skip over gzip header (1f,8b,08... 10 bytes total +
-	 * possible asciz filename)
-	 */
-	strm->next_in = zbuf + 10;
-	strm->avail_in = len - 10;
-	/* skip over asciz filename */
-	if (zbuf[3] & 0x8) {
-		do {
-			/*
-			 * If the filename doesn't fit into the buffer,
-			 * the file is very probably corrupt. Don't try
-			 * to read more data.
-			 */
-			if (strm->avail_in == 0) {
-				error("header error");
-				goto gunzip_5;
-			}
-			--strm->avail_in;
-		} while (*strm->next_in++);
+	if (hdr[3] & GZ_FNAME) {
+		ret = gunzip_stream_skip_string(ctx);
+		if (ret)
+			return ret;
 	}
 
-	strm->next_out = out_buf;
-	strm->avail_out = out_len;
+	if (hdr[3] & GZ_FCOMMENT) {
+		ret = gunzip_stream_skip_string(ctx);
+		if (ret)
+			return ret;
+	}
 
-	rc = zlib_inflateInit2(strm, -MAX_WBITS);
+	if (hdr[3] & GZ_FHCRC) {
+		ret = gunzip_stream_skip(ctx, 2);
+		if (ret)
+			return ret;
+	}
 
-	if (!flush) {
-		WS(strm)->inflate_state.wsize = 0;
-		WS(strm)->inflate_state.window = NULL;
+	if (zlib_inflateInit2(&gz->strm, -MAX_WBITS) != Z_OK) {
+		ctx->error_fn("uncompression error");
+		return -EIO;
 	}
 
-	while (rc == Z_OK) {
-		if (strm->avail_in == 0) {
-			/* TODO: handle case where both pos and fill are set */
-			len = fill(zbuf, GZIP_IOBUF_SIZE);
-			if (len < 0) {
-				rc = -1;
-				error("read error");
-				break;
-			}
-			strm->next_in = zbuf;
-			strm->avail_in = len;
-		}
-		rc = zlib_inflate(strm, 0);
+	if (ctx->contiguous)
+		((struct inflate_state *)gz->strm.state)->contig = 1;
 
-		/* Write any data generated */
-		if (flush && strm->next_out > out_buf) {
-			int l = strm->next_out - out_buf;
-			if (l != flush(out_buf, l)) {
-				rc = -1;
-				error("write error");
-				break;
-			}
-			strm->next_out = out_buf;
-			strm->avail_out = out_len;
+	return 0;
+}
+
+int gunzip_stream_read(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len)
+{
+	struct gunzip_stream *gz = ctx->algo_priv;
+	struct z_stream_s *strm = &gz->strm;
+	int rc, ret;
+
+	strm->next_out = buf;
+	strm->avail_out = len;
+
+	while (strm->avail_out && !gz->end) {
+		if (!strm->avail_in) {
+			ret = gunzip_stream_refill(ctx);
+			if (ret)
+				return ret;
 		}
 
-		/* after Z_FINISH, only Z_STREAM_END is "we unpacked it all" */
+		rc = zlib_inflate(strm, 0);
 		if (rc == Z_STREAM_END) {
-			rc = 0;
-			break;
+			gz->end = 1;
 		} else if (rc != Z_OK) {
-			error("uncompression error");
-			rc = -1;
+			ctx->error_fn("uncompression error");
+			return -EIO;
 		}
 	}
 
-	zlib_inflateEnd(strm);
-	if (pos)
-		/* add + 8 to skip over trailer */
-		*pos = strm->next_in - zbuf+8;
-
-gunzip_5:
-	free(strm->workspace);
-gunzip_nomem4:
-	free(strm);
-gunzip_nomem3:
-	if (!buf)
-		free(zbuf);
-gunzip_nomem2:
-	if (flush)
-		free(out_buf);
-gunzip_nomem1:
-	return rc; /* returns Z_OK (0) if successful */
+	return len - strm->avail_out;
+}
+
+void gunzip_stream_exit(struct uncompress_ctx *ctx)
+{
+	struct gunzip_stream *gz = ctx->algo_priv;
+
+	if (!gz)
+		return;
+
+	zlib_inflateEnd(&gz->strm);
+	free(gz->strm.workspace);
+	free(gz->zbuf);
+	free(gz);
+	ctx->algo_priv = NULL;
 }
 
-#define decompress gunzip
+/*
+ * inflate stops in front of the trailer with the crc32 and the size of the
+ * data, which is part of the gzip stream as well
+ */
+int gunzip_stream_unused(struct uncompress_ctx *ctx)
+{
+	struct gunzip_stream *gz = ctx->algo_priv;
+
+	return (int)gz->strm.avail_in - 8;
+}
@@ -0,0 +1,596 @@
+/*
+ * LZ4 decompressor for barebox, handles the lz4 frame format and the
+ * legacy format used for compressed Linux kernels.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/types.h>
+#include <lz4.h>
+#include <errno.h>
+#include <xfuncs.h>
+#include <uncompress.h>
+#include <linux/xxhash.h>
+
+#include <asm/unaligned.h>
+
+#define LZ4_FRAME_MAGIC		0x184d2204
+#define LZ4_LEGACY_MAGIC	0x184c2102
+
+/* skippable frames carry user data, 0x184d2a50 - 0x184d2a5f */
+#define LZ4_SKIPPABLE_MAGIC	0x184d2a50
+#define LZ4_SKIPPABLE_MASK	0xfffffff0
+
+/* frame descriptor flags */
+#define LZ4_FLG_VERSION_MASK	0xc0
+#define LZ4_FLG_VERSION		0x40
+#define LZ4_FLG_INDEPENDENT	0x20
+#define LZ4_FLG_BLOCK_CSUM	0x10
+#define LZ4_FLG_CONTENT_SIZE	0x08
+#define LZ4_FLG_CONTENT_CSUM	0x04
+#define LZ4_FLG_DICT_ID		0x01
+
+#define LZ4_BLOCK_UNCOMPRESSED	0x80000000
+
+/* linked blocks may reference this much data of the previous blocks */
+#define LZ4_HISTORY_SIZE	(64 * 1024)
+
+/* the legacy format uses independent blocks of 8MiB */
+#define LZ4_LEGACY_BLOCK_SIZE	(8 * 1024 * 1024)
+
+/* blocks that do not fit into the caller's buffer are decompressed in pieces */
+#define LZ4_WINDOW_SIZE		(256 * 1024)
+
+struct unlz4_stream {
+	int legacy;
+	int linked;
+	int block_csum;
+	int content_csum;
+	size_t block_size;
+
+	/* xxh32 of the frame's output so far */
+	struct xxh32_state xxh;
+
+	u8 *in_buf;
+	size_t in_size;
+
+	/* the block being decompressed */
+	int in_block;
+	int stored;
+	size_t stored_pos, stored_len;
+	struct lz4_dec dec;
+	size_t block_out;
+
+	/* output so far, earlier output of contiguous reads is still there */
+	unsigned long total_out;
+	/* output of the current frame, matches do not reach further back */
+	unsigned long frame_out;
+
+	/*
+	 * The window the blocks are decompressed to unless they go to the
+	 * caller's buffer directly. The data is preceded by up to
+	 * LZ4_HISTORY_SIZE bytes of history.
+	 */
+	u8 *out_buf;
+	size_t history;
+	size_t out_pos, out_len;
+
+	int end;
+};
+
+static int unlz4_get_le32(struct uncompress_ctx *ctx, u32 *val)
+{
+	u8 buf[4];
+	int ret;
+
+	ret = uncompress_fill(ctx, buf, sizeof(buf));
+	if (ret < 0)
+		return ret;
+	if (ret && ret < sizeof(buf)) {
+		ctx->error_fn("file corrupted");
+		return -EIO;
+	}
+
+	*val = get_unaligned_le32(buf);
+
+	return ret;
+}
+
+static int unlz4_skip(struct uncompress_ctx *ctx, unsigned int len)
+{
+	u8 buf[64];
+	int ret, now;
+
+	while (len) {
+		now = min_t(unsigned int, len, sizeof(buf));
+		ret = uncompress_fill(ctx, buf, now);
+		if (ret < 0)
+			return ret;
+		if (ret < now) {
+			ctx->error_fn("file corrupted");
+			return -EIO;
+		}
+		len -= now;
+	}
+
+	return 0;
+}
+
+/* the input buffer grows to the largest compressed block seen */
+static int unlz4_in_buf(struct uncompress_ctx *ctx, size_t size)
+{
+	struct unlz4_stream *lz = ctx->algo_priv;
+
+	if (size <= lz->in_size)
+		return 0;
+
+	free(lz->in_buf);
+	lz->in_buf = malloc(size);
+	if (!lz->in_buf) {
+		lz->in_size = 0;
+		ctx->error_fn("Out of memory while allocating input buffer");
+		return -ENOMEM;
+	}
+	lz->in_size = size;
+
+	return 0;
+}
+
+static int unlz4_frame_init(struct uncompress_ctx *ctx)
+{
+	struct unlz4_stream *lz = ctx->algo_priv;
+	u8 desc[11];
+	int ret, id, len;
+
+	ret = uncompress_fill(ctx, desc, 2);
+	if (ret < 0)
+		return ret;
+	if (ret < 2) {
+		ctx->error_fn("file corrupted");
+		return -EIO;
+	}
+
+	if ((desc[0] & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION) {
+		ctx->error_fn("unsupported lz4 version");
+		return -EINVAL;
+	}
+
+	if (desc[0] & LZ4_FLG_DICT_ID) {
+		ctx->error_fn("lz4 dictionaries are not supported");
+		return -EINVAL;
+	}
+
+	/* block maximum size, 4: 64KiB, 5: 256KiB, 6: 1MiB, 7: 4MiB */
+	id = (desc[1] >> 4) & 0x7;
+	if (id < 4) {
+		ctx->error_fn("invalid lz4 block size");
+		return -EINVAL;
+	}
+
+	/* the content size is not needed, the header checksum follows it */
+	len = desc[0] & LZ4_FLG_CONTENT_SIZE ? 11 : 3;
+	ret = uncompress_fill(ctx, desc + 2, len - 2);
+	if (ret < 0)
+		return ret;
+	if (ret < len - 2) {
+		ctx->error_fn("file corrupted");
+		return -EIO;
+	}
+
+	if (desc[len - 1] != ((xxh32(desc, len - 1, 0) >> 8) & 0xff)) {
+		ctx->error_fn("lz4 frame header checksum error");
+		return -EIO;
+	}
+
+	lz->legacy = 0;
+	lz->block_size = 1 << (8 + 2 * id);
+	lz->linked = !(desc[0] & LZ4_FLG_INDEPENDENT);
+	lz->block_csum = desc[0] & LZ4_FLG_BLOCK_CSUM;
+	lz->content_csum = desc[0] & LZ4_FLG_CONTENT_CSUM;
+
+	lz->frame_out = 0;
+
+	if (lz->content_csum)
+		xxh32_reset(&lz->xxh, 0);
+
+	return 0;
+}
+
+/*
+ * Set up the stream starting with magic. Skippable frames are passed
+ * over. Returns 1 if a frame or legacy stream starts, 0 if magic starts
+ * something else.
+ */
+static int unlz4_start_stream(struct uncompress_ctx *ctx, u32 magic)
+{
+	struct unlz4_stream *lz = ctx->algo_priv;
+	u32 len;
+	int ret;
+
+	while ((magic & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC) {
+		ret = unlz4_get_le32(ctx, &len);
+		if (ret <= 0)
+			return ret ? ret : -EIO;
+
+		ret = unlz4_skip(ctx, len);
+		if (ret)
+			return ret;
+
+		ret = unlz4_get_le32(ctx, &magic);
+		if (ret <= 0)
+			return ret;
+	}
+
+	if (magic == LZ4_FRAME_MAGIC) {
+		ret = unlz4_frame_init(ctx);
+		return ret ? ret : 1;
+	}
+
+	if (magic == LZ4_LEGACY_MAGIC) {
+		lz->legacy = 1;
+		lz->linked = 0;
+		lz->block_csum = 0;
+		lz->content_csum = 0;
+		lz->block_size = LZ4_LEGACY_BLOCK_SIZE;
+		return 1;
+	}
+
+	return 0;
+}
+
+int unlz4_stream_init(struct uncompress_ctx *ctx)
+{
+	struct unlz4_stream *lz;
+	u32 magic;
+	int ret;
+
+	lz = xzalloc(sizeof(*lz));
+	ctx->algo_priv = lz;
+
+	ret = unlz4_get_le32(ctx, &magic);
+	if (ret < 0)
+		return ret;
+
+	if (ret) {
+		ret = unlz4_start_stream(ctx, magic);
+		if (ret)
+			return ret < 0 ? ret : 0;
+	}
+
+	ctx->error_fn("Not a lz4 file");
+
+	return -EINVAL;
+}
+
+/*
+ * Another frame or legacy stream may follow the end of a frame. Data that
+ * does not start with a lz4 magic is ignored. Returns 1 if a new stream
+ * starts.
+ */
+static int unlz4_next_stream(struct uncompress_ctx *ctx)
+{
+	u32 magic;
+	int ret;
+
+	ret = unlz4_get_le32(ctx, &magic);
+	if (ret <= 0)
+		return ret;
+
+	return unlz4_start_stream(ctx, magic);
+}
+
+/*
+ * Read the next block of a frame. Returns the size of the compressed data
+ * in in_buf with LZ4_BLOCK_UNCOMPRESSED set for stored blocks, 0 at the
+ * end of the input. The return value is 1 if the frame ended and a new
+ * stream started.
+ */
+static int unlz4_read_frame_block(struct uncompress_ctx *ctx, u32 *size)
+{
+	struct unlz4_stream *lz = ctx->algo_priv;
+	u32 len, csum;
+	int ret;
+
+	ret = unlz4_get_le32(ctx, size);
+	if (ret < 0)
+		return ret;
+	if (!ret) {
+		ctx->error_fn("Compressed file ends unexpectedly");
+		return -EIO;
+	}
+
+	if (!*size) {
+		if (lz->content_csum) {
+			ret = unlz4_get_le32(ctx, &csum);
+			if (ret < 0)
+				return ret;
+			if (!ret || csum != xxh32_digest(&lz->xxh)) {
+				ctx->error_fn("lz4 content checksum error");
+				return -EIO;
+			}
+		}
+
+		return unlz4_next_stream(ctx);
+	}
+
+	len = *size & ~LZ4_BLOCK_UNCOMPRESSED;
+	if (len > lz->block_size) {
+		ctx->error_fn("block size too big");
+		return -EIO;
+	}
+
+	ret = unlz4_in_buf(ctx, len);
+	if (ret)
+		return ret;
+
+	ret = uncompress_fill(ctx, lz->in_buf, len);
+	if (ret < 0)
+		return ret;
+	if (ret < len) {
+		ctx->error_fn("file corrupted");
+		return -EIO;
+	}
+
+	if (lz->block_csum) {
+		ret = unlz4_get_le32(ctx, &csum);
+		if (ret < 0)
+			return ret;
+		if (!ret || csum != xxh32(lz->in_buf, len, 0)) {
+			ctx->error_fn("lz4 block checksum error");
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Read the next block in legacy format. The legacy format has no end
+ * marker, the data just ends. Concatenated streams repeat the magic, a
+ * frame may follow as well.
+ */
+static int unlz4_read_legacy_block(struct uncompress_ctx *ctx, u32 *size)
+{
+	struct unlz4_stream *lz = ctx->algo_priv;
+	size_t bound = lz4_compressbound(LZ4_LEGACY_BLOCK_SIZE);
+	int ret;
+
+	do {
+		ret = unlz4_get_le32(ctx, size);
+		if (ret <= 0) {
+			*size = 0;
+			return ret;
+		}
+	} while (*size == LZ4_LEGACY_MAGIC);
+
+	if (*size == LZ4_FRAME_MAGIC ||
+	    (*size & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC) {
+		ret = unlz4_start_stream(ctx, *size);
+		*size = 0;
+		return ret;
+	}
+
+	/*
+	 * The Linux kernel build appends the uncompressed size to the
+	 * compressed kernel, which reads like the size of a block without
+	 * data.
+	 */
+	if (*size > bound) {
+		u8 c;
+
+		ret = uncompress_fill(ctx, &c, 1);
+		if (ret <= 0) {
+			*size = 0;
+			return ret;
+		}
+
+		ctx->error_fn("block size too big");
+		return -EIO;
+	}
+
+	ret = unlz4_in_buf(ctx, *size);
+	if (ret)
+		return ret;
+
+	ret = uncompress_fill(ctx, lz->in_buf, *size);
+	if (ret <= 0) {
+		*size = 0;
+		return ret;
+	}
+
+	if (ret < *size) {
+		ctx->error_fn("file corrupted");
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int unlz4_start_block(struct uncompress_ctx *ctx)
+{
+	struct unlz4_stream *lz = ctx->algo_priv;
+	u32 size;
+	int ret;
+
+	do {
+		if (lz->legacy)
+			ret = unlz4_read_legacy_block(ctx, &size);
+		else
+			ret = unlz4_read_frame_block(ctx, &size);
+	} while (ret == 1);
+	if (ret)
+		return ret;
+
+	if (!size) {
+		lz->end = 1;
+		return 0;
+	}
+
+	lz->in_block = 1;
+	lz->block_out = 0;
+
+	if (size & LZ4_BLOCK_UNCOMPRESSED) {
+		lz->stored = 1;
+		lz->stored_pos = 0;
+		lz->stored_len = size & ~LZ4_BLOCK_UNCOMPRESSED;
+	} else {
+		lz->stored = 0;
+		lz4_decompress_start(&lz->dec, lz->in_buf, size);
+	}
+
+	return 0;
+}
+
+/*
+ * Decompress up to len bytes of the current block to dst. Matches may
+ * reference prefix bytes of earlier output in front of dst. Returns the
+ * number of bytes written.
+ */
+static int unlz4_decode(struct uncompress_ctx *ctx, u8 *dst, size_t len,
+		size_t prefix)
+{
+	struct unlz4_stream *lz = ctx->algo_priv;
+	size_t now;
+	int ret;
+
+	/* independent blocks do not reference the blocks before */
+	if (lz->linked)
+		prefix = min_t(size_t, prefix, lz->frame_out);
+	else
+		prefix = min(prefix, lz->block_out);
+
+	len = min(len, lz->block_size - lz->block_out);
+
+	if (lz->stored) {
+		now = min(len, lz->stored_len - lz->stored_pos);
+		memcpy(dst, lz->in_buf + lz->stored_pos, now);
+		lz->stored_pos += now;
+		if (lz->stored_pos == lz->stored_len)
+			lz->in_block = 0;
+	} else {
+		now = len;
+		ret = lz4_decompress_partial(&lz->dec, dst, &now, prefix);
+		if (ret < 0) {
+			ctx->error_fn("Compressed data violation");
+			return -EIO;
+		}
+		if (ret == LZ4_E_OK)
+			lz->in_block = 0;
+	}
+
+	lz->block_out += now;
+	lz->frame_out += now;
+
+	if (lz->content_csum)
+		xxh32_update(&lz->xxh, dst, now);
+
+	if (lz->in_block && lz->block_out == lz->block_size) {
+		ctx->error_fn("block size too big");
+		return -EIO;
+	}
+
+	return now;
+}
+
+/* decompress the next piece of the current block to the window */
+static int unlz4_fill_window(struct uncompress_ctx *ctx)
+{
+	struct unlz4_stream *lz = ctx->algo_priv;
+	size_t keep;
+	int ret;
+
+	if (!lz->out_buf) {
+		lz->out_buf = malloc(LZ4_HISTORY_SIZE + LZ4_WINDOW_SIZE);
+		if (!lz->out_buf) {
+			ctx->error_fn("Out of memory while allocating output buffer");
+			return -ENOMEM;
+		}
+	}
+
+	/* keep the last 64KiB of output for the matches to come */
+	keep = min(lz->history + lz->out_len, (size_t)LZ4_HISTORY_SIZE);
+	memmove(lz->out_buf + LZ4_HISTORY_SIZE - keep,
+		lz->out_buf + LZ4_HISTORY_SIZE + lz->out_len - keep, keep);
+	lz->history = keep;
+
+	ret = unlz4_decode(ctx, lz->out_buf + LZ4_HISTORY_SIZE,
+			LZ4_WINDOW_SIZE, lz->history);
+	if (ret < 0)
+		return ret;
+
+	lz->out_pos = 0;
+	lz->out_len = ret;
+
+	return 0;
+}
+
+/*
+ * Contiguous output and blocks that fit into buf are decompressed to buf
+ * directly, everything else goes through the window.
+ */
+int unlz4_stream_read(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len)
+{
+	struct unlz4_stream *lz = ctx->algo_priv;
+	unsigned int total = 0, now;
+	int ret;
+
+	while (len) {
+		if (lz->out_pos < lz->out_len) {
+			now = min(len, (unsigned int)(lz->out_len - lz->out_pos));
+			memcpy(buf, lz->out_buf + LZ4_HISTORY_SIZE + lz->out_pos,
+					now);
+			lz->out_pos += now;
+		} else if (!lz->in_block) {
+			if (lz->end)
+				break;
+
+			ret = unlz4_start_block(ctx);
+			if (ret)
+				return ret;
+			continue;
+		} else if (ctx->contiguous ||
+				(!lz->linked && !lz->block_out &&
+				 len >= lz->block_size)) {
+			ret = unlz4_decode(ctx, buf, len,
+					ctx->contiguous ? lz->total_out : 0);
+			if (ret < 0)
+				return ret;
+			now = ret;
+		} else {
+			ret = unlz4_fill_window(ctx);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		buf += now;
+		len -= now;
+		total += now;
+		lz->total_out += now;
+	}
+
+	return total;
+}
+
+void unlz4_stream_exit(struct uncompress_ctx *ctx)
+{
+	struct unlz4_stream *lz = ctx->algo_priv;
+
+	if (!lz)
+		return;
+
+	free(lz->in_buf);
+	free(lz->out_buf);
+	free(lz);
+	ctx->algo_priv = NULL;
+}
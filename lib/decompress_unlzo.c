@@ -37,6 +37,7 @@
 #include <errno.h>
 #include <fs.h>
 #include <xfuncs.h>
+#include <uncompress.h>
 
 #include <linux/compiler.h>
 #include <asm/unaligned.h>
@@ -106,181 +107,186 @@ static inline int parse_header(u8 *input, int *skip, int in_len)
 	return 1;
 }
 
-int decompress_unlzo(u8 *input, int in_len,
-				int (*fill) (void *, unsigned int),
-				int (*flush) (void *, unsigned int),
-				u8 *output, int *posp,
-				void (*error) (char *x))
+struct unlzo_stream {
+	u8 *in_buf;
+	unsigned int in_pos, in_len;
+	u8 *out_buf;
+	unsigned int out_pos, out_len;
+	int end;
+};
+
+/* make sure at least len bytes of input are available at in_buf + in_pos */
+static int unlzo_stream_need(struct uncompress_ctx *ctx, unsigned int len)
 {
-	u8 r = 0;
-	int skip = 0;
-	u32 src_len, dst_len;
-	size_t tmp;
-	u8 *in_buf, *in_buf_save, *out_buf;
-	int ret = -1;
-
-	if (output) {
-		out_buf = output;
-	} else if (!flush) {
-		error("NULL output pointer and no flush function provided");
-		goto exit;
-	} else {
-		out_buf = malloc(LZO_BLOCK_SIZE);
-		if (!out_buf) {
-			error("Could not allocate output buffer");
-			goto exit;
-		}
+	struct unlzo_stream *lz = ctx->algo_priv;
+	int ret;
+
+	if (lz->in_len >= len)
+		return 0;
+
+	memmove(lz->in_buf, lz->in_buf + lz->in_pos, lz->in_len);
+	lz->in_pos = 0;
+
+	ret = uncompress_fill(ctx, lz->in_buf + lz->in_len, len - lz->in_len);
+	if (ret < 0)
+		return ret;
+
+	lz->in_len += ret;
+	if (lz->in_len < len) {
+		ctx->error_fn("file corrupted");
+		return -EIO;
 	}
 
-	if (input && fill) {
-		error("Both input pointer and fill function provided, don't know what to do");
-		goto exit_1;
-	} else if (input) {
-		in_buf = input;
-	} else if (!fill) {
-		error("NULL input pointer and missing fill function");
-		goto exit_1;
-	} else {
-		in_buf = malloc(lzo1x_worst_compress(LZO_BLOCK_SIZE));
-		if (!in_buf) {
-			error("Could not allocate input buffer");
-			goto exit_1;
-		}
+	return 0;
+}
+
+int unlzo_stream_init(struct uncompress_ctx *ctx)
+{
+	struct unlzo_stream *lz;
+	int skip, ret;
+
+	lz = xzalloc(sizeof(*lz));
+	ctx->algo_priv = lz;
+
+	lz->in_buf = xmalloc(lzo1x_worst_compress(LZO_BLOCK_SIZE));
+	lz->out_buf = xmalloc(LZO_BLOCK_SIZE);
+
+	ret = uncompress_fill(ctx, lz->in_buf, HEADER_SIZE_MAX);
+	if (ret < 0)
+		return ret;
+
+	if (!parse_header(lz->in_buf, &skip, ret)) {
+		ctx->error_fn("invalid header");
+		return -EINVAL;
 	}
-	in_buf_save = in_buf;
-
-	if (posp)
-		*posp = 0;
-
-	if (fill) {
-		/*
-		 * Start from in_buf + HEADER_SIZE_MAX to make it possible
-		 * to use memcpy() to copy the unused data to the beginning
-		 * of the buffer. This way memmove() isn't needed which
-		 * is missing from pre-boot environments of most archs.
-		 */
-		in_buf += HEADER_SIZE_MAX;
-		in_len = fill(in_buf, HEADER_SIZE_MAX);
+
+	lz->in_pos = skip;
+	lz->in_len = ret - skip;
+
+	return 0;
+}
+
+/*
+ * Decompress the next block, directly to buf if it is large enough.
+ * Returns the number of bytes put into buf.
+ */
+static int unlzo_stream_block(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len)
+{
+	struct unlzo_stream *lz = ctx->algo_priv;
+	u32 src_len, dst_len;
+	size_t tmp;
+	u8 *in, *out;
+	int ret;
+
+	ret = unlzo_stream_need(ctx, 4);
+	if (ret)
+		return ret;
+
+	dst_len = get_unaligned_be32(lz->in_buf + lz->in_pos);
+	lz->in_pos += 4;
+	lz->in_len -= 4;
+
+	if (dst_len == 0) {
+		lz->end = 1;
+		return 0;
 	}
 
-	if (!parse_header(in_buf, &skip, in_len)) {
-		error("invalid header");
-		goto exit_2;
+	if (dst_len > LZO_BLOCK_SIZE) {
+		ctx->error_fn("dest len longer than block size");
+		return -EIO;
 	}
-	in_buf += skip;
-	in_len -= skip;
 
-	if (fill) {
-		/* Move the unused data to the beginning of the buffer. */
-		memcpy(in_buf_save, in_buf, in_len);
-		in_buf = in_buf_save;
+	/* compressed block size, skip block checksum */
+	ret = unlzo_stream_need(ctx, 8);
+	if (ret)
+		return ret;
+
+	src_len = get_unaligned_be32(lz->in_buf + lz->in_pos);
+	lz->in_pos += 8;
+	lz->in_len -= 8;
+
+	if (src_len <= 0 || src_len > dst_len) {
+		ctx->error_fn("file corrupted");
+		return -EIO;
 	}
 
-	if (posp)
-		*posp = skip;
+	ret = unlzo_stream_need(ctx, src_len);
+	if (ret)
+		return ret;
 
-	for (;;) {
-		/* read uncompressed block size */
-		if (fill && in_len < 4) {
-			skip = fill(in_buf + in_len, 4 - in_len);
-			if (skip > 0)
-				in_len += skip;
-		}
-		if (in_len < 4) {
-			error("file corrupted");
-			goto exit_2;
-		}
-		dst_len = get_unaligned_be32(in_buf);
-		in_buf += 4;
-		in_len -= 4;
-
-		/* exit if last block */
-		if (dst_len == 0) {
-			if (posp)
-				*posp += 4;
-			break;
-		}
+	in = lz->in_buf + lz->in_pos;
+	out = len >= dst_len ? buf : lz->out_buf;
 
-		if (dst_len > LZO_BLOCK_SIZE) {
-			error("dest len longer than block size");
-			goto exit_2;
+	if (dst_len == src_len) {
+		memcpy(out, in, src_len);
+	} else {
+		tmp = dst_len;
+		ret = lzo1x_decompress_safe(in, src_len, out, &tmp);
+		if (ret != LZO_E_OK || dst_len != tmp) {
+			ctx->error_fn("Compressed data violation");
+			return -EIO;
 		}
+	}
 
-		/* read compressed block size, and skip block checksum info */
-		if (fill && in_len < 8) {
-			skip = fill(in_buf + in_len, 8 - in_len);
-			if (skip > 0)
-				in_len += skip;
-		}
-		if (in_len < 8) {
-			error("file corrupted");
-			goto exit_2;
-		}
-		src_len = get_unaligned_be32(in_buf);
-		in_buf += 8;
-		in_len -= 8;
+	lz->in_pos += src_len;
+	lz->in_len -= src_len;
 
-		if (src_len <= 0 || src_len > dst_len) {
-			error("file corrupted");
-			goto exit_2;
-		}
+	if (out == buf)
+		return dst_len;
 
-		/* decompress */
-		if (fill && in_len < src_len) {
-			skip = fill(in_buf + in_len, src_len - in_len);
-			if (skip > 0)
-				in_len += skip;
-		}
-		if (in_len < src_len) {
-			error("file corrupted");
-			goto exit_2;
-		}
-		tmp = dst_len;
+	lz->out_pos = 0;
+	lz->out_len = dst_len;
 
-		/* When the input data is not compressed at all,
-		 * lzo1x_decompress_safe will fail, so call memcpy()
-		 * instead */
-		if (unlikely(dst_len == src_len))
-			memcpy(out_buf, in_buf, src_len);
-		else {
-			r = lzo1x_decompress_safe((u8 *) in_buf, src_len,
-						out_buf, &tmp);
-
-			if (r != LZO_E_OK || dst_len != tmp) {
-				error("Compressed data violation");
-				goto exit_2;
-			}
-		}
+	return 0;
+}
+
+int unlzo_stream_read(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len)
+{
+	struct unlzo_stream *lz = ctx->algo_priv;
+	unsigned int total = 0, now;
+	int ret;
 
-		if (flush && flush(out_buf, dst_len) != dst_len)
-			goto exit_2;
-		if (output)
-			out_buf += dst_len;
-		if (posp)
-			*posp += src_len + 12;
-
-		in_buf += src_len;
-		in_len -= src_len;
-		if (fill) {
-			/*
-			 * If there happens to still be unused data left in
-			 * in_buf, move it to the beginning of the buffer.
-			 * Use a loop to avoid memmove() dependency.
-			 */
-			if (in_len > 0)
-				for (skip = 0; skip < in_len; ++skip)
-					in_buf_save[skip] = in_buf[skip];
-			in_buf = in_buf_save;
+	while (len) {
+		if (lz->out_pos < lz->out_len) {
+			now = min(len, lz->out_len - lz->out_pos);
+			memcpy(buf, lz->out_buf + lz->out_pos, now);
+			lz->out_pos += now;
+		} else {
+			if (lz->end)
+				break;
+
+			ret = unlzo_stream_block(ctx, buf, len);
+			if (ret < 0)
+				return ret;
+			now = ret;
 		}
+
+		buf += now;
+		len -= now;
+		total += now;
 	}
 
-	ret = 0;
-exit_2:
-	if (!input)
-		free(in_buf_save);
-exit_1:
-	if (!output)
-		free(out_buf);
-exit:
-	return ret;
+	return total;
+}
+
+void unlzo_stream_exit(struct uncompress_ctx *ctx)
+{
+	struct unlzo_stream *lz = ctx->algo_priv;
+
+	if (!lz)
+		return;
+
+	free(lz->in_buf);
+	free(lz->out_buf);
+	free(lz);
+	ctx->algo_priv = NULL;
+}
+
+int unlzo_stream_unused(struct uncompress_ctx *ctx)
+{
+	struct unlzo_stream *lz = ctx->algo_priv;
+
+	return lz->in_len;
 }
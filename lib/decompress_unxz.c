@@ -0,0 +1,132 @@
+/*
+ * xz decompressor for barebox
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <errno.h>
+#include <xfuncs.h>
+#include <uncompress.h>
+#include <linux/xz.h>
+#include <xz.h>
+
+#define XZ_IOBUF_SIZE	(16 * 1024)
+
+struct unxz_stream {
+	struct xz_dec *xz;
+	struct xz_buf b;
+	u8 *in_buf;
+	int end;
+};
+
+int unxz_stream_init(struct uncompress_ctx *ctx)
+{
+	struct unxz_stream *xz;
+
+	xz = xzalloc(sizeof(*xz));
+	ctx->algo_priv = xz;
+
+	xz->in_buf = xmalloc(XZ_IOBUF_SIZE);
+	xz->b.in = xz->in_buf;
+
+	xz->xz = xz_dec_init(CONFIG_XZ_DEC_DICT_MAX * 1024);
+	if (!xz->xz) {
+		ctx->error_fn("XZ decompressor ran out of memory");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static const char *unxz_strerror(enum xz_ret ret)
+{
+	switch (ret) {
+	case XZ_MEM_ERROR:
+		return "XZ decompressor ran out of memory";
+	case XZ_MEMLIMIT_ERROR:
+		return "XZ data needs a larger dictionary than available";
+	case XZ_FORMAT_ERROR:
+		return "Input is not in the XZ format (wrong magic bytes)";
+	case XZ_OPTIONS_ERROR:
+		return "Input was encoded with settings that are not "
+				"supported by this XZ decoder";
+	case XZ_DATA_ERROR:
+		return "XZ-compressed data is corrupt";
+	case XZ_BUF_ERROR:
+		return "Compressed file ends unexpectedly";
+	default:
+		return "Bug in the XZ decompressor";
+	}
+}
+
+int unxz_stream_read(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len)
+{
+	struct unxz_stream *xz = ctx->algo_priv;
+	struct xz_buf *b = &xz->b;
+	enum xz_ret ret;
+	int n;
+
+	b->out = buf;
+	b->out_pos = 0;
+	b->out_size = len;
+
+	while (b->out_pos < b->out_size && !xz->end) {
+		if (b->in_pos == b->in_size) {
+			n = uncompress_fill(ctx, xz->in_buf, XZ_IOBUF_SIZE);
+			if (n < 0)
+				return n;
+			b->in_pos = 0;
+			b->in_size = n;
+		}
+
+		ret = xz_dec_run(xz->xz, b);
+
+		switch (ret) {
+		case XZ_OK:
+			break;
+		case XZ_STREAM_END:
+			xz->end = 1;
+			break;
+		case XZ_UNSUPPORTED_CHECK:
+			/* not fatal, the data is just not verified */
+			ctx->error_fn("XZ integrity check not supported, "
+					"data not verified");
+			break;
+		default:
+			ctx->error_fn((char *)unxz_strerror(ret));
+			return -EIO;
+		}
+	}
+
+	return b->out_pos;
+}
+
+void unxz_stream_exit(struct uncompress_ctx *ctx)
+{
+	struct unxz_stream *xz = ctx->algo_priv;
+
+	if (!xz)
+		return;
+
+	xz_dec_end(xz->xz);
+	free(xz->in_buf);
+	free(xz);
+	ctx->algo_priv = NULL;
+}
+
+int unxz_stream_unused(struct uncompress_ctx *ctx)
+{
+	struct unxz_stream *xz = ctx->algo_priv;
+
+	return xz->b.in_size - xz->b.in_pos;
+}
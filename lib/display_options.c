@@ -22,6 +22,7 @@
  */
 
 #include <common.h>
+#include <asm-generic/div64.h>
 
 /*
  * return a pointer to a string containing the size
@@ -58,3 +59,22 @@ char *size_human_readable(ulong size)
 	return buf;
 }
 EXPORT_SYMBOL(size_human_readable);
+
+/*
+ * print the throughput of processing bytes in ns nanoseconds as
+ * "<what> xxx.yy MiB/s"
+ */
+void print_rate(const char *what, uint64_t bytes, uint64_t ns)
+{
+	uint64_t rate = bytes * 1000000;
+	uint64_t us = ns;
+
+	do_div(us, 1000);
+	if (!us)
+		us = 1;
+	do_div(rate, us);
+
+	printf("  %-16s %6llu.%02llu MiB/s\n", what, rate >> 20,
+			((rate & 0xfffff) * 100) >> 20);
+}
+EXPORT_SYMBOL(print_rate);
@@ -0,0 +1,239 @@
+/*
+ * LZ4 block decompressor
+ *
+ * The LZ4 format was designed by Yann Collet.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A block is a sequence of (token, literals, offset, match) tuples. The
+ * high nibble of the token is the literal length, the low nibble the
+ * match length minus 4. A nibble of 15 is continued by extra bytes, each
+ * added to the length, until a byte != 255. The last sequence only has
+ * literals.
+ */
+
+#include <common.h>
+#include <linux/types.h>
+#include <lz4.h>
+
+#define LZ4_MIN_MATCH	4
+#define LZ4_RUN_MASK	15
+
+/* copies are done in units of this size where there is enough room */
+#define LZ4_COPY_SIZE	8
+
+static inline void lz4_copy8(u8 *dst, const u8 *src)
+{
+	memcpy(dst, src, LZ4_COPY_SIZE);
+}
+
+/*
+ * Copy in 8 byte units. Up to 7 bytes behind dst + len may be written and
+ * up to 7 bytes behind src + len may be read, the caller has to make sure
+ * there is room for that.
+ */
+static inline void lz4_wildcopy(u8 *dst, const u8 *src, size_t len)
+{
+	u8 *end = dst + len;
+
+	do {
+		lz4_copy8(dst, src);
+		dst += LZ4_COPY_SIZE;
+		src += LZ4_COPY_SIZE;
+	} while (dst < end);
+}
+
+static inline int lz4_read_length(const u8 **ipp, const u8 *iend,
+		size_t *length)
+{
+	const u8 *ip = *ipp;
+	unsigned int s;
+
+	do {
+		if (ip >= iend)
+			return LZ4_E_INPUT_OVERRUN;
+		s = *ip++;
+		*length += s;
+	} while (s == 255);
+
+	*ipp = ip;
+
+	return 0;
+}
+
+/*
+ * Decompress to dst until the end of the block or until *dst_len bytes are
+ * written. In the latter case the state is saved in d and the next call
+ * continues where this one stopped.
+ */
+static inline int lz4_decompress_core(struct lz4_dec *d, u8 *dst,
+		size_t *dst_len, size_t prefix_len)
+{
+	const u8 *ip = d->ip;
+	const u8 *iend = d->iend;
+	const u8 *lowest = dst - prefix_len;
+	const u8 *match;
+	u8 *op = dst;
+	u8 *oend = dst + *dst_len;
+	unsigned int token, offset, n;
+	size_t length;
+
+	/* finish the sequence the previous call stopped in */
+	if (d->lit_len) {
+		token = d->token;
+		length = d->lit_len;
+		d->lit_len = 0;
+		goto literals;
+	}
+
+	if (d->match_len) {
+		offset = d->offset;
+		length = d->match_len;
+		d->match_len = 0;
+		goto match;
+	}
+
+	while (1) {
+		if (ip >= iend)
+			return LZ4_E_INPUT_OVERRUN;
+
+		token = *ip++;
+
+		/* literals */
+		length = token >> 4;
+		if (length == LZ4_RUN_MASK &&
+				lz4_read_length(&ip, iend, &length))
+			return LZ4_E_INPUT_OVERRUN;
+
+		if (length > iend - ip)
+			return LZ4_E_INPUT_OVERRUN;
+literals:
+		if (length > oend - op) {
+			n = oend - op;
+			memcpy(op, ip, n);
+			op += n;
+			ip += n;
+			d->token = token;
+			d->lit_len = length - n;
+			goto full;
+		}
+
+		if (length + LZ4_COPY_SIZE <= iend - ip &&
+				length + LZ4_COPY_SIZE <= oend - op)
+			lz4_wildcopy(op, ip, length);
+		else
+			memcpy(op, ip, length);
+
+		op += length;
+		ip += length;
+
+		/* the last sequence ends after the literals */
+		if (ip == iend)
+			break;
+
+		/* match */
+		if (iend - ip < 2)
+			return LZ4_E_INPUT_OVERRUN;
+
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+
+		length = token & LZ4_RUN_MASK;
+		if (length == LZ4_RUN_MASK &&
+				lz4_read_length(&ip, iend, &length))
+			return LZ4_E_INPUT_OVERRUN;
+		length += LZ4_MIN_MATCH;
+match:
+		if (!offset || offset > op - lowest)
+			return LZ4_E_LOOKBEHIND_OVERRUN;
+
+		match = op - offset;
+
+		if (length > oend - op) {
+			n = oend - op;
+			d->offset = offset;
+			d->match_len = length - n;
+			while (n--)
+				*op++ = *match++;
+			goto full;
+		}
+
+		if (length + LZ4_COPY_SIZE > oend - op) {
+			while (length--)
+				*op++ = *match++;
+			continue;
+		}
+
+		if (offset < LZ4_COPY_SIZE) {
+			/*
+			 * The match overlaps the output. The data repeats
+			 * with a period of offset, so it can as well be
+			 * copied from a multiple of offset >= 8 bytes back
+			 * once that many bytes are written.
+			 */
+			n = (LZ4_COPY_SIZE + offset - 1) / offset * offset;
+			n -= offset;
+			if (n > length)
+				n = length;
+			length -= n;
+			while (n--)
+				*op++ = *match++;
+			match = op - (LZ4_COPY_SIZE + offset - 1) / offset *
+				offset;
+			if (!length)
+				continue;
+		}
+
+		lz4_wildcopy(op, match, length);
+		op += length;
+	}
+
+	*dst_len = op - dst;
+
+	return LZ4_E_OK;
+
+full:
+	d->ip = ip;
+	*dst_len = op - dst;
+
+	return LZ4_E_OUTPUT_FULL;
+}
+
+int lz4_decompress_safe(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len)
+{
+	struct lz4_dec d;
+	int ret;
+
+	lz4_decompress_start(&d, src, src_len);
+
+	ret = lz4_decompress_core(&d, dst, dst_len, 0);
+	if (ret == LZ4_E_OUTPUT_FULL)
+		return LZ4_E_OUTPUT_OVERRUN;
+
+	return ret;
+}
+EXPORT_SYMBOL(lz4_decompress_safe);
+
+void lz4_decompress_start(struct lz4_dec *d, const unsigned char *src,
+			size_t src_len)
+{
+	memset(d, 0, sizeof(*d));
+	d->ip = src;
+	d->iend = src + src_len;
+}
+EXPORT_SYMBOL(lz4_decompress_start);
+
+int lz4_decompress_partial(struct lz4_dec *d, unsigned char *dst,
+			size_t *dst_len, size_t prefix_len)
+{
+	return lz4_decompress_core(d, dst, dst_len, prefix_len);
+}
+EXPORT_SYMBOL(lz4_decompress_partial);
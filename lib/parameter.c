@@ -142,15 +142,12 @@ static const char *param_get_generic(struct device_d *dev, struct param_d *p)
 	return p->value ? p->value : "";
 }
 
-static struct param_d *__dev_add_param(struct device_d *dev, const char *name,
+static struct param_d *__dev_add_param(struct device_d *dev,
+		struct param_d *param, const char *name,
 		int (*set)(struct device_d *dev, struct param_d *p, const char *val),
 		const char *(*get)(struct device_d *dev, struct param_d *p),
 		unsigned long flags)
 {
-	struct param_d *param;
-
-	param = xzalloc(sizeof(*param));
-
 	if (set)
 		param->set = set;
 	else
@@ -191,7 +188,8 @@ int dev_add_param(struct device_d *dev, const char *name,
 	if (param)
 		return -EEXIST;
 
-	param = __dev_add_param(dev, name, set, get, flags);
+	param = __dev_add_param(dev, xzalloc(sizeof(*param)), name, set, get,
+			flags);
 
 	return param ? 0 : -EINVAL;
 }
@@ -206,7 +204,8 @@ int dev_add_param_fixed(struct device_d *dev, char *name, char *value)
 {
 	struct param_d *param;
 
-	param = __dev_add_param(dev, name, NULL, NULL, PARAM_FLAG_RO);
+	param = __dev_add_param(dev, xzalloc(sizeof(*param)), name, NULL, NULL,
+			PARAM_FLAG_RO);
 	if (!param)
 		return -EINVAL;
 
@@ -215,6 +214,71 @@ int dev_add_param_fixed(struct device_d *dev, char *name, char *value)
 	return 0;
 }
 
+struct param_u64 {
+	struct param_d param;
+	uint64_t *value;
+};
+
+static inline struct param_u64 *to_param_u64(struct param_d *p)
+{
+	return container_of(p, struct param_u64, param);
+}
+
+static int param_u64_set(struct device_d *dev, struct param_d *p,
+		const char *val)
+{
+	struct param_u64 *pu = to_param_u64(p);
+	uint64_t new;
+
+	if (!val)
+		return dev_param_set_generic(dev, p, NULL);
+
+	new = simple_strtoull(val, NULL, 0);
+	if ((p->flags & PARAM_FLAG_CLEAR) && new)
+		return -EINVAL;
+
+	*pu->value = new;
+
+	return 0;
+}
+
+static const char *param_u64_get(struct device_d *dev, struct param_d *p)
+{
+	struct param_u64 *pu = to_param_u64(p);
+
+	free(p->value);
+	p->value = asprintf("%llu", *pu->value);
+
+	return p->value;
+}
+
+/**
+ * dev_add_param_u64 - add a parameter backed by a 64 bit variable
+ * @param dev	The device
+ * @param name	The name of the parameter
+ * @param value	The variable, it must live as long as the parameter
+ * @param flags	PARAM_FLAG_RO or PARAM_FLAG_CLEAR
+ *
+ * The parameter shows the current value of the variable and writes
+ * to it go directly to the variable.
+ */
+int dev_add_param_u64(struct device_d *dev, const char *name, uint64_t *value,
+		unsigned long flags)
+{
+	struct param_u64 *pu;
+
+	if (get_param_by_name(dev, name))
+		return -EEXIST;
+
+	pu = xzalloc(sizeof(*pu));
+	pu->value = value;
+
+	__dev_add_param(dev, &pu->param, name, param_u64_set, param_u64_get,
+			flags);
+
+	return 0;
+}
+
 /**
  * dev_remove_parameters - remove all parameters from a device and free their
  * memory
@@ -24,44 +24,249 @@
 #include <bunzip2.h>
 #include <gunzip.h>
 #include <lzo.h>
+#include <lz4.h>
+#include <xz.h>
 #include <errno.h>
 #include <filetype.h>
 #include <malloc.h>
 #include <fs.h>
-
-static void *uncompress_buf;
-static unsigned int uncompress_size;
+#include <libbb.h>
 
 void uncompress_err_stdout(char *x)
 {
 	printf("%s\n", x);
 }
 
-static int (*uncompress_fill_fn)(void*, unsigned int);
+static const struct uncompress_algo uncompress_algos[] = {
+#ifdef CONFIG_BZLIB
+	{
+		.filetype = filetype_bzip2,
+		.init = bunzip2_stream_init,
+		.read = bunzip2_stream_read,
+		.exit = bunzip2_stream_exit,
+		.unused = bunzip2_stream_unused,
+	},
+#endif
+#ifdef CONFIG_ZLIB
+	{
+		.filetype = filetype_gzip,
+		.init = gunzip_stream_init,
+		.read = gunzip_stream_read,
+		.exit = gunzip_stream_exit,
+		.unused = gunzip_stream_unused,
+	},
+#endif
+#ifdef CONFIG_LZO_DECOMPRESS
+	{
+		.filetype = filetype_lzo_compressed,
+		.init = unlzo_stream_init,
+		.read = unlzo_stream_read,
+		.exit = unlzo_stream_exit,
+		.unused = unlzo_stream_unused,
+	},
+#endif
+#ifdef CONFIG_LZ4_DECOMPRESS
+	{
+		.filetype = filetype_lz4_compressed,
+		.init = unlz4_stream_init,
+		.read = unlz4_stream_read,
+		.exit = unlz4_stream_exit,
+	},
+#endif
+#ifdef CONFIG_XZ_DECOMPRESS
+	{
+		.filetype = filetype_xz_compressed,
+		.init = unxz_stream_init,
+		.read = unxz_stream_read,
+		.exit = unxz_stream_exit,
+		.unused = unxz_stream_unused,
+	},
+#endif
+};
 
-static int uncompress_fill(void *buf, unsigned int len)
+static int uncompress_get_input(struct uncompress_ctx *ctx, void *buf,
+		unsigned int len)
 {
-	int total = 0;
+	unsigned int now;
 
-	if (uncompress_size) {
-		int now = min(len, uncompress_size);
+	if (ctx->head_pos < ctx->head_len) {
+		now = min(len, ctx->head_len - ctx->head_pos);
+		memcpy(buf, ctx->head + ctx->head_pos, now);
+		ctx->head_pos += now;
+		return now;
+	}
 
-		memcpy(buf, uncompress_buf, now);
-		uncompress_size -= now;
-		len -= now;
-		total = now;
-		buf += now;
+	if (ctx->feed_len) {
+		now = min(len, ctx->feed_len);
+		memcpy(buf, ctx->feed_buf, now);
+		ctx->feed_buf += now;
+		ctx->feed_len -= now;
+		return now;
 	}
 
-	if (len) {
-		int ret = uncompress_fill_fn(buf, len);
+	if (ctx->fill)
+		return ctx->fill(ctx->priv, buf, len);
+
+	return 0;
+}
+
+/*
+ * Get len bytes of compressed data. Less is only returned at the end of
+ * the input.
+ */
+int uncompress_fill(struct uncompress_ctx *ctx, void *buf, unsigned int len)
+{
+	int total = 0, ret;
+
+	while (len) {
+		ret = uncompress_get_input(ctx, buf, len);
 		if (ret < 0)
 			return ret;
+		if (!ret)
+			break;
+		buf += ret;
+		len -= ret;
 		total += ret;
 	}
 
+	ctx->consumed += total;
+
 	return total;
 }
+EXPORT_SYMBOL(uncompress_fill);
+
+struct uncompress_ctx *uncompress_open(
+		int (*fill)(void *priv, void *buf, unsigned int len),
+		void *priv, void (*error_fn)(char *x))
+{
+	struct uncompress_ctx *ctx;
+
+	ctx = xzalloc(sizeof(*ctx));
+	ctx->fill = fill;
+	ctx->priv = priv;
+	ctx->error_fn = error_fn ? error_fn : uncompress_err_stdout;
+
+	return ctx;
+}
+EXPORT_SYMBOL(uncompress_open);
+
+/*
+ * Pass compressed data to the context. The buffer must stay valid until
+ * it is consumed, only one buffer can be pending.
+ */
+int uncompress_feed(struct uncompress_ctx *ctx, const void *buf,
+		unsigned int len)
+{
+	if (ctx->feed_len)
+		return -EBUSY;
+
+	ctx->feed_buf = buf;
+	ctx->feed_len = len;
+
+	return 0;
+}
+EXPORT_SYMBOL(uncompress_feed);
+
+static int uncompress_start(struct uncompress_ctx *ctx)
+{
+	enum filetype ft;
+	char *err;
+	int i, ret;
+
+	ret = uncompress_fill(ctx, ctx->head, UNCOMPRESS_HEAD_SIZE);
+	if (ret < 0)
+		return ret;
+
+	/* the head is handed to the decompressor again */
+	ctx->head_len = ret;
+	ctx->consumed = 0;
+
+	ft = file_detect_type(ctx->head);
+
+	for (i = 0; i < ARRAY_SIZE(uncompress_algos); i++) {
+		if (uncompress_algos[i].filetype == ft) {
+			ctx->algo = &uncompress_algos[i];
+			break;
+		}
+	}
+
+	if (!ctx->algo) {
+		err = asprintf("cannot handle filetype %s",
+				file_type_to_string(ft));
+		ctx->error_fn(err);
+		free(err);
+		return -ENOSYS;
+	}
+
+	ret = ctx->algo->init(ctx);
+	if (ret) {
+		ctx->algo->exit(ctx);
+		ctx->algo = NULL;
+		return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Read up to len bytes of uncompressed data. Returns the number of bytes
+ * read, 0 at the end of the data or a negative error code.
+ */
+int uncompress_read(struct uncompress_ctx *ctx, void *buf, unsigned int len)
+{
+	int ret;
+
+	if (ctx->done)
+		return 0;
+
+	if (!ctx->algo) {
+		ret = uncompress_start(ctx);
+		if (ret)
+			return ret;
+	}
+
+	ret = ctx->algo->read(ctx, buf, len);
+	if (!ret)
+		ctx->done = 1;
+
+	return ret;
+}
+EXPORT_SYMBOL(uncompress_read);
+
+void uncompress_close(struct uncompress_ctx *ctx)
+{
+	if (ctx->algo)
+		ctx->algo->exit(ctx);
+
+	free(ctx);
+}
+EXPORT_SYMBOL(uncompress_close);
+
+/*
+ * The number of input bytes the decompressor used up, not counting data
+ * it has fetched beyond the end of the compressed stream.
+ */
+unsigned long uncompress_consumed(struct uncompress_ctx *ctx)
+{
+	if (ctx->algo && ctx->algo->unused)
+		return ctx->consumed - ctx->algo->unused(ctx);
+
+	return ctx->consumed;
+}
+EXPORT_SYMBOL(uncompress_consumed);
+
+struct uncompress_legacy {
+	int (*fill)(void*, unsigned int);
+};
+
+static int uncompress_legacy_fill(void *priv, void *buf, unsigned int len)
+{
+	struct uncompress_legacy *l = priv;
+
+	return l->fill(buf, len);
+}
+
+#define UNCOMPRESS_BUF_SIZE	(32 * 1024)
 
 int uncompress(unsigned char *inbuf, int len,
 	   int(*fill)(void*, unsigned int),
@@ -70,99 +275,106 @@ int uncompress(unsigned char *inbuf, int len,
 	   int *pos,
 	   void(*error_fn)(char *x))
 {
-	enum filetype ft;
-	int (*compfn)(unsigned char *inbuf, int len,
-            int(*fill)(void*, unsigned int),
-            int(*flush)(void*, unsigned int),
-            unsigned char *output,
-            int *pos,
-            void(*error)(char *x));
+	struct uncompress_legacy legacy = {
+		.fill = fill,
+	};
+	struct uncompress_ctx *ctx;
+	void *buf = NULL;
 	int ret;
-	char *err;
 
-	BUG_ON(uncompress_size);
+	if (!inbuf && !fill)
+		return -EINVAL;
 
-	if (inbuf) {
-		ft = file_detect_type(inbuf);
-		uncompress_buf = NULL;
-		uncompress_size = 0;
-	} else {
-		if (!fill)
-			return -EINVAL;
+	ctx = uncompress_open(inbuf ? NULL : uncompress_legacy_fill, &legacy,
+			error_fn);
+	if (inbuf)
+		uncompress_feed(ctx, inbuf, len);
 
-		uncompress_fill_fn = fill;
-		uncompress_buf = xzalloc(32);
-		uncompress_size = 32;
+	if (flush)
+		buf = xmalloc(UNCOMPRESS_BUF_SIZE);
+	else
+		ctx->contiguous = 1;
 
-		ret = fill(uncompress_buf, 32);
-		if (ret < 0)
-			goto err;
+	while (1) {
+		ret = uncompress_read(ctx, flush ? buf : output,
+				UNCOMPRESS_BUF_SIZE);
+		if (ret <= 0)
+			break;
 
-		ft = file_detect_type(uncompress_buf);
+		if (flush) {
+			if (flush(buf, ret) != ret) {
+				ctx->error_fn("write error");
+				ret = -EIO;
+				break;
+			}
+		} else {
+			output += ret;
+		}
 	}
 
-	switch (ft) {
-#ifdef CONFIG_BZLIB
-	case filetype_bzip2:
-		compfn = bunzip2;
-		break;
-#endif
-#ifdef CONFIG_ZLIB
-	case filetype_gzip:
-		compfn = gunzip;
-		break;
-#endif
-#ifdef CONFIG_LZO_DECOMPRESS
-	case filetype_lzo_compressed:
-		compfn = decompress_unlzo;
-		break;
-#endif
-	default:
-		err = asprintf("cannot handle filetype %s", file_type_to_string(ft));
-		error_fn(err);
-		free(err);
-		ret = -ENOSYS;
-		goto err;
-	}
+	if (pos)
+		*pos = uncompress_consumed(ctx);
 
-	ret = compfn(inbuf, len, fill ? uncompress_fill : NULL,
-			flush, output, pos, error_fn);
-err:
-	free(uncompress_buf);
+	free(buf);
+	uncompress_close(ctx);
 
 	return ret;
 }
 
-static int uncompress_infd, uncompress_outfd;
-
-static int fill_fd(void *buf, unsigned int len)
+static int uncompress_fill_fd(void *priv, void *buf, unsigned int len)
 {
-	return read(uncompress_infd, buf, len);
-}
+	int fd = (int)(long)priv;
 
-static int flush_fd(void *buf, unsigned int len)
-{
-	return write(uncompress_outfd, buf, len);
+	return read(fd, buf, len);
 }
 
 int uncompress_fd_to_fd(int infd, int outfd,
 	   void(*error_fn)(char *x))
 {
-	uncompress_infd = infd;
-	uncompress_outfd = outfd;
-
-	return uncompress(NULL, 0,
-	   fill_fd,
-	   flush_fd,
-	   NULL,
-	   NULL,
-	   error_fn);
+	struct uncompress_ctx *ctx;
+	void *buf;
+	int ret;
+
+	ctx = uncompress_open(uncompress_fill_fd, (void *)(long)infd,
+			error_fn);
+	buf = xmalloc(UNCOMPRESS_BUF_SIZE);
+
+	while (1) {
+		ret = uncompress_read(ctx, buf, UNCOMPRESS_BUF_SIZE);
+		if (ret <= 0)
+			break;
+
+		if (write_full(outfd, buf, ret) < 0) {
+			ctx->error_fn("write error");
+			ret = -EIO;
+			break;
+		}
+	}
+
+	free(buf);
+	uncompress_close(ctx);
+
+	return ret;
 }
 
 int uncompress_fd_to_buf(int infd, void *output,
 		void(*error_fn)(char *x))
 {
-	uncompress_infd = infd;
+	struct uncompress_ctx *ctx;
+	int ret;
+
+	ctx = uncompress_open(uncompress_fill_fd, (void *)(long)infd,
+			error_fn);
+	ctx->contiguous = 1;
+
+	while (1) {
+		ret = uncompress_read(ctx, output, UNCOMPRESS_BUF_SIZE);
+		if (ret <= 0)
+			break;
+		output += ret;
+	}
+
+	uncompress_close(ctx);
 
-	return uncompress(NULL, 0, fill_fd, NULL, output, NULL, error_fn);
+	return ret;
 }
@@ -0,0 +1,191 @@
+/*
+ * xxHash - extremely fast non-cryptographic hash algorithm
+ *
+ * Copyright (C) 2012-2016, Yann Collet.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * Taken from linux kernel, 32 bit variant only.
+ */
+#include <common.h>
+#include <linux/types.h>
+#include <linux/xxhash.h>
+
+#include <asm/unaligned.h>
+
+#define PRIME32_1 2654435761U
+#define PRIME32_2 2246822519U
+#define PRIME32_3 3266489917U
+#define PRIME32_4  668265263U
+#define PRIME32_5  374761393U
+
+static inline u32 xxh_rotl32(u32 x, int r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+static u32 xxh32_round(u32 seed, const u32 input)
+{
+	seed += input * PRIME32_2;
+	seed = xxh_rotl32(seed, 13);
+	seed *= PRIME32_1;
+	return seed;
+}
+
+/* mix in the remaining bytes and avalanche */
+static u32 xxh32_finalize(u32 h32, const u8 *p, const u8 *b_end)
+{
+	while (p + 4 <= b_end) {
+		h32 += get_unaligned_le32(p) * PRIME32_3;
+		h32 = xxh_rotl32(h32, 17) * PRIME32_4;
+		p += 4;
+	}
+
+	while (p < b_end) {
+		h32 += (*p) * PRIME32_5;
+		h32 = xxh_rotl32(h32, 11) * PRIME32_1;
+		p++;
+	}
+
+	h32 ^= h32 >> 15;
+	h32 *= PRIME32_2;
+	h32 ^= h32 >> 13;
+	h32 *= PRIME32_3;
+	h32 ^= h32 >> 16;
+
+	return h32;
+}
+
+u32 xxh32(const void *input, size_t len, u32 seed)
+{
+	const u8 *p = input;
+	const u8 *b_end = p + len;
+	u32 h32;
+
+	if (len >= 16) {
+		const u8 *const limit = b_end - 16;
+		u32 v1 = seed + PRIME32_1 + PRIME32_2;
+		u32 v2 = seed + PRIME32_2;
+		u32 v3 = seed + 0;
+		u32 v4 = seed - PRIME32_1;
+
+		do {
+			v1 = xxh32_round(v1, get_unaligned_le32(p));
+			p += 4;
+			v2 = xxh32_round(v2, get_unaligned_le32(p));
+			p += 4;
+			v3 = xxh32_round(v3, get_unaligned_le32(p));
+			p += 4;
+			v4 = xxh32_round(v4, get_unaligned_le32(p));
+			p += 4;
+		} while (p <= limit);
+
+		h32 = xxh_rotl32(v1, 1) + xxh_rotl32(v2, 7) +
+			xxh_rotl32(v3, 12) + xxh_rotl32(v4, 18);
+	} else {
+		h32 = seed + PRIME32_5;
+	}
+
+	h32 += (u32)len;
+
+	return xxh32_finalize(h32, p, b_end);
+}
+EXPORT_SYMBOL(xxh32);
+
+void xxh32_reset(struct xxh32_state *state, u32 seed)
+{
+	memset(state, 0, sizeof(*state));
+	state->v1 = seed + PRIME32_1 + PRIME32_2;
+	state->v2 = seed + PRIME32_2;
+	state->v3 = seed + 0;
+	state->v4 = seed - PRIME32_1;
+}
+EXPORT_SYMBOL(xxh32_reset);
+
+void xxh32_update(struct xxh32_state *state, const void *input, size_t len)
+{
+	const u8 *p = input;
+	const u8 *const b_end = p + len;
+
+	state->total_len_32 += (u32)len;
+	state->large_len |= (len >= 16) | (state->total_len_32 >= 16);
+
+	/* not enough for a full stripe, keep it for later */
+	if (state->memsize + len < 16) {
+		memcpy((u8 *)state->mem32 + state->memsize, input, len);
+		state->memsize += (u32)len;
+		return;
+	}
+
+	/* complete the stripe kept from the last call */
+	if (state->memsize) {
+		const u32 *p32 = state->mem32;
+
+		memcpy((u8 *)state->mem32 + state->memsize, input,
+			16 - state->memsize);
+
+		state->v1 = xxh32_round(state->v1, get_unaligned_le32(p32++));
+		state->v2 = xxh32_round(state->v2, get_unaligned_le32(p32++));
+		state->v3 = xxh32_round(state->v3, get_unaligned_le32(p32++));
+		state->v4 = xxh32_round(state->v4, get_unaligned_le32(p32));
+
+		p += 16 - state->memsize;
+		state->memsize = 0;
+	}
+
+	if (p <= b_end - 16) {
+		const u8 *const limit = b_end - 16;
+		u32 v1 = state->v1;
+		u32 v2 = state->v2;
+		u32 v3 = state->v3;
+		u32 v4 = state->v4;
+
+		do {
+			v1 = xxh32_round(v1, get_unaligned_le32(p));
+			p += 4;
+			v2 = xxh32_round(v2, get_unaligned_le32(p));
+			p += 4;
+			v3 = xxh32_round(v3, get_unaligned_le32(p));
+			p += 4;
+			v4 = xxh32_round(v4, get_unaligned_le32(p));
+			p += 4;
+		} while (p <= limit);
+
+		state->v1 = v1;
+		state->v2 = v2;
+		state->v3 = v3;
+		state->v4 = v4;
+	}
+
+	if (p < b_end) {
+		memcpy(state->mem32, p, (size_t)(b_end - p));
+		state->memsize = (u32)(b_end - p);
+	}
+}
+EXPORT_SYMBOL(xxh32_update);
+
+u32 xxh32_digest(const struct xxh32_state *state)
+{
+	u32 h32;
+
+	if (state->large_len) {
+		h32 = xxh_rotl32(state->v1, 1) + xxh_rotl32(state->v2, 7) +
+			xxh_rotl32(state->v3, 12) + xxh_rotl32(state->v4, 18);
+	} else {
+		/* v3 is still the seed */
+		h32 = state->v3 + PRIME32_5;
+	}
+
+	h32 += state->total_len_32;
+
+	return xxh32_finalize(h32, (const u8 *)state->mem32,
+			(const u8 *)state->mem32 + state->memsize);
+}
+EXPORT_SYMBOL(xxh32_digest);
@@ -0,0 +1,74 @@
+/*
+ * Private includes and definitions
+ *
+ * Based on XZ Embedded by Lasse Collin <lasse.collin@tukaani.org>
+ *
+ * This file has been put into the public domain.
+ * You can do whatever you want with this file.
+ */
+
+#ifndef XZ_PRIVATE_H
+#define XZ_PRIVATE_H
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/xz.h>
+#include <asm/unaligned.h>
+
+#define memeq(a, b, size) (memcmp(a, b, size) == 0)
+#define memzero(buf, size) memset(buf, 0, size)
+
+#define get_le32(p) get_unaligned_le32(p)
+
+/*
+ * The BCJ filter decoders are needed if any of them is enabled.
+ */
+#if defined(CONFIG_XZ_DEC_X86) || defined(CONFIG_XZ_DEC_ARM) || \
+		defined(CONFIG_XZ_DEC_ARMTHUMB)
+#	define XZ_DEC_BCJ
+#endif
+
+/*
+ * Allocate memory for LZMA2 decoder. The dictionary is allocated when
+ * it is needed, but not more than dict_max bytes.
+ */
+struct xz_dec_lzma2 *xz_dec_lzma2_create(uint32_t dict_max);
+
+/*
+ * Decode the LZMA2 properties (one byte) and reset the decoder. Return
+ * XZ_OK on success or XZ_OPTIONS_ERROR if the dictionary size is not
+ * supported.
+ */
+enum xz_ret xz_dec_lzma2_reset(struct xz_dec_lzma2 *s, uint8_t props);
+
+/* Decode raw LZMA2 stream from b->in to b->out. */
+enum xz_ret xz_dec_lzma2_run(struct xz_dec_lzma2 *s, struct xz_buf *b);
+
+/* Free the memory allocated for the LZMA2 decoder. */
+void xz_dec_lzma2_end(struct xz_dec_lzma2 *s);
+
+#ifdef XZ_DEC_BCJ
+/* Allocate memory for BCJ decoders. */
+struct xz_dec_bcj *xz_dec_bcj_create(void);
+
+/*
+ * Decode the Filter ID of a BCJ filter. This implementation doesn't
+ * support custom start offsets, so no decoding of Filter Properties
+ * is needed. Returns XZ_OK if the given Filter ID is supported.
+ * Otherwise XZ_OPTIONS_ERROR is returned.
+ */
+enum xz_ret xz_dec_bcj_reset(struct xz_dec_bcj *s, uint8_t id);
+
+/*
+ * Decode raw BCJ + LZMA2 stream. This must be used only if there actually
+ * is a BCJ filter in the chain. If the chain has only LZMA2, the
+ * xz_dec_lzma2_run() must be used directly.
+ */
+enum xz_ret xz_dec_bcj_run(struct xz_dec_bcj *s, struct xz_dec_lzma2 *lzma2,
+			   struct xz_buf *b);
+
+/* Free the memory allocated for the BCJ filters. */
+#define xz_dec_bcj_end(s) free(s)
+#endif
+
+#endif
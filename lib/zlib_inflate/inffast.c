@@ -7,6 +7,7 @@
 #include "inftrees.h"
 #include "inflate.h"
 #include "inffast.h"
+#include <asm/unaligned.h>
 
 #ifndef ASMINF
 
@@ -38,6 +39,53 @@ get_unaligned16(const unsigned short *p)
 	return mm.us;
 }
 
+/*
+ * Copy len bytes, a word at a time where possible. The source must either
+ * not overlap the destination or be at least a word behind it, so that
+ * every word read has been completely written before. Returns the new
+ * destination pointer.
+ */
+static inline unsigned char *
+inflate_copy(unsigned char *out, const unsigned char *from, unsigned len)
+{
+	const unsigned long wmask = sizeof(unsigned long) - 1;
+
+#ifndef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+	if (((unsigned long)out ^ (unsigned long)from) & wmask)
+		goto bytes;
+#endif
+	if (len < 2 * sizeof(unsigned long))
+		goto bytes;
+
+	while ((unsigned long)out & wmask) {
+		*out++ = *from++;
+		len--;
+	}
+
+	do {
+#ifdef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+		*(unsigned long *)out = get_unaligned((unsigned long *)from);
+#else
+		*(unsigned long *)out = *(unsigned long *)from;
+#endif
+		out += sizeof(unsigned long);
+		from += sizeof(unsigned long);
+		len -= sizeof(unsigned long);
+	} while (len >= sizeof(unsigned long));
+
+bytes:
+	while (len > 2) {
+		*out++ = *from++;
+		*out++ = *from++;
+		*out++ = *from++;
+		len -= 3;
+	}
+	while (len--)
+		*out++ = *from++;
+
+	return out;
+}
+
 #ifdef POSTINC
 #  define OFF 0
 #  define PUP(a) *(a)++
@@ -210,9 +258,7 @@ void inflate_fast(z_streamp strm, unsigned start)
                         from += wsize - op;
                         if (op < len) {         /* some from window */
                             len -= op;
-                            do {
-                                PUP(out) = PUP(from);
-                            } while (--op);
+                            out = inflate_copy(out + OFF, from + OFF, op) - OFF;
                             from = out - dist;  /* rest from output */
                         }
                     }
@@ -221,16 +267,12 @@ void inflate_fast(z_streamp strm, unsigned start)
                         op -= write;
                         if (op < len) {         /* some from end of window */
                             len -= op;
-                            do {
-                                PUP(out) = PUP(from);
-                            } while (--op);
+                            out = inflate_copy(out + OFF, from + OFF, op) - OFF;
                             from = window - OFF;
                             if (write < len) {  /* some from start of window */
                                 op = write;
                                 len -= op;
-                                do {
-                                    PUP(out) = PUP(from);
-                                } while (--op);
+                                out = inflate_copy(out + OFF, from + OFF, op) - OFF;
                                 from = out - dist;      /* rest from output */
                             }
                         }
@@ -239,12 +281,14 @@ void inflate_fast(z_streamp strm, unsigned start)
                         from += write - op;
                         if (op < len) {         /* some from window */
                             len -= op;
-                            do {
-                                PUP(out) = PUP(from);
-                            } while (--op);
+                            out = inflate_copy(out + OFF, from + OFF, op) - OFF;
                             from = out - dist;  /* rest from output */
                         }
                     }
+                    if (dist >= sizeof(unsigned long)) {
+                        out = inflate_copy(out + OFF, from + OFF, len) - OFF;
+                        len = 0;
+                    }
                     while (len > 2) {
                         PUP(out) = PUP(from);
                         PUP(out) = PUP(from);
@@ -257,6 +301,11 @@ void inflate_fast(z_streamp strm, unsigned start)
                             PUP(out) = PUP(from);
                     }
                 }
+                else if (dist >= sizeof(unsigned long)) {
+                    /* copy direct from output, a word at a time */
+                    from = out - dist;
+                    out = inflate_copy(out + OFF, from + OFF, len) - OFF;
+                }
                 else {
 		    unsigned short *sout;
 		    unsigned long loops;
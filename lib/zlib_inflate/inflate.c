@@ -82,6 +82,7 @@ int zlib_inflateInit2(z_streamp strm, int windowBits)
     }
     state->wbits = (unsigned)windowBits;
     state->window = &WS(strm)->working_window[0];
+    state->contig = 0;
 
     return zlib_inflateReset(strm);
 }
@@ -357,6 +358,15 @@ int zlib_inflate(z_streamp strm, int flush)
     state = (struct inflate_state *)strm->state;
 
     if (state->mode == TYPE) state->mode = TYPEDO;      /* skip check */
+
+    /* contiguous output: the output of the previous calls is the window */
+    if (state->contig) {
+        state->window = strm->next_out - state->wsize;
+        state->whave = state->total < state->wsize ?
+                       (unsigned)state->total : state->wsize;
+        state->write = 0;
+    }
+
     LOAD();
     in = have;
     out = left;
@@ -729,7 +739,8 @@ int zlib_inflate(z_streamp strm, int flush)
      */
   inf_leave:
     RESTORE();
-    if (state->wsize || (state->mode < CHECK && out != strm->avail_out))
+    if (!state->contig &&
+        (state->wsize || (state->mode < CHECK && out != strm->avail_out)))
         zlib_updatewindow(strm, out);
 
     in -= strm->avail_in;
@@ -85,6 +85,7 @@ struct inflate_state {
     unsigned whave;             /* valid bytes in the window */
     unsigned write;             /* window write index */
     unsigned char *window;  /* allocated sliding window, if needed */
+    int contig;                 /* true if all output goes to one buffer */
         /* bit accumulator */
     unsigned long hold;         /* input bit accumulator */
     unsigned bits;              /* number of bits in "in" */